@@ -1,9 +1,29 @@
 #!/bin/sh
 
+# everything in here builds without raylib, ImGui or SDL
+CORE_SOURCES="apu.c breakpoints.c cpu.c cpu_blocks.c cpu_idle.c cpu_instructions.c cpu_jit.c cpu_mmu.c movie.c ppu.c ppu_compose.c profiler.c rewind.c savestate.c snes.c spc.c spc_instructions.c spc_mmu.c timing.c"
+
+function build_core() {
+    mkdir -p out/core
+    for source in $CORE_SOURCES; do
+        gcc -g -c -o out/core/${source%.c}.o src/$source -Wall -Wextra -Werror -DLOG_LEVEL=2 -Wno-unused-function
+        if [ ! "$?" = "0" ]; then
+            return 1
+        fi
+    done
+    rm -f out/libsnescore.a
+    ar rcs out/libsnescore.a out/core/*.o
+}
+
+function build_batch() {
+    build_core || return 1
+    gcc -g -o out/snes-batch src/batch.c -Lout/ -lsnescore -lm -lpthread -Wall -Wextra -Werror -DLOG_LEVEL=2 -Wno-unused-function
+}
+
 function build() {
-    mkdir -p out
+    build_core || return 1
     g++ -g -c -o src/ui.o src/ui.cpp -Isrc/include/ -Wall -Wextra -Werror -Wno-unused-function -Wno-unused-parameter -Wno-write-strings
-	gcc -g -o out/snes src/*.c src/*.o -Isrc/include/ -Lsrc/lib/ -l:libraylib.a -l:libSDL2.a -lm -lrlImGui -limgui -Wall -Wextra -Werror -lstdc++ -DLOG_LEVEL=2 -Wno-unused-function
+	gcc -g -o out/snes src/main.c src/frontend.c src/*.o -Isrc/include/ -Lsrc/lib/ -Lout/ -lsnescore -l:libraylib.a -l:libSDL2.a -lm -lrlImGui -limgui -Wall -Wextra -Werror -lstdc++ -DLOG_LEVEL=2 -Wno-unused-function
 }
 
 function build_raylib() {
@@ -63,7 +83,11 @@ function build_sdl() {
 	rm -rf tmp
 }
 
-if [ "$1" = "raylib" ] ; then
+if [ "$1" = "core" ] ; then
+    build_core
+elif [ "$1" = "batch" ] ; then
+    build_batch
+elif [ "$1" = "raylib" ] ; then
     build_raylib
 elif [ "$1" = "rlimgui" ] ; then
     build_rlimgui
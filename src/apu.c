@@ -1,13 +1,10 @@
 #include "apu.h"
-#include "raylib.h"
+#include "timing.h"
 #include "types.h"
 #include <math.h>
 
-extern cpu_t cpu;
-extern spc_t spc;
-
-static void extract_sample(uint8_t brr, dsp_channel_t *chan, int16_t *out1,
-                           int16_t *out2) {
+static void extract_sample(snes_t *snes, uint8_t brr, dsp_channel_t *chan,
+                           int16_t *out1, int16_t *out2) {
     *out1 = (brr >> 4);
     if (*out1 > 7)
         *out1 -= 16;
@@ -50,7 +47,7 @@ static void extract_sample(uint8_t brr, dsp_channel_t *chan, int16_t *out1,
     chan->prev_sample = *out2;
 }
 
-void audio_cb(void *buffer, unsigned int count) {
+void audio_cb(snes_t *snes, void *buffer, unsigned int count) {
     static const uint16_t gauss_lut[512] = {
         0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
         0,    0,    0,    0,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -107,57 +104,61 @@ void audio_cb(void *buffer, unsigned int count) {
         1.f / 16000.f, 1.f / 32000.f,
     };
 
+    // runs on the audio thread, outside of any section on the stack
+    bool timed = snes->timing.enabled;
+    uint64_t start = timed ? timing_now() : 0;
     uint16_t *out = buffer;
-    static uint16_t smp_counter = 0;
-    static uint16_t noise_generator = 0x4000;
-    static float noise_generator_timer = 0;
     for (uint32_t buffer_idx = 0; buffer_idx < count; buffer_idx++) {
-        if (spc.memory.noise_freq != 0) {
-            noise_generator_timer += 1.f / SAMPLE_RATE;
-            while (noise_generator_timer >
-                   noise_generator_frequencies[spc.memory.noise_freq]) {
-                noise_generator =
-                    (noise_generator >> 1) |
-                    (((noise_generator << 14) ^ (noise_generator << 13)) &
+        if (snes->spc.memory.noise_freq != 0) {
+            snes->spc.memory.noise_generator_timer += 1.f / SAMPLE_RATE;
+            while (snes->spc.memory.noise_generator_timer >
+                   noise_generator_frequencies[snes->spc.memory.noise_freq]) {
+                snes->spc.memory.noise_generator =
+                    (snes->spc.memory.noise_generator >> 1) |
+                    (((snes->spc.memory.noise_generator << 14) ^
+                      (snes->spc.memory.noise_generator << 13)) &
                      0x4000);
-                noise_generator_timer -=
-                    noise_generator_frequencies[spc.memory.noise_freq];
+                snes->spc.memory.noise_generator_timer -=
+                    noise_generator_frequencies[snes->spc.memory.noise_freq];
             }
         }
         for (uint8_t channel_idx = 0; channel_idx < 8; channel_idx++) {
-            dsp_channel_t *chan = &spc.memory.channels[channel_idx];
+            dsp_channel_t *chan = &snes->spc.memory.channels[channel_idx];
             if (!chan->playing && !chan->key_on) {
                 continue;
             }
             if (chan->key_off) {
                 chan->key_off = false;
-                spc.memory.key_off &= ~(1 << channel_idx);
+                snes->spc.memory.key_off &= ~(1 << channel_idx);
                 chan->adsr_state = RELEASE;
                 continue;
             }
             if (chan->key_on) {
                 // channel is turned on
                 chan->key_on = false;
-                spc.memory.key_on &= ~(1 << channel_idx);
+                snes->spc.memory.key_on &= ~(1 << channel_idx);
                 chan->envelope = 0;
                 chan->adsr_state = ATTACK;
                 chan->playing = true;
                 chan->t = 0;
                 // reload pointers
-                uint16_t addr = (spc.memory.sample_source_directory_page << 8) +
-                                (chan->sample_source_directory << 2);
-                chan->sample_addr =
-                    TO_U16(spc.memory.ram[addr], spc.memory.ram[addr + 1]);
-                chan->loop_addr =
-                    TO_U16(spc.memory.ram[addr + 2], spc.memory.ram[addr + 3]);
-                chan->left_shift = spc.memory.ram[chan->sample_addr] >> 4;
-                chan->filter = (spc.memory.ram[chan->sample_addr] >> 2) & 0b11;
-                chan->loop = spc.memory.ram[chan->sample_addr] & 0b10;
-                chan->end = spc.memory.ram[chan->sample_addr++] & 0b1;
+                uint16_t addr =
+                    (snes->spc.memory.sample_source_directory_page << 8) +
+                    (chan->sample_source_directory << 2);
+                chan->sample_addr = TO_U16(snes->spc.memory.ram[addr],
+                                           snes->spc.memory.ram[addr + 1]);
+                chan->loop_addr = TO_U16(snes->spc.memory.ram[addr + 2],
+                                         snes->spc.memory.ram[addr + 3]);
+                chan->left_shift = snes->spc.memory.ram[chan->sample_addr] >> 4;
+                chan->filter =
+                    (snes->spc.memory.ram[chan->sample_addr] >> 2) & 0b11;
+                chan->loop = snes->spc.memory.ram[chan->sample_addr] & 0b10;
+                chan->end = snes->spc.memory.ram[chan->sample_addr++] & 0b1;
                 // preload first 12 sample points (of 16) from first sample
                 for (uint8_t i = 0; i < 6; i++) {
-                    extract_sample(spc.memory.ram[chan->sample_addr++], chan,
-                                   &chan->sample_buffer[i * 2],
+                    extract_sample(snes,
+                                   snes->spc.memory.ram[chan->sample_addr++],
+                                   chan, &chan->sample_buffer[i * 2],
                                    &chan->sample_buffer[i * 2 + 1]);
                 }
                 chan->remaining_values_in_block = 4;
@@ -174,7 +175,8 @@ void audio_cb(void *buffer, unsigned int count) {
             if (chan->adsr_enable) {
                 switch (chan->adsr_state) {
                 case ATTACK:
-                    if ((smp_counter + offset[(chan->a_rate * 2 + 1) % 3]) %
+                    if ((snes->spc.memory.smp_counter +
+                         offset[(chan->a_rate * 2 + 1) % 3]) %
                             period[chan->a_rate * 2 + 1] ==
                         0) {
                         chan->envelope += chan->a_rate == 0xf ? 1024 : 32;
@@ -185,7 +187,8 @@ void audio_cb(void *buffer, unsigned int count) {
                     }
                     break;
                 case DECAY:
-                    if ((smp_counter + offset[(chan->d_rate * 2 + 16) % 3]) %
+                    if ((snes->spc.memory.smp_counter +
+                         offset[(chan->d_rate * 2 + 16) % 3]) %
                             period[chan->d_rate * 2 + 16] ==
                         0) {
                         chan->envelope -= ((chan->envelope - 1) >> 8) + 1;
@@ -196,10 +199,10 @@ void audio_cb(void *buffer, unsigned int count) {
                     }
                     break;
                 case SUSTAIN:
-                    if (chan->s_rate != 0 &&
-                        (smp_counter + offset[chan->s_rate % 3]) %
-                                period[chan->s_rate] ==
-                            0) {
+                    if (chan->s_rate != 0 && (snes->spc.memory.smp_counter +
+                                              offset[chan->s_rate % 3]) %
+                                                     period[chan->s_rate] ==
+                                                 0) {
                         chan->envelope -= ((chan->envelope - 1) >> 8) + 1;
                         if (chan->envelope < 0) {
                             chan->envelope = 0;
@@ -220,10 +223,10 @@ void audio_cb(void *buffer, unsigned int count) {
                     chan->envelope = (chan->gain & 0x7f) << 4;
                 } else {
                     uint8_t gain_value = chan->gain & 0x1f;
-                    if (gain_value != 0 &&
-                        (smp_counter + offset[gain_value % 3]) %
-                                period[gain_value] ==
-                            0) {
+                    if (gain_value != 0 && (snes->spc.memory.smp_counter +
+                                            offset[gain_value % 3]) %
+                                                   period[gain_value] ==
+                                               0) {
                         switch ((chan->gain >> 5) & 0b11) {
                         case 0:
                             chan->envelope -= 32;
@@ -276,8 +279,8 @@ void audio_cb(void *buffer, unsigned int count) {
                     gauss_lut[table_idx] * chan->sample_buffer[(idx + 3) % 12];
                 result >>= 11;
 
-                if (spc.memory.use_noise & (1 << channel_idx)) {
-                    chan->output = noise_generator;
+                if (snes->spc.memory.use_noise & (1 << channel_idx)) {
+                    chan->output = snes->spc.memory.noise_generator;
                 } else {
                     chan->output = result;
                 }
@@ -294,7 +297,7 @@ void audio_cb(void *buffer, unsigned int count) {
                 // load next 4 points
                 for (uint8_t i = 0; i < 2; i++) {
                     extract_sample(
-                        spc.memory.ram[chan->sample_addr++], chan,
+                        snes, snes->spc.memory.ram[chan->sample_addr++], chan,
                         &chan->sample_buffer[chan->refill_idx + i * 2],
                         &chan->sample_buffer[chan->refill_idx + i * 2 + 1]);
                 }
@@ -314,11 +317,12 @@ void audio_cb(void *buffer, unsigned int count) {
                         chan->sample_addr = chan->loop_addr;
                     }
 
-                    chan->left_shift = spc.memory.ram[chan->sample_addr] >> 4;
+                    chan->left_shift =
+                        snes->spc.memory.ram[chan->sample_addr] >> 4;
                     chan->filter =
-                        (spc.memory.ram[chan->sample_addr] >> 2) & 0b11;
-                    chan->loop = spc.memory.ram[chan->sample_addr] & 0b10;
-                    chan->end = spc.memory.ram[chan->sample_addr++] & 0b1;
+                        (snes->spc.memory.ram[chan->sample_addr] >> 2) & 0b11;
+                    chan->loop = snes->spc.memory.ram[chan->sample_addr] & 0b10;
+                    chan->end = snes->spc.memory.ram[chan->sample_addr++] & 0b1;
                     chan->remaining_values_in_block = 16;
                 }
             }
@@ -327,38 +331,29 @@ void audio_cb(void *buffer, unsigned int count) {
         int16_t added_output_left = 0;
         int16_t added_output_right = 0;
         for (uint8_t i = 0; i < 8; i++) {
-            spc.memory.channels[i].outx = spc.memory.channels[i].output / 256;
-            spc.memory.channels[i].envx = spc.memory.channels[i].envelope / 16;
-            if (spc.memory.channels[i].playing &&
-                !spc.memory.channels[i].mute_override) {
-                added_output_left += spc.memory.channels[i].output *
-                                     (spc.memory.channels[i].vol_left / 128.f) *
-                                     (spc.memory.channels[i].envelope / 2048.f);
+            snes->spc.memory.channels[i].outx =
+                snes->spc.memory.channels[i].output / 256;
+            snes->spc.memory.channels[i].envx =
+                snes->spc.memory.channels[i].envelope / 16;
+            if (snes->spc.memory.channels[i].playing &&
+                !snes->spc.memory.channels[i].mute_override) {
+                added_output_left +=
+                    snes->spc.memory.channels[i].output *
+                    (snes->spc.memory.channels[i].vol_left / 128.f) *
+                    (snes->spc.memory.channels[i].envelope / 2048.f);
                 added_output_right +=
-                    spc.memory.channels[i].output *
-                    (spc.memory.channels[i].vol_right / 128.f) *
-                    (spc.memory.channels[i].envelope / 2048.f);
+                    snes->spc.memory.channels[i].output *
+                    (snes->spc.memory.channels[i].vol_right / 128.f) *
+                    (snes->spc.memory.channels[i].envelope / 2048.f);
             }
         }
         out[buffer_idx * 2] = added_output_left;
         out[buffer_idx * 2 + 1] = added_output_right;
-        if (smp_counter == 0)
-            smp_counter = 30720;
+        if (snes->spc.memory.smp_counter == 0)
+            snes->spc.memory.smp_counter = 30720;
         else
-            smp_counter--;
+            snes->spc.memory.smp_counter--;
     }
-}
-
-void apu_init(void) {
-    SetTraceLogLevel(LOG_ERROR);
-    InitAudioDevice();
-    spc.memory.stream = LoadAudioStream(SAMPLE_RATE, 16, 2);
-    SetAudioStreamCallback(spc.memory.stream, audio_cb);
-    PlayAudioStream(spc.memory.stream);
-}
-
-void apu_free(void) {
-    StopAudioStream(spc.memory.stream);
-    UnloadAudioStream(spc.memory.stream);
-    CloseAudioDevice();
+    if (timed)
+        timing_add_audio(snes, timing_now() - start);
 }
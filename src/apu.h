@@ -3,7 +3,6 @@
 
 #include "types.h"
 
-void apu_init(void);
-void apu_free(void);
+void audio_cb(snes_t *snes, void *buffer, unsigned int count);
 
 #endif
@@ -0,0 +1,274 @@
+#include "snes.h"
+#include "types.h"
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+// Runs many machines at once, one job per ROM (or per ROM and input script),
+// spread over a pool of threads. Every worker owns a deque of jobs, pops from
+// its own end and steals from the other end of someone else's once it runs
+// dry, so a few slow carts don't leave the remaining cores idle.
+//
+// usage: ./snes-batch <jobs.txt> [--threads N] [--frames N]
+// Each line of the job file is "<rom>.sfc [input script]", where the input
+// script holds "<frame> <buttons>" lines that set controller 1 from that frame
+// on. Blank lines and lines starting with # are skipped.
+
+typedef struct {
+    uint32_t frame;
+    uint16_t buttons;
+} input_event_t;
+
+typedef struct {
+    char *rom_path;
+    char *input_path;
+    input_event_t *inputs;
+    uint32_t inputs_size;
+
+    bool loaded;
+    uint32_t frames_done;
+    uint32_t framebuffer_hash;
+    uint32_t sram_hash;
+    double fps;
+} batch_job_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t *jobs;
+    uint32_t head, tail;
+} job_deque_t;
+
+typedef struct {
+    uint32_t idx;
+    uint32_t frames;
+    batch_job_t *jobs;
+    job_deque_t *deques;
+    uint32_t deques_size;
+} worker_t;
+
+static double get_wall_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool pop_own(job_deque_t *deque, uint32_t *job) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head != deque->tail) {
+        *job = deque->jobs[--deque->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool steal(job_deque_t *deque, uint32_t *job) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head != deque->tail) {
+        *job = deque->jobs[deque->head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool next_job(worker_t *worker, uint32_t *job) {
+    if (pop_own(&worker->deques[worker->idx], job))
+        return true;
+    // no jobs are ever added after startup, so once every deque has been seen
+    // empty there is nothing left to do
+    for (uint32_t i = 1; i < worker->deques_size; i++) {
+        uint32_t victim = (worker->idx + i) % worker->deques_size;
+        if (steal(&worker->deques[victim], job))
+            return true;
+    }
+    return false;
+}
+
+static void run_job(batch_job_t *job, uint32_t frames) {
+    snes_t *snes = snes_create();
+    job->loaded = snes != NULL && snes_load_rom_file(snes, job->rom_path);
+    if (!job->loaded) {
+        snes_destroy(snes);
+        return;
+    }
+
+    snes->cpu.state = STATE_RUNNING;
+    uint32_t input_idx = 0;
+    double start = get_wall_time();
+    while (job->frames_done < frames) {
+        while (input_idx < job->inputs_size &&
+               job->inputs[input_idx].frame <= job->frames_done) {
+            snes_set_input(snes, 0, job->inputs[input_idx++].buttons);
+        }
+        snes_run_frame(snes);
+        if (snes->cpu.state != STATE_RUNNING)
+            break;
+        job->frames_done++;
+    }
+    double elapsed = get_wall_time() - start;
+
+    job->fps = job->frames_done / MAX(elapsed, 1e-9);
+    job->framebuffer_hash =
+        super_fast_hash((const char *)snes_get_framebuffer(snes),
+                        WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+    job->sram_hash = super_fast_hash((const char *)snes->cpu.memory.sram,
+                                     snes->cpu.memory.sram_size);
+    snes_destroy(snes);
+}
+
+static void *worker_main(void *arg) {
+    worker_t *worker = arg;
+    uint32_t job;
+    while (next_job(worker, &job)) {
+        run_job(&worker->jobs[job], worker->frames);
+    }
+    return NULL;
+}
+
+static bool read_inputs(batch_job_t *job) {
+    FILE *f = fopen(job->input_path, "r");
+    if (f == NULL)
+        return false;
+    uint32_t frame;
+    unsigned int buttons;
+    uint32_t capacity = 0;
+    while (fscanf(f, "%u %x", &frame, &buttons) == 2) {
+        if (job->inputs_size == capacity) {
+            capacity = MAX(capacity * 2, 64);
+            job->inputs =
+                realloc(job->inputs, capacity * sizeof(input_event_t));
+        }
+        job->inputs[job->inputs_size++] =
+            (input_event_t){frame, (uint16_t)buttons};
+    }
+    fclose(f);
+    return true;
+}
+
+static bool read_jobs(const char *path, batch_job_t **jobs,
+                      uint32_t *jobs_size) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Could not open job file %s", path);
+        return false;
+    }
+    uint32_t capacity = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *rom_path = strtok(line, " \t\r\n");
+        if (rom_path == NULL || rom_path[0] == '#')
+            continue;
+        char *input_path = strtok(NULL, " \t\r\n");
+        if (*jobs_size == capacity) {
+            capacity = MAX(capacity * 2, 16);
+            *jobs = realloc(*jobs, capacity * sizeof(batch_job_t));
+        }
+        batch_job_t *job = &(*jobs)[(*jobs_size)++];
+        memset(job, 0, sizeof(batch_job_t));
+        job->rom_path = strdup(rom_path);
+        if (input_path != NULL) {
+            job->input_path = strdup(input_path);
+            if (!read_inputs(job)) {
+                log_message(LOG_LEVEL_WARNING, "Could not open input script %s",
+                            input_path);
+                fclose(f);
+                return false;
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: ./snes-batch <jobs.txt> [--threads N] "
+                        "[--frames N]\n");
+        return 1;
+    }
+
+    uint32_t threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t frames = 600;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Unknown parameter: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    batch_job_t *jobs = NULL;
+    uint32_t jobs_size = 0;
+    if (!read_jobs(argv[1], &jobs, &jobs_size)) {
+        fprintf(stderr, "Could not read jobs from %s\n", argv[1]);
+        return 1;
+    }
+    if (jobs_size == 0) {
+        fprintf(stderr, "No jobs in %s\n", argv[1]);
+        return 1;
+    }
+    threads = MAX(MIN(threads, jobs_size), 1);
+
+    // deal the jobs out round robin, stealing evens out the rest
+    job_deque_t *deques = calloc(threads, sizeof(job_deque_t));
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].jobs = calloc(jobs_size / threads + 1, sizeof(uint32_t));
+    }
+    for (uint32_t i = 0; i < jobs_size; i++) {
+        job_deque_t *deque = &deques[i % threads];
+        deque->jobs[deque->tail++] = i;
+    }
+
+    worker_t *workers = calloc(threads, sizeof(worker_t));
+    pthread_t *handles = calloc(threads, sizeof(pthread_t));
+    double start = get_wall_time();
+    for (uint32_t i = 0; i < threads; i++) {
+        workers[i] = (worker_t){i, frames, jobs, deques, threads};
+        if (pthread_create(&handles[i], NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Could not start worker thread %u\n", i);
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    double elapsed = get_wall_time() - start;
+
+    uint64_t total_frames = 0;
+    printf("rom\tinput\tframes\tframebuffer_hash\tsram_hash\tfps\n");
+    for (uint32_t i = 0; i < jobs_size; i++) {
+        batch_job_t *job = &jobs[i];
+        if (!job->loaded) {
+            printf("%s\t%s\tfailed to load\n", job->rom_path,
+                   job->input_path ? job->input_path : "-");
+            continue;
+        }
+        printf("%s\t%s\t%u\t0x%08x\t0x%08x\t%.2f\n", job->rom_path,
+               job->input_path ? job->input_path : "-", job->frames_done,
+               job->framebuffer_hash, job->sram_hash, job->fps);
+        total_frames += job->frames_done;
+    }
+    printf("instances: %u, threads: %u, wall time: %.3f s, total fps: %.2f\n",
+           jobs_size, threads, elapsed, total_frames / elapsed);
+
+    for (uint32_t i = 0; i < jobs_size; i++) {
+        free(jobs[i].rom_path);
+        free(jobs[i].input_path);
+        free(jobs[i].inputs);
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&deques[i].lock);
+        free(deques[i].jobs);
+    }
+    free(jobs);
+    free(deques);
+    free(workers);
+    free(handles);
+}
@@ -0,0 +1,51 @@
+#include "breakpoints.h"
+#include "types.h"
+
+// The debugger keeps its breakpoints as a list it edits freely. Checking that
+// list on every bus access made emulation slower with every breakpoint added,
+// so the core looks breakpoints up in a table of flags per address instead.
+// Only banks that hold a breakpoint get a table, and the summary in kinds
+// means accesses of a kind without any breakpoints never touch the tables.
+
+void breakpoint_index_build(breakpoint_index_t *index,
+                            const breakpoint_t *breakpoints,
+                            uint32_t breakpoints_size) {
+    index->kinds = 0;
+    bool used[ARRAYSIZE(index->banks)] = {0};
+    for (uint32_t i = 0; i < ARRAYSIZE(index->banks); i++) {
+        if (index->banks[i] != NULL)
+            memset(index->banks[i], 0, 0x10000);
+    }
+    for (uint32_t i = 0; i < breakpoints_size; i++) {
+        const breakpoint_t *breakpoint = &breakpoints[i];
+        uint8_t kinds = (breakpoint->read ? BREAKPOINT_READ : 0) |
+                        (breakpoint->write ? BREAKPOINT_WRITE : 0) |
+                        (breakpoint->execute ? BREAKPOINT_EXECUTE : 0);
+        if (!breakpoint->valid || kinds == 0)
+            continue;
+        uint8_t **bank = &index->banks[U24_HIBYTE(breakpoint->line)];
+        if (*bank == NULL) {
+            *bank = calloc(0x10000, 1);
+            if (*bank == NULL)
+                continue;
+        }
+        (*bank)[U24_LOSHORT(breakpoint->line)] |= kinds;
+        used[U24_HIBYTE(breakpoint->line)] = true;
+        index->kinds |= kinds;
+    }
+    // banks whose breakpoints were all removed are given back
+    for (uint32_t i = 0; i < ARRAYSIZE(index->banks); i++) {
+        if (!used[i]) {
+            free(index->banks[i]);
+            index->banks[i] = NULL;
+        }
+    }
+}
+
+void breakpoint_index_free(breakpoint_index_t *index) {
+    for (uint32_t i = 0; i < ARRAYSIZE(index->banks); i++) {
+        free(index->banks[i]);
+        index->banks[i] = NULL;
+    }
+    index->kinds = 0;
+}
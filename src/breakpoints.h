@@ -0,0 +1,21 @@
+#ifndef BREAKPOINTS_H_
+#define BREAKPOINTS_H_
+
+#include "types.h"
+
+// replaces the contents of index with the valid entries of breakpoints
+EXTERNC void breakpoint_index_build(breakpoint_index_t *index,
+                                    const breakpoint_t *breakpoints,
+                                    uint32_t breakpoints_size);
+EXTERNC void breakpoint_index_free(breakpoint_index_t *index);
+
+// called on every bus access, so kept inline
+static inline bool breakpoint_hit(const breakpoint_index_t *index,
+                                  uint32_t addr, breakpoint_kind_t kind) {
+    if (!(index->kinds & kind))
+        return false;
+    const uint8_t *bank = index->banks[U24_HIBYTE(addr)];
+    return bank != NULL && (bank[U24_LOSHORT(addr)] & kind);
+}
+
+#endif
@@ -5,7 +5,18 @@
 #include "cpu_instructions.h"
 #include "types.h"
 
-void cpu_reset(void);
-void cpu_execute(void);
+typedef struct {
+    // the handler with the addressing mode and flags baked in
+    void (*op)(snes_t *snes);
+    addressing_mode_t mode;
+} cpu_op_t;
+
+// indexed by cpu_flags, then by opcode, unimplemented opcodes have no op
+extern const cpu_op_t cpu_ops[CPU_FLAG_COMBINATIONS][0x100];
+extern const uint8_t cpu_cycle_counts[0x100];
+
+uint8_t cpu_flags(snes_t *snes);
+void cpu_reset(snes_t *snes);
+void cpu_execute(snes_t *snes);
 
 #endif
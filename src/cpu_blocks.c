@@ -0,0 +1,215 @@
+#include "cpu_blocks.h"
+#include "breakpoints.h"
+#include "cpu.h"
+#include "types.h"
+
+// Straight-line runs of instructions are decoded once into blocks, keyed by
+// PBR:PC and the M, X and E flags, which decide the size of immediates. Each
+// instruction carries its cost and the handler specialized for its addressing
+// mode and those flags, so the interpreter calls straight into it and reads
+// operands from the host page instead of going through the bus for every byte.
+//
+// Only ROM and WRAM are cached. Every write to a WRAM page bumps a counter for
+// that page, and blocks decoded from it are thrown away once the counter has
+// moved on, so self-modifying code and code uploaded by DMA stay correct.
+//
+// A block ends at anything that changes PBR:PC out of sequence or changes
+// the flags, so inside a block the next instruction is always the next uop.
+// Instruction lengths only decide where the next uop starts, if one is off the
+// lookup for it misses and a new block is decoded from the real PC.
+
+static bool ends_block(uint8_t opcode) {
+    switch (opcode) {
+    case 0x00: // brk
+    case 0x02: // cop
+    case 0x10: // bpl
+    case 0x20: // jsr
+    case 0x22: // jsl
+    case 0x28: // plp
+    case 0x30: // bmi
+    case 0x40: // rti
+    case 0x44: // mvp
+    case 0x4c: // jmp
+    case 0x50: // bvc
+    case 0x54: // mvn
+    case 0x5c: // jml
+    case 0x60: // rts
+    case 0x6b: // rtl
+    case 0x6c: // jmp
+    case 0x70: // bvs
+    case 0x7c: // jmp
+    case 0x80: // bra
+    case 0x82: // brl
+    case 0x90: // bcc
+    case 0xb0: // bcs
+    case 0xc2: // rep
+    case 0xcb: // wai
+    case 0xd0: // bne
+    case 0xdc: // jml
+    case 0xe2: // sep
+    case 0xf0: // beq
+    case 0xfb: // xce
+    case 0xfc: // jsr
+        return true;
+    default:
+        return false;
+    }
+}
+
+static uint8_t instruction_length(snes_t *snes, uint8_t opcode, uint8_t flags) {
+    switch (opcode) {
+    case 0x42: // wdm
+    case 0xc2: // rep
+    case 0xe2: // sep
+    case 0xd4: // pei
+        return 2;
+    case 0xf4: // pea
+        return 3;
+    case 0xa0: // ldy
+    case 0xa2: // ldx
+    case 0xc0: // cpy
+    case 0xe0: // cpx
+        if (cpu_ops[flags][opcode].mode == AM_IMM)
+            return flags & CPU_FLAG_X ? 2 : 3;
+        break;
+    }
+
+    switch (cpu_ops[flags][opcode].mode) {
+    case AM_ACC:
+    case AM_IMP:
+    case AM_STK:
+        return 1;
+    case AM_IMM:
+        return flags & CPU_FLAG_M ? 2 : 3;
+    case AM_INDX_DIR:
+    case AM_ZBKX_DIR:
+    case AM_ZBKY_DIR:
+    case AM_INDY_DIR:
+    case AM_INDY_DIR_L:
+    case AM_IND_DIR_L:
+    case AM_IND_DIR:
+    case AM_DIR:
+    case AM_PC_REL:
+    case AM_STK_REL:
+    case AM_STK_REL_INDY:
+        return 2;
+    case AM_ABS:
+    case AM_INDX:
+    case AM_ABSX:
+    case AM_ABSY:
+    case AM_IND:
+    case AM_PC_REL_L:
+    case AM_BLK:
+        return 3;
+    case AM_ABSX_L:
+    case AM_ABS_L:
+        return 4;
+    default:
+        UNREACHABLE_SWITCH(cpu_ops[flags][opcode].mode);
+    }
+}
+
+static void decode(snes_t *snes, cpu_block_t *block, uint32_t addr,
+                   uint8_t flags) {
+    cpu_mmu_t *memory = &snes->cpu.memory;
+    block->addr = addr;
+    block->flags = flags;
+    block->size = 0;
+    block->generation = &snes->block_cache->rom_generation;
+
+    const uint8_t *page = snes->read_pages[addr >> MMU_PAGE_BITS];
+    bool in_wram = page != NULL && page >= memory->ram &&
+                   page < memory->ram + sizeof(memory->ram);
+    bool in_rom = page != NULL && page >= memory->rom &&
+                  page < memory->rom + memory->rom_size;
+    if (in_wram) {
+        block->generation =
+            &snes->wram_generation[(page - memory->ram) >> MMU_PAGE_BITS];
+    }
+    block->generation_seen = *block->generation;
+    // MMIO, open bus and SRAM are left to the bus
+    if (!in_wram && !in_rom)
+        return;
+
+    // the fetch of every byte is charged here, with only the 6 clocks of
+    // its cycle in cpu_cycle_counts
+    uint8_t fetch_clocks =
+        mmu_access_clocks(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) - 6;
+    uint16_t pc = U24_LOSHORT(addr);
+    while (block->size < CPU_BLOCK_SIZE) {
+        uint16_t offset = pc & (MMU_PAGE_SIZE - 1);
+        // operands are read from the page, so even the longest instruction
+        // has to fit
+        if (offset + 4 > MMU_PAGE_SIZE)
+            break;
+        uint8_t opcode = page[offset];
+        const cpu_op_t *op = &cpu_ops[flags][opcode];
+        if (op->op == NULL)
+            break;
+        uint8_t length = instruction_length(snes, opcode, flags);
+        block->uops[block->size++] = (cpu_uop_t){
+            .addr = TO_U24(pc, U24_HIBYTE(addr)),
+            .opcode = opcode,
+            .clocks = 6 * cpu_cycle_counts[opcode] + length * fetch_clocks,
+            .op = op->op,
+            .operands = page + offset + 1,
+        };
+        if (ends_block(opcode))
+            break;
+        pc += length;
+    }
+}
+
+static bool block_valid(const cpu_block_t *block, uint32_t addr,
+                        uint8_t flags) {
+    return block->generation != NULL && block->addr == addr &&
+           block->flags == flags &&
+           *block->generation == block->generation_seen;
+}
+
+cpu_block_cache_t *cpu_blocks_create(void) {
+    return calloc(1, sizeof(cpu_block_cache_t));
+}
+
+void cpu_blocks_destroy(cpu_block_cache_t *cache) { free(cache); }
+
+void cpu_blocks_invalidate_changed(snes_t *snes, const uint8_t *ram,
+                                   bool fast_rom) {
+    if (snes->block_cache != NULL && fast_rom != snes->cpu.memory.fast_rom)
+        snes->block_cache->rom_generation++;
+    for (uint32_t i = 0; i < ARRAYSIZE(snes->wram_generation); i++) {
+        uint32_t offset = i << MMU_PAGE_BITS;
+        if (memcmp(snes->cpu.memory.ram + offset, ram + offset,
+                   MMU_PAGE_SIZE) != 0)
+            snes->wram_generation[i]++;
+    }
+}
+
+cpu_block_t *cpu_blocks_get(snes_t *snes, uint32_t addr, uint8_t flags) {
+    cpu_block_cache_t *cache = snes->block_cache;
+    cpu_block_t *block =
+        &cache->blocks[(addr ^ (addr >> 12) ^ (flags << 9)) % CPU_BLOCKS];
+    if (!block_valid(block, addr, flags))
+        decode(snes, block, addr, flags);
+    return block;
+}
+
+const cpu_uop_t *cpu_blocks_fetch(snes_t *snes) {
+    cpu_block_cache_t *cache = snes->block_cache;
+    // read breakpoints have to see instruction fetches
+    if (cache == NULL || (snes->cpu.breakpoints.kinds & BREAKPOINT_READ))
+        return NULL;
+    uint32_t addr = TO_U24(snes->cpu.pc, snes->cpu.pbr);
+    uint8_t flags = cpu_flags(snes);
+
+    cpu_block_t *block = cache->current;
+    if (block != NULL && cache->next < block->size &&
+        block->uops[cache->next].addr == addr && block->flags == flags &&
+        *block->generation == block->generation_seen)
+        return &block->uops[cache->next++];
+
+    block = cpu_blocks_get(snes, addr, flags);
+    cache->current = block;
+    cache->next = 1;
+    return block->size > 0 ? &block->uops[0] : NULL;
+}
@@ -0,0 +1,19 @@
+#ifndef CPU_BLOCKS_H_
+#define CPU_BLOCKS_H_
+
+#include "types.h"
+
+cpu_block_cache_t *cpu_blocks_create(void);
+void cpu_blocks_destroy(cpu_block_cache_t *cache);
+// drops the blocks decoded from WRAM pages that differ from ram, which is
+// about to replace WRAM, and every ROM block if the speed of ROM changes
+void cpu_blocks_invalidate_changed(snes_t *snes, const uint8_t *ram,
+                                   bool fast_rom);
+// the block starting at addr under the M, X and E flags, decoded if it wasn't
+// cached yet. Its size is 0 if the code there can't be cached
+cpu_block_t *cpu_blocks_get(snes_t *snes, uint32_t addr, uint8_t flags);
+// the decoded instruction at PBR:PC, or NULL if it has to be fetched through
+// the bus
+const cpu_uop_t *cpu_blocks_fetch(snes_t *snes);
+
+#endif
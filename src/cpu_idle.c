@@ -0,0 +1,343 @@
+#include "cpu_idle.h"
+#include "breakpoints.h"
+#include "cpu_mmu.h"
+#include "types.h"
+
+// Games spend a good part of every frame in loops like LDA $4212 / BPL, waiting
+// for vblank, the APU or the NMI handler. Such a loop only changes registers,
+// and an iteration that starts from the same registers and reads the same
+// values leaves the same registers behind.
+//
+// A short backward branch makes the watcher record one iteration of the loop:
+// the registers before and after each instruction, what it cost and every
+// value it read. Once an iteration ends where it began the loop is locked.
+// From then on an instruction is not emulated as long as it starts from the
+// recorded registers and peeking at the addresses it read gives the recorded
+// values. Its clocks are charged and the registers it left behind restored.
+// Anything else, an interrupt, a changed register or a value that moved,
+// unlocks the loop and the instruction runs normally.
+//
+// Through the dots before the next PPU event the CPU runs on its own, see
+// snes.c, and what a loop polls can only change at points known in advance:
+// - RAM and ROM only through the CPU itself, DMA it starts or HDMA, which runs
+//   at a PPU event
+// - $4210 and $4211 are only set at PPU events
+// - $4212 changes at PPU events and when the beam passes the start of hblank
+// - $2140-$2143 change when the SPC runs its next instruction
+// So at the loop head, all iterations that end before the first of these are
+// skipped at once. The rest is skipped one instruction at a time, which keeps
+// every read at the clock it would have happened at. Skipped and emulated runs
+// are identical.
+
+// instructions that only read from the bus and only change registers
+static bool side_effect_free(uint8_t opcode) {
+    switch (opcode) {
+    case 0x05: // ora
+    case 0x09: // ora
+    case 0x0d: // ora
+    case 0x0f: // ora
+    case 0x10: // bpl
+    case 0x18: // clc
+    case 0x24: // bit
+    case 0x25: // and
+    case 0x29: // and
+    case 0x2c: // bit
+    case 0x2d: // and
+    case 0x2f: // and
+    case 0x30: // bmi
+    case 0x38: // sec
+    case 0x45: // eor
+    case 0x49: // eor
+    case 0x4d: // eor
+    case 0x4f: // eor
+    case 0x50: // bvc
+    case 0x70: // bvs
+    case 0x80: // bra
+    case 0x89: // bit
+    case 0x8a: // txa
+    case 0x90: // bcc
+    case 0x98: // tya
+    case 0xa0: // ldy
+    case 0xa2: // ldx
+    case 0xa4: // ldy
+    case 0xa5: // lda
+    case 0xa6: // ldx
+    case 0xa8: // tay
+    case 0xa9: // lda
+    case 0xaa: // tax
+    case 0xac: // ldy
+    case 0xad: // lda
+    case 0xae: // ldx
+    case 0xaf: // lda
+    case 0xb0: // bcs
+    case 0xb8: // clv
+    case 0xc0: // cpy
+    case 0xc4: // cpy
+    case 0xc5: // cmp
+    case 0xc9: // cmp
+    case 0xcc: // cpy
+    case 0xcd: // cmp
+    case 0xcf: // cmp
+    case 0xd0: // bne
+    case 0xe0: // cpx
+    case 0xe4: // cpx
+    case 0xea: // nop
+    case 0xec: // cpx
+    case 0xf0: // beq
+        return true;
+    default:
+        return false;
+    }
+}
+
+static cpu_idle_regs_t get_regs(snes_t *snes) {
+    cpu_t *cpu = &snes->cpu;
+    return (cpu_idle_regs_t){
+        .pc = cpu->pc,
+        .c = cpu->c,
+        .x = cpu->x,
+        .y = cpu->y,
+        .d = cpu->d,
+        .s = cpu->s,
+        .dbr = cpu->dbr,
+        .pbr = cpu->pbr,
+        .p = cpu->p,
+        .emulation_mode = cpu->emulation_mode,
+        .n_result = cpu->n_result,
+        .z_result = cpu->z_result,
+    };
+}
+
+static void set_regs(snes_t *snes, const cpu_idle_regs_t *regs) {
+    cpu_t *cpu = &snes->cpu;
+    cpu->pc = regs->pc;
+    cpu->c = regs->c;
+    cpu->x = regs->x;
+    cpu->y = regs->y;
+    cpu->d = regs->d;
+    cpu->s = regs->s;
+    cpu->dbr = regs->dbr;
+    cpu->pbr = regs->pbr;
+    cpu->p = regs->p;
+    cpu->emulation_mode = regs->emulation_mode;
+    cpu->n_result = regs->n_result;
+    cpu->z_result = regs->z_result;
+}
+
+static bool regs_equal(const cpu_idle_regs_t *a, const cpu_idle_regs_t *b) {
+    return a->pc == b->pc && a->c == b->c && a->x == b->x && a->y == b->y &&
+           a->d == b->d && a->s == b->s && a->dbr == b->dbr &&
+           a->pbr == b->pbr && a->p == b->p &&
+           a->emulation_mode == b->emulation_mode &&
+           a->n_result == b->n_result && a->z_result == b->z_result;
+}
+
+// skipped instructions would be missing from both
+static bool can_skip(snes_t *snes) {
+    return !snes->cpu_idle.disabled && !snes->profiler.enabled &&
+           !(snes->cpu.breakpoints.kinds & BREAKPOINT_READ);
+}
+
+// the lowest CPU clocks, counted like cpu_run_t.op_clocks, an instruction
+// reading addr can start at and still see the value it sees now.
+// INT64_MAX if that value can change at any time.
+static int64_t stable_from(snes_t *snes, uint32_t addr) {
+    if (snes->read_pages[addr >> MMU_PAGE_BITS] != NULL)
+        return 1;
+    uint8_t bank = U24_HIBYTE(addr);
+    if (bank >= 0x40 && !(bank >= 0x80 && bank < 0xc0))
+        return INT64_MAX;
+    switch (U24_LOSHORT(addr)) {
+    case 0x2140:
+    case 0x2141:
+    case 0x2142:
+    case 0x2143: {
+        // the SPC runs once the dots left drop below its clocks
+        int64_t spc_dots = (snes->spc.remaining_clocks +
+                            CYCLES_PER_DOT * SPC_CLOCK_SCALE - 1) /
+                           (CYCLES_PER_DOT * SPC_CLOCK_SCALE);
+        return (spc_dots - 1) * CYCLES_PER_DOT + 1;
+    }
+    case 0x4210:
+    case 0x4211:
+        return 1;
+    case 0x4212: {
+        // the beam the CPU sees trails the end of the run by the dots left,
+        // the hblank bit is set from 279 on
+        int64_t end_x = snes->ppu.beam_x + snes->cpu_run.ppu_dots_owed;
+        return (end_x - 279) * CYCLES_PER_DOT + 1;
+    }
+    default:
+        return INT64_MAX;
+    }
+}
+
+static void add_history(snes_t *snes, const cpu_idle_op_t *op) {
+    snes->cpu.opcode_history[snes->cpu.history_idx] = op->opcode;
+    snes->cpu.pc_history[snes->cpu.history_idx] =
+        TO_U24((uint16_t)(U24_LOSHORT(op->addr) + 1), U24_HIBYTE(op->addr));
+    snes->cpu.history_idx++;
+}
+
+// at the loop head, skips the iterations that can't see a polled value change
+// and still end before the CPU's clocks run out
+static void fast_forward(snes_t *snes) {
+    cpu_idle_t *idle = &snes->cpu_idle;
+    // execute breakpoints are checked after every instruction
+    if (!snes->cpu_run.active || snes->cpu.breakpoints.kinds != 0)
+        return;
+    int64_t floor = 1;
+    int64_t clocks = 0;
+    for (uint8_t i = 0; i < idle->size; i++) {
+        const cpu_idle_op_t *op = &idle->ops[i];
+        for (uint8_t j = 0; j < op->reads; j++) {
+            uint8_t value;
+            if (!mmu_peek(snes, U24_LOSHORT(op->read_addrs[j]),
+                          U24_HIBYTE(op->read_addrs[j]), &value) ||
+                value != op->read_values[j])
+                return;
+            floor = MAX(floor, stable_from(snes, op->read_addrs[j]));
+        }
+        clocks += op->clocks;
+    }
+    if (floor == INT64_MAX)
+        return;
+
+    // every instruction of an iteration starts above the clocks it leaves
+    int64_t lowest = MAX(floor - 1, 1);
+    int64_t remaining = snes->cpu.remaining_clocks;
+    if (remaining < lowest + clocks)
+        return;
+    int64_t iterations = (remaining - lowest) / clocks;
+    snes->cpu.remaining_clocks -= iterations * clocks;
+    // the history only keeps the newest instructions
+    uint64_t skipped = iterations * idle->size;
+    uint64_t kept = MIN(skipped, ARRAYSIZE(snes->cpu.opcode_history));
+    snes->cpu.history_idx += skipped - kept;
+    for (uint64_t i = skipped - kept; i < skipped; i++) {
+        add_history(snes, &idle->ops[i % idle->size]);
+    }
+}
+
+static void start_recording(snes_t *snes, uint32_t end) {
+    cpu_idle_t *idle = &snes->cpu_idle;
+    uint32_t head = TO_U24(snes->cpu.pc, snes->cpu.pbr);
+    uint32_t page = head >> MMU_PAGE_BITS;
+    // the loop has to be plain memory and sit in one page, so that a single
+    // write counter tells whether it changed
+    if (snes->read_pages[page] == NULL || (end + 3) >> MMU_PAGE_BITS != page)
+        return;
+    idle->state = CPU_IDLE_RECORDING;
+    idle->head = head;
+    idle->end = end;
+    idle->attempts = 0;
+    idle->page = page;
+    const uint32_t *generation = snes->write_generations[page];
+    idle->generation_seen = generation != NULL ? *generation : 0;
+    idle->size = 0;
+    idle->ops[0].reads = 0;
+    idle->ops[0].before = get_regs(snes);
+}
+
+static void reject(snes_t *snes) {
+    snes->cpu_idle.state = CPU_IDLE_OFF;
+    snes->cpu_idle.rejected = snes->cpu_idle.head;
+}
+
+bool cpu_idle_skip(snes_t *snes) {
+    cpu_idle_t *idle = &snes->cpu_idle;
+    if (idle->state != CPU_IDLE_LOCKED)
+        return false;
+    const cpu_idle_op_t *op = &idle->ops[idle->next];
+    cpu_idle_regs_t regs = get_regs(snes);
+    const uint32_t *generation = snes->write_generations[idle->page];
+    if (!can_skip(snes) || !regs_equal(&regs, &op->before) ||
+        (generation != NULL && *generation != idle->generation_seen)) {
+        idle->state = CPU_IDLE_OFF;
+        return false;
+    }
+    for (uint8_t i = 0; i < op->reads; i++) {
+        uint8_t value;
+        if (!mmu_peek(snes, U24_LOSHORT(op->read_addrs[i]),
+                      U24_HIBYTE(op->read_addrs[i]), &value) ||
+            value != op->read_values[i]) {
+            idle->state = CPU_IDLE_OFF;
+            return false;
+        }
+    }
+
+    if (idle->next == 0)
+        fast_forward(snes);
+    add_history(snes, op);
+    snes->cpu.remaining_clocks -= op->clocks;
+    set_regs(snes, &op->after);
+    idle->next = (idle->next + 1) % idle->size;
+    return true;
+}
+
+void cpu_idle_watch(snes_t *snes, uint32_t addr, uint8_t opcode,
+                    uint16_t clocks) {
+    cpu_idle_t *idle = &snes->cpu_idle;
+    uint32_t pc = TO_U24(snes->cpu.pc, snes->cpu.pbr);
+    if (idle->state != CPU_IDLE_RECORDING) {
+        // a short branch back in the same bank starts a new recording
+        if (pc < addr && addr - pc <= CPU_IDLE_LOOP_BYTES &&
+            U24_HIBYTE(pc) == U24_HIBYTE(addr) && pc != idle->rejected &&
+            can_skip(snes))
+            start_recording(snes, addr);
+        return;
+    }
+
+    // an interrupt or a branch out left the loop, that says nothing about
+    // the loop itself
+    if (addr < idle->head || addr > idle->end) {
+        idle->state = CPU_IDLE_OFF;
+        return;
+    }
+    cpu_idle_op_t *op = &idle->ops[idle->size];
+    if (!side_effect_free(opcode) || op->reads > CPU_IDLE_LOOP_READS) {
+        reject(snes);
+        return;
+    }
+    op->addr = addr;
+    op->opcode = opcode;
+    op->clocks = clocks;
+    op->after = get_regs(snes);
+    idle->size++;
+
+    if (pc != idle->head) {
+        if (idle->size == CPU_IDLE_LOOP_OPS) {
+            reject(snes);
+            return;
+        }
+        idle->ops[idle->size].reads = 0;
+        idle->ops[idle->size].before = op->after;
+        return;
+    }
+    if (regs_equal(&op->after, &idle->ops[0].before)) {
+        idle->state = CPU_IDLE_LOCKED;
+        idle->next = 0;
+        return;
+    }
+    // the first iterations usually still load something, try again from
+    // where this one left the registers
+    if (++idle->attempts == 4) {
+        reject(snes);
+        return;
+    }
+    idle->size = 0;
+    idle->ops[0].reads = 0;
+    idle->ops[0].before = op->after;
+}
+
+void cpu_idle_read(snes_t *snes, uint32_t addr, uint8_t value) {
+    cpu_idle_t *idle = &snes->cpu_idle;
+    cpu_idle_op_t *op = &idle->ops[idle->size];
+    // one past the limit marks the instruction as reading too much
+    if (op->reads < CPU_IDLE_LOOP_READS) {
+        op->read_addrs[op->reads] = addr;
+        op->read_values[op->reads] = value;
+    }
+    if (op->reads <= CPU_IDLE_LOOP_READS)
+        op->reads++;
+}
@@ -0,0 +1,16 @@
+#ifndef CPU_IDLE_H_
+#define CPU_IDLE_H_
+
+#include "types.h"
+
+// runs the next instruction of a recorded idle loop without emulating it,
+// returns false if it has to be executed
+bool cpu_idle_skip(snes_t *snes);
+// called after every executed instruction, addr is the PBR:PC it started at
+// and clocks what it was charged
+void cpu_idle_watch(snes_t *snes, uint32_t addr, uint8_t opcode,
+                    uint16_t clocks);
+// bus reads of the instruction being recorded
+void cpu_idle_read(snes_t *snes, uint32_t addr, uint8_t value);
+
+#endif
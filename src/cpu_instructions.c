@@ -1,9 +1,7 @@
 #include "cpu_instructions.h"
+#include "cpu.h"
 #include "types.h"
 
-extern cpu_t cpu;
-extern spc_t spc;
-
 static const char *addressing_mode_strings[] = {
     "Absolute",
     "Absolute Indexed Indirect",
@@ -31,36 +29,303 @@ static const char *addressing_mode_strings[] = {
     "Stack Relative Indirect Indexed",
 };
 
+static inline uint16_t read_r(snes_t *snes, r_t reg, uint8_t flags) {
+    switch (reg) {
+    case R_C:
+        if (flags & CPU_FLAG_M) {
+            return U16_LOBYTE(snes->cpu.c);
+        }
+        return snes->cpu.c;
+    case R_X:
+        if (flags & CPU_FLAG_X) {
+            return U16_LOBYTE(snes->cpu.x);
+        }
+        return snes->cpu.x;
+    case R_Y:
+        if (flags & CPU_FLAG_X) {
+            return U16_LOBYTE(snes->cpu.y);
+        }
+        return snes->cpu.y;
+    case R_S:
+        if (flags & CPU_FLAG_E)
+            snes->cpu.s = TO_U16(U16_LOBYTE(snes->cpu.s), 1);
+        return snes->cpu.s;
+    case R_D:
+        return snes->cpu.d;
+        break;
+    default:
+        UNREACHABLE_SWITCH(reg);
+    }
+}
+
+static inline uint16_t read_16_dir(snes_t *snes, uint16_t addr, bool hack_flag,
+                                   bool new_instruction, uint8_t flags) {
+    if (!new_instruction && hack_flag && (flags & CPU_FLAG_E) &&
+        snes->cpu.d % 0x100 != 0) {
+        return TO_U16(read_8(snes, addr + snes->cpu.d, 0),
+                      read_8(snes,
+                             TO_U16(U16_LOBYTE(addr + snes->cpu.d + 1),
+                                    U16_HIBYTE(addr + snes->cpu.d)),
+                             0));
+    }
+    if ((flags & CPU_FLAG_E) && snes->cpu.d % 0x100 == 0) {
+        uint16_t t_lo =
+            TO_U16(U16_LOBYTE(snes->cpu.d + addr), U16_HIBYTE(snes->cpu.d));
+        uint16_t t_hi =
+            TO_U16(U16_LOBYTE(snes->cpu.d + addr + 1), U16_HIBYTE(snes->cpu.d));
+        return TO_U16(read_8(snes, t_lo, 0), read_8(snes, t_hi, 0));
+    } else {
+        return read_16(snes, addr + snes->cpu.d, 0);
+    }
+}
+
+static inline uint32_t read_24_dir(snes_t *snes, uint16_t addr) {
+    return read_24(snes, addr + snes->cpu.d, 0);
+}
+
+static inline void write_r(snes_t *snes, r_t reg, uint16_t val, uint8_t flags) {
+    switch (reg) {
+    case R_C:
+        if (flags & CPU_FLAG_M) {
+            val = U16_LOBYTE(val);
+            snes->cpu.c &= 0xff00;
+        } else {
+            snes->cpu.c &= 0;
+        }
+        snes->cpu.c |= val;
+        break;
+    case R_X:
+        if (flags & CPU_FLAG_X) {
+            val = U16_LOBYTE(val);
+            snes->cpu.x &= 0xff00;
+        } else {
+            snes->cpu.x &= 0;
+        }
+        snes->cpu.x |= val;
+        break;
+    case R_Y:
+        if (flags & CPU_FLAG_X) {
+            val = U16_LOBYTE(val);
+            snes->cpu.y &= 0xff00;
+        } else {
+            snes->cpu.y &= 0;
+        }
+        snes->cpu.y |= val;
+        break;
+    case R_S:
+        snes->cpu.s = val;
+        if (flags & CPU_FLAG_E)
+            snes->cpu.s = TO_U16(U16_LOBYTE(snes->cpu.s), 1);
+        break;
+    case R_D:
+        snes->cpu.d = val;
+        break;
+    }
+}
+
+static inline uint32_t resolve_addr(snes_t *snes, addressing_mode_t mode,
+                                    uint8_t flags) {
+    uint32_t ret;
+    switch (mode) {
+    case AM_ABS:
+        ret = TO_U24(next_16(snes), snes->cpu.dbr);
+        break;
+    case AM_INDX:
+        // only to be used with JMP instructions, must be
+        // dereferenced for the actual value
+        ret = read_16(snes, next_16(snes) + read_r(snes, R_X, flags),
+                      snes->cpu.pbr);
+        break;
+    case AM_ABSX:
+        ret = TO_U24(next_16(snes) + read_r(snes, R_X, flags), snes->cpu.dbr);
+        break;
+    case AM_ABSY:
+        ret = TO_U24(next_16(snes) + read_r(snes, R_Y, flags), snes->cpu.dbr);
+        break;
+    case AM_IND:
+        // only to be used with JMP instructions, must be
+        // dereferenced for the actual value
+        ret = next_16(snes);
+        break;
+    case AM_ABSX_L:
+        ret = next_24(snes) + read_r(snes, R_X, flags);
+        break;
+    case AM_ABS_L:
+        ret = next_24(snes);
+        break;
+    case AM_INDX_DIR:
+        ret = TO_U24(read_16_dir(snes, next_8(snes) + read_r(snes, R_X, flags),
+                                 true, false, flags),
+                     snes->cpu.dbr);
+        break;
+    case AM_ZBKX_DIR: // needs dir
+        ret = TO_U24(next_8(snes) + read_r(snes, R_X, flags), 0);
+        break;
+    case AM_ZBKY_DIR: // needs dir
+        ret = TO_U24(next_8(snes) + read_r(snes, R_Y, flags), 0);
+        break;
+    case AM_INDY_DIR:
+        ret = TO_U24(read_16_dir(snes, next_8(snes), false, false, flags),
+                     snes->cpu.dbr) +
+              read_r(snes, R_Y, flags);
+        break;
+    case AM_INDY_DIR_L:
+        ret = read_24_dir(snes, next_8(snes)) + read_r(snes, R_Y, flags);
+        break;
+    case AM_IND_DIR_L:
+        ret = read_24_dir(snes, next_8(snes));
+        break;
+    case AM_IND_DIR:
+        ret = TO_U24(read_16_dir(snes, next_8(snes), false, false, flags),
+                     snes->cpu.dbr);
+        break;
+    case AM_DIR: // needs dir
+        ret = next_8(snes);
+        break;
+    case AM_PC_REL_L:
+        ret = snes->cpu.pc + (int16_t)next_16(snes) + 2;
+        break;
+    case AM_PC_REL:
+        ret = snes->cpu.pc + (int8_t)next_8(snes) + 1;
+        break;
+    case AM_STK_REL:
+        ret = TO_U24(next_8(snes) + read_r(snes, R_S, flags), 0);
+        break;
+    case AM_STK_REL_INDY:
+        ret = TO_U24(read_16(snes, next_8(snes) + read_r(snes, R_S, flags), 0),
+                     snes->cpu.dbr) +
+              read_r(snes, R_Y, flags);
+        break;
+    default:
+        UNREACHABLE_SWITCH(mode);
+    }
+
+    return ret;
+}
+
+static inline uint16_t resolve_read16(snes_t *snes, addressing_mode_t mode,
+                                      bool respect_x, bool respect_m,
+                                      uint8_t flags) {
+    switch (mode) {
+    case AM_ABS:
+    case AM_INDX:
+    case AM_ABSX:
+    case AM_ABSY:
+    case AM_IND:
+    case AM_ABSX_L:
+    case AM_ABS_L:
+    case AM_INDX_DIR:
+    case AM_ZBKX_DIR:
+    case AM_ZBKY_DIR:
+    case AM_INDY_DIR:
+    case AM_INDY_DIR_L:
+    case AM_IND_DIR_L:
+    case AM_IND_DIR:
+    case AM_DIR:
+    case AM_PC_REL_L:
+    case AM_STK_REL:
+    case AM_STK_REL_INDY: {
+        uint32_t addr = resolve_addr(snes, mode, flags);
+        if (((flags & CPU_FLAG_X) && respect_x) ||
+            ((flags & CPU_FLAG_M) && respect_m)) {
+            if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    return read_8(snes,
+                                  TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                         U16_HIBYTE(snes->cpu.d)),
+                                  0);
+                }
+                return read_8(snes, U24_LOSHORT(addr + snes->cpu.d), 0);
+            }
+            return read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+        }
+
+        if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
+            return read_16_dir(snes, U24_LOSHORT(addr), false, false, flags);
+        }
+        return read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+    }
+    case AM_ACC:
+        return read_r(snes, R_C, flags);
+    case AM_IMM:
+        if (((flags & CPU_FLAG_X) && respect_x) ||
+            ((flags & CPU_FLAG_M) && respect_m)) {
+            return next_8(snes);
+        } else {
+            return next_16(snes);
+        }
+    default:
+        UNREACHABLE_SWITCH(mode);
+    }
+}
+
+static inline uint16_t resolve_read8(snes_t *snes, addressing_mode_t mode,
+                                     uint8_t flags) {
+    switch (mode) {
+    case AM_IMM:
+        return next_8(snes);
+    case AM_ABS:
+    case AM_ABSX:
+    case AM_ABSY:
+    case AM_ABS_L:
+    case AM_ABSX_L:
+    case AM_DIR:
+    case AM_IND_DIR:
+    case AM_ZBKX_DIR:
+    case AM_INDX_DIR:
+    case AM_INDY_DIR:
+    case AM_INDY_DIR_L:
+    case AM_STK_REL:
+    case AM_IND_DIR_L:
+    case AM_STK_REL_INDY: {
+        uint32_t addr = resolve_addr(snes, mode, flags);
+        if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                return read_8(snes,
+                              TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                     U16_HIBYTE(snes->cpu.d)),
+                              0);
+            }
+            return read_8(snes, U24_LOSHORT(snes->cpu.d + addr), 0);
+        }
+        return read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+    }
+    default:
+        UNREACHABLE_SWITCH(mode);
+    }
+}
+
 OP(sei) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_IRQOFF, true);
+    set_status_bit(snes, STATUS_IRQOFF, true);
 }
 
 OP(cli) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_IRQOFF, false);
+    set_status_bit(snes, STATUS_IRQOFF, false);
 }
 
 OP(stz) {
     LEGALADDRMODES(AM_ABS | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
 
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+        if (flags & CPU_FLAG_M) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                              U16_HIBYTE(snes->cpu.d));
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         } else {
-            addr += cpu.d;
+            addr += snes->cpu.d;
         }
     }
 
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), 0);
+    if (flags & CPU_FLAG_M) {
+        write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), 0);
     } else {
-        write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), 0);
+        write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), 0);
     }
 }
 
@@ -69,312 +334,290 @@ OP(lda) {
                    AM_ZBKX_DIR | AM_STK_REL | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
-    uint16_t val = resolve_read16(mode, false, true);
-    write_r(R_C, val);
-    set_status_bit(STATUS_ZERO, val == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (val & 0x80)
-                                        : (val & 0x8000));
+    uint16_t val = resolve_read16(snes, mode, false, true, flags);
+    write_r(snes, R_C, val, flags);
+    cpu_set_nz(snes, val, flags & CPU_FLAG_M);
 }
 
 OP(sta) {
     LEGALADDRMODES(AM_ABS | AM_ABSX | AM_ABSY | AM_ABS_L | AM_ABSX_L | AM_DIR |
                    AM_STK_REL | AM_ZBKX_DIR | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+        if (flags & CPU_FLAG_M) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                              U16_HIBYTE(snes->cpu.d));
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         } else {
-            addr += cpu.d;
+            addr += snes->cpu.d;
         }
     }
-    uint16_t val = read_r(R_C);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+    uint16_t val = read_r(snes, R_C, flags);
+    if (flags & CPU_FLAG_M) {
+        write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     } else {
-        write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+        write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     }
 }
 
 OP(stx) {
     LEGALADDRMODES(AM_ABS | AM_DIR | AM_ZBKY_DIR);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+        if (flags & CPU_FLAG_M) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                              U16_HIBYTE(snes->cpu.d));
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         } else {
-            addr += cpu.d;
+            addr += snes->cpu.d;
         }
     }
-    uint16_t val = read_r(R_X);
-    if (get_status_bit(STATUS_XNARROW)) {
-        write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+    uint16_t val = read_r(snes, R_X, flags);
+    if (flags & CPU_FLAG_X) {
+        write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     } else {
-        write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+        write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     }
 }
 
 OP(sty) {
     LEGALADDRMODES(AM_ABS | AM_DIR | AM_ZBKX_DIR);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+        if (flags & CPU_FLAG_M) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                              U16_HIBYTE(snes->cpu.d));
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         } else {
-            addr += cpu.d;
+            addr += snes->cpu.d;
         }
     }
-    uint16_t val = read_r(R_Y);
-    if (get_status_bit(STATUS_XNARROW)) {
-        write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+    uint16_t val = read_r(snes, R_Y, flags);
+    if (flags & CPU_FLAG_X) {
+        write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     } else {
-        write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+        write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     }
 }
 
 OP(clc) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_CARRY, false);
+    set_status_bit(snes, STATUS_CARRY, false);
 }
 
 OP(sed) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_BCD, true);
+    set_status_bit(snes, STATUS_BCD, true);
 }
 
 OP(cld) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_BCD, false);
+    set_status_bit(snes, STATUS_BCD, false);
 }
 
 OP(clv) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_OVERFLOW, false);
+    set_status_bit(snes, STATUS_OVERFLOW, false);
 }
 
 OP(xce) {
     LEGALADDRMODES(AM_ACC);
-    bool tmp = cpu.emulation_mode;
-    cpu.emulation_mode = get_status_bit(STATUS_CARRY);
-    if (cpu.emulation_mode) {
-        cpu.p |= 0b110000;
-        cpu.x &= 0xff;
-        cpu.y &= 0xff;
+    bool tmp = snes->cpu.emulation_mode;
+    snes->cpu.emulation_mode = get_status_bit(snes, STATUS_CARRY);
+    if (snes->cpu.emulation_mode) {
+        snes->cpu.p |= 0b110000;
+        snes->cpu.x &= 0xff;
+        snes->cpu.y &= 0xff;
     }
-    set_status_bit(STATUS_CARRY, tmp);
+    set_status_bit(snes, STATUS_CARRY, tmp);
 }
 
 OP(xba) {
     LEGALADDRMODES(AM_IMP);
     // register write functions are not used because this works despite
     // emulation flag
-    uint8_t lsb = U16_HIBYTE(cpu.c);
-    uint8_t msb = U16_LOBYTE(cpu.c);
-    cpu.c = TO_U16(lsb, msb);
-    set_status_bit(STATUS_ZERO, U16_LOBYTE(cpu.c) == 0);
-    set_status_bit(STATUS_NEGATIVE, U16_LOBYTE(cpu.c) & 0x80);
+    uint8_t lsb = U16_HIBYTE(snes->cpu.c);
+    uint8_t msb = U16_LOBYTE(snes->cpu.c);
+    snes->cpu.c = TO_U16(lsb, msb);
+    cpu_set_nz(snes, U16_LOBYTE(snes->cpu.c), true);
 }
 
 OP(rep) {
     LEGALADDRMODES(AM_IMM);
-    uint8_t val = resolve_read8(mode);
-    cpu.p &= ~val;
+    uint8_t val = resolve_read8(snes, mode, flags);
+    cpu_set_p(snes, cpu_get_p(snes) & ~val);
+    // M and X stay set in emulation mode
+    if (flags & CPU_FLAG_E)
+        snes->cpu.p |= 0b110000;
 }
 
 OP(sep) {
     LEGALADDRMODES(AM_IMM);
-    uint8_t val = resolve_read8(mode);
-    cpu.p |= val;
+    uint8_t val = resolve_read8(snes, mode, flags);
+    cpu_set_p(snes, cpu_get_p(snes) | val);
     if (val & 0x10) {
-        cpu.x &= 0xff;
-        cpu.y &= 0xff;
+        snes->cpu.x &= 0xff;
+        snes->cpu.y &= 0xff;
     }
 }
 
 OP(tcd) {
     LEGALADDRMODES(AM_IMP);
-    cpu.d = cpu.c;
-    set_status_bit(STATUS_ZERO, cpu.d == 0);
-    set_status_bit(STATUS_NEGATIVE, cpu.d & 0x8000);
+    snes->cpu.d = snes->cpu.c;
+    cpu_set_nz(snes, snes->cpu.d, false);
 }
 
 OP(tdc) {
     LEGALADDRMODES(AM_IMP);
-    cpu.c = cpu.d;
-    set_status_bit(STATUS_ZERO, cpu.c == 0);
-    set_status_bit(STATUS_NEGATIVE, cpu.c & 0x8000);
+    snes->cpu.c = snes->cpu.d;
+    cpu_set_nz(snes, snes->cpu.c, false);
 }
 
 OP(tcs) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_S, cpu.c);
+    write_r(snes, R_S, snes->cpu.c, flags);
 }
 
 OP(tsc) {
     LEGALADDRMODES(AM_IMP);
-    cpu.c = read_r(R_S);
-    set_status_bit(STATUS_ZERO, cpu.c == 0);
-    set_status_bit(STATUS_NEGATIVE, cpu.c & 0x8000);
+    snes->cpu.c = read_r(snes, R_S, flags);
+    cpu_set_nz(snes, snes->cpu.c, false);
 }
 
 OP(tsb) {
     LEGALADDRMODES(AM_ABS | AM_DIR);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+        if (flags & CPU_FLAG_M) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                              U16_HIBYTE(snes->cpu.d));
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         } else {
-            addr += cpu.d;
+            addr += snes->cpu.d;
         }
     }
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        uint8_t val = read_8(U24_LOSHORT(addr), U24_HIBYTE(addr));
-        set_status_bit(STATUS_ZERO, (val & read_r(R_C)) == 0);
-        val |= read_r(R_C);
-        write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+    if (flags & CPU_FLAG_M) {
+        uint8_t val = read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+        set_status_bit(snes, STATUS_ZERO,
+                       (val & read_r(snes, R_C, flags)) == 0);
+        val |= read_r(snes, R_C, flags);
+        write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     } else {
-        uint16_t val = read_16(U24_LOSHORT(addr), U24_HIBYTE(addr));
-        set_status_bit(STATUS_ZERO, (val & read_r(R_C)) == 0);
-        val |= read_r(R_C);
-        write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+        uint16_t val = read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+        set_status_bit(snes, STATUS_ZERO,
+                       (val & read_r(snes, R_C, flags)) == 0);
+        val |= read_r(snes, R_C, flags);
+        write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     }
 }
 
 OP(trb) {
     LEGALADDRMODES(AM_ABS | AM_DIR);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+        if (flags & CPU_FLAG_M) {
+            if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                              U16_HIBYTE(snes->cpu.d));
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         } else {
-            addr += cpu.d;
+            addr += snes->cpu.d;
         }
     }
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        uint8_t val = read_8(U24_LOSHORT(addr), U24_HIBYTE(addr));
-        set_status_bit(STATUS_ZERO, (val & read_r(R_C)) == 0);
-        val &= ~read_r(R_C);
-        write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+    if (flags & CPU_FLAG_M) {
+        uint8_t val = read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+        set_status_bit(snes, STATUS_ZERO,
+                       (val & read_r(snes, R_C, flags)) == 0);
+        val &= ~read_r(snes, R_C, flags);
+        write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     } else {
-        uint16_t val = read_16(U24_LOSHORT(addr), U24_HIBYTE(addr));
-        set_status_bit(STATUS_ZERO, (val & read_r(R_C)) == 0);
-        val &= ~read_r(R_C);
-        write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+        uint16_t val = read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+        set_status_bit(snes, STATUS_ZERO,
+                       (val & read_r(snes, R_C, flags)) == 0);
+        val &= ~read_r(snes, R_C, flags);
+        write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
     }
 }
 
 OP(ldx) {
     LEGALADDRMODES(AM_ABS | AM_ABSY | AM_DIR | AM_ZBKY_DIR | AM_IMM);
-    uint16_t val = resolve_read16(mode, true, false);
-    write_r(R_X, val);
-    set_status_bit(STATUS_ZERO, val == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (val & 0x80)
-                                        : (val & 0x8000));
+    uint16_t val = resolve_read16(snes, mode, true, false, flags);
+    write_r(snes, R_X, val, flags);
+    cpu_set_nz(snes, val, flags & CPU_FLAG_X);
 }
 
 OP(ldy) {
     LEGALADDRMODES(AM_ABS | AM_ABSX | AM_DIR | AM_ZBKX_DIR | AM_IMM);
-    uint16_t val = resolve_read16(mode, true, false);
-    write_r(R_Y, val);
-    set_status_bit(STATUS_ZERO, val == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (val & 0x80)
-                                        : (val & 0x8000));
+    uint16_t val = resolve_read16(snes, mode, true, false, flags);
+    write_r(snes, R_Y, val, flags);
+    cpu_set_nz(snes, val, flags & CPU_FLAG_X);
 }
 
 OP(tya) {
     LEGALADDRMODES(AM_ACC);
-    write_r(R_C, cpu.y);
-    set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (read_r(R_C) & 0x80)
-                                        : (read_r(R_C) & 0x8000));
+    write_r(snes, R_C, snes->cpu.y, flags);
+    cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
 }
 
 OP(tax) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_X, cpu.c);
-    set_status_bit(STATUS_ZERO, read_r(R_X) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_X) & 0x80)
-                                        : (read_r(R_X) & 0x8000));
+    write_r(snes, R_X, snes->cpu.c, flags);
+    cpu_set_nz(snes, read_r(snes, R_X, flags), flags & CPU_FLAG_X);
 }
 
 OP(txa) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_C, cpu.x);
-    set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (read_r(R_C) & 0x80)
-                                        : (read_r(R_C) & 0x8000));
+    write_r(snes, R_C, snes->cpu.x, flags);
+    cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
 }
 
 OP(tay) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_Y, cpu.c);
-    set_status_bit(STATUS_ZERO, read_r(R_Y) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_Y) & 0x80)
-                                        : (read_r(R_Y) & 0x8000));
+    write_r(snes, R_Y, snes->cpu.c, flags);
+    cpu_set_nz(snes, read_r(snes, R_Y, flags), flags & CPU_FLAG_X);
 }
 
 OP(txy) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_Y, cpu.x);
-    set_status_bit(STATUS_ZERO, read_r(R_Y) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_Y) & 0x80)
-                                        : (read_r(R_Y) & 0x8000));
+    write_r(snes, R_Y, snes->cpu.x, flags);
+    cpu_set_nz(snes, read_r(snes, R_Y, flags), flags & CPU_FLAG_X);
 }
 
 OP(tyx) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_X, cpu.y);
-    set_status_bit(STATUS_ZERO, read_r(R_X) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_X) & 0x80)
-                                        : (read_r(R_X) & 0x8000));
+    write_r(snes, R_X, snes->cpu.y, flags);
+    cpu_set_nz(snes, read_r(snes, R_X, flags), flags & CPU_FLAG_X);
 }
 
 OP(txs) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_S, read_r(R_X));
+    write_r(snes, R_S, read_r(snes, R_X, flags), flags);
 }
 
 OP(tsx) {
     LEGALADDRMODES(AM_IMP);
-    write_r(R_X, read_r(R_S));
-    set_status_bit(STATUS_ZERO, read_r(R_X) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_X) & 0x80)
-                                        : (read_r(R_X) & 0x8000));
+    write_r(snes, R_X, read_r(snes, R_S, flags), flags);
+    cpu_set_nz(snes, read_r(snes, R_X, flags), flags & CPU_FLAG_X);
 }
 
 OP(sec) {
     LEGALADDRMODES(AM_IMP);
-    set_status_bit(STATUS_CARRY, true);
+    set_status_bit(snes, STATUS_CARRY, true);
 }
 
 OP(adc) {
@@ -383,66 +626,67 @@ OP(adc) {
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
 
-    uint16_t tmp = resolve_read16(mode, false, true);
+    uint16_t tmp = resolve_read16(snes, mode, false, true, flags);
 
-    if (get_status_bit(STATUS_MEMNARROW)) {
+    if (flags & CPU_FLAG_M) {
         uint8_t data = tmp;
         uint16_t result;
-        if (!get_status_bit(STATUS_BCD)) {
-            result = U16_LOBYTE(cpu.c) + data + get_status_bit(STATUS_CARRY);
+        if (!get_status_bit(snes, STATUS_BCD)) {
+            result = U16_LOBYTE(snes->cpu.c) + data +
+                     get_status_bit(snes, STATUS_CARRY);
         } else {
-            result = (U16_LOBYTE(cpu.c) & 0xf) + (data & 0xf) +
-                     (get_status_bit(STATUS_CARRY) << 0);
+            result = (U16_LOBYTE(snes->cpu.c) & 0xf) + (data & 0xf) +
+                     (get_status_bit(snes, STATUS_CARRY) << 0);
             if (result > 0x9)
                 result += 0x6;
-            set_status_bit(STATUS_CARRY, result > 0xf);
-            result = (U16_LOBYTE(cpu.c) & 0xf0) + (data & 0xf0) +
-                     (get_status_bit(STATUS_CARRY) << 4) + (result & 0xf);
+            set_status_bit(snes, STATUS_CARRY, result > 0xf);
+            result = (U16_LOBYTE(snes->cpu.c) & 0xf0) + (data & 0xf0) +
+                     (get_status_bit(snes, STATUS_CARRY) << 4) + (result & 0xf);
         }
 
-        set_status_bit(STATUS_OVERFLOW, ~(U16_LOBYTE(cpu.c) ^ data) &
-                                            (U16_LOBYTE(cpu.c) ^ result) &
-                                            0x80);
-        if (get_status_bit(STATUS_BCD) && result > 0x9f)
+        set_status_bit(snes, STATUS_OVERFLOW,
+                       ~(U16_LOBYTE(snes->cpu.c) ^ data) &
+                           (U16_LOBYTE(snes->cpu.c) ^ result) & 0x80);
+        if (get_status_bit(snes, STATUS_BCD) && result > 0x9f)
             result += 0x60;
-        set_status_bit(STATUS_CARRY, result > 0xff);
-        set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-        set_status_bit(STATUS_NEGATIVE, result & 0x80);
-        write_r(R_C, result);
+        set_status_bit(snes, STATUS_CARRY, result > 0xff);
+        cpu_set_nz(snes, result, true);
+        write_r(snes, R_C, result, flags);
     } else {
         uint16_t data = tmp;
         uint32_t result;
 
-        if (!get_status_bit(STATUS_BCD)) {
-            result = cpu.c + data + get_status_bit(STATUS_CARRY);
+        if (!get_status_bit(snes, STATUS_BCD)) {
+            result = snes->cpu.c + data + get_status_bit(snes, STATUS_CARRY);
         } else {
-            result =
-                (cpu.c & 0xf) + (data & 0xf) + get_status_bit(STATUS_CARRY);
+            result = (snes->cpu.c & 0xf) + (data & 0xf) +
+                     get_status_bit(snes, STATUS_CARRY);
             if (result > 0x9)
                 result += 0x6;
-            set_status_bit(STATUS_CARRY, result > 0xf);
-            result = (cpu.c & 0xf0) + (data & 0xf0) +
-                     (get_status_bit(STATUS_CARRY) << 4) + (result & 0xf);
+            set_status_bit(snes, STATUS_CARRY, result > 0xf);
+            result = (snes->cpu.c & 0xf0) + (data & 0xf0) +
+                     (get_status_bit(snes, STATUS_CARRY) << 4) + (result & 0xf);
             if (result > 0x9f)
                 result += 0x60;
-            set_status_bit(STATUS_CARRY, result > 0xff);
-            result = (cpu.c & 0xf00) + (data & 0xf00) +
-                     (get_status_bit(STATUS_CARRY) << 8) + (result & 0xff);
+            set_status_bit(snes, STATUS_CARRY, result > 0xff);
+            result = (snes->cpu.c & 0xf00) + (data & 0xf00) +
+                     (get_status_bit(snes, STATUS_CARRY) << 8) +
+                     (result & 0xff);
             if (result > 0x9ff)
                 result += 0x600;
-            set_status_bit(STATUS_CARRY, result > 0xfff);
-            result = (cpu.c & 0xf000) + (data & 0xf000) +
-                     (get_status_bit(STATUS_CARRY) << 12) + (result & 0xfff);
+            set_status_bit(snes, STATUS_CARRY, result > 0xfff);
+            result = (snes->cpu.c & 0xf000) + (data & 0xf000) +
+                     (get_status_bit(snes, STATUS_CARRY) << 12) +
+                     (result & 0xfff);
         }
 
-        set_status_bit(STATUS_OVERFLOW,
-                       ~(cpu.c ^ data) & (cpu.c ^ result) & 0x8000);
-        if (get_status_bit(STATUS_BCD) && result > 0x9fff)
+        set_status_bit(snes, STATUS_OVERFLOW,
+                       ~(snes->cpu.c ^ data) & (snes->cpu.c ^ result) & 0x8000);
+        if (get_status_bit(snes, STATUS_BCD) && result > 0x9fff)
             result += 0x6000;
-        set_status_bit(STATUS_CARRY, result > 0xffff);
-        set_status_bit(STATUS_ZERO, (result & 0xffff) == 0);
-        set_status_bit(STATUS_NEGATIVE, result & 0x8000);
-        write_r(R_C, result);
+        set_status_bit(snes, STATUS_CARRY, result > 0xffff);
+        cpu_set_nz(snes, result, false);
+        write_r(snes, R_C, result, flags);
     }
 }
 
@@ -452,68 +696,69 @@ OP(sbc) {
                    AM_STK_REL | AM_ZBKX_DIR | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
-    uint16_t tmp = resolve_read16(mode, false, true);
+    uint16_t tmp = resolve_read16(snes, mode, false, true, flags);
 
-    if (get_status_bit(STATUS_MEMNARROW)) {
+    if (flags & CPU_FLAG_M) {
         uint8_t data = tmp;
         data = ~data;
         uint16_t result;
-        if (!get_status_bit(STATUS_BCD)) {
-            result = U16_LOBYTE(cpu.c) + data + get_status_bit(STATUS_CARRY);
+        if (!get_status_bit(snes, STATUS_BCD)) {
+            result = U16_LOBYTE(snes->cpu.c) + data +
+                     get_status_bit(snes, STATUS_CARRY);
         } else {
-            result = (U16_LOBYTE(cpu.c) & 0xf) + (data & 0xf) +
-                     (get_status_bit(STATUS_CARRY) << 0);
+            result = (U16_LOBYTE(snes->cpu.c) & 0xf) + (data & 0xf) +
+                     (get_status_bit(snes, STATUS_CARRY) << 0);
             if (result < 0x10)
                 result -= 0x6;
-            set_status_bit(STATUS_CARRY, result > 0xf);
-            result = (U16_LOBYTE(cpu.c) & 0xf0) + (data & 0xf0) +
-                     (get_status_bit(STATUS_CARRY) << 4) + (result & 0xf);
+            set_status_bit(snes, STATUS_CARRY, result > 0xf);
+            result = (U16_LOBYTE(snes->cpu.c) & 0xf0) + (data & 0xf0) +
+                     (get_status_bit(snes, STATUS_CARRY) << 4) + (result & 0xf);
         }
 
-        set_status_bit(STATUS_OVERFLOW, ~(U16_LOBYTE(cpu.c) ^ data) &
-                                            (U16_LOBYTE(cpu.c) ^ result) &
-                                            0x80);
-        if (get_status_bit(STATUS_BCD) && result < 0x100)
+        set_status_bit(snes, STATUS_OVERFLOW,
+                       ~(U16_LOBYTE(snes->cpu.c) ^ data) &
+                           (U16_LOBYTE(snes->cpu.c) ^ result) & 0x80);
+        if (get_status_bit(snes, STATUS_BCD) && result < 0x100)
             result -= 0x60;
-        set_status_bit(STATUS_CARRY, result > 0xff);
-        set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-        set_status_bit(STATUS_NEGATIVE, result & 0x80);
-        write_r(R_C, result);
+        set_status_bit(snes, STATUS_CARRY, result > 0xff);
+        cpu_set_nz(snes, result, true);
+        write_r(snes, R_C, result, flags);
     } else {
         uint16_t data = tmp;
         data = ~data;
         int32_t result;
 
-        if (!get_status_bit(STATUS_BCD)) {
-            result = cpu.c + data + get_status_bit(STATUS_CARRY);
+        if (!get_status_bit(snes, STATUS_BCD)) {
+            result = snes->cpu.c + data + get_status_bit(snes, STATUS_CARRY);
         } else {
-            result =
-                (cpu.c & 0xf) + (data & 0xf) + get_status_bit(STATUS_CARRY);
+            result = (snes->cpu.c & 0xf) + (data & 0xf) +
+                     get_status_bit(snes, STATUS_CARRY);
             if (result < 0x10)
                 result -= 0x6;
-            set_status_bit(STATUS_CARRY, result > 0xf);
-            result = (cpu.c & 0xf0) + (data & 0xf0) +
-                     (get_status_bit(STATUS_CARRY) << 4) + (result & 0xf);
+            set_status_bit(snes, STATUS_CARRY, result > 0xf);
+            result = (snes->cpu.c & 0xf0) + (data & 0xf0) +
+                     (get_status_bit(snes, STATUS_CARRY) << 4) + (result & 0xf);
             if (result < 0x100)
                 result -= 0x60;
-            set_status_bit(STATUS_CARRY, result > 0xff);
-            result = (cpu.c & 0xf00) + (data & 0xf00) +
-                     (get_status_bit(STATUS_CARRY) << 8) + (result & 0xff);
+            set_status_bit(snes, STATUS_CARRY, result > 0xff);
+            result = (snes->cpu.c & 0xf00) + (data & 0xf00) +
+                     (get_status_bit(snes, STATUS_CARRY) << 8) +
+                     (result & 0xff);
             if (result < 0x1000)
                 result -= 0x600;
-            set_status_bit(STATUS_CARRY, result > 0xfff);
-            result = (cpu.c & 0xf000) + (data & 0xf000) +
-                     (get_status_bit(STATUS_CARRY) << 12) + (result & 0xfff);
+            set_status_bit(snes, STATUS_CARRY, result > 0xfff);
+            result = (snes->cpu.c & 0xf000) + (data & 0xf000) +
+                     (get_status_bit(snes, STATUS_CARRY) << 12) +
+                     (result & 0xfff);
         }
 
-        set_status_bit(STATUS_OVERFLOW,
-                       ~(cpu.c ^ data) & (cpu.c ^ result) & 0x8000);
-        if (get_status_bit(STATUS_BCD) && result < 0x10000)
+        set_status_bit(snes, STATUS_OVERFLOW,
+                       ~(snes->cpu.c ^ data) & (snes->cpu.c ^ result) & 0x8000);
+        if (get_status_bit(snes, STATUS_BCD) && result < 0x10000)
             result -= 0x6000;
-        set_status_bit(STATUS_CARRY, result > 0xffff);
-        set_status_bit(STATUS_ZERO, (result & 0xffff) == 0);
-        set_status_bit(STATUS_NEGATIVE, result & 0x8000);
-        write_r(R_C, result);
+        set_status_bit(snes, STATUS_CARRY, result > 0xffff);
+        cpu_set_nz(snes, result, false);
+        write_r(snes, R_C, result, flags);
     }
 }
 
@@ -522,75 +767,57 @@ OP(cmp) {
                    AM_STK_REL | AM_ZBKX_DIR | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
-    uint16_t val = resolve_read16(mode, false, true);
-    int32_t result = read_r(R_C) - val;
-    set_status_bit(STATUS_CARRY, result >= 0);
-    set_status_bit(STATUS_ZERO, get_status_bit(STATUS_MEMNARROW)
-                                    ? (result & 0xff) == 0
-                                    : (result & 0xffff) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (result & 0x80)
-                                        : (result & 0x8000));
+    uint16_t val = resolve_read16(snes, mode, false, true, flags);
+    int32_t result = read_r(snes, R_C, flags) - val;
+    set_status_bit(snes, STATUS_CARRY, result >= 0);
+    cpu_set_nz(snes, result, flags & CPU_FLAG_M);
 }
 
 OP(cpx) {
     LEGALADDRMODES(AM_ABS | AM_DIR | AM_IMM);
-    uint16_t val = resolve_read16(mode, true, false);
-    int32_t result = read_r(R_X) - val;
-    set_status_bit(STATUS_CARRY, result >= 0);
-    set_status_bit(STATUS_ZERO, get_status_bit(STATUS_XNARROW)
-                                    ? (result & 0xff) == 0
-                                    : (result & 0xffff) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (result & 0x80)
-                                        : (result & 0x8000));
+    uint16_t val = resolve_read16(snes, mode, true, false, flags);
+    int32_t result = read_r(snes, R_X, flags) - val;
+    set_status_bit(snes, STATUS_CARRY, result >= 0);
+    cpu_set_nz(snes, result, flags & CPU_FLAG_X);
 }
 
 OP(cpy) {
     LEGALADDRMODES(AM_ABS | AM_DIR | AM_IMM);
-    uint16_t val = resolve_read16(mode, true, false);
-    int32_t result = read_r(R_Y) - val;
-    set_status_bit(STATUS_CARRY, result >= 0);
-    set_status_bit(STATUS_ZERO, get_status_bit(STATUS_XNARROW)
-                                    ? (result & 0xff) == 0
-                                    : (result & 0xffff) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (result & 0x80)
-                                        : (result & 0x8000));
+    uint16_t val = resolve_read16(snes, mode, true, false, flags);
+    int32_t result = read_r(snes, R_Y, flags) - val;
+    set_status_bit(snes, STATUS_CARRY, result >= 0);
+    cpu_set_nz(snes, result, flags & CPU_FLAG_X);
 }
 
 OP(inc) {
     LEGALADDRMODES(AM_ABS | AM_ACC | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
     if (mode == AM_ACC) {
-        uint16_t val = read_r(R_C) + 1;
-        write_r(R_C, val);
-        set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (read_r(R_C) & 0x80)
-                                            : (read_r(R_C) & 0x8000));
+        uint16_t val = read_r(snes, R_C, flags) + 1;
+        write_r(snes, R_C, val, flags);
+        cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
     } else {
-        uint32_t addr = resolve_addr(mode);
+        uint32_t addr = resolve_addr(snes, mode, flags);
         if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-            if (get_status_bit(STATUS_MEMNARROW)) {
-                if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                    addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+            if (flags & CPU_FLAG_M) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                  U16_HIBYTE(snes->cpu.d));
                 } else {
-                    addr = U24_LOSHORT(addr + cpu.d);
+                    addr = U24_LOSHORT(addr + snes->cpu.d);
                 }
             } else {
-                addr += cpu.d;
+                addr += snes->cpu.d;
             }
         }
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            uint8_t val = read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) + 1;
-            write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
-            set_status_bit(STATUS_ZERO, val == 0);
-            set_status_bit(STATUS_NEGATIVE, val & 0x80);
+        if (flags & CPU_FLAG_M) {
+            uint8_t val = read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) + 1;
+            write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+            cpu_set_nz(snes, val, true);
         } else {
-            uint16_t val = read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) + 1;
-            write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
-            set_status_bit(STATUS_ZERO, val == 0);
-            set_status_bit(STATUS_NEGATIVE, val & 0x8000);
+            uint16_t val =
+                read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) + 1;
+            write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+            cpu_set_nz(snes, val, false);
         }
     }
 }
@@ -598,81 +825,66 @@ OP(inc) {
 OP(dec) {
     LEGALADDRMODES(AM_ABS | AM_ACC | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
     if (mode == AM_ACC) {
-        uint16_t val = read_r(R_C) - 1;
-        write_r(R_C, val);
-        set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (read_r(R_C) & 0x80)
-                                            : (read_r(R_C) & 0x8000));
+        uint16_t val = read_r(snes, R_C, flags) - 1;
+        write_r(snes, R_C, val, flags);
+        cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
     } else {
-        uint32_t addr = resolve_addr(mode);
+        uint32_t addr = resolve_addr(snes, mode, flags);
         if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-            if (get_status_bit(STATUS_MEMNARROW)) {
-                if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                    addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+            if (flags & CPU_FLAG_M) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                  U16_HIBYTE(snes->cpu.d));
                 } else {
-                    addr = U24_LOSHORT(addr + cpu.d);
+                    addr = U24_LOSHORT(addr + snes->cpu.d);
                 }
             } else {
-                addr += cpu.d;
+                addr += snes->cpu.d;
             }
         }
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            uint8_t val = read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) - 1;
-            write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
-            set_status_bit(STATUS_ZERO, val == 0);
-            set_status_bit(STATUS_NEGATIVE, val & 0x80);
+        if (flags & CPU_FLAG_M) {
+            uint8_t val = read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) - 1;
+            write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+            cpu_set_nz(snes, val, true);
         } else {
-            uint16_t val = read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) - 1;
-            write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), val);
-            set_status_bit(STATUS_ZERO, val == 0);
-            set_status_bit(STATUS_NEGATIVE, val & 0x8000);
+            uint16_t val =
+                read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) - 1;
+            write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), val);
+            cpu_set_nz(snes, val, false);
         }
     }
 }
 
 OP(inx) {
     LEGALADDRMODES(AM_IMP);
-    uint16_t val = read_r(R_X);
+    uint16_t val = read_r(snes, R_X, flags);
     val++;
-    write_r(R_X, val);
-    set_status_bit(STATUS_ZERO, read_r(R_X) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_X) & 0x80)
-                                        : (read_r(R_X) & 0x8000));
+    write_r(snes, R_X, val, flags);
+    cpu_set_nz(snes, read_r(snes, R_X, flags), flags & CPU_FLAG_X);
 }
 
 OP(dex) {
     LEGALADDRMODES(AM_IMP);
-    uint16_t val = read_r(R_X);
+    uint16_t val = read_r(snes, R_X, flags);
     val--;
-    write_r(R_X, val);
-    set_status_bit(STATUS_ZERO, read_r(R_X) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_X) & 0x80)
-                                        : (read_r(R_X) & 0x8000));
+    write_r(snes, R_X, val, flags);
+    cpu_set_nz(snes, read_r(snes, R_X, flags), flags & CPU_FLAG_X);
 }
 
 OP(iny) {
     LEGALADDRMODES(AM_IMP);
-    uint16_t val = read_r(R_Y);
+    uint16_t val = read_r(snes, R_Y, flags);
     val++;
-    write_r(R_Y, val);
-    set_status_bit(STATUS_ZERO, read_r(R_Y) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_Y) & 0x80)
-                                        : (read_r(R_Y) & 0x8000));
+    write_r(snes, R_Y, val, flags);
+    cpu_set_nz(snes, read_r(snes, R_Y, flags), flags & CPU_FLAG_X);
 }
 
 OP(dey) {
     LEGALADDRMODES(AM_IMP);
-    uint16_t val = read_r(R_Y);
+    uint16_t val = read_r(snes, R_Y, flags);
     val--;
-    write_r(R_Y, val);
-    set_status_bit(STATUS_ZERO, read_r(R_Y) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_Y) & 0x80)
-                                        : (read_r(R_Y) & 0x8000));
+    write_r(snes, R_Y, val, flags);
+    cpu_set_nz(snes, read_r(snes, R_Y, flags), flags & CPU_FLAG_X);
 }
 
 OP(and_) {
@@ -680,15 +892,17 @@ OP(and_) {
                    AM_STK_REL | AM_ZBKX_DIR | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        write_r(R_C, read_r(R_C) & resolve_read8(mode));
+    if (flags & CPU_FLAG_M) {
+        write_r(snes, R_C,
+                read_r(snes, R_C, flags) & resolve_read8(snes, mode, flags),
+                flags);
     } else {
-        write_r(R_C, read_r(R_C) & resolve_read16(mode, false, false));
+        write_r(snes, R_C,
+                read_r(snes, R_C, flags) &
+                    resolve_read16(snes, mode, false, false, flags),
+                flags);
     }
-    set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (read_r(R_C) & 0x80)
-                                        : (read_r(R_C) & 0x8000));
+    cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
 }
 
 OP(ora) {
@@ -696,15 +910,17 @@ OP(ora) {
                    AM_STK_REL | AM_ZBKX_DIR | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        write_r(R_C, read_r(R_C) | resolve_read8(mode));
+    if (flags & CPU_FLAG_M) {
+        write_r(snes, R_C,
+                read_r(snes, R_C, flags) | resolve_read8(snes, mode, flags),
+                flags);
     } else {
-        write_r(R_C, read_r(R_C) | resolve_read16(mode, false, false));
+        write_r(snes, R_C,
+                read_r(snes, R_C, flags) |
+                    resolve_read16(snes, mode, false, false, flags),
+                flags);
     }
-    set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (read_r(R_C) & 0x80)
-                                        : (read_r(R_C) & 0x8000));
+    cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
 }
 
 OP(eor) {
@@ -712,312 +928,305 @@ OP(eor) {
                    AM_STK_REL | AM_ZBKX_DIR | AM_IND_DIR | AM_IND_DIR_L |
                    AM_STK_REL_INDY | AM_INDX_DIR | AM_INDY_DIR | AM_INDY_DIR_L |
                    AM_IMM);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        write_r(R_C, read_r(R_C) ^ resolve_read8(mode));
+    if (flags & CPU_FLAG_M) {
+        write_r(snes, R_C,
+                read_r(snes, R_C, flags) ^ resolve_read8(snes, mode, flags),
+                flags);
     } else {
-        write_r(R_C, read_r(R_C) ^ resolve_read16(mode, false, false));
+        write_r(snes, R_C,
+                read_r(snes, R_C, flags) ^
+                    resolve_read16(snes, mode, false, false, flags),
+                flags);
     }
-    set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (read_r(R_C) & 0x80)
-                                        : (read_r(R_C) & 0x8000));
+    cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
 }
 
 OP(bra) {
     LEGALADDRMODES(AM_PC_REL);
-    cpu.pc = resolve_addr(mode);
+    snes->cpu.pc = resolve_addr(snes, mode, flags);
 }
 
 OP(bmi) {
     LEGALADDRMODES(AM_PC_REL);
-    if (get_status_bit(STATUS_NEGATIVE)) {
-        cpu.pc = resolve_addr(mode);
+    if (get_status_bit(snes, STATUS_NEGATIVE)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(bpl) {
     LEGALADDRMODES(AM_PC_REL);
-    if (!get_status_bit(STATUS_NEGATIVE)) {
-        cpu.pc = resolve_addr(mode);
+    if (!get_status_bit(snes, STATUS_NEGATIVE)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(beq) {
     LEGALADDRMODES(AM_PC_REL);
-    if (get_status_bit(STATUS_ZERO)) {
-        cpu.pc = resolve_addr(mode);
+    if (get_status_bit(snes, STATUS_ZERO)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(bne) {
     LEGALADDRMODES(AM_PC_REL);
-    if (!get_status_bit(STATUS_ZERO)) {
-        cpu.pc = resolve_addr(mode);
+    if (!get_status_bit(snes, STATUS_ZERO)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(bcs) {
     LEGALADDRMODES(AM_PC_REL);
-    if (get_status_bit(STATUS_CARRY)) {
-        cpu.pc = resolve_addr(mode);
+    if (get_status_bit(snes, STATUS_CARRY)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(bcc) {
     LEGALADDRMODES(AM_PC_REL);
-    if (!get_status_bit(STATUS_CARRY)) {
-        cpu.pc = resolve_addr(mode);
+    if (!get_status_bit(snes, STATUS_CARRY)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(bvs) {
     LEGALADDRMODES(AM_PC_REL);
-    if (get_status_bit(STATUS_OVERFLOW)) {
-        cpu.pc = resolve_addr(mode);
+    if (get_status_bit(snes, STATUS_OVERFLOW)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(bvc) {
     LEGALADDRMODES(AM_PC_REL);
-    if (!get_status_bit(STATUS_OVERFLOW)) {
-        cpu.pc = resolve_addr(mode);
+    if (!get_status_bit(snes, STATUS_OVERFLOW)) {
+        snes->cpu.pc = resolve_addr(snes, mode, flags);
     } else {
-        cpu.pc++;
+        snes->cpu.pc++;
     }
 }
 
 OP(brl) {
     LEGALADDRMODES(AM_PC_REL_L);
-    cpu.pc = resolve_addr(mode);
+    snes->cpu.pc = resolve_addr(snes, mode, flags);
 }
 
 OP(jmp) {
     LEGALADDRMODES(AM_ABS | AM_IND | AM_INDX);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode == AM_ABS) {
-        cpu.pc = addr;
+        snes->cpu.pc = addr;
     } else if (mode == AM_IND) {
-        cpu.pc = read_16(U24_LOSHORT(addr), 0);
+        snes->cpu.pc = read_16(snes, U24_LOSHORT(addr), 0);
     } else {
-        cpu.pc = addr;
+        snes->cpu.pc = addr;
     }
 }
 
 OP(jml) {
     LEGALADDRMODES(AM_IND | AM_ABS_L);
-    uint32_t addr = resolve_addr(mode);
+    uint32_t addr = resolve_addr(snes, mode, flags);
     if (mode == AM_IND) {
-        uint32_t target = read_24(U24_LOSHORT(addr), U24_HIBYTE(addr));
-        cpu.pc = U24_LOSHORT(target);
-        cpu.pbr = U24_HIBYTE(target);
+        uint32_t target = read_24(snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+        snes->cpu.pc = U24_LOSHORT(target);
+        snes->cpu.pbr = U24_HIBYTE(target);
     } else {
-        cpu.pc = U24_LOSHORT(addr);
-        cpu.pbr = U24_HIBYTE(addr);
+        snes->cpu.pc = U24_LOSHORT(addr);
+        snes->cpu.pbr = U24_HIBYTE(addr);
     }
 }
 
 OP(jsr) {
     LEGALADDRMODES(AM_ABS | AM_INDX);
-    uint16_t addr = resolve_addr(mode);
-    push_16(cpu.pc - 1);
-    cpu.pc = addr;
+    uint16_t addr = resolve_addr(snes, mode, flags);
+    push_16(snes, snes->cpu.pc - 1);
+    snes->cpu.pc = addr;
 }
 
 OP(jsl) {
     LEGALADDRMODES(AM_ABS_L);
-    uint32_t addr = resolve_addr(mode);
-    push_8(cpu.pbr);
-    push_16(cpu.pc - 1);
-    cpu.pc = U24_LOSHORT(addr);
-    cpu.pbr = U24_HIBYTE(addr);
+    uint32_t addr = resolve_addr(snes, mode, flags);
+    push_8(snes, snes->cpu.pbr);
+    push_16(snes, snes->cpu.pc - 1);
+    snes->cpu.pc = U24_LOSHORT(addr);
+    snes->cpu.pbr = U24_HIBYTE(addr);
 }
 
 OP(rts) {
     LEGALADDRMODES(AM_IMP);
-    cpu.pc = pop_16() + 1;
+    snes->cpu.pc = pop_16(snes) + 1;
 }
 
 OP(rtl) {
     LEGALADDRMODES(AM_IMP);
-    uint32_t addr = pop_24();
-    cpu.pbr = U24_HIBYTE(addr);
-    cpu.pc = U24_LOSHORT(addr) + 1;
+    uint32_t addr = pop_24(snes);
+    snes->cpu.pbr = U24_HIBYTE(addr);
+    snes->cpu.pc = U24_LOSHORT(addr) + 1;
 }
 
 OP(rti) {
     LEGALADDRMODES(AM_STK);
-    cpu.p = pop_8();
-    cpu.pc = pop_16();
-    if (!cpu.emulation_mode)
-        cpu.pbr = pop_8();
+    cpu_set_p(snes, pop_8(snes));
+    if (flags & CPU_FLAG_E)
+        snes->cpu.p |= 0b110000;
+    snes->cpu.pc = pop_16(snes);
+    if (!(flags & CPU_FLAG_E))
+        snes->cpu.pbr = pop_8(snes);
 }
 
 OP(php) {
     LEGALADDRMODES(AM_STK);
-    push_8(cpu.p);
+    push_8(snes, cpu_get_p(snes));
 }
 
 OP(plp) {
     LEGALADDRMODES(AM_STK);
-    cpu.p = pop_8();
-    if (get_status_bit(STATUS_XNARROW)) {
-        cpu.x &= 0xff;
-        cpu.y &= 0xff;
+    cpu_set_p(snes, pop_8(snes));
+    if (get_status_bit(snes, STATUS_XNARROW)) {
+        snes->cpu.x &= 0xff;
+        snes->cpu.y &= 0xff;
     }
 }
 
 OP(pha) {
     LEGALADDRMODES(AM_STK);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        push_8(read_r(R_C));
+    if (flags & CPU_FLAG_M) {
+        push_8(snes, read_r(snes, R_C, flags));
     } else {
-        push_16(read_r(R_C));
+        push_16(snes, read_r(snes, R_C, flags));
     }
 }
 
 OP(pla) {
     LEGALADDRMODES(AM_STK);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        write_r(R_C, pop_8());
+    if (flags & CPU_FLAG_M) {
+        write_r(snes, R_C, pop_8(snes), flags);
     } else {
-        write_r(R_C, pop_16());
+        write_r(snes, R_C, pop_16(snes), flags);
     }
-    set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                        ? (read_r(R_C) & 0x80)
-                                        : read_r(R_C) & 0x8000);
+    cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
 }
 
 OP(phx) {
     LEGALADDRMODES(AM_STK);
-    if (get_status_bit(STATUS_XNARROW)) {
-        push_8(read_r(R_X));
+    if (flags & CPU_FLAG_X) {
+        push_8(snes, read_r(snes, R_X, flags));
     } else {
-        push_16(read_r(R_X));
+        push_16(snes, read_r(snes, R_X, flags));
     }
 }
 
 OP(plx) {
     LEGALADDRMODES(AM_STK);
-    if (get_status_bit(STATUS_XNARROW)) {
-        write_r(R_X, pop_8());
+    if (flags & CPU_FLAG_X) {
+        write_r(snes, R_X, pop_8(snes), flags);
     } else {
-        write_r(R_X, pop_16());
+        write_r(snes, R_X, pop_16(snes), flags);
     }
-    set_status_bit(STATUS_ZERO, read_r(R_X) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_X) & 0x80)
-                                        : read_r(R_X) & 0x8000);
+    cpu_set_nz(snes, read_r(snes, R_X, flags), flags & CPU_FLAG_X);
 }
 
 OP(phy) {
     LEGALADDRMODES(AM_STK);
-    if (get_status_bit(STATUS_XNARROW)) {
-        push_8(read_r(R_Y));
+    if (flags & CPU_FLAG_X) {
+        push_8(snes, read_r(snes, R_Y, flags));
     } else {
-        push_16(read_r(R_Y));
+        push_16(snes, read_r(snes, R_Y, flags));
     }
 }
 
 OP(ply) {
     LEGALADDRMODES(AM_STK);
-    if (get_status_bit(STATUS_XNARROW)) {
-        write_r(R_Y, pop_8());
+    if (flags & CPU_FLAG_X) {
+        write_r(snes, R_Y, pop_8(snes), flags);
     } else {
-        write_r(R_Y, pop_16());
+        write_r(snes, R_Y, pop_16(snes), flags);
     }
-    set_status_bit(STATUS_ZERO, read_r(R_Y) == 0);
-    set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_XNARROW)
-                                        ? (read_r(R_Y) & 0x80)
-                                        : read_r(R_Y) & 0x8000);
+    cpu_set_nz(snes, read_r(snes, R_Y, flags), flags & CPU_FLAG_X);
 }
 
 OP(phb) {
     LEGALADDRMODES(AM_STK);
-    push_8(cpu.dbr);
+    push_8(snes, snes->cpu.dbr);
 }
 
 OP(plb) {
     LEGALADDRMODES(AM_STK);
-    cpu.dbr = pop_8();
-    set_status_bit(STATUS_ZERO, cpu.dbr == 0);
-    set_status_bit(STATUS_NEGATIVE, cpu.dbr & 0x80);
+    snes->cpu.dbr = pop_8(snes);
+    cpu_set_nz(snes, snes->cpu.dbr, true);
 }
 
 OP(phd) {
     LEGALADDRMODES(AM_STK);
-    push_16(cpu.d);
+    push_16(snes, snes->cpu.d);
 }
 
 OP(pld) {
     LEGALADDRMODES(AM_STK);
-    cpu.d = pop_16();
-    set_status_bit(STATUS_ZERO, cpu.d == 0);
-    set_status_bit(STATUS_NEGATIVE, cpu.d & 0x8000);
+    snes->cpu.d = pop_16(snes);
+    cpu_set_nz(snes, snes->cpu.d, false);
 }
 
 OP(phk) {
     LEGALADDRMODES(AM_STK);
-    push_8(cpu.pbr);
+    push_8(snes, snes->cpu.pbr);
 }
 
 OP(rol) {
     LEGALADDRMODES(AM_ABS | AM_ACC | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
     if (mode == AM_ACC) {
-        bool carry = get_status_bit(STATUS_CARRY);
-        set_status_bit(STATUS_CARRY, get_status_bit(STATUS_MEMNARROW)
-                                         ? (read_r(R_C) & 0x80)
-                                         : read_r(R_C) & 0x8000);
-        write_r(R_C, (read_r(R_C) << 1) | carry);
-        set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (read_r(R_C) & 0x80)
-                                            : read_r(R_C) & 0x8000);
+        bool carry = get_status_bit(snes, STATUS_CARRY);
+        set_status_bit(snes, STATUS_CARRY,
+                       (flags & CPU_FLAG_M)
+                           ? (read_r(snes, R_C, flags) & 0x80)
+                           : read_r(snes, R_C, flags) & 0x8000);
+        write_r(snes, R_C, (read_r(snes, R_C, flags) << 1) | carry, flags);
+        cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
     } else {
-        bool carry = get_status_bit(STATUS_CARRY);
-        uint32_t addr = resolve_addr(mode);
+        bool carry = get_status_bit(snes, STATUS_CARRY);
+        uint32_t addr = resolve_addr(snes, mode, flags);
         if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-            if (get_status_bit(STATUS_MEMNARROW)) {
-                if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                    addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+            if (flags & CPU_FLAG_M) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                  U16_HIBYTE(snes->cpu.d));
                 } else {
-                    addr = U24_LOSHORT(addr + cpu.d);
+                    addr = U24_LOSHORT(addr + snes->cpu.d);
                 }
             } else {
-                addr += cpu.d;
+                addr += snes->cpu.d;
             }
         }
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            set_status_bit(STATUS_CARRY,
-                           read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) & 0x80);
+        if (flags & CPU_FLAG_M) {
+            set_status_bit(snes, STATUS_CARRY,
+                           read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+                               0x80);
             uint8_t result =
-                (read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1) | carry;
-            write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x80);
+                (read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1) |
+                carry;
+            write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, true);
         } else {
-            set_status_bit(STATUS_CARRY,
-                           read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+            set_status_bit(snes, STATUS_CARRY,
+                           read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
                                0x8000);
             uint16_t result =
-                (read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1) | carry;
-            write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x8000);
+                (read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1) |
+                carry;
+            write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, false);
         }
     }
 }
@@ -1025,47 +1234,46 @@ OP(rol) {
 OP(ror) {
     LEGALADDRMODES(AM_ABS | AM_ACC | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
     if (mode == AM_ACC) {
-        bool carry = get_status_bit(STATUS_CARRY);
-        set_status_bit(STATUS_CARRY, read_r(R_C) & 1);
-        write_r(R_C,
-                (read_r(R_C) >> 1) |
-                    (carry << (get_status_bit(STATUS_MEMNARROW) ? 7 : 15)));
-        set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (read_r(R_C) & 0x80)
-                                            : read_r(R_C) & 0x8000);
+        bool carry = get_status_bit(snes, STATUS_CARRY);
+        set_status_bit(snes, STATUS_CARRY, read_r(snes, R_C, flags) & 1);
+        write_r(snes, R_C,
+                (read_r(snes, R_C, flags) >> 1) |
+                    (carry << ((flags & CPU_FLAG_M) ? 7 : 15)),
+                flags);
+        cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
     } else {
-        bool carry = get_status_bit(STATUS_CARRY);
-        uint32_t addr = resolve_addr(mode);
+        bool carry = get_status_bit(snes, STATUS_CARRY);
+        uint32_t addr = resolve_addr(snes, mode, flags);
         if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-            if (get_status_bit(STATUS_MEMNARROW)) {
-                if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                    addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+            if (flags & CPU_FLAG_M) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                  U16_HIBYTE(snes->cpu.d));
                 } else {
-                    addr = U24_LOSHORT(addr + cpu.d);
+                    addr = U24_LOSHORT(addr + snes->cpu.d);
                 }
             } else {
-                addr += cpu.d;
+                addr += snes->cpu.d;
             }
         }
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            set_status_bit(STATUS_CARRY,
-                           read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) & 1);
+        if (flags & CPU_FLAG_M) {
+            set_status_bit(snes, STATUS_CARRY,
+                           read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+                               1);
             uint8_t result =
-                (read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1) |
+                (read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1) |
                 (carry << 7);
-            write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x80);
+            write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, true);
         } else {
-            set_status_bit(STATUS_CARRY,
-                           read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) & 1);
+            set_status_bit(snes, STATUS_CARRY,
+                           read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+                               1);
             uint16_t result =
-                (read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1) |
+                (read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1) |
                 (carry << 15);
-            write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x8000);
+            write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, false);
         }
     }
 }
@@ -1073,43 +1281,42 @@ OP(ror) {
 OP(asl) {
     LEGALADDRMODES(AM_ABS | AM_ACC | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
     if (mode == AM_ACC) {
-        set_status_bit(STATUS_CARRY, get_status_bit(STATUS_MEMNARROW)
-                                         ? (read_r(R_C) & 0x80)
-                                         : read_r(R_C) & 0x8000);
-        write_r(R_C, read_r(R_C) << 1);
-        set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (read_r(R_C) & 0x80)
-                                            : read_r(R_C) & 0x8000);
+        set_status_bit(snes, STATUS_CARRY,
+                       (flags & CPU_FLAG_M)
+                           ? (read_r(snes, R_C, flags) & 0x80)
+                           : read_r(snes, R_C, flags) & 0x8000);
+        write_r(snes, R_C, read_r(snes, R_C, flags) << 1, flags);
+        cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
     } else {
-        uint32_t addr = resolve_addr(mode);
+        uint32_t addr = resolve_addr(snes, mode, flags);
         if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-            if (get_status_bit(STATUS_MEMNARROW)) {
-                if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                    addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+            if (flags & CPU_FLAG_M) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                  U16_HIBYTE(snes->cpu.d));
                 } else {
-                    addr = U24_LOSHORT(addr + cpu.d);
+                    addr = U24_LOSHORT(addr + snes->cpu.d);
                 }
             } else {
-                addr = U24_LOSHORT(addr + cpu.d);
+                addr = U24_LOSHORT(addr + snes->cpu.d);
             }
         }
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            set_status_bit(STATUS_CARRY,
-                           read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) & 0x80);
-            uint8_t result = read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1;
-            write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x80);
+        if (flags & CPU_FLAG_M) {
+            set_status_bit(snes, STATUS_CARRY,
+                           read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+                               0x80);
+            uint8_t result = read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr))
+                             << 1;
+            write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, true);
         } else {
-            set_status_bit(STATUS_CARRY,
-                           read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+            set_status_bit(snes, STATUS_CARRY,
+                           read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
                                0x8000);
             uint16_t result =
-                (read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1);
-            write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x8000);
+                (read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) << 1);
+            write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, false);
         }
     }
 }
@@ -1117,125 +1324,166 @@ OP(asl) {
 OP(lsr) {
     LEGALADDRMODES(AM_ABS | AM_ACC | AM_ABSX | AM_DIR | AM_ZBKX_DIR);
     if (mode == AM_ACC) {
-        set_status_bit(STATUS_CARRY, read_r(R_C) & 1);
-        write_r(R_C, read_r(R_C) >> 1);
-        set_status_bit(STATUS_ZERO, read_r(R_C) == 0);
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (read_r(R_C) & 0x80)
-                                            : read_r(R_C) & 0x8000);
+        set_status_bit(snes, STATUS_CARRY, read_r(snes, R_C, flags) & 1);
+        write_r(snes, R_C, read_r(snes, R_C, flags) >> 1, flags);
+        cpu_set_nz(snes, read_r(snes, R_C, flags), flags & CPU_FLAG_M);
     } else {
-        uint32_t addr = resolve_addr(mode);
+        uint32_t addr = resolve_addr(snes, mode, flags);
         if (mode & (AM_ZBKX_DIR | AM_ZBKY_DIR | AM_DIR)) {
-            if (get_status_bit(STATUS_MEMNARROW)) {
-                if (cpu.emulation_mode && cpu.d % 256 == 0) {
-                    addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+            if (flags & CPU_FLAG_M) {
+                if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+                    addr = TO_U16(U16_LOBYTE(addr + snes->cpu.d),
+                                  U16_HIBYTE(snes->cpu.d));
                 } else {
-                    addr = U24_LOSHORT(addr + cpu.d);
+                    addr = U24_LOSHORT(addr + snes->cpu.d);
                 }
             } else {
-                addr += cpu.d;
+                addr += snes->cpu.d;
             }
         }
-        if (get_status_bit(STATUS_MEMNARROW)) {
-            set_status_bit(STATUS_CARRY,
-                           read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) & 1);
-            uint8_t result = read_8(U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1;
-            write_8(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x80);
+        if (flags & CPU_FLAG_M) {
+            set_status_bit(snes, STATUS_CARRY,
+                           read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+                               1);
+            uint8_t result =
+                read_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1;
+            write_8(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, true);
         } else {
-            set_status_bit(STATUS_CARRY,
-                           read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) & 1);
+            set_status_bit(snes, STATUS_CARRY,
+                           read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) &
+                               1);
             uint16_t result =
-                (read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1);
-            write_16(U24_LOSHORT(addr), U24_HIBYTE(addr), result);
-            set_status_bit(STATUS_ZERO, result == 0);
-            set_status_bit(STATUS_NEGATIVE, result & 0x8000);
+                (read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)) >> 1);
+            write_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr), result);
+            cpu_set_nz(snes, result, false);
         }
     }
 }
 
 OP(bit) {
     LEGALADDRMODES(AM_IMM | AM_ABS | AM_DIR | AM_ABSX | AM_ZBKX_DIR);
-    uint16_t operand = resolve_read16(mode, false, true);
+    uint16_t operand = resolve_read16(snes, mode, false, true, flags);
     if (mode != AM_IMM) {
-        set_status_bit(STATUS_NEGATIVE, get_status_bit(STATUS_MEMNARROW)
-                                            ? (operand & 0x80)
+        set_status_bit(snes, STATUS_NEGATIVE,
+                       (flags & CPU_FLAG_M) ? (operand & 0x80)
                                             : (operand & 0x8000));
-        set_status_bit(STATUS_OVERFLOW, get_status_bit(STATUS_MEMNARROW)
-                                            ? (operand & 0x40)
+        set_status_bit(snes, STATUS_OVERFLOW,
+                       (flags & CPU_FLAG_M) ? (operand & 0x40)
                                             : (operand & 0x4000));
     }
-    set_status_bit(STATUS_ZERO, (operand & read_r(R_C)) == 0);
+    set_status_bit(snes, STATUS_ZERO,
+                   (operand & read_r(snes, R_C, flags)) == 0);
 }
 
 OP(mvp) {
     LEGALADDRMODES(AM_BLK);
-    uint8_t dest_b = next_8();
-    uint8_t src_b = next_8();
-    while (cpu.c != 0xffff) {
-        write_8(read_r(R_Y), dest_b, read_8(read_r(R_X), src_b));
-        write_r(R_X, read_r(R_X) - 1);
-        write_r(R_Y, read_r(R_Y) - 1);
-        cpu.c--;
+    uint8_t dest_b = next_8(snes);
+    uint8_t src_b = next_8(snes);
+    while (snes->cpu.c != 0xffff) {
+        write_8(snes, read_r(snes, R_Y, flags), dest_b,
+                read_8(snes, read_r(snes, R_X, flags), src_b));
+        write_r(snes, R_X, read_r(snes, R_X, flags) - 1, flags);
+        write_r(snes, R_Y, read_r(snes, R_Y, flags) - 1, flags);
+        snes->cpu.c--;
     }
 
-    cpu.dbr = dest_b;
+    snes->cpu.dbr = dest_b;
 }
 
 OP(mvn) {
     LEGALADDRMODES(AM_BLK);
-    uint8_t dest_b = next_8();
-    uint8_t src_b = next_8();
-
-    while (cpu.c != 0xffff) {
-        write_8(read_r(R_Y), dest_b, read_8(read_r(R_X), src_b));
-        write_r(R_X, read_r(R_X) + 1);
-        write_r(R_Y, read_r(R_Y) + 1);
-        cpu.c--;
+    uint8_t dest_b = next_8(snes);
+    uint8_t src_b = next_8(snes);
+
+    while (snes->cpu.c != 0xffff) {
+        write_8(snes, read_r(snes, R_Y, flags), dest_b,
+                read_8(snes, read_r(snes, R_X, flags), src_b));
+        write_r(snes, R_X, read_r(snes, R_X, flags) + 1, flags);
+        write_r(snes, R_Y, read_r(snes, R_Y, flags) + 1, flags);
+        snes->cpu.c--;
     }
 
-    cpu.dbr = dest_b;
+    snes->cpu.dbr = dest_b;
 }
 
 OP(per) {
     LEGALADDRMODES(AM_PC_REL_L);
-    uint16_t operand = next_16();
-    push_16(cpu.pc + operand);
+    uint16_t operand = next_16(snes);
+    push_16(snes, snes->cpu.pc + operand);
 }
 
 OP(brk) {
     LEGALADDRMODES(AM_IMP);
-    cpu.brk = true;
+    snes->cpu.brk = true;
 }
 
 OP(cop) {
     LEGALADDRMODES(AM_IMP);
-    cpu.cop = true;
+    snes->cpu.cop = true;
 }
 
 OP(pea) {
     LEGALADDRMODES(AM_STK);
-    push_16(next_16());
+    push_16(snes, next_16(snes));
 }
 
 OP(pei) {
     LEGALADDRMODES(AM_STK);
-    uint32_t addr = resolve_addr(AM_DIR);
-    if (get_status_bit(STATUS_MEMNARROW)) {
-        if (cpu.emulation_mode && cpu.d % 256 == 0) {
-            addr = TO_U16(U16_LOBYTE(addr + cpu.d), U16_HIBYTE(cpu.d));
+    uint32_t addr = resolve_addr(snes, AM_DIR, flags);
+    if (flags & CPU_FLAG_M) {
+        if ((flags & CPU_FLAG_E) && snes->cpu.d % 256 == 0) {
+            addr =
+                TO_U16(U16_LOBYTE(addr + snes->cpu.d), U16_HIBYTE(snes->cpu.d));
         } else {
-            addr = U24_LOSHORT(addr + cpu.d);
+            addr = U24_LOSHORT(addr + snes->cpu.d);
         }
     } else {
-        addr += cpu.d;
+        addr += snes->cpu.d;
     }
 
-    push_16(read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)));
+    push_16(snes, read_16(snes, U24_LOSHORT(addr), U24_HIBYTE(addr)));
 }
 
 OP(wai) {
     LEGALADDRMODES(AM_IMP);
-    cpu.waiting = true;
+    snes->cpu.waiting = true;
+}
+
+OP(nop) {
+    LEGALADDRMODES(AM_IMP);
+    // this page intentionally left blank
 }
+
+OP(wdm) {
+    LEGALADDRMODES(AM_IMM);
+    (void)next_8(snes);
+}
+
+#define SPECIALIZE(opcode, name, mode, flags)                                  \
+    static void name##_##opcode##_##flags(snes_t *snes) {                      \
+        name(snes, mode, flags);                                               \
+    }
+#define SPECIALIZE_ALL(opcode, name, mode)                                     \
+    SPECIALIZE(opcode, name, mode, 0)                                          \
+    SPECIALIZE(opcode, name, mode, 1)                                          \
+    SPECIALIZE(opcode, name, mode, 2)                                          \
+    SPECIALIZE(opcode, name, mode, 3)                                          \
+    SPECIALIZE(opcode, name, mode, 7)
+
+CPU_OPCODES(SPECIALIZE_ALL)
+
+#define ENTRY_0(opcode, name, mode) [opcode] = {name##_##opcode##_0, mode},
+#define ENTRY_1(opcode, name, mode) [opcode] = {name##_##opcode##_1, mode},
+#define ENTRY_2(opcode, name, mode) [opcode] = {name##_##opcode##_2, mode},
+#define ENTRY_3(opcode, name, mode) [opcode] = {name##_##opcode##_3, mode},
+#define ENTRY_7(opcode, name, mode) [opcode] = {name##_##opcode##_7, mode},
+
+// the rows for E without M or X stay empty, cpu_flags never returns them
+const cpu_op_t cpu_ops[CPU_FLAG_COMBINATIONS][0x100] = {
+    [0] = {CPU_OPCODES(ENTRY_0)},
+    [CPU_FLAG_M] = {CPU_OPCODES(ENTRY_1)},
+    [CPU_FLAG_X] = {CPU_OPCODES(ENTRY_2)},
+    [CPU_FLAG_M | CPU_FLAG_X] = {CPU_OPCODES(ENTRY_3)},
+    [CPU_FLAG_M | CPU_FLAG_X | CPU_FLAG_E] = {CPU_OPCODES(ENTRY_7)},
+};
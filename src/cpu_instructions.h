@@ -3,99 +3,275 @@
 
 #include "types.h"
 
-#define OP(name) void name(addressing_mode_t mode)
+// Handlers get the addressing mode and the M, X and E flags as arguments, but
+// they are only ever called with constants from the wrappers in cpu_ops, one
+// per opcode and flag combination, so every width and mode check folds away.
+#define OP(name)                                                               \
+    static inline __attribute__((always_inline)) void name(                   \
+        snes_t *snes, addressing_mode_t mode,                                  \
+        __attribute__((unused)) uint8_t flags)
 #define LEGALADDRMODES(modes)                                                  \
     ASSERT((mode & (modes)) != 0,                                              \
            "Illegal address mode for mask: expected %d, found %s", modes,      \
            addressing_mode_strings[(uint8_t)log2(mode)])
 
-OP(sei);
-OP(cli);
-OP(stz);
-OP(lda);
-OP(sta);
-OP(stx);
-OP(sty);
-OP(clc);
-OP(sed);
-OP(cld);
-OP(clv);
-OP(xce);
-OP(xba);
-OP(rep);
-OP(sep);
-OP(tcd);
-OP(tdc);
-OP(tcs);
-OP(tsc);
-OP(tsb);
-OP(trb);
-OP(ldx);
-OP(ldy);
-OP(tya);
-OP(tax);
-OP(txa);
-OP(tay);
-OP(txy);
-OP(tyx);
-OP(txs);
-OP(tsx);
-OP(sec);
-OP(adc);
-OP(sbc);
-OP(cmp);
-OP(cpx);
-OP(cpy);
-OP(inc);
-OP(dec);
-OP(inx);
-OP(dex);
-OP(iny);
-OP(dey);
-OP(and_);
-OP(ora);
-OP(eor);
-OP(bra);
-OP(bmi);
-OP(bpl);
-OP(beq);
-OP(bne);
-OP(bcs);
-OP(bcc);
-OP(bvs);
-OP(bvc);
-OP(brl);
-OP(jmp);
-OP(jml);
-OP(jsr);
-OP(jsl);
-OP(rts);
-OP(rtl);
-OP(rti);
-OP(php);
-OP(plp);
-OP(pha);
-OP(pla);
-OP(phx);
-OP(plx);
-OP(phy);
-OP(ply);
-OP(phb);
-OP(plb);
-OP(phd);
-OP(pld);
-OP(phk);
-OP(rol);
-OP(ror);
-OP(asl);
-OP(lsr);
-OP(bit);
-OP(mvp);
-OP(mvn);
-OP(per);
-OP(brk);
-OP(cop);
-OP(pea);
-OP(pei);
-OP(wai);
+// every opcode with its handler and addressing mode, expanded into the
+// dispatch tables in cpu_instructions.c and the profiler's opcode names
+#define CPU_OPCODES(X)                                                         \
+    X(0x00, brk, AM_IMP)                                                       \
+    X(0x01, ora, AM_INDX_DIR)                                                  \
+    X(0x02, cop, AM_IMP)                                                       \
+    X(0x03, ora, AM_STK_REL)                                                   \
+    X(0x04, tsb, AM_DIR)                                                       \
+    X(0x05, ora, AM_DIR)                                                       \
+    X(0x06, asl, AM_DIR)                                                       \
+    X(0x07, ora, AM_IND_DIR_L)                                                 \
+    X(0x08, php, AM_STK)                                                       \
+    X(0x09, ora, AM_IMM)                                                       \
+    X(0x0a, asl, AM_ACC)                                                       \
+    X(0x0b, phd, AM_STK)                                                       \
+    X(0x0c, tsb, AM_ABS)                                                       \
+    X(0x0d, ora, AM_ABS)                                                       \
+    X(0x0e, asl, AM_ABS)                                                       \
+    X(0x0f, ora, AM_ABS_L)                                                     \
+    X(0x10, bpl, AM_PC_REL)                                                    \
+    X(0x11, ora, AM_INDY_DIR)                                                  \
+    X(0x12, ora, AM_IND_DIR)                                                   \
+    X(0x13, ora, AM_STK_REL_INDY)                                              \
+    X(0x14, trb, AM_DIR)                                                       \
+    X(0x15, ora, AM_ZBKX_DIR)                                                  \
+    X(0x16, asl, AM_ZBKX_DIR)                                                  \
+    X(0x17, ora, AM_INDY_DIR_L)                                                \
+    X(0x18, clc, AM_IMP)                                                       \
+    X(0x19, ora, AM_ABSY)                                                      \
+    X(0x1a, inc, AM_ACC)                                                       \
+    X(0x1b, tcs, AM_IMP)                                                       \
+    X(0x1c, trb, AM_ABS)                                                       \
+    X(0x1d, ora, AM_ABSX)                                                      \
+    X(0x1e, asl, AM_ABSX)                                                      \
+    X(0x1f, ora, AM_ABSX_L)                                                    \
+    X(0x20, jsr, AM_ABS)                                                       \
+    X(0x21, and_, AM_INDX_DIR)                                                 \
+    X(0x22, jsl, AM_ABS_L)                                                     \
+    X(0x23, and_, AM_STK_REL)                                                  \
+    X(0x24, bit, AM_DIR)                                                       \
+    X(0x25, and_, AM_DIR)                                                      \
+    X(0x26, rol, AM_DIR)                                                       \
+    X(0x27, and_, AM_IND_DIR_L)                                                \
+    X(0x28, plp, AM_STK)                                                       \
+    X(0x29, and_, AM_IMM)                                                      \
+    X(0x2a, rol, AM_ACC)                                                       \
+    X(0x2b, pld, AM_STK)                                                       \
+    X(0x2c, bit, AM_ABS)                                                       \
+    X(0x2d, and_, AM_ABS)                                                      \
+    X(0x2e, rol, AM_ABS)                                                       \
+    X(0x2f, and_, AM_ABS_L)                                                    \
+    X(0x30, bmi, AM_PC_REL)                                                    \
+    X(0x31, and_, AM_INDY_DIR)                                                 \
+    X(0x32, and_, AM_IND_DIR)                                                  \
+    X(0x33, and_, AM_STK_REL_INDY)                                             \
+    X(0x34, bit, AM_ZBKX_DIR)                                                  \
+    X(0x35, and_, AM_ZBKX_DIR)                                                 \
+    X(0x36, rol, AM_ZBKX_DIR)                                                  \
+    X(0x37, and_, AM_INDY_DIR_L)                                               \
+    X(0x38, sec, AM_IMP)                                                       \
+    X(0x39, and_, AM_ABSY)                                                     \
+    X(0x3a, dec, AM_ACC)                                                       \
+    X(0x3b, tsc, AM_IMP)                                                       \
+    X(0x3c, bit, AM_ABSX)                                                      \
+    X(0x3d, and_, AM_ABSX)                                                     \
+    X(0x3e, rol, AM_ABSX)                                                      \
+    X(0x3f, and_, AM_ABSX_L)                                                   \
+    X(0x40, rti, AM_STK)                                                       \
+    X(0x41, eor, AM_INDX_DIR)                                                  \
+    X(0x42, wdm, AM_IMM)                                                       \
+    X(0x43, eor, AM_STK_REL)                                                   \
+    X(0x44, mvp, AM_BLK)                                                       \
+    X(0x45, eor, AM_DIR)                                                       \
+    X(0x46, lsr, AM_DIR)                                                       \
+    X(0x47, eor, AM_IND_DIR_L)                                                 \
+    X(0x48, pha, AM_STK)                                                       \
+    X(0x49, eor, AM_IMM)                                                       \
+    X(0x4a, lsr, AM_ACC)                                                       \
+    X(0x4b, phk, AM_STK)                                                       \
+    X(0x4c, jmp, AM_ABS)                                                       \
+    X(0x4d, eor, AM_ABS)                                                       \
+    X(0x4e, lsr, AM_ABS)                                                       \
+    X(0x4f, eor, AM_ABS_L)                                                     \
+    X(0x50, bvc, AM_PC_REL)                                                    \
+    X(0x51, eor, AM_INDY_DIR)                                                  \
+    X(0x52, eor, AM_IND_DIR)                                                   \
+    X(0x53, eor, AM_STK_REL_INDY)                                              \
+    X(0x54, mvn, AM_BLK)                                                       \
+    X(0x55, eor, AM_ZBKX_DIR)                                                  \
+    X(0x56, lsr, AM_ZBKX_DIR)                                                  \
+    X(0x57, eor, AM_INDY_DIR_L)                                                \
+    X(0x58, cli, AM_IMP)                                                       \
+    X(0x59, eor, AM_ABSY)                                                      \
+    X(0x5a, phy, AM_STK)                                                       \
+    X(0x5b, tcd, AM_IMP)                                                       \
+    X(0x5c, jml, AM_ABS_L)                                                     \
+    X(0x5d, eor, AM_ABSX)                                                      \
+    X(0x5e, lsr, AM_ABSX)                                                      \
+    X(0x5f, eor, AM_ABSX_L)                                                    \
+    X(0x60, rts, AM_IMP)                                                       \
+    X(0x61, adc, AM_INDX_DIR)                                                  \
+    X(0x62, per, AM_PC_REL_L)                                                  \
+    X(0x63, adc, AM_STK_REL)                                                   \
+    X(0x64, stz, AM_DIR)                                                       \
+    X(0x65, adc, AM_DIR)                                                       \
+    X(0x66, ror, AM_DIR)                                                       \
+    X(0x67, adc, AM_IND_DIR_L)                                                 \
+    X(0x68, pla, AM_STK)                                                       \
+    X(0x69, adc, AM_IMM)                                                       \
+    X(0x6a, ror, AM_ACC)                                                       \
+    X(0x6b, rtl, AM_IMP)                                                       \
+    X(0x6c, jmp, AM_IND)                                                       \
+    X(0x6d, adc, AM_ABS)                                                       \
+    X(0x6e, ror, AM_ABS)                                                       \
+    X(0x6f, adc, AM_ABS_L)                                                     \
+    X(0x70, bvs, AM_PC_REL)                                                    \
+    X(0x71, adc, AM_INDY_DIR)                                                  \
+    X(0x72, adc, AM_IND_DIR)                                                   \
+    X(0x73, adc, AM_STK_REL_INDY)                                              \
+    X(0x74, stz, AM_ZBKX_DIR)                                                  \
+    X(0x75, adc, AM_ZBKX_DIR)                                                  \
+    X(0x76, ror, AM_ZBKX_DIR)                                                  \
+    X(0x77, adc, AM_INDY_DIR_L)                                                \
+    X(0x78, sei, AM_IMP)                                                       \
+    X(0x79, adc, AM_ABSY)                                                      \
+    X(0x7a, ply, AM_STK)                                                       \
+    X(0x7b, tdc, AM_IMP)                                                       \
+    X(0x7c, jmp, AM_INDX)                                                      \
+    X(0x7d, adc, AM_ABSX)                                                      \
+    X(0x7e, ror, AM_ABSX)                                                      \
+    X(0x7f, adc, AM_ABSX_L)                                                    \
+    X(0x80, bra, AM_PC_REL)                                                    \
+    X(0x81, sta, AM_INDX_DIR)                                                  \
+    X(0x82, brl, AM_PC_REL_L)                                                  \
+    X(0x83, sta, AM_STK_REL)                                                   \
+    X(0x84, sty, AM_DIR)                                                       \
+    X(0x85, sta, AM_DIR)                                                       \
+    X(0x86, stx, AM_DIR)                                                       \
+    X(0x87, sta, AM_IND_DIR_L)                                                 \
+    X(0x88, dey, AM_IMP)                                                       \
+    X(0x89, bit, AM_IMM)                                                       \
+    X(0x8a, txa, AM_IMP)                                                       \
+    X(0x8b, phb, AM_STK)                                                       \
+    X(0x8c, sty, AM_ABS)                                                       \
+    X(0x8d, sta, AM_ABS)                                                       \
+    X(0x8e, stx, AM_ABS)                                                       \
+    X(0x8f, sta, AM_ABS_L)                                                     \
+    X(0x90, bcc, AM_PC_REL)                                                    \
+    X(0x91, sta, AM_INDY_DIR)                                                  \
+    X(0x92, sta, AM_IND_DIR)                                                   \
+    X(0x93, sta, AM_STK_REL_INDY)                                              \
+    X(0x94, sty, AM_ZBKX_DIR)                                                  \
+    X(0x95, sta, AM_ZBKX_DIR)                                                  \
+    X(0x96, stx, AM_ZBKY_DIR)                                                  \
+    X(0x97, sta, AM_INDY_DIR_L)                                                \
+    X(0x98, tya, AM_ACC)                                                       \
+    X(0x99, sta, AM_ABSY)                                                      \
+    X(0x9a, txs, AM_IMP)                                                       \
+    X(0x9b, txy, AM_IMP)                                                       \
+    X(0x9c, stz, AM_ABS)                                                       \
+    X(0x9d, sta, AM_ABSX)                                                      \
+    X(0x9e, stz, AM_ABSX)                                                      \
+    X(0x9f, sta, AM_ABSX_L)                                                    \
+    X(0xa0, ldy, AM_IMM)                                                       \
+    X(0xa1, lda, AM_INDX_DIR)                                                  \
+    X(0xa2, ldx, AM_IMM)                                                       \
+    X(0xa3, lda, AM_STK_REL)                                                   \
+    X(0xa4, ldy, AM_DIR)                                                       \
+    X(0xa5, lda, AM_DIR)                                                       \
+    X(0xa6, ldx, AM_DIR)                                                       \
+    X(0xa7, lda, AM_IND_DIR_L)                                                 \
+    X(0xa8, tay, AM_IMP)                                                       \
+    X(0xa9, lda, AM_IMM)                                                       \
+    X(0xaa, tax, AM_IMP)                                                       \
+    X(0xab, plb, AM_STK)                                                       \
+    X(0xac, ldy, AM_ABS)                                                       \
+    X(0xad, lda, AM_ABS)                                                       \
+    X(0xae, ldx, AM_ABS)                                                       \
+    X(0xaf, lda, AM_ABS_L)                                                     \
+    X(0xb0, bcs, AM_PC_REL)                                                    \
+    X(0xb1, lda, AM_INDY_DIR)                                                  \
+    X(0xb2, lda, AM_IND_DIR)                                                   \
+    X(0xb3, lda, AM_STK_REL_INDY)                                              \
+    X(0xb4, ldy, AM_ZBKX_DIR)                                                  \
+    X(0xb5, lda, AM_ZBKX_DIR)                                                  \
+    X(0xb6, ldx, AM_ZBKY_DIR)                                                  \
+    X(0xb7, lda, AM_INDY_DIR_L)                                                \
+    X(0xb8, clv, AM_IMP)                                                       \
+    X(0xb9, lda, AM_ABSY)                                                      \
+    X(0xba, tsx, AM_IMP)                                                       \
+    X(0xbb, tyx, AM_IMP)                                                       \
+    X(0xbc, ldy, AM_ABSX)                                                      \
+    X(0xbd, lda, AM_ABSX)                                                      \
+    X(0xbe, ldx, AM_ABSY)                                                      \
+    X(0xbf, lda, AM_ABSX_L)                                                    \
+    X(0xc0, cpy, AM_IMM)                                                       \
+    X(0xc1, cmp, AM_INDX_DIR)                                                  \
+    X(0xc2, rep, AM_IMM)                                                       \
+    X(0xc3, cmp, AM_STK_REL)                                                   \
+    X(0xc4, cpy, AM_DIR)                                                       \
+    X(0xc5, cmp, AM_DIR)                                                       \
+    X(0xc6, dec, AM_DIR)                                                       \
+    X(0xc7, cmp, AM_IND_DIR_L)                                                 \
+    X(0xc8, iny, AM_IMP)                                                       \
+    X(0xc9, cmp, AM_IMM)                                                       \
+    X(0xca, dex, AM_IMP)                                                       \
+    X(0xcb, wai, AM_IMP)                                                       \
+    X(0xcc, cpy, AM_ABS)                                                       \
+    X(0xcd, cmp, AM_ABS)                                                       \
+    X(0xce, dec, AM_ABS)                                                       \
+    X(0xcf, cmp, AM_ABS_L)                                                     \
+    X(0xd0, bne, AM_PC_REL)                                                    \
+    X(0xd1, cmp, AM_INDY_DIR)                                                  \
+    X(0xd2, cmp, AM_IND_DIR)                                                   \
+    X(0xd3, cmp, AM_STK_REL_INDY)                                              \
+    X(0xd4, pei, AM_STK)                                                       \
+    X(0xd5, cmp, AM_ZBKX_DIR)                                                  \
+    X(0xd6, dec, AM_ZBKX_DIR)                                                  \
+    X(0xd7, cmp, AM_INDY_DIR_L)                                                \
+    X(0xd8, cld, AM_IMP)                                                       \
+    X(0xd9, cmp, AM_ABSY)                                                      \
+    X(0xda, phx, AM_STK)                                                       \
+    X(0xdc, jml, AM_IND)                                                       \
+    X(0xdd, cmp, AM_ABSX)                                                      \
+    X(0xde, dec, AM_ABSX)                                                      \
+    X(0xdf, cmp, AM_ABSX_L)                                                    \
+    X(0xe0, cpx, AM_IMM)                                                       \
+    X(0xe1, sbc, AM_INDX_DIR)                                                  \
+    X(0xe2, sep, AM_IMM)                                                       \
+    X(0xe3, sbc, AM_STK_REL)                                                   \
+    X(0xe4, cpx, AM_DIR)                                                       \
+    X(0xe5, sbc, AM_DIR)                                                       \
+    X(0xe6, inc, AM_DIR)                                                       \
+    X(0xe7, sbc, AM_IND_DIR_L)                                                 \
+    X(0xe8, inx, AM_IMP)                                                       \
+    X(0xe9, sbc, AM_IMM)                                                       \
+    X(0xea, nop, AM_IMP)                                                       \
+    X(0xeb, xba, AM_IMP)                                                       \
+    X(0xec, cpx, AM_ABS)                                                       \
+    X(0xed, sbc, AM_ABS)                                                       \
+    X(0xee, inc, AM_ABS)                                                       \
+    X(0xef, sbc, AM_ABS_L)                                                     \
+    X(0xf0, beq, AM_PC_REL)                                                    \
+    X(0xf1, sbc, AM_INDY_DIR)                                                  \
+    X(0xf2, sbc, AM_IND_DIR)                                                   \
+    X(0xf3, sbc, AM_STK_REL_INDY)                                              \
+    X(0xf4, pea, AM_STK)                                                       \
+    X(0xf5, sbc, AM_ZBKX_DIR)                                                  \
+    X(0xf6, inc, AM_ZBKX_DIR)                                                  \
+    X(0xf7, sbc, AM_INDY_DIR_L)                                                \
+    X(0xf8, sed, AM_IMP)                                                       \
+    X(0xf9, sbc, AM_ABSY)                                                      \
+    X(0xfa, plx, AM_STK)                                                       \
+    X(0xfb, xce, AM_ACC)                                                       \
+    X(0xfc, jsr, AM_INDX)                                                      \
+    X(0xfd, sbc, AM_ABSX)                                                      \
+    X(0xfe, inc, AM_ABSX)                                                      \
+    X(0xff, sbc, AM_ABSX_L)
+
 #endif
@@ -0,0 +1,780 @@
+#include "cpu_jit.h"
+#include "cpu.h"
+#include "cpu_blocks.h"
+#include "cpu_idle.h"
+#include "types.h"
+#include <stddef.h>
+
+// ROM blocks that run often are compiled to x86-64. For every instruction the
+// code does what cpu_execute does around the handler: it notes where the
+// instruction started for the run's catch-ups, writes the history, charges the
+// decoded clocks and sets PC. Flag changes, register transfers, immediates,
+// absolute loads and stores and branches are then done natively, anything
+// else calls the handler the interpreter would.
+//
+// A block only runs under the M, X and E flags it was decoded for, and
+// everything that changes them ends the block. In between instructions the
+// code skips the checks try_step_cpu makes, so it's only entered when none of
+// them can fire: no interrupt pending, no breakpoints, no profiler and no idle
+// loop being recorded. Unmasking IRQs ends a block as well. What else raises
+// an interrupt or ends the run goes through a register, so after any
+// instruction that touched one the code hands back to the interpreter, and
+// also once the CPU is out of clocks. Absolute accesses go straight to the
+// host page and leave registers and open bus to the handler.
+//
+// ROM is never written, so compiled blocks only go stale when ROM changes
+// speed and their clocks with it. Code in RAM stays with the interpreter.
+//
+// The pages of the code buffer are only writable while a block is compiled
+// into them, and executable the rest of the time.
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+
+// times a block has to be reached before it's compiled
+#define CPU_JIT_HOT 64
+#define CPU_JIT_CODE_SIZE 0x800000
+// more than the longest block compiles to
+#define CPU_JIT_BLOCK_CODE 0x2000
+
+#define AT(field) ((int32_t)offsetof(snes_t, field))
+
+enum { RAX, RCX, RDX };
+enum { JE = 0x74, JNE = 0x75, JG = 0x7f };
+
+typedef struct {
+    uint8_t *at;
+} emitter_t;
+
+static void emit(emitter_t *e, const uint8_t *bytes, size_t size) {
+    memcpy(e->at, bytes, size);
+    e->at += size;
+}
+
+#define EMIT(e, ...)                                                           \
+    emit(e, (const uint8_t[]){__VA_ARGS__},                                    \
+         sizeof((const uint8_t[]){__VA_ARGS__}))
+
+static void emit_16(emitter_t *e, uint16_t value) {
+    emit(e, (const uint8_t *)&value, sizeof(value));
+}
+
+static void emit_32(emitter_t *e, uint32_t value) {
+    emit(e, (const uint8_t *)&value, sizeof(value));
+}
+
+static void emit_64(emitter_t *e, uint64_t value) {
+    emit(e, (const uint8_t *)&value, sizeof(value));
+}
+
+// the memory operand [rbx + offset], rbx holds snes. reg is the other operand
+// or the opcode extension
+static void at_snes(emitter_t *e, uint8_t reg, int32_t offset) {
+    EMIT(e, 0x80 | reg << 3 | 3);
+    emit_32(e, offset);
+}
+
+// the memory operand [rdx + offset], rdx holds a host page
+static void at_page(emitter_t *e, uint8_t reg, uint16_t addr) {
+    EMIT(e, 0x80 | reg << 3 | 2);
+    emit_32(e, addr & (MMU_PAGE_SIZE - 1));
+}
+
+// returns what the block's code returns after uop ran
+static void emit_return(emitter_t *e, const cpu_uop_t *uop) {
+    // mov eax, opcode << 24 | PBR:PC; pop rbx; ret
+    EMIT(e, 0xb8);
+    emit_32(e, (uint32_t)uop->opcode << 24 | uop->addr);
+    EMIT(e, 0x5b, 0xc3);
+}
+
+// returns after uop unless the condition jcc tests holds
+static void return_unless(emitter_t *e, uint8_t jcc, const cpu_uop_t *uop) {
+    EMIT(e, jcc, 7);
+    emit_return(e, uop);
+}
+
+// jz or jmp to a target patch fills in later
+static uint8_t *jump_32(emitter_t *e, bool if_zero) {
+    if (if_zero) {
+        EMIT(e, 0x0f, 0x84);
+    } else {
+        EMIT(e, 0xe9);
+    }
+    uint8_t *displacement = e->at;
+    emit_32(e, 0);
+    return displacement;
+}
+
+static void patch(uint8_t *displacement, const uint8_t *target) {
+    int32_t offset = target - (displacement + 4);
+    memcpy(displacement, &offset, sizeof(offset));
+}
+
+static void set_pc(emitter_t *e, uint16_t pc) {
+    // mov word [pc], pc
+    EMIT(e, 0x66, 0xc7);
+    at_snes(e, 0, AT(cpu.pc));
+    emit_16(e, pc);
+}
+
+// movzx eax, byte or word [offset]
+static void load_eax(emitter_t *e, int32_t offset, bool narrow) {
+    EMIT(e, 0x0f, narrow ? 0xb6 : 0xb7);
+    at_snes(e, RAX, offset);
+}
+
+// mov [offset], al or ax
+static void store_eax(emitter_t *e, int32_t offset, bool narrow) {
+    if (narrow) {
+        EMIT(e, 0x88);
+    } else {
+        EMIT(e, 0x66, 0x89);
+    }
+    at_snes(e, RAX, offset);
+}
+
+// N and Z from the result in eax, zero-extended from its width
+static void set_nz(emitter_t *e, bool narrow) {
+    EMIT(e, 0x66, 0x89);
+    at_snes(e, RAX, AT(cpu.z_result));
+    if (narrow)
+        EMIT(e, 0xc1, 0xe0, 8); // shl eax, 8
+    EMIT(e, 0x66, 0x89);
+    at_snes(e, RAX, AT(cpu.n_result));
+}
+
+// set_status_bit and get_status_bit set bits 4 and 5 again in emulation mode
+static void emulation_bits(emitter_t *e, uint8_t flags) {
+    if (flags & CPU_FLAG_E) {
+        // or byte [p], 0x30
+        EMIT(e, 0x80);
+        at_snes(e, 1, AT(cpu.p));
+        EMIT(e, 0x30);
+    }
+}
+
+// what cpu_execute does before the instruction runs
+static void start(emitter_t *e, const cpu_uop_t *uop, uint8_t index) {
+    if (index > 0) {
+        // mov rax, [remaining_clocks]; mov [op_clocks], rax
+        EMIT(e, 0x48, 0x8b);
+        at_snes(e, RAX, AT(cpu.remaining_clocks));
+        EMIT(e, 0x48, 0x89);
+        at_snes(e, RAX, AT(cpu_run.op_clocks));
+    }
+    // movzx ecx, word [history_idx]
+    EMIT(e, 0x0f, 0xb7);
+    at_snes(e, RCX, AT(cpu.history_idx));
+    // mov byte [rcx + opcode_history], opcode
+    EMIT(e, 0xc6, 0x84, 0x0b);
+    emit_32(e, AT(cpu.opcode_history));
+    EMIT(e, uop->opcode);
+    // mov dword [rcx * 4 + pc_history], PBR:PC past the opcode
+    EMIT(e, 0xc7, 0x84, 0x8b);
+    emit_32(e, AT(cpu.pc_history));
+    emit_32(e, TO_U24((uint16_t)(U24_LOSHORT(uop->addr) + 1),
+                      U24_HIBYTE(uop->addr)));
+    // inc word [history_idx]
+    EMIT(e, 0x66, 0xff);
+    at_snes(e, 0, AT(cpu.history_idx));
+    // sub qword [remaining_clocks], clocks
+    EMIT(e, 0x48, 0x81);
+    at_snes(e, 5, AT(cpu.remaining_clocks));
+    emit_32(e, uop->clocks);
+}
+
+// calls the handler as cpu_execute does. Unless the instruction is the last
+// one, the block ends after it if it touched a register or PC isn't next
+static void call_handler(emitter_t *e, const cpu_uop_t *uop, bool last,
+                         uint16_t next) {
+    set_pc(e, U24_LOSHORT(uop->addr) + 1);
+    // mov rax, operands; mov [cpu_fetch], rax
+    EMIT(e, 0x48, 0xb8);
+    emit_64(e, (uintptr_t)uop->operands);
+    EMIT(e, 0x48, 0x89);
+    at_snes(e, RAX, AT(cpu_fetch));
+    // mov rdi, rbx; mov rax, op; call rax
+    EMIT(e, 0x48, 0x89, 0xdf);
+    EMIT(e, 0x48, 0xb8);
+    emit_64(e, (uintptr_t)uop->op);
+    EMIT(e, 0xff, 0xd0);
+    // mov qword [cpu_fetch], 0
+    EMIT(e, 0x48, 0xc7);
+    at_snes(e, 0, AT(cpu_fetch));
+    emit_32(e, 0);
+    if (last)
+        return;
+    // cmp word [pc], next
+    EMIT(e, 0x66, 0x81);
+    at_snes(e, 7, AT(cpu.pc));
+    emit_16(e, next);
+    return_unless(e, JE, uop);
+    // cmp byte [mmio], 0
+    EMIT(e, 0x80);
+    at_snes(e, 7, AT(cpu_run.mmio));
+    EMIT(e, 0);
+    return_unless(e, JE, uop);
+}
+
+static void set_status(emitter_t *e, uint8_t bits, bool value, uint8_t flags) {
+    // or or and byte [p], bits
+    EMIT(e, 0x80);
+    at_snes(e, value ? 1 : 4, AT(cpu.p));
+    EMIT(e, value ? bits : (uint8_t)~bits);
+    emulation_bits(e, flags);
+}
+
+static void step(emitter_t *e, int32_t reg, bool increment, bool narrow) {
+    // inc or dec byte or word [reg]
+    if (narrow) {
+        EMIT(e, 0xfe);
+    } else {
+        EMIT(e, 0x66, 0xff);
+    }
+    at_snes(e, increment ? 0 : 1, reg);
+    load_eax(e, reg, narrow);
+    set_nz(e, narrow);
+}
+
+static void transfer(emitter_t *e, int32_t from, int32_t to, bool narrow) {
+    load_eax(e, from, narrow);
+    store_eax(e, to, narrow);
+    set_nz(e, narrow);
+}
+
+static void load_immediate(emitter_t *e, int32_t reg, uint16_t value,
+                           bool narrow) {
+    // mov byte or word [reg], value, N and Z are known as well
+    if (narrow) {
+        EMIT(e, 0xc6);
+        at_snes(e, 0, reg);
+        EMIT(e, value);
+    } else {
+        EMIT(e, 0x66, 0xc7);
+        at_snes(e, 0, reg);
+        emit_16(e, value);
+    }
+    EMIT(e, 0x66, 0xc7);
+    at_snes(e, 0, AT(cpu.z_result));
+    emit_16(e, value);
+    EMIT(e, 0x66, 0xc7);
+    at_snes(e, 0, AT(cpu.n_result));
+    emit_16(e, narrow ? value << 8 : value);
+}
+
+static void compare_immediate(emitter_t *e, int32_t reg, uint16_t value,
+                              bool narrow, uint8_t flags) {
+    load_eax(e, reg, narrow);
+    // sub eax, value; setns dl
+    EMIT(e, 0x2d);
+    emit_32(e, value);
+    EMIT(e, 0x0f, 0x99, 0xc2);
+    // and byte [p], ~1; or [p], dl
+    EMIT(e, 0x80);
+    at_snes(e, 4, AT(cpu.p));
+    EMIT(e, 0xfe);
+    EMIT(e, 0x08);
+    at_snes(e, RDX, AT(cpu.p));
+    emulation_bits(e, flags);
+    if (narrow)
+        EMIT(e, 0x0f, 0xb6, 0xc0); // movzx eax, al
+    set_nz(e, narrow);
+}
+
+// extension picks and, or or xor
+static void logic_immediate(emitter_t *e, uint8_t extension, uint16_t value,
+                            bool narrow) {
+    if (narrow) {
+        EMIT(e, 0x80);
+        at_snes(e, extension, AT(cpu.c));
+        EMIT(e, value);
+    } else {
+        EMIT(e, 0x66, 0x81);
+        at_snes(e, extension, AT(cpu.c));
+        emit_16(e, value);
+    }
+    load_eax(e, AT(cpu.c), narrow);
+    set_nz(e, narrow);
+}
+
+// rdx is the host page of DBR:addr from pages and rcx its index. Returns the
+// jump taken if it has none
+static uint8_t *host_page(emitter_t *e, uint16_t addr, int32_t pages) {
+    // movzx ecx, byte [dbr]; shl ecx, 4; or ecx, addr >> 12
+    EMIT(e, 0x0f, 0xb6);
+    at_snes(e, RCX, AT(cpu.dbr));
+    EMIT(e, 0xc1, 0xe1, 16 - MMU_PAGE_BITS);
+    EMIT(e, 0x81, 0xc9);
+    emit_32(e, addr >> MMU_PAGE_BITS);
+    // mov rdx, [rcx * 8 + pages]; test rdx, rdx
+    EMIT(e, 0x48, 0x8b, 0x94, 0xcb);
+    emit_32(e, pages);
+    EMIT(e, 0x48, 0x85, 0xd2);
+    return jump_32(e, true);
+}
+
+// charges the accesses to the page in rcx as charge_access does
+static void charge(emitter_t *e, bool narrow) {
+    // movzx r8d, byte [rcx + access_clocks]; sub r8d, 6
+    EMIT(e, 0x44, 0x0f, 0xb6, 0x84, 0x0b);
+    emit_32(e, AT(access_clocks));
+    EMIT(e, 0x41, 0x83, 0xe8, 6);
+    if (!narrow)
+        EMIT(e, 0x41, 0xd1, 0xe0); // shl r8d, 1
+    // sub [remaining_clocks], r8
+    EMIT(e, 0x4c, 0x29);
+    at_snes(e, 0, AT(cpu.remaining_clocks));
+}
+
+// reads from pages that are neither registers nor open bus. Accesses that
+// cross into the next page are left to the handler
+static void load_absolute(emitter_t *e, const cpu_uop_t *uop, int32_t reg,
+                          bool narrow, bool last, uint16_t next) {
+    uint16_t addr = TO_U16(uop->operands[0], uop->operands[1]);
+    uint8_t *done = NULL;
+    if (narrow || (addr & (MMU_PAGE_SIZE - 1)) != MMU_PAGE_SIZE - 1) {
+        uint8_t *slow = host_page(e, addr, AT(read_pages));
+        charge(e, narrow);
+        // movzx eax, byte or word [rdx + addr]
+        EMIT(e, 0x0f, narrow ? 0xb6 : 0xb7);
+        at_page(e, RAX, addr);
+        store_eax(e, reg, narrow);
+        set_nz(e, narrow);
+        set_pc(e, next);
+        done = jump_32(e, false);
+        patch(slow, e->at);
+    }
+    call_handler(e, uop, last, next);
+    if (done != NULL)
+        patch(done, e->at);
+}
+
+// reg is -1 for stz
+static void store_absolute(emitter_t *e, const cpu_uop_t *uop, int32_t reg,
+                           bool narrow, bool last, uint16_t next) {
+    uint16_t addr = TO_U16(uop->operands[0], uop->operands[1]);
+    uint8_t *done = NULL;
+    if (narrow || (addr & (MMU_PAGE_SIZE - 1)) != MMU_PAGE_SIZE - 1) {
+        uint8_t *slow = host_page(e, addr, AT(write_pages));
+        charge(e, narrow);
+        if (reg < 0) {
+            // mov byte or word [rdx + addr], 0
+            if (narrow) {
+                EMIT(e, 0xc6);
+                at_page(e, 0, addr);
+                EMIT(e, 0);
+            } else {
+                EMIT(e, 0x66, 0xc7);
+                at_page(e, 0, addr);
+                emit_16(e, 0);
+            }
+        } else {
+            load_eax(e, reg, narrow);
+            // mov [rdx + addr], al or ax
+            if (narrow) {
+                EMIT(e, 0x88);
+            } else {
+                EMIT(e, 0x66, 0x89);
+            }
+            at_page(e, RAX, addr);
+        }
+        // mov rdx, [rcx * 8 + write_generations]; add dword [rdx], bytes
+        EMIT(e, 0x48, 0x8b, 0x94, 0xcb);
+        emit_32(e, AT(write_generations));
+        EMIT(e, 0x83, 0x02, narrow ? 1 : 2);
+        set_pc(e, next);
+        done = jump_32(e, false);
+        patch(slow, e->at);
+    }
+    call_handler(e, uop, last, next);
+    if (done != NULL)
+        patch(done, e->at);
+}
+
+static void branch(emitter_t *e, const cpu_uop_t *uop, uint8_t flags) {
+    uint16_t next = U24_LOSHORT(uop->addr) + 2;
+    uint16_t target = next + (int8_t)uop->operands[0];
+    if (uop->opcode == 0x80) {
+        set_pc(e, target);
+        return;
+    }
+    set_pc(e, next);
+    // the jcc that skips the branch, after testing the flag it depends on
+    uint8_t skip;
+    switch (uop->opcode) {
+    case 0x10: // bpl
+    case 0x30: // bmi
+        // test word [n_result], 0x8000
+        EMIT(e, 0x66, 0xf7);
+        at_snes(e, 0, AT(cpu.n_result));
+        emit_16(e, 0x8000);
+        skip = uop->opcode == 0x10 ? JNE : JE;
+        break;
+    case 0xd0: // bne
+    case 0xf0: // beq
+        // cmp word [z_result], 0
+        EMIT(e, 0x66, 0x83);
+        at_snes(e, 7, AT(cpu.z_result));
+        EMIT(e, 0);
+        skip = uop->opcode == 0xf0 ? JNE : JE;
+        break;
+    default:
+        // bvc, bvs, bcc and bcs, test byte [p], bit
+        emulation_bits(e, flags);
+        EMIT(e, 0xf6);
+        at_snes(e, 0, AT(cpu.p));
+        EMIT(e, uop->opcode < 0x90 ? 1 << STATUS_OVERFLOW : 1 << STATUS_CARRY);
+        skip = uop->opcode == 0x50 || uop->opcode == 0x90 ? JNE : JE;
+        break;
+    }
+    // over the 9 bytes of set_pc
+    EMIT(e, skip, 9);
+    set_pc(e, target);
+}
+
+// bytes of the instructions compiled to native code, 0 for the rest
+static uint8_t native_length(uint8_t opcode, uint8_t flags) {
+    switch (opcode) {
+    case 0x18: // clc
+    case 0x38: // sec
+    case 0x58: // cli
+    case 0x78: // sei
+    case 0xb8: // clv
+    case 0xd8: // cld
+    case 0xf8: // sed
+    case 0xea: // nop
+    case 0xe8: // inx
+    case 0xc8: // iny
+    case 0xca: // dex
+    case 0x88: // dey
+    case 0xaa: // tax
+    case 0xa8: // tay
+    case 0x8a: // txa
+    case 0x98: // tya
+        return 1;
+    case 0x09: // ora
+    case 0x29: // and
+    case 0x49: // eor
+    case 0xa9: // lda
+    case 0xc9: // cmp
+        return flags & CPU_FLAG_M ? 2 : 3;
+    case 0xa0: // ldy
+    case 0xa2: // ldx
+    case 0xc0: // cpy
+    case 0xe0: // cpx
+        return flags & CPU_FLAG_X ? 2 : 3;
+    case 0x10: // bpl
+    case 0x30: // bmi
+    case 0x50: // bvc
+    case 0x70: // bvs
+    case 0x80: // bra
+    case 0x90: // bcc
+    case 0xb0: // bcs
+    case 0xd0: // bne
+    case 0xf0: // beq
+        return 2;
+    case 0x8c: // sty
+    case 0x8d: // sta
+    case 0x8e: // stx
+    case 0x9c: // stz
+    case 0xac: // ldy
+    case 0xad: // lda
+    case 0xae: // ldx
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// flag changes, transfers and immediates, which leave PC to the caller
+static void simple(snes_t *snes, emitter_t *e, const cpu_uop_t *uop,
+                   uint8_t flags) {
+    bool m = flags & CPU_FLAG_M;
+    bool x = flags & CPU_FLAG_X;
+    uint16_t operand = TO_U16(uop->operands[0], uop->operands[1]);
+    uint16_t imm_m = m ? uop->operands[0] : operand;
+    uint16_t imm_x = x ? uop->operands[0] : operand;
+    switch (uop->opcode) {
+    case 0x18: // clc
+        set_status(e, 1 << STATUS_CARRY, false, flags);
+        break;
+    case 0x38: // sec
+        set_status(e, 1 << STATUS_CARRY, true, flags);
+        break;
+    case 0x58: // cli
+        set_status(e, 1 << STATUS_IRQOFF, false, flags);
+        break;
+    case 0x78: // sei
+        set_status(e, 1 << STATUS_IRQOFF, true, flags);
+        break;
+    case 0xb8: // clv
+        set_status(e, 1 << STATUS_OVERFLOW, false, flags);
+        break;
+    case 0xd8: // cld
+        set_status(e, 1 << STATUS_BCD, false, flags);
+        break;
+    case 0xf8: // sed
+        set_status(e, 1 << STATUS_BCD, true, flags);
+        break;
+    case 0xea: // nop
+        break;
+    case 0xe8: // inx
+        step(e, AT(cpu.x), true, x);
+        break;
+    case 0xc8: // iny
+        step(e, AT(cpu.y), true, x);
+        break;
+    case 0xca: // dex
+        step(e, AT(cpu.x), false, x);
+        break;
+    case 0x88: // dey
+        step(e, AT(cpu.y), false, x);
+        break;
+    case 0xaa: // tax
+        transfer(e, AT(cpu.c), AT(cpu.x), x);
+        break;
+    case 0xa8: // tay
+        transfer(e, AT(cpu.c), AT(cpu.y), x);
+        break;
+    case 0x8a: // txa
+        transfer(e, AT(cpu.x), AT(cpu.c), m);
+        break;
+    case 0x98: // tya
+        transfer(e, AT(cpu.y), AT(cpu.c), m);
+        break;
+    case 0xa9: // lda
+        load_immediate(e, AT(cpu.c), imm_m, m);
+        break;
+    case 0xa2: // ldx
+        load_immediate(e, AT(cpu.x), imm_x, x);
+        break;
+    case 0xa0: // ldy
+        load_immediate(e, AT(cpu.y), imm_x, x);
+        break;
+    case 0xc9: // cmp
+        compare_immediate(e, AT(cpu.c), imm_m, m, flags);
+        break;
+    case 0xe0: // cpx
+        compare_immediate(e, AT(cpu.x), imm_x, x, flags);
+        break;
+    case 0xc0: // cpy
+        compare_immediate(e, AT(cpu.y), imm_x, x, flags);
+        break;
+    case 0x29: // and
+        logic_immediate(e, 4, imm_m, m);
+        break;
+    case 0x09: // ora
+        logic_immediate(e, 1, imm_m, m);
+        break;
+    case 0x49: // eor
+        logic_immediate(e, 6, imm_m, m);
+        break;
+    default:
+        UNREACHABLE_SWITCH(uop->opcode);
+    }
+}
+
+// next is the PC the following instruction starts at, if there is one
+static void compile_uop(snes_t *snes, emitter_t *e, const cpu_uop_t *uop,
+                        uint8_t flags, uint8_t index, bool last,
+                        uint16_t next) {
+    start(e, uop, index);
+    bool m = flags & CPU_FLAG_M;
+    bool x = flags & CPU_FLAG_X;
+    uint8_t length = native_length(uop->opcode, flags);
+    uint16_t end = U24_LOSHORT(uop->addr) + length;
+    if (length == 0 || (!last && end != next)) {
+        call_handler(e, uop, last, next);
+    } else {
+        switch (uop->opcode) {
+        case 0x10: // bpl
+        case 0x30: // bmi
+        case 0x50: // bvc
+        case 0x70: // bvs
+        case 0x80: // bra
+        case 0x90: // bcc
+        case 0xb0: // bcs
+        case 0xd0: // bne
+        case 0xf0: // beq
+            branch(e, uop, flags);
+            break;
+        case 0xad: // lda
+            load_absolute(e, uop, AT(cpu.c), m, last, end);
+            break;
+        case 0xae: // ldx
+            load_absolute(e, uop, AT(cpu.x), x, last, end);
+            break;
+        case 0xac: // ldy
+            load_absolute(e, uop, AT(cpu.y), x, last, end);
+            break;
+        case 0x8d: // sta
+            store_absolute(e, uop, AT(cpu.c), m, last, end);
+            break;
+        case 0x8e: // stx
+            store_absolute(e, uop, AT(cpu.x), x, last, end);
+            break;
+        case 0x8c: // sty
+            store_absolute(e, uop, AT(cpu.y), x, last, end);
+            break;
+        case 0x9c: // stz
+            store_absolute(e, uop, -1, m, last, end);
+            break;
+        default:
+            simple(snes, e, uop, flags);
+            set_pc(e, end);
+            break;
+        }
+    }
+    if (last) {
+        emit_return(e, uop);
+    } else {
+        // cmp qword [remaining_clocks], 0
+        EMIT(e, 0x48, 0x83);
+        at_snes(e, 7, AT(cpu.remaining_clocks));
+        EMIT(e, 0);
+        return_unless(e, JG, uop);
+    }
+}
+
+// switches the pages a block is compiled into between writable and
+// executable, they're never both. Hosts that refuse leave everything to the
+// interpreter from then on
+static bool protect(snes_t *snes, uint32_t offset, int prot) {
+    uint32_t page = sysconf(_SC_PAGESIZE);
+    uint32_t start = offset / page * page;
+    uint32_t end =
+        MIN(offset + CPU_JIT_BLOCK_CODE + page - 1, CPU_JIT_CODE_SIZE) / page *
+        page;
+    if (mprotect(snes->cpu_jit.cache->code + start, end - start, prot) == 0)
+        return true;
+    log_message(LOG_LEVEL_WARNING,
+                "The JIT's code buffer can't be made %s, leaving every "
+                "instruction to the interpreter",
+                prot & PROT_EXEC ? "executable" : "writable");
+    snes->cpu_jit.disabled = true;
+    return false;
+}
+
+static bool compile(snes_t *snes, cpu_jit_block_t *block) {
+    cpu_jit_cache_t *cache = snes->cpu_jit.cache;
+    const cpu_block_t *decoded =
+        cpu_blocks_get(snes, block->addr, block->flags);
+    if (decoded->size == 0 ||
+        decoded->generation != &snes->block_cache->rom_generation)
+        return false;
+    if (cache->used + CPU_JIT_BLOCK_CODE > CPU_JIT_CODE_SIZE) {
+        // start over rather than keep track of what's free
+        cpu_jit_block_t keep = *block;
+        memset(cache->blocks, 0, sizeof(cache->blocks));
+        cache->used = 0;
+        *block = keep;
+    }
+    uint32_t offset = cache->used;
+    if (!protect(snes, offset, PROT_READ | PROT_WRITE))
+        return false;
+
+    uint8_t *code = cache->code + offset;
+    emitter_t e = {code};
+    // push rbx; mov rbx, rdi
+    EMIT(&e, 0x53, 0x48, 0x89, 0xfb);
+    bool last = false;
+    for (uint8_t i = 0; !last; i++) {
+        const cpu_uop_t *uop = &decoded->uops[i];
+        // the interpreter checks for IRQs once they are unmasked
+        last = i + 1 == decoded->size || uop->opcode == 0x58;
+        compile_uop(snes, &e, uop, block->flags, i, last,
+                    last ? 0 : U24_LOSHORT(decoded->uops[i + 1].addr));
+    }
+    ASSERT(e.at - code <= CPU_JIT_BLOCK_CODE,
+           "Compiled block at 0x%06x is %d bytes long", block->addr,
+           (int)(e.at - code));
+    cache->used += e.at - code;
+    if (!protect(snes, offset, PROT_READ | PROT_EXEC))
+        return false;
+    block->code = (uint32_t(*)(snes_t *))(void *)code;
+    return true;
+}
+
+// whether try_step_cpu has nothing to do after an instruction that doesn't
+// touch a register, unmask IRQs or change the flags
+static bool can_enter(snes_t *snes) {
+    cpu_t *cpu = &snes->cpu;
+    bool nmi = cpu->vblank_nmi_enable && cpu->memory.vblank_has_occurred &&
+               !cpu->prev_vblank;
+    bool irq = cpu->irq && !(cpu->p & (1 << STATUS_IRQOFF));
+    return snes->cpu_run.active && !snes->cpu_jit.disabled &&
+           cpu->breakpoints.kinds == 0 && !snes->profiler.enabled &&
+           snes->cpu_idle.state == CPU_IDLE_OFF && !nmi && !irq && !cpu->brk &&
+           !cpu->cop &&
+           // the compiled code leaves out the checks that set bits 4 and 5
+           // in emulation mode, they have to be set already
+           (!cpu->emulation_mode || (cpu->p & 0x30) == 0x30);
+}
+
+cpu_jit_cache_t *cpu_jit_create(void) {
+    cpu_jit_cache_t *cache = calloc(1, sizeof(cpu_jit_cache_t));
+    if (cache == NULL)
+        return NULL;
+    // mapped without write access, compile opens it up while it emits
+    cache->code = mmap(NULL, CPU_JIT_CODE_SIZE, PROT_READ | PROT_EXEC,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (cache->code == MAP_FAILED) {
+        log_message(LOG_LEVEL_WARNING,
+                    "No executable memory for the JIT, leaving every "
+                    "instruction to the interpreter");
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void cpu_jit_destroy(cpu_jit_cache_t *cache) {
+    if (cache == NULL)
+        return;
+    munmap(cache->code, CPU_JIT_CODE_SIZE);
+    free(cache);
+}
+
+bool cpu_jit_run(snes_t *snes) {
+    cpu_jit_cache_t *cache = snes->cpu_jit.cache;
+    if (cache == NULL || !can_enter(snes))
+        return false;
+    uint32_t addr = TO_U24(snes->cpu.pc, snes->cpu.pbr);
+    uint8_t flags = cpu_flags(snes);
+    uint32_t generation = snes->block_cache->rom_generation;
+    // Fibonacci hashing, nearby addresses and the same address under other
+    // flags land far apart
+    uint32_t hash = (addr | (uint32_t)flags << 24) * 0x9e3779b1u;
+    cpu_jit_block_t *block = &cache->blocks[hash >> (32 - CPU_JIT_BLOCK_BITS)];
+    if (block->addr != addr || block->flags != flags ||
+        block->generation_seen != generation) {
+        *block = (cpu_jit_block_t){
+            .addr = addr, .flags = flags, .generation_seen = generation};
+    }
+    if (block->code == NULL) {
+        if (block->rejected || ++block->hits < CPU_JIT_HOT)
+            return false;
+        if (!compile(snes, block)) {
+            block->rejected = true;
+            return false;
+        }
+    }
+
+    snes->cpu_run.mmio = false;
+    uint32_t last = block->code(snes);
+    cpu_idle_watch(snes, last & 0xffffff, last >> 24,
+                   snes->cpu_run.op_clocks - snes->cpu.remaining_clocks);
+    return true;
+}
+#else
+cpu_jit_cache_t *cpu_jit_create(void) { return NULL; }
+
+void cpu_jit_destroy(cpu_jit_cache_t *cache) { (void)cache; }
+
+bool cpu_jit_run(snes_t *snes) {
+    (void)snes;
+    return false;
+}
+#endif
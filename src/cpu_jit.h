@@ -0,0 +1,13 @@
+#ifndef CPU_JIT_H_
+#define CPU_JIT_H_
+
+#include "types.h"
+
+// NULL on hosts the JIT can't run on
+cpu_jit_cache_t *cpu_jit_create(void);
+void cpu_jit_destroy(cpu_jit_cache_t *cache);
+// runs the compiled block at PBR:PC, returns false if the instruction there is
+// left to the interpreter
+bool cpu_jit_run(snes_t *snes);
+
+#endif
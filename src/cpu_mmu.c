@@ -1,26 +1,24 @@
 #include "cpu_mmu.h"
+#include "ppu.h"
+#include "timing.h"
 #include "types.h"
 
-extern cpu_t cpu;
-extern ppu_t ppu;
-extern spc_t spc;
-
 // https://snes.nesdev.org/wiki/Memory_map#LoROM
-uint32_t lo_rom_resolve(uint32_t addr, bool log) {
+uint32_t lo_rom_resolve(snes_t *snes, uint32_t addr, bool log) {
     uint32_t ret = addr & 0x7fff;
     ret |= (addr >> 1) & 0b1111111000000000000000;
     if (log)
         log_message(LOG_LEVEL_VERBOSE,
                     "Resolved LoROM address 0x%06x to 0x%06x", addr, ret);
-    return ret % cpu.memory.rom_size;
+    return ret % snes->cpu.memory.rom_size;
 }
 
 // https://snes.nesdev.org/wiki/Memory_map#HiROM
-uint32_t hi_rom_resolve(uint32_t addr, bool log) {
+uint32_t hi_rom_resolve(snes_t *snes, uint32_t addr, bool log) {
     uint32_t ret = addr & 0x3fffff;
-    ASSERT(ret < cpu.memory.rom_size,
+    ASSERT(ret < snes->cpu.memory.rom_size,
            "ROM index 0x%06x larger than size 0x%06x", ret,
-           cpu.memory.rom_size);
+           snes->cpu.memory.rom_size);
     if (log)
         log_message(LOG_LEVEL_VERBOSE,
                     "Resolved HiROM address 0x%06x to 0x%06x", addr, ret);
@@ -28,26 +26,1154 @@ uint32_t hi_rom_resolve(uint32_t addr, bool log) {
 }
 
 // https://snes.nesdev.org/wiki/Memory_map#ExHiROM
-uint32_t ex_hi_rom_resolve(uint32_t addr, bool log) {
+uint32_t ex_hi_rom_resolve(snes_t *snes, uint32_t addr, bool log) {
     uint32_t ret = addr & 0x3fffff;
     ret |= ((~addr) >> 1) & 0x400000;
-    ASSERT(ret < cpu.memory.rom_size,
+    ASSERT(ret < snes->cpu.memory.rom_size,
            "ROM index 0x%06x larger than size 0x%06x", ret,
-           cpu.memory.rom_size);
+           snes->cpu.memory.rom_size);
     if (log)
         log_message(LOG_LEVEL_VERBOSE,
                     "Resolved ExHiROM address 0x%06x to 0x%06x", addr, ret);
     return ret;
 }
 
-uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
+// host address of a byte that is plain ROM, RAM or SRAM to the CPU, or NULL if
+// accessing it has side effects or no backing memory. Follows the same mapping
+// as mmu_read and mmu_write
+static uint8_t *host_address(snes_t *snes, uint16_t addr, uint8_t bank,
+                             bool write) {
+    cpu_mmu_t *memory = &snes->cpu.memory;
+    uint32_t addr24 = TO_U24(addr, bank);
+    bool hirom_sram =
+        ((bank >= 0x30 && bank < 0x40) || (bank >= 0xb0 && bank < 0xc0)) &&
+        addr >= 0x6000 && addr < 0x8000;
+
+    switch (memory->mode) {
+    case LOROM:
+        if (!write && (bank <= 0x7d || bank >= 0x80) && addr >= 0x8000)
+            return memory->rom + lo_rom_resolve(snes, addr24, false);
+        if (bank >= 0x70 && bank <= 0x7d)
+            return memory->sram_size > 0
+                       ? memory->sram + addr % memory->sram_size
+                       : NULL;
+        break;
+    case HIROM:
+        if (!write &&
+            ((bank < 0x40 && addr >= 0x8000) ||
+             (bank >= 0x80 && bank < 0xc0 && addr >= 0x8000) || bank >= 0xc0))
+            // out of range reads are left to assert on the slow path
+            return (addr24 & 0x3fffff) < memory->rom_size
+                       ? memory->rom + (addr24 & 0x3fffff)
+                       : NULL;
+        if (hirom_sram)
+            return memory->sram_size > 0
+                       ? memory->sram + (addr - 0x6000) % memory->sram_size
+                       : NULL;
+        break;
+    case EXHIROM:
+        if (!write &&
+            ((bank < 0x40 && addr >= 0x8000) || (bank >= 0x40 && bank < 0x7d) ||
+             (bank >= 0x80 && bank < 0xc0 && addr >= 0x8000) ||
+             (bank >= 0xc0))) {
+            uint32_t idx = (addr24 & 0x3fffff) | (((~addr24) >> 1) & 0x400000);
+            return idx < memory->rom_size ? memory->rom + idx : NULL;
+        }
+        break;
+    }
+
+    if ((bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) && addr < 0x8000)
+        return addr < 0x2000 ? memory->ram + addr : NULL;
+    if (bank == 0x7e || bank == 0x7f)
+        return memory->ram + (bank - 0x7e) * 0x10000 + addr;
+    return NULL;
+}
+
+// a page can only be accessed through its host pointer if all of its bytes
+// map to one contiguous run, which is not the case where a small ROM or SRAM
+// wraps around in the middle of it
+static uint8_t *host_page(snes_t *snes, uint32_t page, bool write) {
+    uint32_t base = page << MMU_PAGE_BITS;
+    uint8_t *host =
+        host_address(snes, U24_LOSHORT(base), U24_HIBYTE(base), write);
+    if (host == NULL)
+        return NULL;
+    for (uint32_t i = 1; i < MMU_PAGE_SIZE; i++) {
+        uint32_t addr24 = base + i;
+        if (host_address(snes, U24_LOSHORT(addr24), U24_HIBYTE(addr24),
+                         write) != host + i)
+            return NULL;
+    }
+    return host;
+}
+
+void mmu_build_pages(snes_t *snes) {
+    for (uint32_t page = 0; page < MMU_PAGES; page++) {
+        if (snes->cpu.memory.rom == NULL) {
+            snes->read_pages[page] = NULL;
+            snes->write_pages[page] = NULL;
+            snes->write_generations[page] = NULL;
+            continue;
+        }
+        snes->read_pages[page] = host_page(snes, page, false);
+        snes->write_pages[page] = host_page(snes, page, true);
+        uint8_t *host = snes->write_pages[page];
+        uint8_t *ram = snes->cpu.memory.ram;
+        if (host == NULL) {
+            snes->write_generations[page] = NULL;
+        } else if (host >= ram && host < ram + sizeof(snes->cpu.memory.ram)) {
+            snes->write_generations[page] =
+                &snes->wram_generation[(host - ram) >> MMU_PAGE_BITS];
+        } else {
+            snes->write_generations[page] = &snes->sram_generation;
+        }
+    }
+    mmu_build_access_clocks(snes);
+}
+
+void mmu_build_access_clocks(snes_t *snes) {
+    uint8_t rom_clocks = snes->cpu.memory.fast_rom ? 6 : 8;
+    for (uint32_t page = 0; page < MMU_PAGES; page++) {
+        uint8_t bank = page >> (16 - MMU_PAGE_BITS);
+        uint16_t addr = page << MMU_PAGE_BITS;
+        uint8_t clocks = 8;
+        if (bank & 0x40) {
+            // ROM, SRAM and WRAM
+        } else if (addr < 0x2000) {
+            // WRAM
+        } else if (addr < 0x4000) {
+            clocks = 6;
+        } else if (addr < 0x5000) {
+            // old style joypad ports
+            clocks = 0;
+        } else if (addr < 0x6000) {
+            clocks = 6;
+        }
+        if ((bank & 0x80) && (addr >= 0x8000 || (bank & 0x40)))
+            clocks = rom_clocks;
+        snes->access_clocks[page] = clocks;
+    }
+}
+
+static const uint8_t transfer_patterns[8][4] = {
+    {0, 0, 0, 0}, {0, 1, 0, 1}, {0, 0, 0, 0}, {0, 0, 1, 1},
+    {0, 1, 2, 3}, {0, 1, 0, 1}, {0, 0, 0, 0}, {0, 0, 1, 1}};
+
+// Registers in $2000-$5fff are dispatched through tables of handlers, one
+// table per page of 256 addresses. Handlers are named after the registers and
+// get the full address, so that mirrored registers and the eight DMA channels
+// can share one.
+typedef uint8_t (*mmio_read_t)(snes_t *snes, uint16_t addr);
+typedef void (*mmio_write_t)(snes_t *snes, uint16_t addr, uint8_t value);
+
+#define MMIO_READ(name)                                                        \
+    static uint8_t read_##name(__attribute__((unused)) snes_t *snes,           \
+                               __attribute__((unused)) uint16_t addr)
+#define MMIO_WRITE(name)                                                       \
+    static void write_##name(__attribute__((unused)) snes_t *snes,             \
+                             __attribute__((unused)) uint16_t addr,            \
+                             __attribute__((unused)) uint8_t value)
+// the same register in all eight DMA channels
+#define DMA_REGISTER(reg, handler)                                             \
+    [0x00 | (reg)] = handler, [0x10 | (reg)] = handler,                        \
+            [0x20 | (reg)] = handler, [0x30 | (reg)] = handler,                \
+            [0x40 | (reg)] = handler, [0x50 | (reg)] = handler,                \
+            [0x60 | (reg)] = handler, [0x70 | (reg)] = handler
+
+MMIO_READ(mpyl) {
+    return (snes->ppu.mul_factor_1 * snes->ppu.mul_factor_2) & 0xff;
+}
+
+MMIO_READ(mpym) {
+    return (snes->ppu.mul_factor_1 * snes->ppu.mul_factor_2) >> 8;
+}
+
+MMIO_READ(mpyh) {
+    return (snes->ppu.mul_factor_1 * snes->ppu.mul_factor_2) >> 16;
+}
+
+MMIO_READ(slhv) {
+    catch_up_ppu(snes);
+    snes->ppu.beam_x_latch_content = snes->ppu.beam_x;
+    snes->ppu.beam_y_latch_content = snes->ppu.beam_y;
+    snes->ppu.counter_latch = true;
+    return 0;
+}
+
+MMIO_READ(rdoam) {
+    if (snes->ppu.oam_addr_internal < 512) {
+        uint8_t oam_idx = snes->ppu.oam_addr_internal / 4;
+        uint8_t ret = 0;
+        switch (snes->ppu.oam_addr_internal % 4) {
+        case 0:
+            ret = snes->ppu.oam[oam_idx].x & 0xff;
+            break;
+        case 1:
+            ret = snes->ppu.oam[oam_idx].y;
+            break;
+        case 2:
+            ret = snes->ppu.oam[oam_idx].tile_idx;
+            break;
+        case 3:
+            ret = snes->ppu.oam[oam_idx].use_second_sprite_page |
+                  (snes->ppu.oam[oam_idx].palette << 1) |
+                  (snes->ppu.oam[oam_idx].priority << 4) |
+                  (snes->ppu.oam[oam_idx].flip_h << 6) |
+                  (snes->ppu.oam[oam_idx].flip_v << 7);
+            break;
+        }
+        snes->ppu.oam_addr_internal += 1;
+        snes->ppu.oam_addr_internal %= 0x220;
+        return ret;
+    } else {
+        uint8_t idx = snes->ppu.oam_addr_internal - 512;
+        uint8_t ret = 0;
+        ret = ((snes->ppu.oam[idx * 4].x >> 8) << 0) |
+              ((snes->ppu.oam[idx * 4].use_second_size) << 1) |
+              ((snes->ppu.oam[idx * 4 + 1].x >> 8) << 2) |
+              ((snes->ppu.oam[idx * 4 + 1].use_second_size) << 3) |
+              ((snes->ppu.oam[idx * 4 + 2].x >> 8) << 4) |
+              ((snes->ppu.oam[idx * 4 + 2].use_second_size) << 5) |
+              ((snes->ppu.oam[idx * 4 + 3].x >> 8) << 6) |
+              ((snes->ppu.oam[idx * 4 + 3].use_second_size) << 7);
+        snes->ppu.oam_addr_internal += 1;
+        snes->ppu.oam_addr_internal %= 0x220;
+        return ret;
+    }
+}
+
+MMIO_READ(rdvram) {
+    uint8_t ret =
+        addr == 0x2139 ? snes->ppu.vram_latch_l : snes->ppu.vram_latch_h;
+    if (snes->ppu.address_increment_mode == (addr - 0x2139)) {
+        snes->ppu.vram_latch_l = snes->ppu.vram[snes->ppu.vram_addr * 2];
+        snes->ppu.vram_latch_h = snes->ppu.vram[snes->ppu.vram_addr * 2 + 1];
+        switch (snes->ppu.address_increment_amount) {
+        case 0:
+            snes->ppu.vram_addr++;
+            break;
+        case 1:
+            snes->ppu.vram_addr += 32;
+            break;
+        case 2:
+        case 3:
+            snes->ppu.vram_addr += 128;
+            break;
+        default:
+            UNREACHABLE_SWITCH(snes->ppu.address_increment_amount);
+        }
+    }
+    return ret;
+}
+
+MMIO_READ(rdcgram) {
+    snes->ppu.cgram_latched = !snes->ppu.cgram_latched;
+    uint16_t col = r8g8b8a8_to_r5g5b5(snes->ppu.cgram[snes->ppu.cgram_addr++]);
+    return snes->ppu.cgram_latched ? U16_LOBYTE(col) : U16_HIBYTE(col);
+}
+
+MMIO_READ(ophct) {
+    snes->ppu.beam_x_latch = !snes->ppu.beam_x_latch;
+    return snes->ppu.beam_x_latch ? U16_LOBYTE(snes->ppu.beam_x_latch_content)
+                                  : U16_HIBYTE(snes->ppu.beam_x_latch_content);
+}
+
+MMIO_READ(opvct) {
+    snes->ppu.beam_y_latch = !snes->ppu.beam_y_latch;
+    return snes->ppu.beam_y_latch ? U16_LOBYTE(snes->ppu.beam_y_latch_content)
+                                  : U16_HIBYTE(snes->ppu.beam_y_latch_content);
+}
+
+MMIO_READ(stat77) {
+    return 0b1 | (snes->ppu.oam_sprite_tile_overflow << 6) |
+           (snes->ppu.oam_sprite_overflow << 7);
+}
+
+MMIO_READ(stat78) {
+    snes->ppu.counter_latch = false;
+    snes->ppu.beam_x_latch = false;
+    snes->ppu.beam_y_latch = false;
+    return 0b11 | (snes->ppu.interlace_field << 7);
+}
+
+MMIO_READ(apuio) {
+    catch_up_spc(snes);
+    return snes->spc.memory.ram[0xf4 + (addr - 0x2140)];
+}
+
+MMIO_READ(wmdata) {
+    uint8_t ret = snes->cpu.memory.ram[snes->cpu.memory.ramaddr++];
+    snes->cpu.memory.ramaddr &= 0x1ffff;
+    return ret;
+}
+
+MMIO_READ(joyser0) {
+    if (snes->cpu.memory.joy_latch_pending) {
+        return (snes->cpu.memory.joy1l & 0x8000) ? 0 : 1;
+    }
+    uint8_t ret = ((snes->cpu.memory.joy1l_latched &
+                    (0x8000 >> snes->cpu.memory.joy1_shift_idx))
+                       ? 0
+                       : 1);
+    if (snes->cpu.memory.joy1_shift_idx >= 16)
+        ret |= 1;
+    snes->cpu.memory.joy1_shift_idx++;
+    return ret;
+}
+
+MMIO_READ(joyser1) {
+    if (snes->cpu.memory.joy_latch_pending) {
+        return (snes->cpu.memory.joy2l & 0x8000) ? 0 : 1;
+    }
+    uint8_t ret = ((snes->cpu.memory.joy2l_latched &
+                    (0x8000 >> snes->cpu.memory.joy2_shift_idx))
+                       ? 0
+                       : 1);
+    if (snes->cpu.memory.joy2_shift_idx >= 16)
+        ret |= 1;
+    snes->cpu.memory.joy2_shift_idx++;
+    return ret;
+}
+
+MMIO_READ(wrmpya) { return snes->cpu.memory.mul_factor_a; }
+
+MMIO_READ(wrmpyb) { return snes->cpu.memory.mul_factor_b; }
+
+MMIO_READ(rdnmi) {
+    bool ret = snes->cpu.memory.vblank_has_occurred;
+    snes->cpu.memory.vblank_has_occurred = false;
+    return ret << 7;
+}
+
+MMIO_READ(timeup) {
+    bool ret = snes->cpu.memory.timer_has_occurred;
+    snes->cpu.memory.timer_has_occurred = false;
+    return ret << 7;
+}
+
+MMIO_READ(hvbjoy) {
+    catch_up_ppu(snes);
+    bool vblank = snes->ppu.beam_y > 224;
+    bool hblank = snes->ppu.beam_x > 278;
+    bool read_in_progress =
+        snes->cpu.memory.joy_auto_read && snes->ppu.beam_y == 224;
+    return (vblank << 7) | (hblank << 6) | read_in_progress;
+}
+
+MMIO_READ(rddivl) { return U16_LOBYTE(snes->cpu.memory.div_output); }
+
+MMIO_READ(rddivh) { return U16_HIBYTE(snes->cpu.memory.div_output); }
+
+MMIO_READ(rdmpyl) { return U16_LOBYTE(snes->cpu.memory.mul_output); }
+
+MMIO_READ(rdmpyh) { return U16_HIBYTE(snes->cpu.memory.mul_output); }
+
+MMIO_READ(joy1l) { return U16_LOBYTE(snes->cpu.memory.joy1l); }
+
+MMIO_READ(joy1h) { return U16_HIBYTE(snes->cpu.memory.joy1l); }
+
+MMIO_READ(joy2l) { return U16_LOBYTE(snes->cpu.memory.joy2l); }
+
+MMIO_READ(joy2h) { return U16_HIBYTE(snes->cpu.memory.joy2l); }
+
+MMIO_READ(dmap) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].params_raw;
+}
+
+MMIO_READ(bbad) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].b_bus_addr;
+}
+
+MMIO_READ(a1tl) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr >> 0;
+}
+
+MMIO_READ(a1th) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr >> 8;
+}
+
+MMIO_READ(a1b) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr >> 16;
+}
+
+MMIO_READ(dasl) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count >> 0;
+}
+
+MMIO_READ(dash) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count >> 8;
+}
+
+MMIO_READ(dasb) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count >> 16;
+}
+
+MMIO_READ(a2al) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address &
+           0xff;
+}
+
+MMIO_READ(a2ah) {
+    return (snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address >>
+            8) &
+           0xff;
+}
+
+MMIO_READ(ntrl) {
+    return snes->cpu.memory.dmas[(addr - 0x4300) / 16].scanlines_left |
+           (snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_repeat << 7);
+}
+
+MMIO_WRITE(inidisp) {
+    if ((value & 0xf) != snes->ppu.brightness) {
+        snes->ppu.brightness = value & 0xf;
+        ppu_build_palette(snes);
+    }
+    snes->ppu.force_blanking = value & 0x80;
+}
+
+MMIO_WRITE(obsel) {
+    snes->ppu.obj_sprite_size = value >> 5;
+    snes->ppu.obj_name_select = (value >> 3) & 0b11;
+    snes->ppu.obj_name_base_address = value & 0b111;
+}
+
+MMIO_WRITE(oamaddl) {
+    snes->ppu.oam_addr &= ~0x1ff;
+    snes->ppu.oam_addr |= (value << 1);
+    snes->ppu.oam_addr %= 0x220;
+    snes->ppu.oam_addr_internal = snes->ppu.oam_addr;
+}
+
+MMIO_WRITE(oamaddh) {
+    snes->ppu.oam_addr &= ~0x200;
+    snes->ppu.oam_addr |= (value & 1) << 9;
+    snes->ppu.oam_addr %= 0x220;
+    snes->ppu.oam_addr_internal = snes->ppu.oam_addr;
+    snes->ppu.oam_priority_rotation = value & 0x80;
+}
+
+MMIO_WRITE(oamdata) {
+    if ((snes->ppu.oam_addr_internal & 1) == 0) {
+        snes->ppu.oam_latch = value;
+    }
+    if (snes->ppu.oam_addr_internal < 0x200 &&
+        (snes->ppu.oam_addr_internal & 1)) {
+        uint8_t oam_idx = snes->ppu.oam_addr_internal / 4;
+        if (snes->ppu.oam_addr_internal % 4 == 1) {
+            snes->ppu.oam[oam_idx].x &= 0xff00;
+            snes->ppu.oam[oam_idx].x |= snes->ppu.oam_latch;
+            snes->ppu.oam[oam_idx].y = value;
+        }
+        if (snes->ppu.oam_addr_internal % 4 == 3) {
+            snes->ppu.oam[oam_idx].tile_idx = snes->ppu.oam_latch;
+            snes->ppu.oam[oam_idx].use_second_sprite_page = value & 1;
+            snes->ppu.oam[oam_idx].palette = (value >> 1) & 0b111;
+            snes->ppu.oam[oam_idx].priority = (value >> 4) & 0b11;
+            snes->ppu.oam[oam_idx].flip_h = value & 0x40;
+            snes->ppu.oam[oam_idx].flip_v = value & 0x80;
+        }
+    }
+    if (snes->ppu.oam_addr_internal >= 0x200) {
+        for (uint8_t i = 0; i < 4; i++) {
+            snes->ppu.oam[(snes->ppu.oam_addr_internal % 0x20) * 4 + i].x &=
+                0xff;
+            snes->ppu.oam[(snes->ppu.oam_addr_internal % 0x20) * 4 + i].x |=
+                ((value >> (i * 2)) & 1) << 8;
+            snes->ppu.oam[(snes->ppu.oam_addr_internal % 0x20) * 4 + i]
+                .use_second_size = (value >> (i * 2 + 1)) & 1;
+        }
+    }
+    snes->ppu.oam_addr_internal++;
+    snes->ppu.oam_addr_internal %= 0x220;
+}
+
+MMIO_WRITE(bgmode) {
+    snes->ppu.bg_mode = value & 0b111;
+    snes->ppu.mode_1_bg3_prio = value & 8;
+    snes->ppu.bg_config[0].large_characters = value & 16;
+    snes->ppu.bg_config[1].large_characters = value & 32;
+    snes->ppu.bg_config[2].large_characters = value & 64;
+    snes->ppu.bg_config[3].large_characters = value & 128;
+}
+
+MMIO_WRITE(mosaic) {
+    snes->ppu.mosaic_size = value >> 4;
+    snes->ppu.bg_config[0].enable_mosaic = value & 1;
+    snes->ppu.bg_config[1].enable_mosaic = value & 2;
+    snes->ppu.bg_config[2].enable_mosaic = value & 4;
+    snes->ppu.bg_config[3].enable_mosaic = value & 8;
+}
+
+MMIO_WRITE(bgsc) {
+    snes->ppu.bg_config[addr - 0x2107].double_h_tilemap = value & 1;
+    snes->ppu.bg_config[addr - 0x2107].double_v_tilemap = value & 2;
+    snes->ppu.bg_config[addr - 0x2107].tilemap_addr = (value & 0x7c) << 9;
+}
+
+MMIO_WRITE(bg12nba) {
+    snes->ppu.bg_config[0].tiledata_addr = (value & 0xf) << 13;
+    snes->ppu.bg_config[1].tiledata_addr = (value >> 4) << 13;
+}
+
+MMIO_WRITE(bg34nba) {
+    snes->ppu.bg_config[2].tiledata_addr = (value & 0xf) << 13;
+    snes->ppu.bg_config[3].tiledata_addr = (value >> 4) << 13;
+}
+
+MMIO_WRITE(bghofs) {
+    snes->ppu.bg_config[(addr - 0x210d) / 2].h_scroll =
+        (value << 8) | (snes->ppu.bg_scroll_latch & ~7) |
+        ((snes->ppu.bg_config[(addr - 0x210d) / 2].h_scroll >> 8) & 7);
+    snes->ppu.bg_scroll_latch = value;
+}
+
+MMIO_WRITE(bgvofs) {
+    snes->ppu.bg_config[(addr - 0x210e) / 2].v_scroll =
+        (value << 8) | snes->ppu.bg_scroll_latch;
+    snes->ppu.bg_scroll_latch = value;
+}
+
+MMIO_WRITE(vmain) {
+    snes->ppu.address_increment_amount = value & 0b11;
+    snes->ppu.address_remapping = (value >> 2) & 0b11;
+    snes->ppu.address_increment_mode = value & 0x80;
+}
+
+MMIO_WRITE(vmaddl) {
+    snes->ppu.vram_addr &= 0xff00;
+    snes->ppu.vram_addr |= value;
+    snes->ppu.vram_latch_l = snes->ppu.vram[snes->ppu.vram_addr * 2];
+    snes->ppu.vram_latch_h = snes->ppu.vram[snes->ppu.vram_addr * 2 + 1];
+}
+
+MMIO_WRITE(vmaddh) {
+    snes->ppu.vram_addr &= 0xff;
+    snes->ppu.vram_addr |= value << 8;
+    snes->ppu.vram_latch_l = snes->ppu.vram[snes->ppu.vram_addr * 2];
+    snes->ppu.vram_latch_h = snes->ppu.vram[snes->ppu.vram_addr * 2 + 1];
+}
+
+MMIO_WRITE(vmdata) {
+    uint16_t actual_addr = snes->ppu.vram_addr;
+    switch (snes->ppu.address_remapping) {
+    case 0:
+        // this page intentionally left blank
+        break;
+    case 1:
+        actual_addr = (actual_addr & 0xff00) | ((actual_addr << 3) & 0xf8) |
+                      ((actual_addr >> 5) & 0x7);
+        break;
+    case 2:
+        actual_addr = (actual_addr & 0xfe00) | ((actual_addr << 3) & 0x1f8) |
+                      ((actual_addr >> 6) & 0x7);
+        break;
+    case 3:
+        actual_addr = (actual_addr & 0xfc00) | ((actual_addr << 3) & 0x3f8) |
+                      ((actual_addr >> 7) & 0x7);
+        break;
+    default:
+        UNREACHABLE_SWITCH(snes->ppu.address_remapping);
+    }
+    actual_addr = (actual_addr << 1) + (addr - 0x2118);
+
+    snes->ppu.vram[actual_addr] = value;
+    ppu_invalidate_tiles(snes, actual_addr);
+    if (snes->ppu.address_increment_mode == (addr - 0x2118)) {
+        switch (snes->ppu.address_increment_amount) {
+        case 0:
+            snes->ppu.vram_addr++;
+            break;
+        case 1:
+            snes->ppu.vram_addr += 32;
+            break;
+        case 2:
+        case 3:
+            snes->ppu.vram_addr += 128;
+            break;
+        default:
+            UNREACHABLE_SWITCH(snes->ppu.address_increment_amount);
+        }
+    }
+}
+
+MMIO_WRITE(m7sel) {
+    snes->ppu.mode_7_flip_h = value & 1;
+    snes->ppu.mode_7_flip_v = value & 2;
+    snes->ppu.mode_7_non_tilemap_fill = value & 64;
+    snes->ppu.mode_7_tilemap_repeat = !(value & 128);
+}
+
+MMIO_WRITE(m7a) {
+    snes->ppu.a_7 = (value << 8) | snes->ppu.mode_7_latch;
+    snes->ppu.mode_7_latch = value;
+    snes->ppu.mul_factor_1 = snes->ppu.a_7;
+}
+
+MMIO_WRITE(m7b) {
+    snes->ppu.b_7 = (value << 8) | snes->ppu.mode_7_latch;
+    snes->ppu.mode_7_latch = value;
+    snes->ppu.mul_factor_2 = value;
+}
+
+MMIO_WRITE(m7c) {
+    snes->ppu.c_7 = (value << 8) | snes->ppu.mode_7_latch;
+    snes->ppu.mode_7_latch = value;
+}
+
+MMIO_WRITE(m7d) {
+    snes->ppu.d_7 = (value << 8) | snes->ppu.mode_7_latch;
+    snes->ppu.mode_7_latch = value;
+}
+
+MMIO_WRITE(m7x) {
+    snes->ppu.mode_7_center_x = (value << 8) | snes->ppu.mode_7_latch;
+    snes->ppu.mode_7_latch = value;
+}
+
+MMIO_WRITE(m7y) {
+    snes->ppu.mode_7_center_y = (value << 8) | snes->ppu.mode_7_latch;
+    snes->ppu.mode_7_latch = value;
+}
+
+MMIO_WRITE(cgadd) {
+    snes->ppu.cgram_addr = value;
+    snes->ppu.cgram_latched = false;
+}
+
+MMIO_WRITE(cgdata) {
+    if (!snes->ppu.cgram_latched) {
+        snes->ppu.cgram_latch = value;
+        snes->ppu.cgram_latched = true;
+    } else {
+        snes->ppu.cgram[snes->ppu.cgram_addr] =
+            r5g5b5_to_r8g8b8a8(TO_U16(snes->ppu.cgram_latch, value));
+        ppu_update_palette(snes, snes->ppu.cgram_addr++);
+        snes->ppu.cgram_latched = false;
+    }
+}
+
+MMIO_WRITE(w12sel) {
+    snes->ppu.bg_config[0].window_1_invert = value & 1;
+    snes->ppu.bg_config[0].window_1_enable = value & 2;
+    snes->ppu.bg_config[0].window_2_invert = value & 4;
+    snes->ppu.bg_config[0].window_2_enable = value & 8;
+    snes->ppu.bg_config[1].window_1_invert = value & 16;
+    snes->ppu.bg_config[1].window_1_enable = value & 32;
+    snes->ppu.bg_config[1].window_2_invert = value & 64;
+    snes->ppu.bg_config[1].window_2_enable = value & 128;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(w34sel) {
+    snes->ppu.bg_config[2].window_1_invert = value & 1;
+    snes->ppu.bg_config[2].window_1_enable = value & 2;
+    snes->ppu.bg_config[2].window_2_invert = value & 4;
+    snes->ppu.bg_config[2].window_2_enable = value & 8;
+    snes->ppu.bg_config[3].window_1_invert = value & 16;
+    snes->ppu.bg_config[3].window_1_enable = value & 32;
+    snes->ppu.bg_config[3].window_2_invert = value & 64;
+    snes->ppu.bg_config[3].window_2_enable = value & 128;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wobjsel) {
+    snes->ppu.obj_window_1_invert = value & 1;
+    snes->ppu.obj_window_1_enable = value & 2;
+    snes->ppu.obj_window_2_invert = value & 4;
+    snes->ppu.obj_window_2_enable = value & 8;
+    snes->ppu.col_window_1_invert = value & 16;
+    snes->ppu.col_window_1_enable = value & 32;
+    snes->ppu.col_window_2_invert = value & 64;
+    snes->ppu.col_window_2_enable = value & 128;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wh0) {
+    snes->ppu.window_1_l = value;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wh1) {
+    snes->ppu.window_1_r = value;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wh2) {
+    snes->ppu.window_2_l = value;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wh3) {
+    snes->ppu.window_2_r = value;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wbglog) {
+    snes->ppu.bg_config[0].mask_logic = (value >> 0) & 0b11;
+    snes->ppu.bg_config[1].mask_logic = (value >> 2) & 0b11;
+    snes->ppu.bg_config[2].mask_logic = (value >> 4) & 0b11;
+    snes->ppu.bg_config[3].mask_logic = (value >> 6) & 0b11;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(wobjlog) {
+    snes->ppu.obj_window_mask_logic = (value >> 0) & 0b11;
+    snes->ppu.col_window_mask_logic = (value >> 2) & 0b11;
+    ppu_invalidate_windows(snes);
+}
+
+MMIO_WRITE(tm) {
+    snes->ppu.bg_config[0].main_screen_enable = value & 1;
+    snes->ppu.bg_config[1].main_screen_enable = value & 2;
+    snes->ppu.bg_config[2].main_screen_enable = value & 4;
+    snes->ppu.bg_config[3].main_screen_enable = value & 8;
+    snes->ppu.obj_main_screen_enable = value & 16;
+}
+
+MMIO_WRITE(ts) {
+    snes->ppu.bg_config[0].sub_screen_enable = value & 1;
+    snes->ppu.bg_config[1].sub_screen_enable = value & 2;
+    snes->ppu.bg_config[2].sub_screen_enable = value & 4;
+    snes->ppu.bg_config[3].sub_screen_enable = value & 8;
+    snes->ppu.obj_sub_screen_enable = value & 16;
+}
+
+MMIO_WRITE(tmw) {
+    snes->ppu.bg_config[0].main_window_enable = value & 1;
+    snes->ppu.bg_config[1].main_window_enable = value & 2;
+    snes->ppu.bg_config[2].main_window_enable = value & 4;
+    snes->ppu.bg_config[3].main_window_enable = value & 8;
+    snes->ppu.obj_main_window_enable = value & 16;
+}
+
+MMIO_WRITE(tsw) {
+    snes->ppu.bg_config[0].sub_window_enable = value & 1;
+    snes->ppu.bg_config[1].sub_window_enable = value & 2;
+    snes->ppu.bg_config[2].sub_window_enable = value & 4;
+    snes->ppu.bg_config[3].sub_window_enable = value & 8;
+    snes->ppu.obj_sub_window_enable = value & 16;
+}
+
+MMIO_WRITE(cgwsel) {
+    snes->ppu.direct_color_mode = value & 1;
+    snes->ppu.addend_subscreen = value & 2;
+    snes->ppu.sub_window_transparent_region = (value >> 4) & 0b11;
+    snes->ppu.main_window_black_region = (value >> 6) & 0b11;
+}
+
+MMIO_WRITE(cgadsub) {
+    snes->ppu.bg_config[0].color_math_enable = value & 1;
+    snes->ppu.bg_config[1].color_math_enable = value & 2;
+    snes->ppu.bg_config[2].color_math_enable = value & 4;
+    snes->ppu.bg_config[3].color_math_enable = value & 8;
+    snes->ppu.obj_color_math_enable = value & 16;
+    snes->ppu.backdrop_color_math_enable = value & 32;
+    snes->ppu.half_color_math = value & 64;
+    snes->ppu.color_math_subtract = value & 128;
+}
+
+MMIO_WRITE(coldata) {
+    if (value & 0x80) {
+        snes->ppu.fixed_color_b = value & 0x1f;
+    }
+    if (value & 0x40) {
+        snes->ppu.fixed_color_g = value & 0x1f;
+    }
+    if (value & 0x20) {
+        snes->ppu.fixed_color_r = value & 0x1f;
+    }
+    snes->ppu.fixed_color_24bit = r5g5b5_components_to_r8g8b8a8(
+        snes->ppu.fixed_color_r, snes->ppu.fixed_color_g,
+        snes->ppu.fixed_color_b);
+}
+
+MMIO_WRITE(setini) {
+    snes->ppu.screen_interlacing = value & 0b1;
+    snes->ppu.obj_interlacing = value & 0b10;
+    snes->ppu.overscan = value & 0b100;
+    snes->ppu.high_res = value & 0b1000;
+    snes->ppu.extbg = value & 0b1000000;
+    snes->ppu.external_sync = value & 0b10000000;
+}
+
+MMIO_WRITE(apuio) {
+    log_message(LOG_LEVEL_INFO, "CPU: wrote 0x%02x to port %d of APU bus",
+                value, addr - 0x2140 + 1);
+    catch_up_spc(snes);
+    snes->cpu.memory.apu_io[addr - 0x2140] = value;
+}
+
+MMIO_WRITE(wmdata) {
+    snes->wram_generation[snes->cpu.memory.ramaddr >> MMU_PAGE_BITS]++;
+    snes->cpu.memory.ram[snes->cpu.memory.ramaddr++] = value;
+    snes->cpu.memory.ramaddr &= 0x1ffff;
+}
+
+MMIO_WRITE(wmaddl) {
+    snes->cpu.memory.ramaddr &= 0x1ff00;
+    snes->cpu.memory.ramaddr |= value;
+}
+
+MMIO_WRITE(wmaddm) {
+    snes->cpu.memory.ramaddr &= 0x100ff;
+    snes->cpu.memory.ramaddr |= value << 8;
+}
+
+MMIO_WRITE(wmaddh) {
+    snes->cpu.memory.ramaddr &= 0xffff;
+    snes->cpu.memory.ramaddr |= (value & 1) << 16;
+}
+
+MMIO_WRITE(joywr) {
+    if (!snes->cpu.memory.joy_latch_pending && (value & 1)) {
+        snes->cpu.memory.joy1_shift_idx = 0;
+        snes->cpu.memory.joy2_shift_idx = 0;
+        snes->cpu.memory.joy1l_latched = snes->cpu.memory.joy1l;
+        snes->cpu.memory.joy1h_latched = snes->cpu.memory.joy1h;
+        snes->cpu.memory.joy2l_latched = snes->cpu.memory.joy2l;
+        snes->cpu.memory.joy2h_latched = snes->cpu.memory.joy2h;
+    }
+
+    snes->cpu.memory.joy_latch_pending = value & 1;
+}
+
+MMIO_WRITE(nmitimen) {
+    snes->cpu.memory.joy_auto_read = value & 1;
+    snes->cpu.vblank_nmi_enable = value & 0x80;
+    snes->cpu.timer_irq = (value >> 4) & 0b11;
+    // the H timer is one of the PPU's events
+    snes->cpu_run.cut = true;
+}
+
+MMIO_WRITE(wrio) {
+    if (value & 0x80) {
+        catch_up_ppu(snes);
+        if (!snes->ppu.counter_latch) {
+            snes->ppu.beam_x_latch_content = snes->ppu.beam_x;
+            snes->ppu.beam_y_latch_content = snes->ppu.beam_y;
+        }
+        snes->ppu.counter_latch = true;
+    }
+}
+
+MMIO_WRITE(wrmpya) { snes->cpu.memory.mul_factor_a = value; }
+
+MMIO_WRITE(wrmpyb) {
+    snes->cpu.memory.mul_factor_b = value;
+    snes->cpu.memory.mul_output =
+        snes->cpu.memory.mul_factor_a * snes->cpu.memory.mul_factor_b;
+}
+
+MMIO_WRITE(wrdivl) {
+    snes->cpu.memory.dividend &= 0xff00;
+    snes->cpu.memory.dividend |= value;
+}
+
+MMIO_WRITE(wrdivh) {
+    snes->cpu.memory.dividend &= 0xff;
+    snes->cpu.memory.dividend |= value << 8;
+}
+
+MMIO_WRITE(wrdivb) {
+    snes->cpu.memory.divisor = value;
+    snes->cpu.memory.div_output =
+        value == 0 ? 0xffff
+                   : snes->cpu.memory.dividend / snes->cpu.memory.divisor;
+    snes->cpu.memory.mul_output =
+        value == 0 ? snes->cpu.memory.dividend
+                   : snes->cpu.memory.dividend % snes->cpu.memory.divisor;
+}
+
+MMIO_WRITE(htimel) {
+    snes->ppu.h_timer_target &= 0x100;
+    snes->ppu.h_timer_target |= value;
+    snes->cpu_run.cut = true;
+}
+
+MMIO_WRITE(htimeh) {
+    snes->ppu.h_timer_target &= 0xff;
+    snes->ppu.h_timer_target |= (value & 1) << 8;
+    snes->cpu_run.cut = true;
+}
+
+MMIO_WRITE(vtimel) {
+    snes->ppu.v_timer_target &= 0x100;
+    snes->ppu.v_timer_target |= value;
+}
+
+MMIO_WRITE(vtimeh) {
+    snes->ppu.v_timer_target &= 0xff;
+    snes->ppu.v_timer_target |= (value & 1) << 8;
+}
+
+MMIO_WRITE(mdmaen) {
+    TIMING_ENTER(snes, TIMING_DMA);
+    for (uint8_t i = 0; i < 8; i++)
+        if (value & (1 << i)) {
+            uint32_t byte_count =
+                snes->cpu.memory.dmas[i].dma_byte_count & 0xffff;
+            bool direction = snes->cpu.memory.dmas[i].direction;
+            uint32_t a_addr = snes->cpu.memory.dmas[i].dma_src_addr;
+            uint16_t b_addr = 0x2100 + snes->cpu.memory.dmas[i].b_bus_addr;
+            uint8_t transfer_pattern =
+                snes->cpu.memory.dmas[i].transfer_pattern;
+            uint8_t addr_inc_mode = snes->cpu.memory.dmas[i].addr_inc_mode;
+            if (byte_count == 0)
+                byte_count = 0x10000;
+            for (uint32_t j = 0; j < byte_count; j++) {
+                if (direction) {
+                    uint8_t to_transfer = dma_read_8(
+                        snes,
+                        b_addr + transfer_patterns[transfer_pattern][j % 4], 0);
+                    dma_write_8(snes, U24_LOSHORT(a_addr), U24_HIBYTE(a_addr),
+                                to_transfer);
+                    if (addr_inc_mode == 0)
+                        a_addr =
+                            TO_U24(U24_LOSHORT(a_addr + 1), U24_HIBYTE(a_addr));
+                    if (addr_inc_mode == 2)
+                        a_addr =
+                            TO_U24(U24_LOSHORT(a_addr - 1), U24_HIBYTE(a_addr));
+                } else {
+                    uint8_t to_transfer = dma_read_8(snes, U24_LOSHORT(a_addr),
+                                                     U24_HIBYTE(a_addr));
+                    if (addr_inc_mode == 0)
+                        a_addr =
+                            TO_U24(U24_LOSHORT(a_addr + 1), U24_HIBYTE(a_addr));
+                    if (addr_inc_mode == 2)
+                        a_addr =
+                            TO_U24(U24_LOSHORT(a_addr - 1), U24_HIBYTE(a_addr));
+                    dma_write_8(snes,
+                                b_addr +
+                                    transfer_patterns[transfer_pattern][j % 4],
+                                0, to_transfer);
+                }
+            }
+
+            snes->cpu.memory.dmas[i].dma_src_addr = a_addr;
+            snes->cpu.memory.dmas[i].dma_byte_count = 0;
+        }
+    TIMING_LEAVE(snes);
+}
+
+MMIO_WRITE(hdmaen) {
+    for (uint8_t i = 0; i < 8; i++) {
+        snes->cpu.memory.dmas[i].hdma_enable = value & (1 << i);
+        if (snes->cpu.memory.dmas[i].hdma_enable) {
+            snes->cpu.memory.dmas[i].hdma_current_address =
+                snes->cpu.memory.dmas[i].dma_src_addr;
+        }
+    }
+}
+
+MMIO_WRITE(memsel) {
+    if (snes->cpu.memory.fast_rom == (value & 1))
+        return;
+    snes->cpu.memory.fast_rom = value & 1;
+    mmu_build_access_clocks(snes);
+    // cached instructions carry the cost of their fetch
+    if (snes->block_cache != NULL)
+        snes->block_cache->rom_generation++;
+}
+
+MMIO_WRITE(rddivl) {
+    snes->cpu.memory.div_output =
+        TO_U16(value, U16_HIBYTE(snes->cpu.memory.div_output));
+}
+
+MMIO_WRITE(rddivh) {
+    snes->cpu.memory.div_output =
+        TO_U16(U16_LOBYTE(snes->cpu.memory.div_output), value);
+}
+
+MMIO_WRITE(rdmpyl) {
+    snes->cpu.memory.mul_output =
+        TO_U16(value, U16_HIBYTE(snes->cpu.memory.mul_output));
+}
+
+MMIO_WRITE(rdmpyh) {
+    snes->cpu.memory.mul_output =
+        TO_U16(U16_LOBYTE(snes->cpu.memory.mul_output), value);
+}
+
+MMIO_WRITE(dmap) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].direction = value & 0x80;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].indirect_hdma = value & 0x40;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].addr_inc_mode =
+        (value >> 3) & 0b11;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].transfer_pattern =
+        value & 0b111;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].params_raw = value;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(bbad) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].b_bus_addr = value;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(a1tl) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr &= 0xffff00;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr |= value;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(a1th) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr &= 0xff00ff;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr |= value << 8;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(a1b) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr &= 0xffff;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr |= value << 16;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(dasl) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count &= 0xffff00;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count |= value;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(dash) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count &= 0xff00ff;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count |= value << 8;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(dasb) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count &= 0xffff;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count |= value << 16;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(a2al) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address &=
+        0xffff00;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address |= value;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(a2ah) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address &=
+        0xff00ff;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address |= value
+                                                                        << 8;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+MMIO_WRITE(ntrl) {
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].scanlines_left = value & 0x7f;
+    snes->cpu.memory.dmas[(addr - 0x4300) / 16].hdma_repeat = value & 0x80;
+    snes->cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
+}
+
+static const mmio_read_t b_bus_reads[0x100] = {
+    [0x34] = read_mpyl,   [0x35] = read_mpym,    [0x36] = read_mpyh,
+    [0x37] = read_slhv,   [0x38] = read_rdoam,   [0x39] = read_rdvram,
+    [0x3a] = read_rdvram, [0x3b] = read_rdcgram, [0x3c] = read_ophct,
+    [0x3d] = read_opvct,  [0x3e] = read_stat77,  [0x3f] = read_stat78,
+    [0x40] = read_apuio,  [0x41] = read_apuio,   [0x42] = read_apuio,
+    [0x43] = read_apuio,  [0x80] = read_wmdata,
+};
+
+static const mmio_read_t joypad_reads[0x100] = {
+    [0x16] = read_joyser0,
+    [0x17] = read_joyser1,
+};
+
+static const mmio_read_t cpu_reads[0x100] = {
+    [0x02] = read_wrmpya, [0x03] = read_wrmpyb, [0x10] = read_rdnmi,
+    [0x11] = read_timeup, [0x12] = read_hvbjoy, [0x14] = read_rddivl,
+    [0x15] = read_rddivh, [0x16] = read_rdmpyl, [0x17] = read_rdmpyh,
+    [0x18] = read_joy1l,  [0x19] = read_joy1h,  [0x1a] = read_joy2l,
+    [0x1b] = read_joy2h,
+};
+
+static const mmio_read_t dma_reads[0x100] = {
+    DMA_REGISTER(0x0, read_dmap), DMA_REGISTER(0x1, read_bbad),
+    DMA_REGISTER(0x2, read_a1tl), DMA_REGISTER(0x3, read_a1th),
+    DMA_REGISTER(0x4, read_a1b),  DMA_REGISTER(0x5, read_dasl),
+    DMA_REGISTER(0x6, read_dash), DMA_REGISTER(0x7, read_dasb),
+    DMA_REGISTER(0x8, read_a2al), DMA_REGISTER(0x9, read_a2ah),
+    DMA_REGISTER(0xa, read_ntrl),
+};
+
+// indexed by (addr - 0x2000) >> 8, pages without registers are NULL
+static const mmio_read_t *const mmio_reads[0x40] = {
+    [0x01] = b_bus_reads,
+    [0x20] = joypad_reads,
+    [0x22] = cpu_reads,
+    [0x23] = dma_reads,
+};
+
+static const mmio_write_t b_bus_writes[0x100] = {
+    [0x00] = write_inidisp, [0x01] = write_obsel,   [0x02] = write_oamaddl,
+    [0x03] = write_oamaddh, [0x04] = write_oamdata, [0x05] = write_bgmode,
+    [0x06] = write_mosaic,  [0x07] = write_bgsc,    [0x08] = write_bgsc,
+    [0x09] = write_bgsc,    [0x0a] = write_bgsc,    [0x0b] = write_bg12nba,
+    [0x0c] = write_bg34nba, [0x0d] = write_bghofs,  [0x0e] = write_bgvofs,
+    [0x0f] = write_bghofs,  [0x10] = write_bgvofs,  [0x11] = write_bghofs,
+    [0x12] = write_bgvofs,  [0x13] = write_bghofs,  [0x14] = write_bgvofs,
+    [0x15] = write_vmain,   [0x16] = write_vmaddl,  [0x17] = write_vmaddh,
+    [0x18] = write_vmdata,  [0x19] = write_vmdata,  [0x1a] = write_m7sel,
+    [0x1b] = write_m7a,     [0x1c] = write_m7b,     [0x1d] = write_m7c,
+    [0x1e] = write_m7d,     [0x1f] = write_m7x,     [0x20] = write_m7y,
+    [0x21] = write_cgadd,   [0x22] = write_cgdata,  [0x23] = write_w12sel,
+    [0x24] = write_w34sel,  [0x25] = write_wobjsel, [0x26] = write_wh0,
+    [0x27] = write_wh1,     [0x28] = write_wh2,     [0x29] = write_wh3,
+    [0x2a] = write_wbglog,  [0x2b] = write_wobjlog, [0x2c] = write_tm,
+    [0x2d] = write_ts,      [0x2e] = write_tmw,     [0x2f] = write_tsw,
+    [0x30] = write_cgwsel,  [0x31] = write_cgadsub, [0x32] = write_coldata,
+    [0x33] = write_setini,  [0x40] = write_apuio,   [0x41] = write_apuio,
+    [0x42] = write_apuio,   [0x43] = write_apuio,   [0x80] = write_wmdata,
+    [0x81] = write_wmaddl,  [0x82] = write_wmaddm,  [0x83] = write_wmaddh,
+};
+
+static const mmio_write_t joypad_writes[0x100] = {
+    [0x16] = write_joywr,
+};
+
+static const mmio_write_t cpu_writes[0x100] = {
+    [0x00] = write_nmitimen, [0x01] = write_wrio,   [0x02] = write_wrmpya,
+    [0x03] = write_wrmpyb,   [0x04] = write_wrdivl, [0x05] = write_wrdivh,
+    [0x06] = write_wrdivb,   [0x07] = write_htimel, [0x08] = write_htimeh,
+    [0x09] = write_vtimel,   [0x0a] = write_vtimeh, [0x0b] = write_mdmaen,
+    [0x0c] = write_hdmaen,   [0x0d] = write_memsel, [0x14] = write_rddivl,
+    [0x15] = write_rddivh,   [0x16] = write_rdmpyl, [0x17] = write_rdmpyh,
+};
+
+static const mmio_write_t dma_writes[0x100] = {
+    DMA_REGISTER(0x0, write_dmap), DMA_REGISTER(0x1, write_bbad),
+    DMA_REGISTER(0x2, write_a1tl), DMA_REGISTER(0x3, write_a1th),
+    DMA_REGISTER(0x4, write_a1b),  DMA_REGISTER(0x5, write_dasl),
+    DMA_REGISTER(0x6, write_dash), DMA_REGISTER(0x7, write_dasb),
+    DMA_REGISTER(0x8, write_a2al), DMA_REGISTER(0x9, write_a2ah),
+    DMA_REGISTER(0xa, write_ntrl),
+};
+
+// indexed by (addr - 0x2000) >> 8, pages without registers are NULL
+static const mmio_write_t *const mmio_writes[0x40] = {
+    [0x01] = b_bus_writes,
+    [0x20] = joypad_writes,
+    [0x22] = cpu_writes,
+    [0x23] = dma_writes,
+};
+
+uint8_t mmu_read(snes_t *snes, uint16_t addr, uint8_t bank, bool log) {
+    uint8_t *page = snes->read_pages[TO_U24(addr, bank) >> MMU_PAGE_BITS];
+    if (page != NULL)
+        return page[addr & (MMU_PAGE_SIZE - 1)];
+
     // ROM resolution
     uint8_t ret;
 
-    switch (cpu.memory.mode) {
+    switch (snes->cpu.memory.mode) {
     case LOROM:
         if ((bank <= 0x7d || bank >= 0x80) && addr >= 0x8000) {
-            ret = cpu.memory.rom[lo_rom_resolve(TO_U24(addr, bank), log)];
+            ret = snes->cpu.memory
+                      .rom[lo_rom_resolve(snes, TO_U24(addr, bank), log)];
             if (log)
                 log_message(LOG_LEVEL_VERBOSE,
                             "Read 0x%02x from ROM address 0x%04x, bank 0x%02x",
@@ -55,8 +1181,8 @@ uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
             return ret;
         }
         if (bank >= 0x70 && bank <= 0x7d) {
-            if (cpu.memory.sram_size > 0) {
-                return cpu.memory.sram[addr % cpu.memory.sram_size];
+            if (snes->cpu.memory.sram_size > 0) {
+                return snes->cpu.memory.sram[addr % snes->cpu.memory.sram_size];
             }
             return 0xff;
         }
@@ -64,7 +1190,8 @@ uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
     case HIROM:
         if ((bank < 0x40 && addr >= 0x8000) ||
             (bank >= 0x80 && bank < 0xc0 && addr >= 0x8000) || bank >= 0xc0) {
-            ret = cpu.memory.rom[hi_rom_resolve(TO_U24(addr, bank), log)];
+            ret = snes->cpu.memory
+                      .rom[hi_rom_resolve(snes, TO_U24(addr, bank), log)];
             if (log)
                 log_message(LOG_LEVEL_VERBOSE,
                             "Read 0x%02x from ROM address 0x%04x, bank 0x%02x",
@@ -73,8 +1200,9 @@ uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
         }
         if (((bank >= 0x30 && bank < 0x40) || (bank >= 0xb0 && bank < 0xc0)) &&
             addr >= 0x6000 && addr < 0x8000) {
-            if (cpu.memory.sram_size > 0) {
-                return cpu.memory.sram[(addr - 0x6000) % cpu.memory.sram_size];
+            if (snes->cpu.memory.sram_size > 0) {
+                return snes->cpu.memory
+                    .sram[(addr - 0x6000) % snes->cpu.memory.sram_size];
             }
             return 0xff;
         }
@@ -82,7 +1210,8 @@ uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
     case EXHIROM:
         if ((bank < 0x40 && addr >= 0x8000) || (bank >= 0x40 && bank < 0x7d) ||
             (bank >= 0x80 && bank < 0xc0 && addr >= 0x8000) || (bank >= 0xc0)) {
-            ret = cpu.memory.rom[ex_hi_rom_resolve(TO_U24(addr, bank), log)];
+            ret = snes->cpu.memory
+                      .rom[ex_hi_rom_resolve(snes, TO_U24(addr, bank), log)];
             if (log)
                 log_message(LOG_LEVEL_VERBOSE,
                             "Read 0x%02x from ROM address 0x%04x, bank 0x%02x",
@@ -94,296 +1223,20 @@ uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
 
     if ((bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) && addr < 0x8000) {
         if (addr < 0x2000) {
-            return cpu.memory.ram[addr];
+            return snes->cpu.memory.ram[addr];
         } else if (addr < 0x6000) {
-            switch (addr) {
-            case 0x2134:
-                return (ppu.mul_factor_1 * ppu.mul_factor_2) & 0xff;
-            case 0x2135:
-                return (ppu.mul_factor_1 * ppu.mul_factor_2) >> 8;
-            case 0x2136:
-                return (ppu.mul_factor_1 * ppu.mul_factor_2) >> 16;
-            case 0x2137:
-                ppu.beam_x_latch_content = ppu.beam_x;
-                ppu.beam_y_latch_content = ppu.beam_y;
-                ppu.counter_latch = true;
-                return 0;
-            case 0x2138: {
-                if (ppu.oam_addr_internal < 512) {
-                    uint8_t oam_idx = ppu.oam_addr_internal / 4;
-                    uint8_t ret = 0;
-                    switch (ppu.oam_addr_internal % 4) {
-                    case 0:
-                        ret = ppu.oam[oam_idx].x & 0xff;
-                        break;
-                    case 1:
-                        ret = ppu.oam[oam_idx].y;
-                        break;
-                    case 2:
-                        ret = ppu.oam[oam_idx].tile_idx;
-                        break;
-                    case 3:
-                        ret = ppu.oam[oam_idx].use_second_sprite_page |
-                              (ppu.oam[oam_idx].palette << 1) |
-                              (ppu.oam[oam_idx].priority << 4) |
-                              (ppu.oam[oam_idx].flip_h << 6) |
-                              (ppu.oam[oam_idx].flip_v << 7);
-                        break;
-                    }
-                    ppu.oam_addr_internal += 1;
-                    ppu.oam_addr_internal %= 0x220;
-                    return ret;
-                } else {
-                    uint8_t idx = ppu.oam_addr_internal - 512;
-                    uint8_t ret = 0;
-                    ret = ((ppu.oam[idx * 4].x >> 8) << 0) |
-                          ((ppu.oam[idx * 4].use_second_size) << 1) |
-                          ((ppu.oam[idx * 4 + 1].x >> 8) << 2) |
-                          ((ppu.oam[idx * 4 + 1].use_second_size) << 3) |
-                          ((ppu.oam[idx * 4 + 2].x >> 8) << 4) |
-                          ((ppu.oam[idx * 4 + 2].use_second_size) << 5) |
-                          ((ppu.oam[idx * 4 + 3].x >> 8) << 6) |
-                          ((ppu.oam[idx * 4 + 3].use_second_size) << 7);
-                    ppu.oam_addr_internal += 1;
-                    ppu.oam_addr_internal %= 0x220;
-                    return ret;
-                }
-            }
-            case 0x2139:
-            case 0x213a: {
-                uint8_t ret =
-                    addr == 0x2139 ? ppu.vram_latch_l : ppu.vram_latch_h;
-                if (ppu.address_increment_mode == (addr - 0x2139)) {
-                    ppu.vram_latch_l = ppu.vram[ppu.vram_addr * 2];
-                    ppu.vram_latch_h = ppu.vram[ppu.vram_addr * 2 + 1];
-                    switch (ppu.address_increment_amount) {
-                    case 0:
-                        ppu.vram_addr++;
-                        break;
-                    case 1:
-                        ppu.vram_addr += 32;
-                        break;
-                    case 2:
-                    case 3:
-                        ppu.vram_addr += 128;
-                        break;
-                    default:
-                        UNREACHABLE_SWITCH(ppu.address_increment_amount);
-                    }
-                }
-                return ret;
-            };
-            case 0x213b: {
-                ppu.cgram_latched = !ppu.cgram_latched;
-                uint16_t col = r8g8b8a8_to_r5g5b5(ppu.cgram[ppu.cgram_addr++]);
-                return ppu.cgram_latched ? U16_LOBYTE(col) : U16_HIBYTE(col);
-            }
-            case 0x213c:
-                ppu.beam_x_latch = !ppu.beam_x_latch;
-                return ppu.beam_x_latch ? U16_LOBYTE(ppu.beam_x_latch_content)
-                                        : U16_HIBYTE(ppu.beam_x_latch_content);
-            case 0x213d:
-                ppu.beam_y_latch = !ppu.beam_y_latch;
-                return ppu.beam_y_latch ? U16_LOBYTE(ppu.beam_y_latch_content)
-                                        : U16_HIBYTE(ppu.beam_y_latch_content);
-            case 0x213e:
-                return 0b1 | (ppu.oam_sprite_tile_overflow << 6) |
-                       (ppu.oam_sprite_overflow << 7);
-            case 0x213f:
-                ppu.counter_latch = false;
-                ppu.beam_x_latch = false;
-                ppu.beam_y_latch = false;
-                return 0b11 | (ppu.interlace_field << 7);
-            case 0x2140:
-            case 0x2141:
-            case 0x2142:
-            case 0x2143:
-                return spc.memory.ram[0xf4 + (addr - 0x2140)];
-            case 0x2180: {
-                uint8_t ret = cpu.memory.ram[cpu.memory.ramaddr++];
-                cpu.memory.ramaddr &= 0x1ffff;
-                return ret;
-            }
-            case 0x4016: {
-                if (cpu.memory.joy_latch_pending) {
-                    return (cpu.memory.joy1l & 0x8000) ? 0 : 1;
-                }
-                uint8_t ret = ((cpu.memory.joy1l_latched &
-                                (0x8000 >> cpu.memory.joy1_shift_idx))
-                                   ? 0
-                                   : 1);
-                if (cpu.memory.joy1_shift_idx >= 16)
-                    ret |= 1;
-                cpu.memory.joy1_shift_idx++;
-                return ret;
-            }
-            case 0x4017: {
-                if (cpu.memory.joy_latch_pending) {
-                    return (cpu.memory.joy2l & 0x8000) ? 0 : 1;
-                }
-                uint8_t ret = ((cpu.memory.joy2l_latched &
-                                (0x8000 >> cpu.memory.joy2_shift_idx))
-                                   ? 0
-                                   : 1);
-                if (cpu.memory.joy2_shift_idx >= 16)
-                    ret |= 1;
-                cpu.memory.joy2_shift_idx++;
-                return ret;
-            }
-            case 0x4202:
-                return cpu.memory.mul_factor_a;
-            case 0x4203:
-                return cpu.memory.mul_factor_b;
-            case 0x4210: {
-                bool ret = cpu.memory.vblank_has_occurred;
-                cpu.memory.vblank_has_occurred = false;
-                return ret << 7;
-            }
-            case 0x4211: {
-                bool ret = cpu.memory.timer_has_occurred;
-                cpu.memory.timer_has_occurred = false;
-                return ret << 7;
-            }
-            case 0x4212: {
-                bool vblank = ppu.beam_y > 224;
-                bool hblank = ppu.beam_x > 278;
-                bool read_in_progress =
-                    cpu.memory.joy_auto_read && ppu.beam_y == 224;
-                return (vblank << 7) | (hblank << 6) | read_in_progress;
-            }
-            case 0x4214:
-                return U16_LOBYTE(cpu.memory.div_output);
-            case 0x4215:
-                return U16_HIBYTE(cpu.memory.div_output);
-            case 0x4216:
-                return U16_LOBYTE(cpu.memory.mul_output);
-            case 0x4217:
-                return U16_HIBYTE(cpu.memory.mul_output);
-            case 0x4218:
-                return U16_LOBYTE(cpu.memory.joy1l);
-            case 0x4219:
-                return U16_HIBYTE(cpu.memory.joy1l);
-            case 0x421a:
-                return U16_LOBYTE(cpu.memory.joy2l);
-            case 0x421b:
-                return U16_HIBYTE(cpu.memory.joy2l);
-            case 0x4300:
-            case 0x4310:
-            case 0x4320:
-            case 0x4330:
-            case 0x4340:
-            case 0x4350:
-            case 0x4360:
-            case 0x4370:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].params_raw;
-            case 0x4301:
-            case 0x4311:
-            case 0x4321:
-            case 0x4331:
-            case 0x4341:
-            case 0x4351:
-            case 0x4361:
-            case 0x4371:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].b_bus_addr;
-            case 0x4302:
-            case 0x4312:
-            case 0x4322:
-            case 0x4332:
-            case 0x4342:
-            case 0x4352:
-            case 0x4362:
-            case 0x4372:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr >> 0;
-            case 0x4303:
-            case 0x4313:
-            case 0x4323:
-            case 0x4333:
-            case 0x4343:
-            case 0x4353:
-            case 0x4363:
-            case 0x4373:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr >> 8;
-            case 0x4304:
-            case 0x4314:
-            case 0x4324:
-            case 0x4334:
-            case 0x4344:
-            case 0x4354:
-            case 0x4364:
-            case 0x4374:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr >> 16;
-            case 0x4305:
-            case 0x4315:
-            case 0x4325:
-            case 0x4335:
-            case 0x4345:
-            case 0x4355:
-            case 0x4365:
-            case 0x4375:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count >>
-                       0;
-            case 0x4306:
-            case 0x4316:
-            case 0x4326:
-            case 0x4336:
-            case 0x4346:
-            case 0x4356:
-            case 0x4366:
-            case 0x4376:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count >>
-                       8;
-            case 0x4307:
-            case 0x4317:
-            case 0x4327:
-            case 0x4337:
-            case 0x4347:
-            case 0x4357:
-            case 0x4367:
-            case 0x4377:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count >>
-                       16;
-            case 0x4308:
-            case 0x4318:
-            case 0x4328:
-            case 0x4338:
-            case 0x4348:
-            case 0x4358:
-            case 0x4368:
-            case 0x4378:
-                return cpu.memory.dmas[(addr - 0x4300) / 16]
-                           .hdma_current_address &
-                       0xff;
-            case 0x4309:
-            case 0x4319:
-            case 0x4329:
-            case 0x4339:
-            case 0x4349:
-            case 0x4359:
-            case 0x4369:
-            case 0x4379:
-                return (cpu.memory.dmas[(addr - 0x4300) / 16]
-                            .hdma_current_address >>
-                        8) &
-                       0xff;
-            case 0x430a:
-            case 0x431a:
-            case 0x432a:
-            case 0x433a:
-            case 0x434a:
-            case 0x435a:
-            case 0x436a:
-            case 0x437a:
-                return cpu.memory.dmas[(addr - 0x4300) / 16].scanlines_left |
-                       (cpu.memory.dmas[(addr - 0x4300) / 16].hdma_repeat << 7);
-            default:
-                log_message(LOG_LEVEL_WARNING,
-                            "Tried to read from bank 0x%02x, address 0x%04x",
-                            bank, addr);
-                return 0;
+            const mmio_read_t *handlers = mmio_reads[(addr - 0x2000) >> 8];
+            if (handlers != NULL && handlers[addr & 0xff] != NULL) {
+                snes->cpu_run.mmio = true;
+                return handlers[addr & 0xff](snes, addr);
             }
+            log_message(LOG_LEVEL_WARNING,
+                        "Tried to read from bank 0x%02x, address 0x%04x", bank,
+                        addr);
+            return 0;
         }
     } else if (bank == 0x7e || bank == 0x7f) {
-        return cpu.memory.ram[(bank - 0x7e) * 0x10000 + addr];
+        return snes->cpu.memory.ram[(bank - 0x7e) * 0x10000 + addr];
     }
 
     log_message(LOG_LEVEL_WARNING,
@@ -391,704 +1244,90 @@ uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log) {
     return 0;
 }
 
-static uint8_t transfer_patterns[8][4] = {
-    {0, 0, 0, 0}, {0, 1, 0, 1}, {0, 0, 0, 0}, {0, 0, 1, 1},
-    {0, 1, 2, 3}, {0, 1, 0, 1}, {0, 0, 0, 0}, {0, 0, 1, 1}};
+bool mmu_peek(snes_t *snes, uint16_t addr, uint8_t bank, uint8_t *value) {
+    uint8_t *page = snes->read_pages[TO_U24(addr, bank) >> MMU_PAGE_BITS];
+    if (page != NULL) {
+        *value = page[addr & (MMU_PAGE_SIZE - 1)];
+        return true;
+    }
+    if (bank >= 0x40 && !(bank >= 0x80 && bank < 0xc0))
+        return false;
+
+    // the registers games poll while waiting
+    switch (addr) {
+    case 0x2140:
+    case 0x2141:
+    case 0x2142:
+    case 0x2143:
+        *value = read_apuio(snes, addr);
+        return true;
+    case 0x4210:
+        // reading a set flag clears it
+        if (snes->cpu.memory.vblank_has_occurred)
+            return false;
+        *value = read_rdnmi(snes, addr);
+        return true;
+    case 0x4211:
+        if (snes->cpu.memory.timer_has_occurred)
+            return false;
+        *value = read_timeup(snes, addr);
+        return true;
+    case 0x4212:
+        *value = read_hvbjoy(snes, addr);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void mmu_write(snes_t *snes, uint16_t addr, uint8_t bank, uint8_t value) {
+    uint32_t page_idx = TO_U24(addr, bank) >> MMU_PAGE_BITS;
+    uint8_t *page = snes->write_pages[page_idx];
+    if (page != NULL) {
+        page[addr & (MMU_PAGE_SIZE - 1)] = value;
+        // cached code from this page may have changed
+        (*snes->write_generations[page_idx])++;
+        return;
+    }
 
-void mmu_write(uint16_t addr, uint8_t bank, uint8_t value, bool log) {
-    if (cpu.memory.mode == LOROM && bank >= 0x70 && bank <= 0x7d) {
-        if (cpu.memory.sram_size > 0) {
-            cpu.memory.sram[addr % cpu.memory.sram_size] = value;
+    if (snes->cpu.memory.mode == LOROM && bank >= 0x70 && bank <= 0x7d) {
+        if (snes->cpu.memory.sram_size > 0) {
+            snes->cpu.memory.sram[addr % snes->cpu.memory.sram_size] = value;
         }
-    } else if (cpu.memory.mode == HIROM &&
+    } else if (snes->cpu.memory.mode == HIROM &&
                ((bank >= 0x30 && bank < 0x40) ||
                 (bank >= 0xb0 && bank < 0xc0)) &&
                addr >= 0x6000 && addr < 0x8000) {
-        if (cpu.memory.sram_size > 0) {
-            cpu.memory.sram[(addr - 0x6000) % cpu.memory.sram_size] = value;
+        if (snes->cpu.memory.sram_size > 0) {
+            snes->cpu.memory
+                .sram[(addr - 0x6000) % snes->cpu.memory.sram_size] = value;
         }
     } else if ((bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) &&
                addr < 0x8000) {
         if (addr < 0x2000) {
-            cpu.memory.ram[addr] = value;
+            snes->cpu.memory.ram[addr] = value;
         } else if (addr < 0x6000) {
-            switch (addr) {
-            case 0x2100:
-                ppu.brightness = value & 0xf;
-                ppu.force_blanking = value & 0x80;
-                break;
-            case 0x2101:
-                ppu.obj_sprite_size = value >> 5;
-                ppu.obj_name_select = (value >> 3) & 0b11;
-                ppu.obj_name_base_address = value & 0b111;
-                break;
-            case 0x2102:
-                ppu.oam_addr &= ~0x1ff;
-                ppu.oam_addr |= (value << 1);
-                ppu.oam_addr %= 0x220;
-                ppu.oam_addr_internal = ppu.oam_addr;
-                break;
-            case 0x2103:
-                ppu.oam_addr &= ~0x200;
-                ppu.oam_addr |= (value & 1) << 9;
-                ppu.oam_addr %= 0x220;
-                ppu.oam_addr_internal = ppu.oam_addr;
-                ppu.oam_priority_rotation = value & 0x80;
-                break;
-            case 0x2104:
-                if ((ppu.oam_addr_internal & 1) == 0) {
-                    ppu.oam_latch = value;
-                }
-                if (ppu.oam_addr_internal < 0x200 &&
-                    (ppu.oam_addr_internal & 1)) {
-                    uint8_t oam_idx = ppu.oam_addr_internal / 4;
-                    if (ppu.oam_addr_internal % 4 == 1) {
-                        ppu.oam[oam_idx].x &= 0xff00;
-                        ppu.oam[oam_idx].x |= ppu.oam_latch;
-                        ppu.oam[oam_idx].y = value;
-                    }
-                    if (ppu.oam_addr_internal % 4 == 3) {
-                        ppu.oam[oam_idx].tile_idx = ppu.oam_latch;
-                        ppu.oam[oam_idx].use_second_sprite_page = value & 1;
-                        ppu.oam[oam_idx].palette = (value >> 1) & 0b111;
-                        ppu.oam[oam_idx].priority = (value >> 4) & 0b11;
-                        ppu.oam[oam_idx].flip_h = value & 0x40;
-                        ppu.oam[oam_idx].flip_v = value & 0x80;
-                    }
-                }
-                if (ppu.oam_addr_internal >= 0x200) {
-                    for (uint8_t i = 0; i < 4; i++) {
-                        ppu.oam[(ppu.oam_addr_internal % 0x20) * 4 + i].x &=
-                            0xff;
-                        ppu.oam[(ppu.oam_addr_internal % 0x20) * 4 + i].x |=
-                            ((value >> (i * 2)) & 1) << 8;
-                        ppu.oam[(ppu.oam_addr_internal % 0x20) * 4 + i]
-                            .use_second_size = (value >> (i * 2 + 1)) & 1;
-                    }
-                }
-                ppu.oam_addr_internal++;
-                ppu.oam_addr_internal %= 0x220;
-                break;
-            case 0x2105:
-                ppu.bg_mode = value & 0b111;
-                ppu.mode_1_bg3_prio = value & 8;
-                ppu.bg_config[0].large_characters = value & 16;
-                ppu.bg_config[1].large_characters = value & 32;
-                ppu.bg_config[2].large_characters = value & 64;
-                ppu.bg_config[3].large_characters = value & 128;
-                break;
-            case 0x2106:
-                ppu.mosaic_size = value >> 4;
-                ppu.bg_config[0].enable_mosaic = value & 1;
-                ppu.bg_config[1].enable_mosaic = value & 2;
-                ppu.bg_config[2].enable_mosaic = value & 4;
-                ppu.bg_config[3].enable_mosaic = value & 8;
-                break;
-            case 0x2107:
-            case 0x2108:
-            case 0x2109:
-            case 0x210a:
-                ppu.bg_config[addr - 0x2107].double_h_tilemap = value & 1;
-                ppu.bg_config[addr - 0x2107].double_v_tilemap = value & 2;
-                ppu.bg_config[addr - 0x2107].tilemap_addr = (value & 0x7c) << 9;
-                break;
-            case 0x210b:
-                ppu.bg_config[0].tiledata_addr = (value & 0xf) << 13;
-                ppu.bg_config[1].tiledata_addr = (value >> 4) << 13;
-                break;
-            case 0x210c:
-                ppu.bg_config[2].tiledata_addr = (value & 0xf) << 13;
-                ppu.bg_config[3].tiledata_addr = (value >> 4) << 13;
-                break;
-            case 0x210d:
-            case 0x210f:
-            case 0x2111:
-            case 0x2113:
-                ppu.bg_config[(addr - 0x210d) / 2].h_scroll =
-                    (value << 8) | (ppu.bg_scroll_latch & ~7) |
-                    ((ppu.bg_config[(addr - 0x210d) / 2].h_scroll >> 8) & 7);
-                ppu.bg_scroll_latch = value;
-                break;
-            case 0x210e:
-            case 0x2110:
-            case 0x2112:
-            case 0x2114:
-                ppu.bg_config[(addr - 0x210e) / 2].v_scroll =
-                    (value << 8) | ppu.bg_scroll_latch;
-                ppu.bg_scroll_latch = value;
-                break;
-            case 0x2115:
-                ppu.address_increment_amount = value & 0b11;
-                ppu.address_remapping = (value >> 2) & 0b11;
-                ppu.address_increment_mode = value & 0x80;
-                break;
-            case 0x2116:
-                ppu.vram_addr &= 0xff00;
-                ppu.vram_addr |= value;
-                ppu.vram_latch_l = ppu.vram[ppu.vram_addr * 2];
-                ppu.vram_latch_h = ppu.vram[ppu.vram_addr * 2 + 1];
-                break;
-            case 0x2117:
-                ppu.vram_addr &= 0xff;
-                ppu.vram_addr |= value << 8;
-                ppu.vram_latch_l = ppu.vram[ppu.vram_addr * 2];
-                ppu.vram_latch_h = ppu.vram[ppu.vram_addr * 2 + 1];
-                break;
-            case 0x2118:
-            case 0x2119: {
-                uint16_t actual_addr = ppu.vram_addr;
-                switch (ppu.address_remapping) {
-                case 0:
-                    // this page intentionally left blank
-                    break;
-                case 1:
-                    actual_addr = (actual_addr & 0xff00) |
-                                  ((actual_addr << 3) & 0xf8) |
-                                  ((actual_addr >> 5) & 0x7);
-                    break;
-                case 2:
-                    actual_addr = (actual_addr & 0xfe00) |
-                                  ((actual_addr << 3) & 0x1f8) |
-                                  ((actual_addr >> 6) & 0x7);
-                    break;
-                case 3:
-                    actual_addr = (actual_addr & 0xfc00) |
-                                  ((actual_addr << 3) & 0x3f8) |
-                                  ((actual_addr >> 7) & 0x7);
-                    break;
-                default:
-                    UNREACHABLE_SWITCH(ppu.address_remapping);
-                }
-                actual_addr = (actual_addr << 1) + (addr - 0x2118);
-
-                ppu.vram[actual_addr] = value;
-                if (ppu.address_increment_mode == (addr - 0x2118)) {
-                    switch (ppu.address_increment_amount) {
-                    case 0:
-                        ppu.vram_addr++;
-                        break;
-                    case 1:
-                        ppu.vram_addr += 32;
-                        break;
-                    case 2:
-                    case 3:
-                        ppu.vram_addr += 128;
-                        break;
-                    default:
-                        UNREACHABLE_SWITCH(ppu.address_increment_amount);
-                    }
-                }
-            } break;
-            case 0x211a:
-                ppu.mode_7_flip_h = value & 1;
-                ppu.mode_7_flip_v = value & 2;
-                ppu.mode_7_non_tilemap_fill = value & 64;
-                ppu.mode_7_tilemap_repeat = !(value & 128);
-                break;
-            case 0x211b:
-                ppu.a_7_buffer = (value << 8) | ppu.mode_7_latch;
-                ppu.mode_7_latch = value;
-                ppu.a_7 = ppu.a_7_buffer / 256.f;
-                if (ppu.a_7_buffer & 0x8000)
-                    ppu.a_7 -= 256.f;
-                ppu.mul_factor_1 = ppu.a_7_buffer;
-                break;
-            case 0x211c:
-                ppu.b_7_buffer = (value << 8) | ppu.mode_7_latch;
-                ppu.mode_7_latch = value;
-                ppu.b_7 = ppu.b_7_buffer / 256.f;
-                if (ppu.b_7_buffer & 0x8000)
-                    ppu.b_7 -= 256.f;
-                ppu.mul_factor_2 = value;
-                break;
-            case 0x211d:
-                ppu.c_7_buffer = (value << 8) | ppu.mode_7_latch;
-                ppu.mode_7_latch = value;
-                ppu.c_7 = ppu.c_7_buffer / 256.f;
-                if (ppu.c_7_buffer & 0x8000)
-                    ppu.c_7 -= 256.f;
-                break;
-            case 0x211e:
-                ppu.d_7_buffer = (value << 8) | ppu.mode_7_latch;
-                ppu.mode_7_latch = value;
-                ppu.d_7 = ppu.d_7_buffer / 256.f;
-                if (ppu.d_7_buffer & 0x8000)
-                    ppu.d_7 -= 256.f;
-                break;
-            case 0x211f:
-                ppu.mode_7_center_x = (value << 8) | ppu.mode_7_latch;
-                ppu.mode_7_latch = value;
-                break;
-            case 0x2120:
-                ppu.mode_7_center_y = (value << 8) | ppu.mode_7_latch;
-                ppu.mode_7_latch = value;
-                break;
-            case 0x2121:
-                ppu.cgram_addr = value;
-                ppu.cgram_latched = false;
-                break;
-            case 0x2122:
-                if (!ppu.cgram_latched) {
-                    ppu.cgram_latch = value;
-                    ppu.cgram_latched = true;
-                } else {
-                    ppu.cgram[ppu.cgram_addr++] =
-                        r5g5b5_to_r8g8b8a8(TO_U16(ppu.cgram_latch, value));
-                    ppu.cgram_latched = false;
-                }
-                break;
-            case 0x2123:
-                ppu.bg_config[0].window_1_invert = value & 1;
-                ppu.bg_config[0].window_1_enable = value & 2;
-                ppu.bg_config[0].window_2_invert = value & 4;
-                ppu.bg_config[0].window_2_enable = value & 8;
-                ppu.bg_config[1].window_1_invert = value & 16;
-                ppu.bg_config[1].window_1_enable = value & 32;
-                ppu.bg_config[1].window_2_invert = value & 64;
-                ppu.bg_config[1].window_2_enable = value & 128;
-                break;
-            case 0x2124:
-                ppu.bg_config[2].window_1_invert = value & 1;
-                ppu.bg_config[2].window_1_enable = value & 2;
-                ppu.bg_config[2].window_2_invert = value & 4;
-                ppu.bg_config[2].window_2_enable = value & 8;
-                ppu.bg_config[3].window_1_invert = value & 16;
-                ppu.bg_config[3].window_1_enable = value & 32;
-                ppu.bg_config[3].window_2_invert = value & 64;
-                ppu.bg_config[3].window_2_enable = value & 128;
-                break;
-            case 0x2125:
-                ppu.obj_window_1_invert = value & 1;
-                ppu.obj_window_1_enable = value & 2;
-                ppu.obj_window_2_invert = value & 4;
-                ppu.obj_window_2_enable = value & 8;
-                ppu.col_window_1_invert = value & 16;
-                ppu.col_window_1_enable = value & 32;
-                ppu.col_window_2_invert = value & 64;
-                ppu.col_window_2_enable = value & 128;
-                break;
-            case 0x2126:
-                ppu.window_1_l = value;
-                break;
-            case 0x2127:
-                ppu.window_1_r = value;
-                break;
-            case 0x2128:
-                ppu.window_2_l = value;
-                break;
-            case 0x2129:
-                ppu.window_2_r = value;
-                break;
-            case 0x212a:
-                ppu.bg_config[0].mask_logic = (value >> 0) & 0b11;
-                ppu.bg_config[1].mask_logic = (value >> 2) & 0b11;
-                ppu.bg_config[2].mask_logic = (value >> 4) & 0b11;
-                ppu.bg_config[3].mask_logic = (value >> 6) & 0b11;
-                break;
-            case 0x212b:
-                ppu.obj_window_mask_logic = (value >> 0) & 0b11;
-                ppu.col_window_mask_logic = (value >> 2) & 0b11;
-                break;
-            case 0x212c:
-                ppu.bg_config[0].main_screen_enable = value & 1;
-                ppu.bg_config[1].main_screen_enable = value & 2;
-                ppu.bg_config[2].main_screen_enable = value & 4;
-                ppu.bg_config[3].main_screen_enable = value & 8;
-                ppu.obj_main_screen_enable = value & 16;
-                break;
-            case 0x212d:
-                ppu.bg_config[0].sub_screen_enable = value & 1;
-                ppu.bg_config[1].sub_screen_enable = value & 2;
-                ppu.bg_config[2].sub_screen_enable = value & 4;
-                ppu.bg_config[3].sub_screen_enable = value & 8;
-                ppu.obj_sub_screen_enable = value & 16;
-                break;
-            case 0x212e:
-                ppu.bg_config[0].main_window_enable = value & 1;
-                ppu.bg_config[1].main_window_enable = value & 2;
-                ppu.bg_config[2].main_window_enable = value & 4;
-                ppu.bg_config[3].main_window_enable = value & 8;
-                ppu.obj_main_window_enable = value & 16;
-                break;
-            case 0x212f:
-                ppu.bg_config[0].sub_window_enable = value & 1;
-                ppu.bg_config[1].sub_window_enable = value & 2;
-                ppu.bg_config[2].sub_window_enable = value & 4;
-                ppu.bg_config[3].sub_window_enable = value & 8;
-                ppu.obj_sub_window_enable = value & 16;
-                break;
-            case 0x2130:
-                ppu.direct_color_mode = value & 1;
-                ppu.addend_subscreen = value & 2;
-                ppu.sub_window_transparent_region = (value >> 4) & 0b11;
-                ppu.main_window_black_region = (value >> 6) & 0b11;
-                break;
-            case 0x2131:
-                ppu.bg_config[0].color_math_enable = value & 1;
-                ppu.bg_config[1].color_math_enable = value & 2;
-                ppu.bg_config[2].color_math_enable = value & 4;
-                ppu.bg_config[3].color_math_enable = value & 8;
-                ppu.obj_color_math_enable = value & 16;
-                ppu.backdrop_color_math_enable = value & 32;
-                ppu.half_color_math = value & 64;
-                ppu.color_math_subtract = value & 128;
-                break;
-            case 0x2132:
-                if (value & 0x80) {
-                    ppu.fixed_color_b = value & 0x1f;
-                }
-                if (value & 0x40) {
-                    ppu.fixed_color_g = value & 0x1f;
-                }
-                if (value & 0x20) {
-                    ppu.fixed_color_r = value & 0x1f;
-                }
-                ppu.fixed_color_24bit = r5g5b5_components_to_r8g8b8a8(
-                    ppu.fixed_color_r, ppu.fixed_color_g, ppu.fixed_color_b);
-                break;
-            case 0x2133:
-                ppu.screen_interlacing = value & 0b1;
-                ppu.obj_interlacing = value & 0b10;
-                ppu.overscan = value & 0b100;
-                ppu.high_res = value & 0b1000;
-                ppu.extbg = value & 0b1000000;
-                ppu.external_sync = value & 0b10000000;
-                break;
-            case 0x2140:
-            case 0x2141:
-            case 0x2142:
-            case 0x2143:
-                if (log)
-                    log_message(LOG_LEVEL_INFO,
-                                "CPU: wrote 0x%02x to port %d of APU bus",
-                                value, addr - 0x2140 + 1);
-                cpu.memory.apu_io[addr - 0x2140] = value;
-                break;
-            case 0x2180:
-                cpu.memory.ram[cpu.memory.ramaddr++] = value;
-                cpu.memory.ramaddr &= 0x1ffff;
-                break;
-            case 0x2181:
-                cpu.memory.ramaddr &= 0x1ff00;
-                cpu.memory.ramaddr |= value;
-                break;
-            case 0x2182:
-                cpu.memory.ramaddr &= 0x100ff;
-                cpu.memory.ramaddr |= value << 8;
-                break;
-            case 0x2183:
-                cpu.memory.ramaddr &= 0xffff;
-                cpu.memory.ramaddr |= (value & 1) << 16;
-                break;
-            case 0x4016:
-                if (!cpu.memory.joy_latch_pending && (value & 1)) {
-                    cpu.memory.joy1_shift_idx = 0;
-                    cpu.memory.joy2_shift_idx = 0;
-                    cpu.memory.joy1l_latched = cpu.memory.joy1l;
-                    cpu.memory.joy1h_latched = cpu.memory.joy1h;
-                    cpu.memory.joy2l_latched = cpu.memory.joy2l;
-                    cpu.memory.joy2h_latched = cpu.memory.joy2h;
-                }
-
-                cpu.memory.joy_latch_pending = value & 1;
-                break;
-            case 0x4200:
-                cpu.memory.joy_auto_read = value & 1;
-                cpu.vblank_nmi_enable = value & 0x80;
-                cpu.timer_irq = (value >> 4) & 0b11;
-                break;
-            case 0x4201:
-                if (value & 0x80) {
-                    if (!ppu.counter_latch) {
-                        ppu.beam_x_latch_content = ppu.beam_x;
-                        ppu.beam_y_latch_content = ppu.beam_y;
-                    }
-                    ppu.counter_latch = true;
-                }
-                break;
-            case 0x4202:
-                cpu.memory.mul_factor_a = value;
-                break;
-            case 0x4203:
-                cpu.memory.mul_factor_b = value;
-                cpu.memory.mul_output =
-                    cpu.memory.mul_factor_a * cpu.memory.mul_factor_b;
-                break;
-            case 0x4204:
-                cpu.memory.dividend &= 0xff00;
-                cpu.memory.dividend |= value;
-                break;
-            case 0x4205:
-                cpu.memory.dividend &= 0xff;
-                cpu.memory.dividend |= value << 8;
-                break;
-            case 0x4206:
-                cpu.memory.divisor = value;
-                cpu.memory.div_output =
-                    value == 0 ? 0xffff
-                               : cpu.memory.dividend / cpu.memory.divisor;
-                cpu.memory.mul_output =
-                    value == 0 ? cpu.memory.dividend
-                               : cpu.memory.dividend % cpu.memory.divisor;
-                break;
-            case 0x4207:
-                ppu.h_timer_target &= 0x100;
-                ppu.h_timer_target |= value;
-                break;
-            case 0x4208:
-                ppu.h_timer_target &= 0xff;
-                ppu.h_timer_target |= (value & 1) << 8;
-                break;
-            case 0x4209:
-                ppu.v_timer_target &= 0x100;
-                ppu.v_timer_target |= value;
-                break;
-            case 0x420a:
-                ppu.v_timer_target &= 0xff;
-                ppu.v_timer_target |= (value & 1) << 8;
-                break;
-            case 0x420b:
-                for (uint8_t i = 0; i < 8; i++)
-                    if (value & (1 << i)) {
-                        uint32_t byte_count =
-                            cpu.memory.dmas[i].dma_byte_count & 0xffff;
-                        bool direction = cpu.memory.dmas[i].direction;
-                        uint32_t a_addr = cpu.memory.dmas[i].dma_src_addr;
-                        uint16_t b_addr =
-                            0x2100 + cpu.memory.dmas[i].b_bus_addr;
-                        uint8_t transfer_pattern =
-                            cpu.memory.dmas[i].transfer_pattern;
-                        uint8_t addr_inc_mode =
-                            cpu.memory.dmas[i].addr_inc_mode;
-                        if (byte_count == 0)
-                            byte_count = 0x10000;
-                        for (uint32_t j = 0; j < byte_count; j++) {
-                            if (direction) {
-                                uint8_t to_transfer = read_8(
-                                    b_addr + transfer_patterns[transfer_pattern]
-                                                              [j % 4],
-                                    0);
-                                write_8(U24_LOSHORT(a_addr), U24_HIBYTE(a_addr),
-                                        to_transfer);
-                                if (addr_inc_mode == 0)
-                                    a_addr = TO_U24(U24_LOSHORT(a_addr + 1),
-                                                    U24_HIBYTE(a_addr));
-                                if (addr_inc_mode == 2)
-                                    a_addr = TO_U24(U24_LOSHORT(a_addr - 1),
-                                                    U24_HIBYTE(a_addr));
-                            } else {
-                                uint8_t to_transfer = read_8(
-                                    U24_LOSHORT(a_addr), U24_HIBYTE(a_addr));
-                                if (addr_inc_mode == 0)
-                                    a_addr = TO_U24(U24_LOSHORT(a_addr + 1),
-                                                    U24_HIBYTE(a_addr));
-                                if (addr_inc_mode == 2)
-                                    a_addr = TO_U24(U24_LOSHORT(a_addr - 1),
-                                                    U24_HIBYTE(a_addr));
-                                write_8(b_addr +
-                                            transfer_patterns[transfer_pattern]
-                                                             [j % 4],
-                                        0, to_transfer);
-                            }
-                        }
-
-                        cpu.memory.dmas[i].dma_src_addr = a_addr;
-                        cpu.memory.dmas[i].dma_byte_count = 0;
-                    }
-                break;
-            case 0x420c:
-                for (uint8_t i = 0; i < 8; i++) {
-                    cpu.memory.dmas[i].hdma_enable = value & (1 << i);
-                    if (cpu.memory.dmas[i].hdma_enable) {
-                        cpu.memory.dmas[i].hdma_current_address =
-                            cpu.memory.dmas[i].dma_src_addr;
-                    }
-                }
-                break;
-            case 0x420d:
-                // who needs fastROM when all ROM is fast
-                break;
-            case 0x4214:
-                cpu.memory.div_output =
-                    TO_U16(value, U16_HIBYTE(cpu.memory.div_output));
-                break;
-            case 0x4215:
-                cpu.memory.div_output =
-                    TO_U16(U16_LOBYTE(cpu.memory.div_output), value);
-                break;
-            case 0x4216:
-                cpu.memory.mul_output =
-                    TO_U16(value, U16_HIBYTE(cpu.memory.mul_output));
-                break;
-            case 0x4217:
-                cpu.memory.mul_output =
-                    TO_U16(U16_LOBYTE(cpu.memory.mul_output), value);
-                break;
-            case 0x4300:
-            case 0x4310:
-            case 0x4320:
-            case 0x4330:
-            case 0x4340:
-            case 0x4350:
-            case 0x4360:
-            case 0x4370:
-                cpu.memory.dmas[(addr - 0x4300) / 16].direction = value & 0x80;
-                cpu.memory.dmas[(addr - 0x4300) / 16].indirect_hdma =
-                    value & 0x40;
-                cpu.memory.dmas[(addr - 0x4300) / 16].addr_inc_mode =
-                    (value >> 3) & 0b11;
-                cpu.memory.dmas[(addr - 0x4300) / 16].transfer_pattern =
-                    value & 0b111;
-                cpu.memory.dmas[(addr - 0x4300) / 16].params_raw = value;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4301:
-            case 0x4311:
-            case 0x4321:
-            case 0x4331:
-            case 0x4341:
-            case 0x4351:
-            case 0x4361:
-            case 0x4371:
-                cpu.memory.dmas[(addr - 0x4300) / 16].b_bus_addr = value;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4302:
-            case 0x4312:
-            case 0x4322:
-            case 0x4332:
-            case 0x4342:
-            case 0x4352:
-            case 0x4362:
-            case 0x4372:
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr &= 0xffff00;
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr |= value;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4303:
-            case 0x4313:
-            case 0x4323:
-            case 0x4333:
-            case 0x4343:
-            case 0x4353:
-            case 0x4363:
-            case 0x4373:
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr &= 0xff00ff;
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr |= value
-                                                                      << 8;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4304:
-            case 0x4314:
-            case 0x4324:
-            case 0x4334:
-            case 0x4344:
-            case 0x4354:
-            case 0x4364:
-            case 0x4374:
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr &= 0xffff;
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_src_addr |= value
-                                                                      << 16;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4305:
-            case 0x4315:
-            case 0x4325:
-            case 0x4335:
-            case 0x4345:
-            case 0x4355:
-            case 0x4365:
-            case 0x4375:
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count &=
-                    0xffff00;
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count |= value;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4306:
-            case 0x4316:
-            case 0x4326:
-            case 0x4336:
-            case 0x4346:
-            case 0x4356:
-            case 0x4366:
-            case 0x4376:
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count &=
-                    0xff00ff;
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count |= value
-                                                                        << 8;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4307:
-            case 0x4317:
-            case 0x4327:
-            case 0x4337:
-            case 0x4347:
-            case 0x4357:
-            case 0x4367:
-            case 0x4377:
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count &= 0xffff;
-                cpu.memory.dmas[(addr - 0x4300) / 16].dma_byte_count |= value
-                                                                        << 16;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4308:
-            case 0x4318:
-            case 0x4328:
-            case 0x4338:
-            case 0x4348:
-            case 0x4358:
-            case 0x4368:
-            case 0x4378:
-                cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address &=
-                    0xffff00;
-                cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address |=
-                    value;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x4309:
-            case 0x4319:
-            case 0x4329:
-            case 0x4339:
-            case 0x4349:
-            case 0x4359:
-            case 0x4369:
-            case 0x4379:
-                cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address &=
-                    0xff00ff;
-                cpu.memory.dmas[(addr - 0x4300) / 16].hdma_current_address |=
-                    value << 8;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            case 0x430a:
-            case 0x431a:
-            case 0x432a:
-            case 0x433a:
-            case 0x434a:
-            case 0x435a:
-            case 0x436a:
-            case 0x437a:
-                cpu.memory.dmas[(addr - 0x4300) / 16].scanlines_left =
-                    value & 0x7f;
-                cpu.memory.dmas[(addr - 0x4300) / 16].hdma_repeat =
-                    value & 0x80;
-                cpu.memory.dmas_for_reloading[addr - 0x4300] = value;
-                break;
-            default:
+            const mmio_write_t *handlers = mmio_writes[(addr - 0x2000) >> 8];
+            if (handlers != NULL && handlers[addr & 0xff] != NULL) {
+                snes->cpu_run.mmio = true;
+                handlers[addr & 0xff](snes, addr, value);
+            } else {
                 log_message(
                     LOG_LEVEL_WARNING,
                     "Tried to write 0x%02x to bank 0x%02x, address 0x%04x",
                     value, bank, addr);
-                return;
             }
         } else {
-            log_message(LOG_LEVEL_WARNING, "Tried to write 0x%02x to expansion address 0x%04x", value, addr);
+            log_message(LOG_LEVEL_WARNING,
+                        "Tried to write 0x%02x to expansion address 0x%04x",
+                        value, addr);
         }
     } else if (bank == 0x7e || bank == 0x7f) {
         ASSERT(
             (bank - 0x7e) * 0x10000 + addr < 0x20000,
             "Tried to access RAM out of bounds at address 0x%04x, bank 0x%02x",
             addr, bank);
-        cpu.memory.ram[(bank - 0x7e) * 0x10000 + addr] = value;
+        snes->cpu.memory.ram[(bank - 0x7e) * 0x10000 + addr] = value;
     } else {
         log_message(LOG_LEVEL_WARNING,
                     "Tried to write 0x%02x to bank 0x%02x, address 0x%04x",
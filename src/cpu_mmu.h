@@ -3,8 +3,20 @@
 
 #include "types.h"
 
-void mmu_init(memory_map_mode_t mode);
-uint8_t mmu_read(uint16_t addr, uint8_t bank, bool log);
-void mmu_write(uint16_t addr, uint8_t bank, uint8_t value, bool log);
+void mmu_init(snes_t *snes, memory_map_mode_t mode);
+void mmu_build_pages(snes_t *snes);
+void mmu_build_access_clocks(snes_t *snes);
+uint8_t mmu_read(snes_t *snes, uint16_t addr, uint8_t bank, bool log);
+// what reading addr would return, if that can be known without side effects
+bool mmu_peek(snes_t *snes, uint16_t addr, uint8_t bank, uint8_t *value);
+void mmu_write(snes_t *snes, uint16_t addr, uint8_t bank, uint8_t value);
+
+static inline uint8_t mmu_access_clocks(snes_t *snes, uint16_t addr,
+                                        uint8_t bank) {
+    uint8_t clocks = snes->access_clocks[TO_U24(addr, bank) >> MMU_PAGE_BITS];
+    if (clocks == 0)
+        return addr < 0x4200 ? 12 : 6;
+    return clocks;
+}
 
 #endif
@@ -0,0 +1,231 @@
+#include "frontend.h"
+#include "movie.h"
+#include "raylib.h"
+#include "rewind.h"
+#include "snes.h"
+#include "timing.h"
+#include "types.h"
+#include "ui.h"
+
+#define GAMEPAD_UP GAMEPAD_BUTTON_LEFT_FACE_UP
+#define GAMEPAD_DOWN GAMEPAD_BUTTON_LEFT_FACE_DOWN
+#define GAMEPAD_LEFT GAMEPAD_BUTTON_LEFT_FACE_LEFT
+#define GAMEPAD_RIGHT GAMEPAD_BUTTON_LEFT_FACE_RIGHT
+
+#define GAMEPAD_A GAMEPAD_BUTTON_RIGHT_FACE_RIGHT
+#define GAMEPAD_B GAMEPAD_BUTTON_RIGHT_FACE_DOWN
+#define GAMEPAD_X GAMEPAD_BUTTON_RIGHT_FACE_UP
+#define GAMEPAD_Y GAMEPAD_BUTTON_RIGHT_FACE_LEFT
+
+#define GAMEPAD_START GAMEPAD_BUTTON_MIDDLE_RIGHT
+#define GAMEPAD_SELECT GAMEPAD_BUTTON_MIDDLE_LEFT
+
+#define GAMEPAD_R GAMEPAD_BUTTON_RIGHT_TRIGGER_1
+#define GAMEPAD_L GAMEPAD_BUTTON_LEFT_TRIGGER_1
+
+static AudioStream stream;
+// raylib's audio callback carries no user pointer, so the machine that feeds
+// the stream is remembered here
+static snes_t *stream_snes;
+
+static void stream_cb(void *buffer, unsigned int count) {
+    audio_cb(stream_snes, buffer, count);
+}
+
+void apu_init(snes_t *snes) {
+    SetTraceLogLevel(LOG_ERROR);
+    InitAudioDevice();
+    stream_snes = snes;
+    stream = LoadAudioStream(SAMPLE_RATE, 16, 2);
+    SetAudioStreamCallback(stream, stream_cb);
+    PlayAudioStream(stream);
+}
+
+void apu_free(void) {
+    StopAudioStream(stream);
+    UnloadAudioStream(stream);
+    CloseAudioDevice();
+}
+
+static void stop_recording(snes_t *snes, movie_t *movie) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.wmov", snes->cpu.file_name);
+    if (movie_save(movie, path)) {
+        log_message(LOG_LEVEL_INFO, "Recorded %d frames to %s",
+                    movie_frames(movie), path);
+    } else {
+        log_message(LOG_LEVEL_WARNING, "Could not save movie %s", path);
+    }
+    movie_destroy(movie);
+}
+
+void ui(snes_t *snes) {
+    SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE);
+    InitWindow(WINDOW_WIDTH * 4, WINDOW_HEIGHT * 4, "snes");
+    Image framebuffer_image = {(void *)snes_get_framebuffer(snes), WINDOW_WIDTH,
+                               WINDOW_HEIGHT, 1,
+                               PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    Texture texture = LoadTextureFromImage(framebuffer_image);
+    cpp_init(snes);
+
+    bool view_debug_ui = false, view_scanline = false;
+    rewind_t *rewind = rewind_create(64 * 1024 * 1024, 60);
+    // frames emulated ahead of the real machine with the current input,
+    // cycled with F9. The real timeline, and the audio, never see them.
+    uint32_t run_ahead = 0;
+    snes_t *ahead = NULL;
+    // F7 starts and stops recording a movie to <rom>.wmov. While recording,
+    // whole frames are run so that input only changes between frames.
+    movie_t *movie = NULL;
+
+    while (!WindowShouldClose()) {
+        BeginDrawing();
+        ClearBackground(GetColor(SWAP_ENDIAN(snes->ppu.fixed_color_24bit))));
+
+        // while rewinding, every host frame steps back one recorded frame and
+        // plays it forward again so there is a picture to show
+        bool rewinding = IsKeyDown(KEY_BACKSPACE) &&
+                         snes->cpu.state == STATE_RUNNING && movie == NULL;
+        if (rewinding) {
+            rewind_pop(rewind, snes);
+        }
+        if (movie != NULL && snes->cpu.state == STATE_RUNNING) {
+            movie_run_frame(movie, snes);
+        } else {
+            snes_run_dots(snes, 341 * 262 * snes->cpu.speed *
+                                    (GetFrameTime() / 0.0166f));
+        }
+        if (!rewinding && snes->cpu.state == STATE_RUNNING) {
+            rewind_push(rewind, snes);
+        }
+
+        uint16_t buttons = 0;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_R) << 4;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_L) << 5;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_X) << 6;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_A) << 7;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_RIGHT) << 8;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_LEFT) << 9;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_DOWN) << 10;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_UP) << 11;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_START) << 12;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_SELECT) << 13;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_Y) << 14;
+        buttons |= IsGamepadButtonDown(0, GAMEPAD_B) << 15;
+
+        buttons |= (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_X) > 0.5) << 8;
+        buttons |= (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_X) < -0.5) << 9;
+        buttons |= (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_Y) > 0.5) << 10;
+        buttons |= (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_Y) < -0.5)
+                   << 11;
+
+        buttons |= IsKeyDown(KEY_RIGHT) << 8;
+        buttons |= IsKeyDown(KEY_LEFT) << 9;
+        buttons |= IsKeyDown(KEY_DOWN) << 10;
+        buttons |= IsKeyDown(KEY_UP) << 11;
+        buttons |= IsKeyDown(KEY_RIGHT_CONTROL) << 12;
+        buttons |= IsKeyDown(KEY_LEFT_CONTROL) << 13;
+        snes_set_input(snes, 0, buttons);
+
+        const uint8_t *shown = snes_get_framebuffer(snes);
+        if (run_ahead > 0 && !rewinding && snes->cpu.state == STATE_RUNNING) {
+            if (ahead == NULL)
+                ahead = snes_clone(snes);
+            if (ahead != NULL && snes_run_ahead(snes, ahead, run_ahead))
+                shown = snes_get_framebuffer(ahead);
+        }
+        UpdateTexture(texture, shown);
+        DrawTexturePro(texture, (Rectangle){0, 0, WINDOW_WIDTH, WINDOW_HEIGHT},
+                       (Rectangle){0, 0, GetScreenWidth(), GetScreenHeight()},
+                       (Vector2){0, 0}, 0.0f, WHITE);
+
+        if (IsKeyPressed(KEY_TAB)) {
+            view_debug_ui = !view_debug_ui;
+        }
+
+        if (IsKeyPressed(KEY_F10)) {
+            snes->cpu.state = snes->cpu.state == STATE_RUNNING ? STATE_STOPPED
+                                                               : STATE_RUNNING;
+        }
+
+        if (IsKeyPressed(KEY_END)) {
+            snes->cpu.speed *= 2;
+        }
+
+        if (IsKeyPressed(KEY_HOME)) {
+            snes->cpu.speed /= 2;
+        }
+
+        if (IsKeyPressed(KEY_F7)) {
+            if (movie == NULL) {
+                // recording has to start on a frame boundary
+                if (!(snes->ppu.beam_x == 0 && snes->ppu.beam_y == 0))
+                    snes_run_frame(snes);
+                if (snes->ppu.beam_x == 0 && snes->ppu.beam_y == 0)
+                    movie = movie_create(snes);
+                else
+                    log_message(LOG_LEVEL_WARNING,
+                                "Movies can only be recorded while running");
+            } else {
+                stop_recording(snes, movie);
+                movie = NULL;
+            }
+        }
+
+        if (IsKeyPressed(KEY_F8)) {
+            timing_enable(snes, !snes->timing.enabled);
+        }
+
+        if (IsKeyPressed(KEY_F9)) {
+            run_ahead = (run_ahead + 1) % 5;
+            log_message(LOG_LEVEL_INFO, "Run-ahead: %d frames", run_ahead);
+        }
+
+        if (IsKeyPressed(KEY_LEFT_ALT)) {
+            view_scanline = !view_scanline;
+        }
+
+        if (view_scanline) {
+            uint32_t scanline_pos =
+                ((snes->ppu.beam_y - 1.f) / WINDOW_HEIGHT) * GetScreenHeight();
+            DrawLine(0, scanline_pos - 1, GetScreenWidth(), scanline_pos - 1,
+                     WHITE);
+            DrawLine(0, scanline_pos, GetScreenWidth(), scanline_pos, RED);
+            DrawLine(0, scanline_pos + 1, GetScreenWidth(), scanline_pos + 1,
+                     WHITE);
+        }
+
+        if (view_debug_ui) {
+            cpp_imgui_render();
+        }
+
+        DrawFPS(0, 0);
+        if (snes->timing.enabled && snes->timing.frames > 0) {
+            // the last finished frame, broken down by section
+            const float *last =
+                snes->timing
+                    .history[(snes->timing.frames - 1) % TIMING_HISTORY];
+            DrawText(
+                TextFormat("frame %.2f ms  p50 %.2f  p99 %.2f",
+                           last[TIMING_SECTIONS],
+                           timing_percentile(snes, TIMING_SECTIONS, 0.5f),
+                           timing_percentile(snes, TIMING_SECTIONS, 0.99f)),
+                0, 20, 20, LIME);
+            for (uint32_t i = 0; i < TIMING_SECTIONS; i++) {
+                DrawText(TextFormat("%-12s %.3f ms", timing_section_name(i),
+                                    last[i]),
+                         0, 40 + i * 20, 20, LIME);
+            }
+        }
+
+        EndDrawing();
+    }
+
+    cpp_end();
+    rewind_destroy(rewind);
+    snes_destroy(ahead);
+    if (movie != NULL)
+        stop_recording(snes, movie);
+    UnloadTexture(texture);
+    CloseWindow();
+}
@@ -0,0 +1,11 @@
+#ifndef FRONTEND_H_
+#define FRONTEND_H_
+
+#include "apu.h"
+#include "types.h"
+
+void apu_init(snes_t *snes);
+void apu_free(void);
+void ui(snes_t *snes);
+
+#endif
@@ -1,5 +0,0 @@
-#include "types.h"
-
-cpu_t cpu = {0};
-ppu_t ppu = {0};
-spc_t spc = {0};
@@ -1,185 +1,141 @@
-#include "apu.h"
-#include "cpu.h"
-#include "ppu.h"
-#include "spc.h"
+#include "frontend.h"
+#include "movie.h"
+#include "profiler.h"
+#include "snes.h"
+#include "timing.h"
 #include "types.h"
+#include <time.h>
 
-extern cpu_t cpu;
-extern spc_t spc;
+static snes_t *snes = NULL;
+static bool dump_history = true;
 
-#define get16bits(d)                                                           \
-    ((((uint32_t)(((const uint8_t *)(d))[1])) << 8) +                          \
-     (uint32_t)(((const uint8_t *)(d))[0]))
-// source: https://www.azillionmonkeys.com/qed/hash.html
-uint32_t super_fast_hash(const char *data, uint32_t len) {
-    uint32_t hash = len, tmp;
-    int rem;
-
-    if (len <= 0 || data == NULL)
-        return 0;
-
-    rem = len & 3;
-    len >>= 2;
-
-    /* Main loop */
-    for (; len > 0; len--) {
-        hash += get16bits(data);
-        tmp = (get16bits(data + 2) << 11) ^ hash;
-        hash = (hash << 16) ^ tmp;
-        data += 2 * sizeof(uint16_t);
-        hash += hash >> 11;
-    }
-
-    /* Handle end cases */
-    switch (rem) {
-    case 3:
-        hash += get16bits(data);
-        hash ^= hash << 16;
-        hash ^= ((signed char)data[sizeof(uint16_t)]) << 18;
-        hash += hash >> 11;
-        break;
-    case 2:
-        hash += get16bits(data);
-        hash ^= hash << 11;
-        hash += hash >> 17;
-        break;
-    case 1:
-        hash += (signed char)*data;
-        hash ^= hash << 10;
-        hash += hash >> 1;
+void at_exit(void) {
+    if (snes == NULL)
+        return;
+    if (dump_history) {
+        for (uint16_t i = snes->cpu.history_idx, j = snes->spc.history_idx;
+             i != snes->cpu.history_idx - 1; i++, j++) {
+            printf("0x%06x: 0x%02x\t 0x%04x: 0x%02x\n", snes->cpu.pc_history[i],
+                   snes->cpu.opcode_history[i], snes->spc.pc_history[j],
+                   snes->spc.opcode_history[j]);
+        }
     }
-
-    /* Force "avalanching" of final 127 bits */
-    hash ^= hash << 3;
-    hash += hash >> 5;
-    hash ^= hash << 4;
-    hash += hash >> 17;
-    hash ^= hash << 25;
-    hash += hash >> 6;
-
-    return hash;
+    snes_destroy(snes);
+    snes = NULL;
 }
-#undef get16bits
 
-static cart_hash_t rom_hash_lookup[] = {
-    {"Super Mario World", 0x270efb15, LOROM},
-    {"Super Mario All Stars", 0x2272b1cd, LOROM},
-    {"SNES CPU Test", 0x69d6bf43, LOROM},
-    {"SNES CPU Test Basic", 0x7b3f6de6, LOROM},
-    {"SNES SPC Test", 0xb9a70b6a, LOROM},
-    {"Earthbound", 0xb4975b60, HIROM},
-    {"Puzzle Bobble", 0xc1a14c71, LOROM},
-    {"Control Test Auto", 0xdd642b6a, LOROM},
-    {"Control Test Simple", 0xc0467d5c, LOROM},
-    {"Donkey Kong Country", 0xc1a8ad4c, HIROM},
-    {"Aging Test ROM", 0x35a123c5, LOROM},
-    {"Burn In Test ROM", 0x660892f8, LOROM},
-    {"Harvest Moon", 0xe39158fd, LOROM},
-    {"The Legend Of Zelda: A Link To The Past", 0x5c289c1c, LOROM},
-    {"Mega Man X", 0xcb111768, LOROM},
-    {"Chrono Trigger", 0x12183f9, HIROM},
-    {"Kirby's Dream Course", 0x859f36cd, LOROM},
-};
+static double get_wall_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-void at_exit(void) {
-    for (uint16_t i = cpu.history_idx, j = spc.history_idx; i != cpu.history_idx - 1; i++, j++) {
-        printf("0x%06x: 0x%02x\t 0x%04x: 0x%02x\n", cpu.pc_history[i],
-               cpu.opcode_history[i], spc.pc_history[j], spc.opcode_history[j]);
+// with a movie, its input drives the machine and the run ends with the movie
+static void headless(uint32_t frames, movie_t *movie) {
+    uint32_t frames_hash = 0;
+    double start = get_wall_time();
+    uint32_t frames_done = 0;
+    while (frames_done < frames) {
+        if (movie != NULL) {
+            if (!movie_run_frame(movie, snes))
+                break;
+        } else {
+            snes_run_frame(snes);
+        }
+        if (snes->cpu.state != STATE_RUNNING)
+            break;
+        frames_hash = frames_hash * 31 +
+                      super_fast_hash((const char *)snes_get_framebuffer(snes),
+                                      WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+        frames_done++;
+    }
+    double elapsed = get_wall_time() - start;
+
+    printf("frames: %u\n", frames_done);
+    printf("frame hash: 0x%08x\n", frames_hash);
+    if (movie != NULL) {
+        if (movie_desync_frame(movie) == UINT32_MAX) {
+            printf("movie: in sync\n");
+        } else {
+            printf("movie: desynced at frame %u\n", movie_desync_frame(movie));
+        }
     }
+    printf("wall time: %.3f s\n", elapsed);
+    printf("emulated fps: %.2f\n", frames_done / elapsed);
+    printf("ms/frame: %.4f\n", elapsed * 1000 / MAX(frames_done, 1));
 }
 
 int main(int argc, char **argv) {
-    ASSERT(argc == 2,
-           "Incorrect parameter count: %d, expected 1, usage: ./snes <rom>.sfc",
+    // created first so that failed assertions have a machine to report on
+    snes = snes_create();
+    ASSERT(argc >= 2,
+           "Incorrect parameter count: %d, expected at least 1, usage: ./snes "
+           "<rom>.sfc [--headless] [--frames N] [--movie <movie>.wmov] "
+           "[--timing <out>.json] [--profile <out>.csv] [--no-jit] "
+           "[--no-idle-skip]",
            argc - 1);
-    ASSERT(strncmp(".sfc", strrchr(argv[1], '.'), 5) == 0,
-           "Incorrect file extension: %s, expected .sfc",
-           strrchr(argv[1], '.'));
-
-    cpu.file_name = argv[1];
-    FILE *f = fopen(argv[1], "rb");
-    fseek(f, 0, SEEK_END);
-    uint32_t file_size = ftell(f);
-    if (file_size % 1024 != 0) {
-        fseek(f, 512, SEEK_SET);
-    } else {
-        fseek(f, 0, SEEK_SET);
-    }
-
-    // problem: SNES roms are in one of three possible layouts and it's not
-    // documented in the rom which one it is
-    // solution: hardcode hashes of the roms
-
-    uint8_t *file_to_hash = calloc(file_size, 1);
-    fread(file_to_hash, 1, file_size, f);
-    fclose(f);
-    uint32_t hash_value = super_fast_hash((char *)file_to_hash, file_size);
-    log_message(LOG_LEVEL_INFO, "ROM hash value: 0x%x", hash_value);
-    bool identified = false;
-    memory_map_mode_t mode;
-    for (uint32_t i = 0; i < ARRAYSIZE(rom_hash_lookup); i++) {
-        if (rom_hash_lookup[i].hash == hash_value) {
-            log_message(LOG_LEVEL_INFO, "Identified cart as %s",
-                        rom_hash_lookup[i].name);
-            identified = true;
-            mode = rom_hash_lookup[i].mode;
-            break;
+    ASSERT(strrchr(argv[1], '.') != NULL &&
+               strncmp(".sfc", strrchr(argv[1], '.'), 5) == 0,
+           "Incorrect file extension: %s, expected .sfc", argv[1]);
+
+    bool run_headless = false;
+    uint32_t frames = 600;
+    char *movie_path = NULL;
+    char *timing_path = NULL;
+    char *profile_path = NULL;
+    bool no_idle_skip = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            run_headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--movie") == 0 && i + 1 < argc) {
+            movie_path = argv[++i];
+            run_headless = true;
+        } else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc) {
+            timing_path = argv[++i];
+            run_headless = true;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+            run_headless = true;
+        } else if (strcmp(argv[i], "--no-jit") == 0) {
+            snes->cpu_jit.disabled = true;
+        } else if (strcmp(argv[i], "--no-idle-skip") == 0) {
+            no_idle_skip = true;
+        } else {
+            ASSERT(0, "Unknown parameter: %s", argv[i]);
         }
     }
 
-    if (!identified) {
-        ASSERT(0, "Cart not identified, hash value is 0x%x", hash_value);
-    }
+    snes->cpu.file_name = argv[1];
+    ASSERT(snes_load_rom_file(snes, argv[1]), "Cart %s could not be loaded",
+           argv[1]);
+    // after loading, which sets it for carts known to need it
+    if (no_idle_skip)
+        snes->cpu_idle.disabled = true;
 
-    uint8_t *header = NULL;
-    switch (mode) {
-    case LOROM:
-        header = file_to_hash + 0x7fc0;
-        break;
-    case HIROM:
-        header = file_to_hash + 0xffc0;
-        break;
-    case EXHIROM:
-        header = file_to_hash + 0x40ffc0;
-        break;
-    default:
-        UNREACHABLE_SWITCH(mode);
-    }
-
-    log_message(LOG_LEVEL_INFO, "Cartridge type: %d", header[0x16]);
-    log_message(LOG_LEVEL_INFO, "Cart size: %d kilobytes; %d banks",
-                file_size / 1024, file_size / 0x10000);
-    log_message(LOG_LEVEL_INFO, "ROM size: %d kilobytes",
-                (uint32_t)pow(2, header[0x17]));
-    log_message(LOG_LEVEL_INFO, "RAM size: %d kilobytes",
-                (uint32_t)pow(2, (double)(header[0x18])));
-
-    cpu.memory.coprocessor = header[0x16] >> 8;
-    cpu.memory.rom_size = file_size;// pow(2, header[0x17]) * 1024;
-    cpu.memory.rom = calloc(cpu.memory.rom_size, 1);
-    if (header[0x16] == 0x00 || ((header[0x16] & 0xf) == 0x3) ||
-        ((header[0x16] & 0xf) == 0x6)) {
-        // since the size of the cart RAM is calculated with 1 << N, it is
-        // impossible to specify for the ram to not exist using just this field.
-        // Therefore, information is taken from the cart type to establish if
-        // the cart should have RAM or not
-        cpu.memory.sram_size = 0;
-    } else {
-        cpu.memory.sram_size = pow(2, header[0x18]) * 1024;
-        cpu.memory.sram = calloc(cpu.memory.sram_size, 1);
-        for (uint32_t i = 0; i < cpu.memory.sram_size; i++) {
-            cpu.memory.sram[i] = 0xff;
+    atexit(at_exit);
+    if (run_headless) {
+        movie_t *movie = NULL;
+        if (movie_path != NULL) {
+            movie = movie_load(movie_path);
+            ASSERT(movie != NULL && movie_start_playback(movie, snes),
+                   "Movie %s could not be played back", movie_path);
+            frames = movie_frames(movie);
         }
+        snes->cpu.state = STATE_RUNNING;
+        timing_enable(snes, timing_path != NULL);
+        profiler_enable(snes, profile_path != NULL);
+        headless(frames, movie);
+        movie_destroy(movie);
+        if (timing_path != NULL)
+            timing_write_json(snes, timing_path);
+        if (profile_path != NULL)
+            profiler_write_csv(snes, profile_path);
+        dump_history = false;
+    } else {
+        apu_init(snes);
+        ui(snes);
+        apu_free();
     }
-    memcpy(cpu.memory.rom, file_to_hash, MIN(file_size, cpu.memory.rom_size));
-    cpu.memory.mode = mode;
-    cpu_reset();
-    spc_reset();
-    atexit(at_exit);
-    apu_init();
-    ui();
-    apu_free();
-
-    free(cpu.memory.sram);
-    free(cpu.memory.rom);
 }
@@ -0,0 +1,209 @@
+#include "movie.h"
+#include "types.h"
+
+// A movie is the input of both controllers for every frame, starting from a
+// save state taken when recording began. Both latched and auto-joypad reads
+// go through joy1l/joy2l, so setting those before each frame replays exactly
+// what the game saw. The framebuffer hash of each frame is stored alongside
+// to spot where playback goes a different way than the recording did.
+//
+// On disk: a movie_header_t, the save state, then one movie_frame_t per
+// frame.
+
+#define MOVIE_MAGIC 0x564f4d57 // "WMOV"
+#define MOVIE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rom_hash;
+    uint32_t state_size;
+    uint32_t frames_size;
+} movie_header_t;
+
+typedef struct {
+    uint16_t joy1, joy2;
+    uint32_t framebuffer_hash;
+} movie_frame_t;
+
+struct movie_t {
+    uint32_t rom_hash;
+    uint8_t *state;
+    uint32_t state_size;
+
+    movie_frame_t *frames;
+    uint32_t frames_size, frames_capacity;
+
+    bool recording;
+    uint32_t position;
+    uint32_t desync_frame;
+};
+
+static uint32_t hash_rom(snes_t *snes) {
+    return super_fast_hash((const char *)snes->cpu.memory.rom,
+                           snes->cpu.memory.rom_size);
+}
+
+static uint32_t hash_framebuffer(snes_t *snes) {
+    return super_fast_hash((const char *)snes_get_framebuffer(snes),
+                           WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+}
+
+movie_t *movie_create(snes_t *snes) {
+    movie_t *movie = calloc(1, sizeof(movie_t));
+    if (movie == NULL)
+        return NULL;
+    movie->rom_hash = hash_rom(snes);
+    movie->state_size = snes_save_state_size(snes);
+    movie->state = malloc(movie->state_size);
+    if (movie->state == NULL) {
+        free(movie);
+        return NULL;
+    }
+    snes_save_state(snes, movie->state);
+    movie->recording = true;
+    movie->desync_frame = UINT32_MAX;
+    return movie;
+}
+
+movie_t *movie_load(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Could not open movie %s", path);
+        return NULL;
+    }
+    movie_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != MOVIE_MAGIC || header.version != MOVIE_VERSION) {
+        log_message(LOG_LEVEL_WARNING, "%s is not a movie of version %d", path,
+                    MOVIE_VERSION);
+        fclose(f);
+        return NULL;
+    }
+
+    // the sizes come from the file, they have to fit in what's left of it
+    // before anything is allocated for them
+    long start = ftell(f);
+    long end = -1;
+    if (start >= 0 && fseek(f, 0, SEEK_END) == 0)
+        end = ftell(f);
+    long left = end - start;
+    if (end < start || fseek(f, start, SEEK_SET) != 0 ||
+        !snes_save_state_size_valid(header.state_size) ||
+        header.state_size > (unsigned long)left ||
+        header.frames_size >
+            (left - header.state_size) / sizeof(movie_frame_t)) {
+        log_message(LOG_LEVEL_WARNING, "Movie %s is truncated or corrupt",
+                    path);
+        fclose(f);
+        return NULL;
+    }
+
+    movie_t *movie = calloc(1, sizeof(movie_t));
+    if (movie == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Out of memory loading movie %s", path);
+        fclose(f);
+        return NULL;
+    }
+    movie->rom_hash = header.rom_hash;
+    movie->state_size = header.state_size;
+    movie->state = malloc(header.state_size);
+    movie->frames_size = movie->frames_capacity = header.frames_size;
+    movie->frames = calloc(MAX(header.frames_size, 1), sizeof(movie_frame_t));
+    movie->desync_frame = UINT32_MAX;
+    if (movie->state == NULL || movie->frames == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Out of memory loading movie %s", path);
+        fclose(f);
+        movie_destroy(movie);
+        return NULL;
+    }
+    bool complete =
+        fread(movie->state, 1, header.state_size, f) == header.state_size &&
+        fread(movie->frames, sizeof(movie_frame_t), header.frames_size, f) ==
+            header.frames_size;
+    fclose(f);
+    if (!complete) {
+        log_message(LOG_LEVEL_WARNING, "Movie %s is truncated", path);
+        movie_destroy(movie);
+        return NULL;
+    }
+    return movie;
+}
+
+bool movie_save(movie_t *movie, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Could not open %s for writing", path);
+        return false;
+    }
+    movie_header_t header = {
+        .magic = MOVIE_MAGIC,
+        .version = MOVIE_VERSION,
+        .rom_hash = movie->rom_hash,
+        .state_size = movie->state_size,
+        .frames_size = movie->frames_size,
+    };
+    bool written =
+        fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(movie->state, 1, movie->state_size, f) == movie->state_size &&
+        fwrite(movie->frames, sizeof(movie_frame_t), movie->frames_size, f) ==
+            movie->frames_size;
+    fclose(f);
+    return written;
+}
+
+void movie_destroy(movie_t *movie) {
+    if (movie == NULL)
+        return;
+    free(movie->state);
+    free(movie->frames);
+    free(movie);
+}
+
+uint32_t movie_frames(movie_t *movie) { return movie->frames_size; }
+
+bool movie_start_playback(movie_t *movie, snes_t *snes) {
+    if (movie->rom_hash != hash_rom(snes)) {
+        log_message(LOG_LEVEL_WARNING,
+                    "Movie was recorded with a different cart, hash 0x%x",
+                    movie->rom_hash);
+        return false;
+    }
+    if (!snes_load_state(snes, movie->state, movie->state_size))
+        return false;
+    movie->recording = false;
+    movie->position = 0;
+    movie->desync_frame = UINT32_MAX;
+    return true;
+}
+
+bool movie_run_frame(movie_t *movie, snes_t *snes) {
+    if (movie->recording) {
+        if (movie->frames_size == movie->frames_capacity) {
+            movie->frames_capacity = MAX(movie->frames_capacity * 2, 1024);
+            movie->frames = realloc(movie->frames, movie->frames_capacity *
+                                                       sizeof(movie_frame_t));
+        }
+        movie_frame_t *frame = &movie->frames[movie->frames_size++];
+        frame->joy1 = snes->cpu.memory.joy1l;
+        frame->joy2 = snes->cpu.memory.joy2l;
+        snes_run_frame(snes);
+        frame->framebuffer_hash = hash_framebuffer(snes);
+        return true;
+    }
+
+    if (movie->position >= movie->frames_size)
+        return false;
+    movie_frame_t *frame = &movie->frames[movie->position];
+    snes_set_input(snes, 0, frame->joy1);
+    snes_set_input(snes, 1, frame->joy2);
+    snes_run_frame(snes);
+    if (movie->desync_frame == UINT32_MAX &&
+        hash_framebuffer(snes) != frame->framebuffer_hash) {
+        movie->desync_frame = movie->position;
+    }
+    movie->position++;
+    return true;
+}
+
+uint32_t movie_desync_frame(movie_t *movie) { return movie->desync_frame; }
@@ -0,0 +1,28 @@
+#ifndef MOVIE_H_
+#define MOVIE_H_
+
+#include "snes.h"
+#include "types.h"
+
+typedef struct movie_t movie_t;
+
+// starts recording at the current state of the machine, which should be at
+// the start of a frame
+EXTERNC movie_t *movie_create(snes_t *snes);
+EXTERNC movie_t *movie_load(const char *path);
+EXTERNC bool movie_save(movie_t *movie, const char *path);
+EXTERNC void movie_destroy(movie_t *movie);
+EXTERNC uint32_t movie_frames(movie_t *movie);
+
+// checks that the movie was made with the loaded cart and puts the machine
+// into the state recording started from
+EXTERNC bool movie_start_playback(movie_t *movie, snes_t *snes);
+// runs one frame. While recording, the input the machine was given is
+// appended to the movie. While playing back, the recorded input is set and
+// the picture compared against the recording. Returns false once playback
+// is over.
+EXTERNC bool movie_run_frame(movie_t *movie, snes_t *snes);
+// first frame whose picture differed from the recording, or UINT32_MAX
+EXTERNC uint32_t movie_desync_frame(movie_t *movie);
+
+#endif
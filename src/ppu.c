@@ -1,117 +1,125 @@
 #include "ppu.h"
-#include "raylib.h"
+#include "breakpoints.h"
+#include "ppu_compose.h"
 #include "spc.h"
+#include "timing.h"
 #include "types.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-extern cpu_t cpu;
-extern ppu_t ppu;
-extern spc_t spc;
-
-uint8_t framebuffer[WINDOW_WIDTH * WINDOW_HEIGHT * 4] = {0};
-uint8_t subscreen[WINDOW_WIDTH * WINDOW_HEIGHT * 4] = {0};
-uint8_t priority[WINDOW_WIDTH * WINDOW_HEIGHT] = {0};
-uint8_t priority_sub[WINDOW_WIDTH * WINDOW_HEIGHT] = {0};
-bool use_color_math[WINDOW_WIDTH] = {0};
-
-#define GAMEPAD_UP GAMEPAD_BUTTON_LEFT_FACE_UP
-#define GAMEPAD_DOWN GAMEPAD_BUTTON_LEFT_FACE_DOWN
-#define GAMEPAD_LEFT GAMEPAD_BUTTON_LEFT_FACE_LEFT
-#define GAMEPAD_RIGHT GAMEPAD_BUTTON_LEFT_FACE_RIGHT
-
-#define GAMEPAD_A GAMEPAD_BUTTON_RIGHT_FACE_RIGHT
-#define GAMEPAD_B GAMEPAD_BUTTON_RIGHT_FACE_DOWN
-#define GAMEPAD_X GAMEPAD_BUTTON_RIGHT_FACE_UP
-#define GAMEPAD_Y GAMEPAD_BUTTON_RIGHT_FACE_LEFT
-
-#define GAMEPAD_START GAMEPAD_BUTTON_MIDDLE_RIGHT
-#define GAMEPAD_SELECT GAMEPAD_BUTTON_MIDDLE_LEFT
-
-#define GAMEPAD_R GAMEPAD_BUTTON_RIGHT_TRIGGER_1
-#define GAMEPAD_L GAMEPAD_BUTTON_LEFT_TRIGGER_1
-
-void set_pixel(uint16_t x, uint16_t y, uint32_t color) {
-    ((uint32_t *)framebuffer)[x + WINDOW_WIDTH * y] = color;
+void set_pixel(snes_t *snes, uint16_t x, uint16_t y, uint32_t color) {
+    ((uint32_t *)snes->framebuffer)[x + WINDOW_WIDTH * y] = color;
 }
 
-void try_step_cpu(void) {
-    static bool prev_vblank = false;
-    if (cpu.remaining_clocks > 0) {
-        cpu_execute();
-        for (uint32_t i = 0; i < cpu.breakpoints_size; i++) {
-            if (cpu.breakpoints[i].valid && cpu.breakpoints[i].execute &&
-                TO_U24(cpu.pc, cpu.pbr) == cpu.breakpoints[i].line) {
-                cpu.state = STATE_STOPPED;
-                break;
-            }
-        }
+void try_step_cpu(snes_t *snes) {
+    if (snes->cpu.remaining_clocks > 0) {
+        TIMING_ENTER(snes, TIMING_CPU);
+        cpu_execute(snes);
+        if (breakpoint_hit(&snes->cpu.breakpoints,
+                           TO_U24(snes->cpu.pc, snes->cpu.pbr),
+                           BREAKPOINT_EXECUTE))
+            snes->cpu.state = STATE_STOPPED;
         bool any_interrupt_happened = true;
         bool curr_vblank =
-            cpu.vblank_nmi_enable && cpu.memory.vblank_has_occurred;
-        if (curr_vblank && !prev_vblank) {
-            if (!cpu.emulation_mode)
-                push_8(cpu.pbr);
-            push_16(cpu.pc);
-            push_8(cpu.p);
-            cpu.pc = read_16(cpu.emulation_mode ? 0xfffa : 0xffea, 0);
-            cpu.pbr = 0;
-        } else if (cpu.brk) {
-            cpu.brk = false;
-            if (!cpu.emulation_mode)
-                push_8(cpu.pbr);
-            push_16(cpu.pc + 1);
-            if (cpu.emulation_mode)
-                set_status_bit(STATUS_BREAK, true);
-            push_8(cpu.p);
-            set_status_bit(STATUS_IRQOFF, true);
-            set_status_bit(STATUS_BCD, false);
-            cpu.pc = read_16(cpu.emulation_mode ? 0xfffe : 0xffe6, 0);
-            cpu.pbr = 0;
-        } else if (cpu.cop) {
-            cpu.cop = false;
-            if (!cpu.emulation_mode)
-                push_8(cpu.pbr);
-            push_16(cpu.pc + 1);
-            push_8(cpu.p);
-            set_status_bit(STATUS_IRQOFF, true);
-            set_status_bit(STATUS_BCD, false);
-            cpu.pc = read_16(cpu.emulation_mode ? 0xfff4 : 0xffe4, 0);
-            cpu.pbr = 0;
-        } else if (!get_status_bit(STATUS_IRQOFF) && cpu.irq) {
-            if (!cpu.emulation_mode)
-                push_8(cpu.pbr);
-            push_16(cpu.pc);
-            push_8(cpu.p);
-            cpu.pc = read_16(cpu.emulation_mode ? 0xfffe : 0xffee, 0);
-            cpu.pbr = 0;
-            cpu.irq = false;
+            snes->cpu.vblank_nmi_enable && snes->cpu.memory.vblank_has_occurred;
+        if (curr_vblank && !snes->cpu.prev_vblank) {
+            if (!snes->cpu.emulation_mode)
+                push_8(snes, snes->cpu.pbr);
+            push_16(snes, snes->cpu.pc);
+            push_8(snes, cpu_get_p(snes));
+            snes->cpu.pc =
+                read_16(snes, snes->cpu.emulation_mode ? 0xfffa : 0xffea, 0);
+            snes->cpu.pbr = 0;
+        } else if (snes->cpu.brk) {
+            snes->cpu.brk = false;
+            if (!snes->cpu.emulation_mode)
+                push_8(snes, snes->cpu.pbr);
+            push_16(snes, snes->cpu.pc + 1);
+            if (snes->cpu.emulation_mode)
+                set_status_bit(snes, STATUS_BREAK, true);
+            push_8(snes, cpu_get_p(snes));
+            set_status_bit(snes, STATUS_IRQOFF, true);
+            set_status_bit(snes, STATUS_BCD, false);
+            snes->cpu.pc =
+                read_16(snes, snes->cpu.emulation_mode ? 0xfffe : 0xffe6, 0);
+            snes->cpu.pbr = 0;
+        } else if (snes->cpu.cop) {
+            snes->cpu.cop = false;
+            if (!snes->cpu.emulation_mode)
+                push_8(snes, snes->cpu.pbr);
+            push_16(snes, snes->cpu.pc + 1);
+            push_8(snes, cpu_get_p(snes));
+            set_status_bit(snes, STATUS_IRQOFF, true);
+            set_status_bit(snes, STATUS_BCD, false);
+            snes->cpu.pc =
+                read_16(snes, snes->cpu.emulation_mode ? 0xfff4 : 0xffe4, 0);
+            snes->cpu.pbr = 0;
+        } else if (!get_status_bit(snes, STATUS_IRQOFF) && snes->cpu.irq) {
+            if (!snes->cpu.emulation_mode)
+                push_8(snes, snes->cpu.pbr);
+            push_16(snes, snes->cpu.pc);
+            push_8(snes, cpu_get_p(snes));
+            snes->cpu.pc =
+                read_16(snes, snes->cpu.emulation_mode ? 0xfffe : 0xffee, 0);
+            snes->cpu.pbr = 0;
+            snes->cpu.irq = false;
         } else {
             any_interrupt_happened = false;
         }
-        if (cpu.waiting && any_interrupt_happened) {
-            cpu.waiting = false;
+        if (snes->cpu.waiting && any_interrupt_happened) {
+            snes->cpu.waiting = false;
         }
-        prev_vblank = curr_vblank;
+        snes->cpu.prev_vblank = curr_vblank;
+        TIMING_LEAVE(snes);
     }
 }
 
-void try_step_spc(void) {
-    if (spc.remaining_clocks > 0) {
-        spc_execute();
-        for (uint32_t i = 0; i < spc.breakpoints_size; i++) {
-            if (spc.breakpoints[i].valid && spc.breakpoints[i].execute &&
-                spc.pc == spc.breakpoints[i].line) {
-                cpu.state = STATE_STOPPED;
-                break;
-            }
-        }
-        if (spc.brk) {
-            spc.brk = false;
-            spc_push_16(spc.pc);
-            spc_push_8(spc.p);
-            spc_set_status_bit(STATUS_BREAK, true);
-            spc_set_status_bit(STATUS_IRQOFF, false);
-            spc.pc = spc_read_16(0xffde);
-        }
+void try_step_spc(snes_t *snes) {
+    if (snes->spc.remaining_clocks > 0) {
+        TIMING_ENTER(snes, TIMING_SPC);
+        spc_execute(snes);
+        if (breakpoint_hit(&snes->spc.breakpoints, snes->spc.pc,
+                           BREAKPOINT_EXECUTE))
+            snes->cpu.state = STATE_STOPPED;
+        if (snes->spc.brk) {
+            snes->spc.brk = false;
+            spc_push_16(snes, snes->spc.pc);
+            spc_push_8(snes, spc_get_p(snes));
+            spc_set_status_bit(snes, STATUS_BREAK, true);
+            spc_set_status_bit(snes, STATUS_IRQOFF, false);
+            snes->spc.pc = spc_read_16(snes, 0xffde);
+        }
+        TIMING_LEAVE(snes);
+    }
+}
+
+// dots from the one the CPU's instruction started on to the end of the run
+static uint32_t dots_left(snes_t *snes) {
+    int64_t clocks = snes->cpu_run.op_clocks;
+    return clocks > 0 ? (clocks + CYCLES_PER_DOT - 1) / CYCLES_PER_DOT : 0;
+}
+
+// A dot runs the CPU first, then the SPC, then the PPU. So an instruction
+// sees the SPC and the beam as they were after the dot before its own.
+void catch_up_spc(snes_t *snes) {
+    if (!snes->cpu_run.active)
+        return;
+    int64_t target =
+        (int64_t)dots_left(snes) * CYCLES_PER_DOT * SPC_CLOCK_SCALE;
+    while (snes->spc.remaining_clocks > target &&
+           snes->cpu.state != STATE_STOPPED) {
+        try_step_spc(snes);
+    }
+}
+
+void catch_up_ppu(snes_t *snes) {
+    if (!snes->cpu_run.active)
+        return;
+    uint32_t owed = dots_left(snes);
+    if (snes->cpu_run.ppu_dots_owed > owed) {
+        ppu_skip_dots(snes, snes->cpu_run.ppu_dots_owed - owed);
+        snes->cpu_run.ppu_dots_owed = owed;
     }
 }
 
@@ -135,206 +143,224 @@ uint32_t r5g5b5_components_to_r8g8b8a8(uint8_t r, uint8_t g, uint8_t b) {
     return ret;
 }
 
-uint32_t brightness_adjust(uint32_t col) {
-    uint32_t ret = 0xff000000;
-    ret |= (uint32_t)((col & 0x0000ff) * (ppu.brightness / 15.f)) & 0x0000ff;
-    ret |= (uint32_t)((col & 0x00ff00) * (ppu.brightness / 15.f)) & 0x00ff00;
-    ret |= (uint32_t)((col & 0xff0000) * (ppu.brightness / 15.f)) & 0xff0000;
-    return ret;
+// every channel is a 5 bit color shifted up by 3, scaled by brightness / 15
+#define SCALE(b, c) ((c)*8 * (b) / 15)
+#define SCALE_8(b, c)                                                          \
+    SCALE(b, c), SCALE(b, c + 1), SCALE(b, c + 2), SCALE(b, c + 3),            \
+        SCALE(b, c + 4), SCALE(b, c + 5), SCALE(b, c + 6), SCALE(b, c + 7)
+#define SCALE_32(b)                                                            \
+    { SCALE_8(b, 0), SCALE_8(b, 8), SCALE_8(b, 16), SCALE_8(b, 24) }
+static const uint8_t brightness_lut[16][32] = {
+    SCALE_32(0),  SCALE_32(1),  SCALE_32(2),  SCALE_32(3),
+    SCALE_32(4),  SCALE_32(5),  SCALE_32(6),  SCALE_32(7),
+    SCALE_32(8),  SCALE_32(9),  SCALE_32(10), SCALE_32(11),
+    SCALE_32(12), SCALE_32(13), SCALE_32(14), SCALE_32(15),
+};
+#undef SCALE_32
+#undef SCALE_8
+#undef SCALE
+
+uint32_t brightness_adjust(snes_t *snes, uint32_t col) {
+    const uint8_t *lut = brightness_lut[snes->ppu.brightness];
+    return 0xff000000 | lut[(col >> 3) & 0x1f] |
+           (uint32_t)lut[(col >> 11) & 0x1f] << 8 |
+           (uint32_t)lut[(col >> 19) & 0x1f] << 16;
 }
 
-void fetch_tile_color_row(uint16_t tile_vram_offset, uint8_t y_offset,
-                          uint8_t width, uint8_t height, color_depth_t bpp,
-                          uint8_t out[width]) {
-    ASSERT(height > y_offset,
-           "Tried indexing tile of height %d out of bounds at y = %d", height,
-           y_offset);
+void ppu_update_palette(snes_t *snes, uint8_t idx) {
+    snes->palette[idx] = brightness_adjust(snes, snes->ppu.cgram[idx]);
+}
+
+void ppu_build_palette(snes_t *snes) {
+    for (uint16_t i = 0; i < ARRAYSIZE(snes->palette); i++) {
+        ppu_update_palette(snes, i);
+    }
+}
+
+// Tiles are decoded from their bitplanes to one byte per pixel the first time
+// they are drawn and kept until VRAM under them is written. VRAM holds 4096
+// 2bpp, 2048 4bpp and 1024 8bpp tiles, every depth has its own copy since the
+// same bytes can be drawn as any of them.
+static uint8_t *cached_tile(snes_t *snes, uint16_t tile_addr,
+                            color_depth_t bpp) {
+    tile_cache_t *cache = &snes->tile_cache;
+    uint16_t idx = tile_addr / (bpp * 8);
+    uint8_t *pixels;
+    bool *valid;
     switch (bpp) {
-    case BPP_2: {
-        uint16_t adj_tile_vram_offset =
-            tile_vram_offset + (y_offset % 8) * 2 + (y_offset / 8) * 256;
-        for (uint8_t i = 0; i < width / 8; i++) {
-            out[i * 8 + 0] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 7) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 7) & 1) << 1);
-            out[i * 8 + 1] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 6) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 6) & 1) << 1);
-            out[i * 8 + 2] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 5) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 5) & 1) << 1);
-            out[i * 8 + 3] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 4) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 4) & 1) << 1);
-            out[i * 8 + 4] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 3) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 3) & 1) << 1);
-            out[i * 8 + 5] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 2) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 2) & 1) << 1);
-            out[i * 8 + 6] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 1) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 1) & 1) << 1);
-            out[i * 8 + 7] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 0) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 0) & 1) << 1);
-            adj_tile_vram_offset += 16;
-        }
-    } break;
-    case BPP_4: {
-        uint16_t adj_tile_vram_offset =
-            tile_vram_offset + (y_offset % 8) * 2 + (y_offset / 8) * 512;
-        for (uint8_t i = 0; i < width / 8; i++) {
-            out[i * 8 + 0] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 7) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 7) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 7) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 7) & 1) << 3);
-            out[i * 8 + 1] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 6) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 6) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 6) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 6) & 1) << 3);
-            out[i * 8 + 2] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 5) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 5) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 5) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 5) & 1) << 3);
-            out[i * 8 + 3] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 4) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 4) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 4) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 4) & 1) << 3);
-            out[i * 8 + 4] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 3) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 3) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 3) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 3) & 1) << 3);
-            out[i * 8 + 5] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 2) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 2) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 2) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 2) & 1) << 3);
-            out[i * 8 + 6] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 1) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 1) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 1) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 1) & 1) << 3);
-            out[i * 8 + 7] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 0) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 0) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 0) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 0) & 1) << 3);
-            adj_tile_vram_offset += 32;
-        }
-    } break;
-    case BPP_8: {
-        uint16_t adj_tile_vram_offset =
-            tile_vram_offset + (y_offset % 8) * 2 + (y_offset / 8) * 1024;
-        for (uint8_t i = 0; i < width / 8; i++) {
-            out[i * 8 + 0] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 7) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 7) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 7) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 7) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 7) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 7) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 7) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 7) & 1) << 7);
-            out[i * 8 + 1] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 6) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 6) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 6) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 6) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 6) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 6) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 6) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 6) & 1) << 7);
-            out[i * 8 + 2] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 5) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 5) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 5) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 5) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 5) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 5) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 5) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 5) & 1) << 7);
-            out[i * 8 + 3] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 4) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 4) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 4) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 4) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 4) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 4) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 4) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 4) & 1) << 7);
-            out[i * 8 + 4] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 3) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 3) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 3) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 3) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 3) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 3) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 3) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 3) & 1) << 7);
-            out[i * 8 + 5] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 2) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 2) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 2) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 2) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 2) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 2) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 2) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 2) & 1) << 7);
-            out[i * 8 + 6] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 1) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 1) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 1) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 1) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 1) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 1) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 1) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 1) & 1) << 7);
-            out[i * 8 + 7] =
-                (((ppu.vram[adj_tile_vram_offset + 0] >> 0) & 1) << 0) |
-                (((ppu.vram[adj_tile_vram_offset + 1] >> 0) & 1) << 1) |
-                (((ppu.vram[adj_tile_vram_offset + 16] >> 0) & 1) << 2) |
-                (((ppu.vram[adj_tile_vram_offset + 17] >> 0) & 1) << 3) |
-                (((ppu.vram[adj_tile_vram_offset + 32] >> 0) & 1) << 4) |
-                (((ppu.vram[adj_tile_vram_offset + 33] >> 0) & 1) << 5) |
-                (((ppu.vram[adj_tile_vram_offset + 48] >> 0) & 1) << 6) |
-                (((ppu.vram[adj_tile_vram_offset + 49] >> 0) & 1) << 7);
-            adj_tile_vram_offset += 64;
-        }
-    } break;
+    case BPP_2:
+        pixels = cache->pixels_2bpp[idx];
+        valid = &cache->valid_2bpp[idx];
+        break;
+    case BPP_4:
+        pixels = cache->pixels_4bpp[idx];
+        valid = &cache->valid_4bpp[idx];
+        break;
+    case BPP_8:
+        pixels = cache->pixels_8bpp[idx];
+        valid = &cache->valid_8bpp[idx];
+        break;
     default:
         UNREACHABLE_SWITCH(bpp);
     }
+    if (*valid)
+        return pixels;
+
+    // pairs of bitplanes are interleaved by row, 16 bytes to a pair
+    for (uint8_t row = 0; row < 8; row++) {
+        for (uint8_t x = 0; x < 8; x++) {
+            uint8_t pixel = 0;
+            for (uint8_t plane = 0; plane < bpp; plane++) {
+                uint8_t byte =
+                    snes->ppu.vram[(uint16_t)(tile_addr + (plane / 2) * 16 +
+                                              row * 2 + plane % 2)];
+                pixel |= ((byte >> (7 - x)) & 1) << plane;
+            }
+            pixels[row * 8 + x] = pixel;
+        }
+    }
+    *valid = true;
+    return pixels;
+}
+
+void ppu_invalidate_tiles(snes_t *snes, uint16_t vram_addr) {
+    snes->tile_cache.valid_2bpp[vram_addr / 16] = false;
+    snes->tile_cache.valid_4bpp[vram_addr / 32] = false;
+    snes->tile_cache.valid_8bpp[vram_addr / 64] = false;
+}
+
+void ppu_invalidate_changed_tiles(snes_t *snes, const uint8_t *vram) {
+    // 16 bytes are the smallest tile, a 2bpp one
+    for (uint32_t addr = 0; addr < sizeof(snes->ppu.vram); addr += 16) {
+        if (memcmp(snes->ppu.vram + addr, vram + addr, 16) != 0)
+            ppu_invalidate_tiles(snes, addr);
+    }
+}
+
+void ppu_invalidate_all_tiles(snes_t *snes) {
+    memset(snes->tile_cache.valid_2bpp, 0, sizeof(snes->tile_cache.valid_2bpp));
+    memset(snes->tile_cache.valid_4bpp, 0, sizeof(snes->tile_cache.valid_4bpp));
+    memset(snes->tile_cache.valid_8bpp, 0, sizeof(snes->tile_cache.valid_8bpp));
+}
+
+void fetch_tile_color_row(snes_t *snes, uint16_t tile_vram_offset,
+                          uint8_t y_offset, uint8_t width, uint8_t height,
+                          color_depth_t bpp, uint8_t out[width]) {
+    ASSERT(height > y_offset,
+           "Tried indexing tile of height %d out of bounds at y = %d", height,
+           y_offset);
+    uint16_t tile_size = bpp * 8;
+    ASSERT(tile_vram_offset % tile_size == 0,
+           "Tile at 0x%04x is not aligned to its size", tile_vram_offset);
+    // large tiles are made of 8x8 ones, 16 of them to a row in VRAM
+    uint16_t tile_addr = tile_vram_offset + (y_offset / 8) * 16 * tile_size;
+    for (uint8_t i = 0; i < width / 8; i++) {
+        memcpy(out + i * 8,
+               cached_tile(snes, tile_addr, bpp) + (y_offset % 8) * 8, 8);
+        tile_addr += tile_size;
+    }
 }
 
-void draw_bg(uint8_t bg_idx, uint16_t y, color_depth_t bpp, uint8_t low_prio,
-             uint8_t high_prio) {
-    if (!ppu.bg_config[bg_idx].main_screen_enable &&
-        !ppu.bg_config[bg_idx].sub_screen_enable)
+// sets the bits of [l, r), the range IN_INTERVAL tests
+static void interval_mask(uint64_t mask[WINDOW_WIDTH / 64], uint8_t l,
+                          uint8_t r) {
+    for (uint16_t i = 0; i < WINDOW_WIDTH / 64; i++) {
+        uint16_t lo = MAX(l, i * 64), hi = MIN(r, i * 64 + 64);
+        if (lo >= hi) {
+            mask[i] = 0;
+            continue;
+        }
+        uint64_t upto_hi =
+            hi - i * 64 == 64 ? ~0ull : (1ull << (hi - i * 64)) - 1;
+        mask[i] = upto_hi & ~((1ull << (lo - i * 64)) - 1);
+    }
+}
+
+static void build_window_mask(snes_t *snes, uint64_t mask[WINDOW_WIDTH / 64],
+                              bool window_1_enable, bool window_1_invert,
+                              bool window_2_enable, bool window_2_invert,
+                              uint8_t mask_logic) {
+    uint64_t window_1[WINDOW_WIDTH / 64], window_2[WINDOW_WIDTH / 64];
+    interval_mask(window_1, snes->ppu.window_1_l, snes->ppu.window_1_r);
+    interval_mask(window_2, snes->ppu.window_2_l, snes->ppu.window_2_r);
+    for (uint16_t i = 0; i < WINDOW_WIDTH / 64; i++) {
+        if (window_1_invert)
+            window_1[i] = ~window_1[i];
+        if (window_2_invert)
+            window_2[i] = ~window_2[i];
+        if (!window_1_enable && !window_2_enable) {
+            mask[i] = 0;
+        } else if (!window_2_enable) {
+            mask[i] = window_1[i];
+        } else if (!window_1_enable) {
+            mask[i] = window_2[i];
+        } else
+            switch (mask_logic) {
+            case 0:
+                mask[i] = window_1[i] | window_2[i];
+                break;
+            case 1:
+                mask[i] = window_1[i] & window_2[i];
+                break;
+            case 2:
+                mask[i] = window_1[i] ^ window_2[i];
+                break;
+            case 3:
+                mask[i] = ~(window_1[i] ^ window_2[i]);
+                break;
+            default:
+                UNREACHABLE_SWITCH(mask_logic);
+            }
+    }
+}
+
+static void build_window_masks(snes_t *snes) {
+    window_masks_t *windows = &snes->window_masks;
+    for (uint8_t i = 0; i < 4; i++) {
+        build_window_mask(snes, windows->masks[LAYER_BG1 + i],
+                          snes->ppu.bg_config[i].window_1_enable,
+                          snes->ppu.bg_config[i].window_1_invert,
+                          snes->ppu.bg_config[i].window_2_enable,
+                          snes->ppu.bg_config[i].window_2_invert,
+                          snes->ppu.bg_config[i].mask_logic);
+    }
+    build_window_mask(
+        snes, windows->masks[LAYER_OBJ], snes->ppu.obj_window_1_enable,
+        snes->ppu.obj_window_1_invert, snes->ppu.obj_window_2_enable,
+        snes->ppu.obj_window_2_invert, snes->ppu.obj_window_mask_logic);
+    build_window_mask(
+        snes, windows->masks[LAYER_COL], snes->ppu.col_window_1_enable,
+        snes->ppu.col_window_1_invert, snes->ppu.col_window_2_enable,
+        snes->ppu.col_window_2_invert, snes->ppu.col_window_mask_logic);
+    windows->dirty = false;
+}
+
+void ppu_invalidate_windows(snes_t *snes) { snes->window_masks.dirty = true; }
+
+static bool window_blocked(snes_t *snes, uint8_t layer, uint8_t x) {
+    return (snes->window_masks.masks[layer][x / 64] >> (x % 64)) & 1;
+}
+
+void draw_bg(snes_t *snes, uint8_t bg_idx, uint16_t y, color_depth_t bpp,
+             uint8_t low_prio, uint8_t high_prio) {
+    if (!snes->ppu.bg_config[bg_idx].main_screen_enable &&
+        !snes->ppu.bg_config[bg_idx].sub_screen_enable)
         return;
-    if (ppu.enable_bg_override[bg_idx])
+    if (snes->ppu.enable_bg_override[bg_idx])
         return;
-    uint16_t screen_y = y;
-    if (ppu.bg_config[bg_idx].enable_mosaic) {
-        y -= y % (ppu.mosaic_size + 1);
+    if (snes->ppu.bg_config[bg_idx].enable_mosaic) {
+        y -= y % (snes->ppu.mosaic_size + 1);
     }
-    uint32_t *target =
-        (uint32_t *)(framebuffer + (WINDOW_WIDTH * 4 * screen_y));
-    uint32_t *target_sub =
-        (uint32_t *)(subscreen + (WINDOW_WIDTH * 4 * screen_y));
-    uint8_t tilemap_w = ppu.bg_config[bg_idx].double_h_tilemap ? 64 : 32;
-    uint8_t tilemap_h = ppu.bg_config[bg_idx].double_v_tilemap ? 64 : 32;
-    uint16_t tilemap_line_pointer = ppu.bg_config[bg_idx].tilemap_addr;
-    uint8_t tile_size = ppu.bg_config[bg_idx].large_characters ? 16 : 8;
+    layer_line_t *line = &snes->layer_lines[LAYER_BG1 + bg_idx];
+    uint8_t tilemap_w = snes->ppu.bg_config[bg_idx].double_h_tilemap ? 64 : 32;
+    uint8_t tilemap_h = snes->ppu.bg_config[bg_idx].double_v_tilemap ? 64 : 32;
+    uint16_t tilemap_line_pointer = snes->ppu.bg_config[bg_idx].tilemap_addr;
+    uint8_t tile_size = snes->ppu.bg_config[bg_idx].large_characters ? 16 : 8;
     uint16_t window_height = tilemap_h * tile_size;
     uint16_t window_width = tilemap_w * tile_size;
     uint8_t tile_index_v =
-        (((y + ppu.bg_config[bg_idx].v_scroll) % window_height) / tile_size);
+        (((y + snes->ppu.bg_config[bg_idx].v_scroll) % window_height) /
+         tile_size);
     if (tile_index_v > 31 && tilemap_w == 64 && tilemap_h == 64) {
         tilemap_line_pointer += 0x1000;
     }
@@ -349,20 +375,24 @@ void draw_bg(uint8_t bg_idx, uint16_t y, color_depth_t bpp, uint8_t low_prio,
     uint16_t tilemap_fetch[64] = {0};
     for (uint8_t i = 0; i < 64; i++) {
         tilemap_fetch[i] = TO_U16(
-            ppu.vram[tilemap_line_pointer + (tilemap_line_index % 32) * 2 +
-                     (tilemap_line_index / 32) * 0x800],
-            ppu.vram[tilemap_line_pointer + (tilemap_line_index % 32) * 2 +
-                     (tilemap_line_index / 32) * 0x800 + 1]);
+            snes->ppu
+                .vram[tilemap_line_pointer + (tilemap_line_index % 32) * 2 +
+                      (tilemap_line_index / 32) * 0x800],
+            snes->ppu
+                .vram[tilemap_line_pointer + (tilemap_line_index % 32) * 2 +
+                      (tilemap_line_index / 32) * 0x800 + 1]);
         tilemap_line_index++;
         tilemap_line_index %= tilemap_w;
     }
 
     uint8_t out[1024] = {0};
     for (uint8_t tile_idx = 0; tile_idx < tilemap_w; tile_idx++) {
-        uint8_t tile_y_off = (y + ppu.bg_config[bg_idx].v_scroll) % tile_size;
+        uint8_t tile_y_off =
+            (y + snes->ppu.bg_config[bg_idx].v_scroll) % tile_size;
         if (tilemap_fetch[tile_idx] >> 15)
             tile_y_off = tile_size - 1 - tile_y_off;
-        fetch_tile_color_row(ppu.bg_config[bg_idx].tiledata_addr +
+        fetch_tile_color_row(snes,
+                             snes->ppu.bg_config[bg_idx].tiledata_addr +
                                  (tilemap_fetch[tile_idx] & 0x3ff) *
                                      ((bpp * tile_size * tile_size) / 8),
                              tile_y_off, tile_size, tile_size, bpp,
@@ -371,216 +401,142 @@ void draw_bg(uint8_t bg_idx, uint16_t y, color_depth_t bpp, uint8_t low_prio,
 
     for (uint16_t screen_x = 0; screen_x < WINDOW_WIDTH; screen_x++) {
         uint16_t x = screen_x;
-        if (ppu.bg_config[bg_idx].enable_mosaic) {
-            x -= x % (ppu.mosaic_size + 1);
+        if (snes->ppu.bg_config[bg_idx].enable_mosaic) {
+            x -= x % (snes->ppu.mosaic_size + 1);
         }
         uint8_t tilemap_idx =
-            (((x + ppu.bg_config[bg_idx].h_scroll) % window_width) /
+            (((x + snes->ppu.bg_config[bg_idx].h_scroll) % window_width) /
              tile_size) %
             64;
         bool prio = tilemap_fetch[tilemap_idx] & 0x2000;
 
-        bool window_1 = false;
-        if (ppu.bg_config[bg_idx].window_1_enable) {
-            window_1 = IN_INTERVAL(screen_x, ppu.window_1_l, ppu.window_1_r) ^
-                       ppu.bg_config[bg_idx].window_1_invert;
-        }
-        bool window_2 = false;
-        if (ppu.bg_config[bg_idx].window_2_enable) {
-            window_2 = IN_INTERVAL(screen_x, ppu.window_2_l, ppu.window_2_r) ^
-                       ppu.bg_config[bg_idx].window_2_invert;
-        }
-
-        bool blocked;
-        if (!ppu.bg_config[bg_idx].window_1_enable &&
-            !ppu.bg_config[bg_idx].window_2_enable) {
-            blocked = false;
-        } else if (ppu.bg_config[bg_idx].window_1_enable &&
-                   !ppu.bg_config[bg_idx].window_2_enable) {
-            blocked = window_1;
-        } else if (!ppu.bg_config[bg_idx].window_1_enable &&
-                   ppu.bg_config[bg_idx].window_2_enable) {
-            blocked = window_2;
-        } else
-            switch (ppu.bg_config[bg_idx].mask_logic) {
-            case 0:
-                blocked = window_1 || window_2;
-                break;
-            case 1:
-                blocked = window_1 && window_2;
-                break;
-            case 2:
-                blocked = window_1 ^ window_2;
-                break;
-            case 3:
-                blocked = window_1 == window_2;
-                break;
-            default:
-                UNREACHABLE_SWITCH(ppu.bg_config[bg_idx].mask_logic);
-            }
-        uint8_t tile_x_off = (x + ppu.bg_config[bg_idx].h_scroll) % tile_size;
+        uint8_t tile_x_off =
+            (x + snes->ppu.bg_config[bg_idx].h_scroll) % tile_size;
         if ((tilemap_fetch[tilemap_idx] >> 14) & 1)
             tile_x_off = tile_size - 1 - tile_x_off;
         uint8_t palette = (tilemap_fetch[tilemap_idx] >> 10) & 0b111;
+        uint8_t pixel = out[tilemap_idx * tile_size + tile_x_off];
 
-        if (ppu.bg_config[bg_idx].main_screen_enable &&
-            priority[screen_y * WINDOW_WIDTH + screen_x] <
-                (prio ? high_prio : low_prio)) {
-            if (blocked && ppu.bg_config[bg_idx].main_window_enable) {
-                continue;
-            }
-
-            if (out[tilemap_idx * tile_size + tile_x_off] != 0) {
-                target[screen_x] = brightness_adjust(
-                    ppu.cgram[palette * bpp * bpp +
-                              out[tilemap_idx * tile_size + tile_x_off]]);
-                priority[screen_y * WINDOW_WIDTH + screen_x] =
-                    prio ? high_prio : low_prio;
-                use_color_math[screen_x] =
-                    ppu.bg_config[bg_idx].color_math_enable;
-            }
-        }
-
-        if (ppu.bg_config[bg_idx].sub_screen_enable &&
-            priority_sub[screen_y * WINDOW_WIDTH + screen_x] <
-                (prio ? high_prio : low_prio)) {
-            if (blocked && ppu.bg_config[bg_idx].sub_window_enable) {
-                // target_sub[screen_x] = 0xff000000;
-                // priority_sub[screen_y * WINDOW_WIDTH + screen_x] =
-                //     prio ? high_prio : low_prio;
-                continue;
-            }
+        // 8bpp tiles use all of cgram, their palette bits don't count
+        line->color[screen_x] =
+            bpp == BPP_8 ? pixel : palette * bpp * bpp + pixel;
+        line->priority[screen_x] =
+            pixel == 0 ? 0 : (prio ? high_prio : low_prio);
+    }
+}
 
-            if (out[tilemap_idx * tile_size + tile_x_off] != 0) {
-                target_sub[screen_x] = brightness_adjust(
-                    ppu.cgram[palette * bpp * bpp +
-                              out[tilemap_idx * tile_size + tile_x_off]]);
-                priority_sub[screen_y * WINDOW_WIDTH + screen_x] =
-                    prio ? high_prio : low_prio;
-            }
-        }
+// map coordinates of the pixels on a mode 7 line, in 8.8 fixed point from x
+// and y on, each pixel step_x and step_y on from the one before. Wrapped around
+// the 1024x1024 map if it repeats, left outside of it otherwise
+static void mode_7_line(uint32_t x, uint32_t y, uint32_t step_x,
+                        uint32_t step_y, bool repeat,
+                        int32_t map_x[WINDOW_WIDTH],
+                        int32_t map_y[WINDOW_WIDTH]) {
+    int32_t wrap = repeat ? 1023 : -1;
+#ifdef __SSE2__
+    __m128i xs = _mm_add_epi32(
+        _mm_set1_epi32(x), _mm_set_epi32(3 * step_x, 2 * step_x, step_x, 0));
+    __m128i ys = _mm_add_epi32(
+        _mm_set1_epi32(y), _mm_set_epi32(3 * step_y, 2 * step_y, step_y, 0));
+    const __m128i steps_x = _mm_set1_epi32(4 * step_x);
+    const __m128i steps_y = _mm_set1_epi32(4 * step_y);
+    const __m128i wraps = _mm_set1_epi32(wrap);
+    for (uint16_t i = 0; i < WINDOW_WIDTH; i += 4) {
+        _mm_storeu_si128((__m128i *)(map_x + i),
+                         _mm_and_si128(_mm_srai_epi32(xs, 8), wraps));
+        _mm_storeu_si128((__m128i *)(map_y + i),
+                         _mm_and_si128(_mm_srai_epi32(ys, 8), wraps));
+        xs = _mm_add_epi32(xs, steps_x);
+        ys = _mm_add_epi32(ys, steps_y);
     }
+#else
+    for (uint16_t i = 0; i < WINDOW_WIDTH; i++) {
+        map_x[i] = ((int32_t)x >> 8) & wrap;
+        map_y[i] = ((int32_t)y >> 8) & wrap;
+        x += step_x;
+        y += step_y;
+    }
+#endif
 }
 
-void draw_bg_1_mode_7(int16_t y) {
-    if (!ppu.bg_config[0].main_screen_enable &&
-        !ppu.bg_config[0].sub_screen_enable)
+void draw_bg_1_mode_7(snes_t *snes, int16_t screen_y) {
+    if (!snes->ppu.bg_config[0].main_screen_enable &&
+        !snes->ppu.bg_config[0].sub_screen_enable)
         return;
-    if (ppu.enable_bg_override[0])
+    if (snes->ppu.enable_bg_override[0])
         return;
-    int16_t screen_y = y;
-    uint32_t *target =
-        (uint32_t *)(framebuffer + (WINDOW_WIDTH * 4 * screen_y));
-    uint32_t *target_sub =
-        (uint32_t *)(subscreen + (WINDOW_WIDTH * 4 * screen_y));
-    for (int16_t screen_x = 0; screen_x < WINDOW_WIDTH; screen_x++) {
-        int16_t x = ppu.mode_7_center_x;
-        y = ppu.mode_7_center_y;
-        x += (screen_x + ppu.bg_config[0].h_scroll - ppu.mode_7_center_x) *
-                 ppu.a_7 +
-             (screen_y + ppu.bg_config[0].v_scroll - ppu.mode_7_center_y) *
-                 ppu.b_7;
-        y += (screen_x + ppu.bg_config[0].h_scroll - ppu.mode_7_center_x) *
-                 ppu.c_7 +
-             (screen_y + ppu.bg_config[0].v_scroll - ppu.mode_7_center_y) *
-                 ppu.d_7;
-        if (x < 0 || y < 0 || x >= 1024 || y >= 1024) {
-            if (ppu.mode_7_tilemap_repeat) {
-                while(x < 0) x += 1024;
-                while(y < 0) y += 1024;
-                x %= 1024;
-                y %= 1024;
-            } else {
-                if (ppu.mode_7_non_tilemap_fill) {
-                    x = 0;
-                    y = 0;
-                } else {
-                    continue;
-                }
-            }
-        }
-        if (ppu.bg_config[0].enable_mosaic) {
-            y -= y % (ppu.mosaic_size + 1);
-        }
-        if (ppu.bg_config[0].enable_mosaic) {
-            x -= x % (ppu.mosaic_size + 1);
-        }
+    layer_line_t *line = &snes->layer_lines[LAYER_BG1];
+    int16_t center_x = snes->ppu.mode_7_center_x;
+    int16_t center_y = snes->ppu.mode_7_center_y;
+    int32_t offset_x = snes->ppu.bg_config[0].h_scroll - center_x;
+    int32_t offset_y = screen_y + snes->ppu.bg_config[0].v_scroll - center_y;
+    // in unsigned math, which wraps instead of overflowing
+    uint32_t start_x = (uint32_t)center_x * 256 +
+                       (uint32_t)snes->ppu.a_7 * offset_x +
+                       (uint32_t)snes->ppu.b_7 * offset_y;
+    uint32_t start_y = (uint32_t)center_y * 256 +
+                       (uint32_t)snes->ppu.c_7 * offset_x +
+                       (uint32_t)snes->ppu.d_7 * offset_y;
+    int32_t map_x[WINDOW_WIDTH], map_y[WINDOW_WIDTH];
+    mode_7_line(start_x, start_y, snes->ppu.a_7, snes->ppu.c_7,
+                snes->ppu.mode_7_tilemap_repeat, map_x, map_y);
 
-        bool window_1 = false;
-        if (ppu.bg_config[0].window_1_enable) {
-            window_1 = IN_INTERVAL(screen_x, ppu.window_1_l, ppu.window_1_r) ^
-                       ppu.bg_config[0].window_1_invert;
+    for (uint16_t screen_x = 0; screen_x < WINDOW_WIDTH; screen_x++) {
+        // the windows hide mode 7 on both screens whatever TMW and TSW say
+        if (window_blocked(snes, LAYER_BG1, screen_x))
+            continue;
+        int32_t x = map_x[screen_x];
+        int32_t y = map_y[screen_x];
+        if ((x | y) & ~1023) {
+            if (!snes->ppu.mode_7_non_tilemap_fill)
+                continue;
+            x = 0;
+            y = 0;
         }
-        bool window_2 = false;
-        if (ppu.bg_config[0].window_2_enable) {
-            window_2 = IN_INTERVAL(screen_x, ppu.window_2_l, ppu.window_2_r) ^
-                       ppu.bg_config[0].window_2_invert;
+        if (snes->ppu.bg_config[0].enable_mosaic) {
+            y -= y % (snes->ppu.mosaic_size + 1);
+            x -= x % (snes->ppu.mosaic_size + 1);
         }
 
-        bool blocked;
-        if (!ppu.bg_config[0].window_1_enable &&
-            !ppu.bg_config[0].window_2_enable) {
-            blocked = false;
-        } else if (ppu.bg_config[0].window_1_enable &&
-                   !ppu.bg_config[0].window_2_enable) {
-            blocked = window_1;
-        } else if (!ppu.bg_config[0].window_1_enable &&
-                   ppu.bg_config[0].window_2_enable) {
-            blocked = window_2;
-        } else
-            switch (ppu.bg_config[0].mask_logic) {
-            case 0:
-                blocked = window_1 || window_2;
-                break;
-            case 1:
-                blocked = window_1 && window_2;
-                break;
-            case 2:
-                blocked = window_1 ^ window_2;
-                break;
-            case 3:
-                blocked = window_1 == window_2;
-                break;
-            default:
-                UNREACHABLE_SWITCH(ppu.bg_config[0].mask_logic);
-            }
-
         uint16_t tile_number = (y / 8) * 128 + (x / 8);
-        uint16_t tile_idx = ppu.vram[tile_number * 2];
-        uint8_t palette_idx =
-            ppu.vram[tile_idx * 128 + (2 * (x % 8)) + (2 * (y % 8) * 8) + 1];
-        if (ppu.bg_config[0].main_screen_enable && !blocked)
-            target[screen_x] = brightness_adjust(ppu.cgram[palette_idx]);
-        if (ppu.bg_config[0].sub_screen_enable && !blocked)
-            target_sub[screen_x] = brightness_adjust(ppu.cgram[palette_idx]);
+        uint16_t tile_idx = snes->ppu.vram[tile_number * 2];
+        // above the backdrop and below every sprite
+        line->color[screen_x] =
+            snes->ppu
+                .vram[tile_idx * 128 + (2 * (x % 8)) + (2 * (y % 8) * 8) + 1];
+        line->priority[screen_x] = 1;
     }
 }
 
-void draw_obj(uint16_t y) {
-    static uint8_t size_lut[8][4] = {
-        {8, 8, 16, 16},   {8, 8, 32, 32},   {8, 8, 64, 64},   {16, 16, 32, 32},
-        {16, 16, 64, 64}, {32, 32, 64, 64}, {16, 32, 32, 64}, {16, 32, 32, 32}};
+static const uint8_t size_lut[8][4] = {
+    {8, 8, 16, 16},   {8, 8, 32, 32},   {8, 8, 64, 64},   {16, 16, 32, 32},
+    {16, 16, 64, 64}, {32, 32, 64, 64}, {16, 32, 32, 64}, {16, 32, 32, 32}};
+
+// picks the sprites on line y and latches the overflow flags, which the CPU
+// can read back even when nothing is drawn
+void evaluate_obj(snes_t *snes, uint16_t y) {
     uint8_t draw_count = 0;
     uint8_t sliver_count = 0;
-    if (ppu.enable_obj_override)
+    if (snes->ppu.enable_obj_override)
         return;
 
     // step 1: collecting (lower index, higher priority)
     for (uint8_t i = 0; i < 128; i++) {
-        int16_t sp_x = ppu.oam[i].x;
-        int16_t sp_y = ppu.oam[i].y;
-        uint8_t sp_w =
-            size_lut[ppu.obj_sprite_size][ppu.oam[i].use_second_size * 2];
-        uint8_t sp_h =
-            size_lut[ppu.obj_sprite_size][ppu.oam[i].use_second_size * 2 + 1];
-        ppu.oam[i].draw_this_line = IN_INTERVAL(y, sp_y, sp_y + sp_h) &&
-                                    IN_INTERVAL(sp_x, 0, WINDOW_WIDTH - sp_w);
-        if (ppu.oam[i].draw_this_line) {
+        int16_t sp_x = snes->ppu.oam[i].x;
+        int16_t sp_y = snes->ppu.oam[i].y;
+        uint8_t sp_w = size_lut[snes->ppu.obj_sprite_size]
+                               [snes->ppu.oam[i].use_second_size * 2];
+        uint8_t sp_h = size_lut[snes->ppu.obj_sprite_size]
+                               [snes->ppu.oam[i].use_second_size * 2 + 1];
+        snes->ppu.oam[i].draw_this_line =
+            IN_INTERVAL(y, sp_y, sp_y + sp_h) &&
+            IN_INTERVAL(sp_x, 0, WINDOW_WIDTH - sp_w);
+        if (snes->ppu.oam[i].draw_this_line) {
             draw_count++;
             sliver_count += sp_w / 8;
         }
         if (draw_count > 32 || sliver_count > 34)
-            ppu.oam[i].draw_this_line = false;
+            snes->ppu.oam[i].draw_this_line = false;
     }
     // This really doesn't make much sense.
     // The (scarce) documentation around these two flags from STAT77
@@ -590,581 +546,317 @@ void draw_obj(uint16_t y) {
     // Also, the latter is meant to be GREATER THAN 34 but actually seems
     // to function only with GREATER THAN 32, also in accordance with
     // SNES9X and the Aging ROM.
-    ppu.oam_sprite_tile_overflow |= draw_count >= 32;
-    ppu.oam_sprite_overflow |= sliver_count > 32;
+    snes->ppu.oam_sprite_tile_overflow |= draw_count >= 32;
+    snes->ppu.oam_sprite_overflow |= sliver_count > 32;
+}
 
-    uint16_t name_base = ppu.obj_name_base_address << 14;
-    uint16_t name_alt = name_base + ((ppu.obj_name_select + 1) << 13);
+void draw_obj(snes_t *snes, uint16_t y) {
+    if (snes->ppu.enable_obj_override)
+        return;
+    evaluate_obj(snes, y);
 
-    // step 2: drawing (lower index, higher priority)
-    uint32_t *target = (uint32_t *)(framebuffer + (WINDOW_WIDTH * 4 * y));
-    uint32_t *target_sub = (uint32_t *)(subscreen + (WINDOW_WIDTH * 4 * y));
+    uint16_t name_base = snes->ppu.obj_name_base_address << 14;
+    uint16_t name_alt = name_base + ((snes->ppu.obj_name_select + 1) << 13);
 
+    // step 2: drawing (lower index, higher priority)
+    layer_line_t *line = &snes->layer_lines[LAYER_OBJ];
     for (uint8_t i = 0; i < 128; i++) {
-        if (ppu.oam[i].draw_this_line) {
-            int16_t sp_x = ppu.oam[i].x;
-            uint8_t sp_w =
-                size_lut[ppu.obj_sprite_size][ppu.oam[i].use_second_size * 2];
-            uint8_t sp_h = size_lut[ppu.obj_sprite_size]
-                                   [ppu.oam[i].use_second_size * 2 + 1];
-            uint8_t y_off = y - ppu.oam[i].y;
-            if (ppu.oam[i].flip_v)
+        if (snes->ppu.oam[i].draw_this_line) {
+            int16_t sp_x = snes->ppu.oam[i].x;
+            uint8_t sp_w = size_lut[snes->ppu.obj_sprite_size]
+                                   [snes->ppu.oam[i].use_second_size * 2];
+            uint8_t sp_h = size_lut[snes->ppu.obj_sprite_size]
+                                   [snes->ppu.oam[i].use_second_size * 2 + 1];
+            uint8_t y_off = y - snes->ppu.oam[i].y;
+            if (snes->ppu.oam[i].flip_v)
                 y_off = (sp_h - 1) - y_off;
 
             uint8_t tiles[64] = {0};
-            fetch_tile_color_row(
-                (ppu.oam[i].use_second_sprite_page ? name_alt : name_base) +
-                    ppu.oam[i].tile_idx * 32,
-                y_off, sp_w, sp_h, BPP_4, tiles);
-
-            uint8_t prio = ppu.oam[i].priority * 3 + 2;
+            fetch_tile_color_row(snes,
+                                 (snes->ppu.oam[i].use_second_sprite_page
+                                      ? name_alt
+                                      : name_base) +
+                                     snes->ppu.oam[i].tile_idx * 32,
+                                 y_off, sp_w, sp_h, BPP_4, tiles);
+
+            uint8_t prio = snes->ppu.oam[i].priority * 3 + 2;
             for (int16_t x_off = 0; x_off < sp_w; x_off++) {
                 int16_t x =
-                    sp_x + (ppu.oam[i].flip_h ? (sp_w - (x_off + 1)) : x_off);
-
-                bool window_1 = false;
-                if (ppu.obj_window_1_enable) {
-                    window_1 = IN_INTERVAL(x, ppu.window_1_l, ppu.window_1_r) ^
-                               ppu.obj_window_1_invert;
-                }
-                bool window_2 = false;
-                if (ppu.obj_window_2_enable) {
-                    window_2 = IN_INTERVAL(x, ppu.window_2_l, ppu.window_2_r) ^
-                               ppu.obj_window_2_invert;
-                }
-
-                bool blocked;
-                if (!ppu.obj_window_1_enable && !ppu.obj_window_2_enable) {
-                    blocked = false;
-                } else if (ppu.obj_window_1_enable &&
-                           !ppu.obj_window_2_enable) {
-                    blocked = window_1;
-                } else if (!ppu.obj_window_1_enable &&
-                           ppu.obj_window_2_enable) {
-                    blocked = window_2;
-                } else
-                    switch (ppu.obj_window_mask_logic) {
-                    case 0:
-                        blocked = window_1 || window_2;
-                        break;
-                    case 1:
-                        blocked = window_1 && window_2;
-                        break;
-                    case 2:
-                        blocked = window_1 ^ window_2;
-                        break;
-                    case 3:
-                        blocked = window_1 == window_2;
-                        break;
-                    default:
-                        UNREACHABLE_SWITCH(ppu.obj_window_mask_logic);
-                    }
+                    sp_x +
+                    (snes->ppu.oam[i].flip_h ? (sp_w - (x_off + 1)) : x_off);
 
-                if (ppu.obj_main_screen_enable &&
-                    priority[y * WINDOW_WIDTH + x] < prio) {
-                    if (x < 0 || x > 255)
-                        continue;
-                    if (blocked && ppu.obj_main_window_enable) {
-                        continue;
-                    }
-
-                    if (tiles[x_off] != 0) {
-                        uint32_t col = brightness_adjust(
-                            ppu.cgram[128 + ppu.oam[i].palette * 16 +
-                                      tiles[x_off]]);
-                        target[x] = col;
-                        priority[y * WINDOW_WIDTH + x] = prio;
-                        use_color_math[x] =
-                            ppu.obj_color_math_enable && ppu.oam[i].palette > 3;
-                    }
-                }
-
-                if (ppu.obj_sub_screen_enable &&
-                    priority_sub[y * WINDOW_WIDTH + x] < prio) {
-                    if (x < 0 || x > 255) {
-                        continue;
-                    }
-                    if (blocked && ppu.obj_sub_window_enable) {
-                        // target_sub[x] = 0xff000000;
-                        // priority_sub[y * WINDOW_WIDTH + x] = prio;
-                        continue;
-                    }
-
-                    if (tiles[x_off] != 0) {
-                        uint32_t col = brightness_adjust(
-                            ppu.cgram[128 + ppu.oam[i].palette * 16 +
-                                      tiles[x_off]]);
-                        target_sub[x] = col;
-                        priority_sub[y * WINDOW_WIDTH + x] = prio;
-                    }
-                }
+                if (x < 0 || x > 255 || tiles[x_off] == 0 ||
+                    line->priority[x] >= prio)
+                    continue;
+                line->color[x] =
+                    128 + snes->ppu.oam[i].palette * 16 + tiles[x_off];
+                line->priority[x] = prio;
             }
         }
     }
 }
 
-void try_step_ppu(void) {
-    if (ppu.remaining_clocks > 0) {
-        ppu.remaining_clocks -= CYCLES_PER_DOT;
+// the beam positions try_step_ppu does anything at besides moving on, every
+// line has the same ones. Whatever happens at the start of a line or frame is
+// on the wrap from 339 to 0
+uint32_t ppu_dots_until_event(snes_t *snes) {
+    // a PPU that is behind doesn't step every dot
+    if (snes->ppu.remaining_clocks + CYCLES_PER_DOT <= 0)
+        return 1;
+    uint16_t x = snes->ppu.beam_x;
+    uint16_t next = 340;
+    if (x < 22)
+        next = 22;
+    else if (x < 278)
+        next = 278;
+    else if (x < 339)
+        next = 339;
+    if ((snes->cpu.timer_irq & 1) && snes->ppu.h_timer_target > x)
+        next = MIN(next, snes->ppu.h_timer_target);
+    return next - x;
+}
+
+void ppu_skip_dots(snes_t *snes, uint32_t dots) {
+    ASSERT(snes->ppu.beam_x + dots < 340, "Skipped %d dots past the line end",
+           dots);
+    snes->ppu.beam_x += dots;
+}
 
-        ppu.beam_x++;
-        if (ppu.beam_x == 340) {
-            ppu.beam_x = 0;
-            ppu.beam_y++;
-            if (cpu.state == STATE_RUNNING && cpu.break_next_scanline) {
-                cpu.state = STATE_STOPPED;
-                cpu.break_next_scanline = false;
+void try_step_ppu(snes_t *snes) {
+    if (snes->ppu.remaining_clocks > 0) {
+        snes->ppu.remaining_clocks -= CYCLES_PER_DOT;
+
+        snes->ppu.beam_x++;
+        if (snes->ppu.beam_x == 340) {
+            snes->ppu.beam_x = 0;
+            snes->ppu.beam_y++;
+            if (snes->cpu.state == STATE_RUNNING &&
+                snes->cpu.break_next_scanline) {
+                snes->cpu.state = STATE_STOPPED;
+                snes->cpu.break_next_scanline = false;
             }
-            if (ppu.beam_y == 262) {
-                ppu.interlace_field = !ppu.interlace_field;
-                ppu.beam_y = 0;
-                ppu.oam_sprite_overflow = false;
-                ppu.oam_sprite_tile_overflow = false;
-                if (cpu.state == STATE_RUNNING && cpu.break_next_frame) {
-                    cpu.state = STATE_STOPPED;
-                    cpu.break_next_frame = false;
+            if (snes->ppu.beam_y == 262) {
+                timing_end_frame(snes);
+                snes->ppu.interlace_field = !snes->ppu.interlace_field;
+                snes->ppu.beam_y = 0;
+                snes->ppu.oam_sprite_overflow = false;
+                snes->ppu.oam_sprite_tile_overflow = false;
+                if (snes->cpu.state == STATE_RUNNING &&
+                    snes->cpu.break_next_frame) {
+                    snes->cpu.state = STATE_STOPPED;
+                    snes->cpu.break_next_frame = false;
                 }
             }
         }
 
-        if (cpu.timer_irq) {
-            if ((cpu.timer_irq == 1 && ppu.beam_x == ppu.h_timer_target) ||
-                (cpu.timer_irq == 2 && ppu.beam_y == ppu.v_timer_target &&
-                 ppu.beam_x == 0) ||
-                (cpu.timer_irq == 3 && ppu.beam_y == ppu.v_timer_target &&
-                 ppu.beam_x == ppu.h_timer_target)) {
-                cpu.irq = true;
-                cpu.memory.timer_has_occurred = true;
+        if (snes->cpu.timer_irq) {
+            if ((snes->cpu.timer_irq == 1 &&
+                 snes->ppu.beam_x == snes->ppu.h_timer_target) ||
+                (snes->cpu.timer_irq == 2 &&
+                 snes->ppu.beam_y == snes->ppu.v_timer_target &&
+                 snes->ppu.beam_x == 0) ||
+                (snes->cpu.timer_irq == 3 &&
+                 snes->ppu.beam_y == snes->ppu.v_timer_target &&
+                 snes->ppu.beam_x == snes->ppu.h_timer_target)) {
+                snes->cpu.irq = true;
+                snes->cpu.memory.timer_has_occurred = true;
             }
         }
 
         uint16_t vblank_start = 225;
-        if (ppu.overscan) {
+        if (snes->ppu.overscan) {
             vblank_start += 15;
         }
-        if (ppu.beam_x == 0 && ppu.beam_y == vblank_start) {
-            cpu.memory.vblank_has_occurred = true;
+        if (snes->ppu.beam_x == 0 && snes->ppu.beam_y == vblank_start) {
+            snes->cpu.memory.vblank_has_occurred = true;
             for (uint8_t i = 0; i < 8; i++) {
-                cpu.memory.dmas[i].dma_byte_count =
-                    (cpu.memory.dmas_for_reloading[0x10 * i + 0x07] << 16) |
-                    (cpu.memory.dmas_for_reloading[0x10 * i + 0x06] << 8) |
-                    (cpu.memory.dmas_for_reloading[0x10 * i + 0x05] << 0);
-                cpu.memory.dmas[i].hdma_current_address =
-                    cpu.memory.dmas[i].dma_src_addr;
-                cpu.memory.dmas[i].scanlines_left = 0;
-                cpu.memory.dmas[i].hdma_repeat = false;
-                cpu.memory.dmas[i].hdma_stopped = false;
+                snes->cpu.memory.dmas[i].dma_byte_count =
+                    (snes->cpu.memory.dmas_for_reloading[0x10 * i + 0x07]
+                     << 16) |
+                    (snes->cpu.memory.dmas_for_reloading[0x10 * i + 0x06]
+                     << 8) |
+                    (snes->cpu.memory.dmas_for_reloading[0x10 * i + 0x05] << 0);
+                snes->cpu.memory.dmas[i].hdma_current_address =
+                    snes->cpu.memory.dmas[i].dma_src_addr;
+                snes->cpu.memory.dmas[i].scanlines_left = 0;
+                snes->cpu.memory.dmas[i].hdma_repeat = false;
+                snes->cpu.memory.dmas[i].hdma_stopped = false;
             }
-            if(!ppu.force_blanking) ppu.oam_addr_internal = ppu.oam_addr;
+            if (!snes->ppu.force_blanking)
+                snes->ppu.oam_addr_internal = snes->ppu.oam_addr;
         }
-        if (ppu.beam_x == 339 && ppu.beam_y == 261) {
-            cpu.memory.vblank_has_occurred = false;
+        if (snes->ppu.beam_x == 339 && snes->ppu.beam_y == 261) {
+            snes->cpu.memory.vblank_has_occurred = false;
         }
 
-        if (ppu.beam_x == 278 && ppu.beam_y > 0 && ppu.beam_y < 225) {
+        if (snes->ppu.beam_x == 278 && snes->ppu.beam_y > 0 &&
+            snes->ppu.beam_y < 225) {
+            TIMING_ENTER(snes, TIMING_HDMA);
             for (uint8_t i = 0; i < 8; i++) {
-                if (cpu.memory.dmas[i].hdma_enable &&
-                    !cpu.memory.dmas[i].hdma_stopped) {
-                    if (cpu.memory.dmas[i].scanlines_left == 0) {
-                        uint32_t addr = cpu.memory.dmas[i].hdma_current_address;
-                        uint8_t next =
-                            read_8(U24_LOSHORT(addr), U24_HIBYTE(addr));
+                if (snes->cpu.memory.dmas[i].hdma_enable &&
+                    !snes->cpu.memory.dmas[i].hdma_stopped) {
+                    if (snes->cpu.memory.dmas[i].scanlines_left == 0) {
+                        uint32_t addr =
+                            snes->cpu.memory.dmas[i].hdma_current_address;
+                        uint8_t next = dma_read_8(snes, U24_LOSHORT(addr),
+                                                  U24_HIBYTE(addr));
                         addr = TO_U24(U24_LOSHORT(addr) + 1, U24_HIBYTE(addr));
                         if (next == 0) {
-                            cpu.memory.dmas[i].hdma_stopped = true;
+                            snes->cpu.memory.dmas[i].hdma_stopped = true;
                             continue;
                         }
-                        cpu.memory.dmas[i].hdma_repeat = next & 0x80;
-                        cpu.memory.dmas[i].scanlines_left = next & 0x7f;
-                        cpu.memory.dmas[i].hdma_current_address = addr;
-                        cpu.memory.dmas[i].hdma_waiting = false;
-                        if (cpu.memory.dmas[i].indirect_hdma) {
-                            cpu.memory.dmas[i].dma_byte_count = TO_U24(
-                                read_16(U24_LOSHORT(addr), U24_HIBYTE(addr)),
-                                U24_HIBYTE(cpu.memory.dmas[i].dma_byte_count));
+                        snes->cpu.memory.dmas[i].hdma_repeat = next & 0x80;
+                        snes->cpu.memory.dmas[i].scanlines_left = next & 0x7f;
+                        snes->cpu.memory.dmas[i].hdma_current_address = addr;
+                        snes->cpu.memory.dmas[i].hdma_waiting = false;
+                        if (snes->cpu.memory.dmas[i].indirect_hdma) {
+                            snes->cpu.memory.dmas[i].dma_byte_count = TO_U24(
+                                TO_U16(dma_read_8(snes, U24_LOSHORT(addr),
+                                                  U24_HIBYTE(addr)),
+                                       dma_read_8(snes, U24_LOSHORT(addr + 1),
+                                                  U24_HIBYTE(addr))),
+                                U24_HIBYTE(
+                                    snes->cpu.memory.dmas[i].dma_byte_count));
                             addr =
                                 TO_U24(U24_LOSHORT(addr) + 2, U24_HIBYTE(addr));
-                            cpu.memory.dmas[i].hdma_current_address = addr;
+                            snes->cpu.memory.dmas[i].hdma_current_address =
+                                addr;
                         }
                     }
 
-                    static uint8_t transfer_patterns[8][5] = {
+                    static const uint8_t transfer_patterns[8][5] = {
                         {1, 0, 0, 0, 0}, {2, 0, 1, 0, 0}, {2, 0, 0, 0, 0},
                         {4, 0, 0, 1, 1}, {4, 0, 1, 2, 3}, {4, 0, 1, 0, 1},
                         {2, 0, 0, 0, 0}, {4, 0, 0, 1, 1},
                     };
-                    if (cpu.memory.dmas[i].indirect_hdma) {
-                        if (cpu.memory.dmas[i].hdma_repeat ||
-                            !cpu.memory.dmas[i].hdma_waiting) {
+                    if (snes->cpu.memory.dmas[i].indirect_hdma) {
+                        if (snes->cpu.memory.dmas[i].hdma_repeat ||
+                            !snes->cpu.memory.dmas[i].hdma_waiting) {
                             uint8_t count =
-                                transfer_patterns[cpu.memory.dmas[i]
+                                transfer_patterns[snes->cpu.memory.dmas[i]
                                                       .transfer_pattern][0];
-                            uint32_t addr = cpu.memory.dmas[i].dma_byte_count;
+                            uint32_t addr =
+                                snes->cpu.memory.dmas[i].dma_byte_count;
                             for (uint8_t j = 0; j < count; j++) {
-                                uint8_t to_write =
-                                    read_8(U24_LOSHORT(addr), U24_HIBYTE(addr));
-                                if (cpu.memory.dmas[i].addr_inc_mode == 0)
+                                uint8_t to_write = dma_read_8(
+                                    snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+                                if (snes->cpu.memory.dmas[i].addr_inc_mode == 0)
                                     addr = TO_U24(U24_LOSHORT(addr) + 1,
                                                   U24_HIBYTE(addr));
-                                if (cpu.memory.dmas[i].addr_inc_mode == 2)
+                                if (snes->cpu.memory.dmas[i].addr_inc_mode == 2)
                                     addr = TO_U24(U24_LOSHORT(addr) - 1,
                                                   U24_HIBYTE(addr));
 
-                                write_8(
-                                    0x2100 + cpu.memory.dmas[i].b_bus_addr +
-                                        transfer_patterns[cpu.memory.dmas[i]
+                                dma_write_8(
+                                    snes,
+                                    0x2100 +
+                                        snes->cpu.memory.dmas[i].b_bus_addr +
+                                        transfer_patterns[snes->cpu.memory
+                                                              .dmas[i]
                                                               .transfer_pattern]
                                                          [1 + j],
                                     0, to_write);
                             }
-                            cpu.memory.dmas[i].dma_byte_count = addr;
-                            if (!cpu.memory.dmas[i].hdma_repeat)
-                                cpu.memory.dmas[i].hdma_waiting = true;
+                            snes->cpu.memory.dmas[i].dma_byte_count = addr;
+                            if (!snes->cpu.memory.dmas[i].hdma_repeat)
+                                snes->cpu.memory.dmas[i].hdma_waiting = true;
                         }
                     } else {
-                        if (cpu.memory.dmas[i].hdma_repeat ||
-                            !cpu.memory.dmas[i].hdma_waiting) {
+                        if (snes->cpu.memory.dmas[i].hdma_repeat ||
+                            !snes->cpu.memory.dmas[i].hdma_waiting) {
                             uint8_t count =
-                                transfer_patterns[cpu.memory.dmas[i]
+                                transfer_patterns[snes->cpu.memory.dmas[i]
                                                       .transfer_pattern][0];
                             uint32_t addr =
-                                cpu.memory.dmas[i].hdma_current_address;
+                                snes->cpu.memory.dmas[i].hdma_current_address;
                             for (uint8_t j = 0; j < count; j++) {
-                                uint8_t to_write =
-                                    read_8(U24_LOSHORT(addr), U24_HIBYTE(addr));
-                                if (cpu.memory.dmas[i].addr_inc_mode == 0)
+                                uint8_t to_write = dma_read_8(
+                                    snes, U24_LOSHORT(addr), U24_HIBYTE(addr));
+                                if (snes->cpu.memory.dmas[i].addr_inc_mode == 0)
                                     addr = TO_U24(U24_LOSHORT(addr) + 1,
                                                   U24_HIBYTE(addr));
-                                if (cpu.memory.dmas[i].addr_inc_mode == 2)
+                                if (snes->cpu.memory.dmas[i].addr_inc_mode == 2)
                                     addr = TO_U24(U24_LOSHORT(addr) - 1,
                                                   U24_HIBYTE(addr));
-                                write_8(
-                                    0x2100 + cpu.memory.dmas[i].b_bus_addr +
-                                        transfer_patterns[cpu.memory.dmas[i]
+                                dma_write_8(
+                                    snes,
+                                    0x2100 +
+                                        snes->cpu.memory.dmas[i].b_bus_addr +
+                                        transfer_patterns[snes->cpu.memory
+                                                              .dmas[i]
                                                               .transfer_pattern]
                                                          [1 + j],
                                     0, to_write);
                             }
-                            cpu.memory.dmas[i].hdma_current_address = addr;
-                            if (!cpu.memory.dmas[i].hdma_repeat)
-                                cpu.memory.dmas[i].hdma_waiting = true;
+                            snes->cpu.memory.dmas[i].hdma_current_address =
+                                addr;
+                            if (!snes->cpu.memory.dmas[i].hdma_repeat)
+                                snes->cpu.memory.dmas[i].hdma_waiting = true;
                         }
                     }
 
-                    cpu.memory.dmas[i].scanlines_left--;
+                    snes->cpu.memory.dmas[i].scanlines_left--;
                 }
             }
+            TIMING_LEAVE(snes);
         }
 
-        if (ppu.beam_x == 22 && ppu.beam_y > 0 && ppu.beam_y < 225) {
-            if (ppu.force_blanking)
+        if (snes->ppu.beam_x == 22 && snes->ppu.beam_y > 0 &&
+            snes->ppu.beam_y < 225) {
+            if (snes->ppu.force_blanking)
+                return;
+            // frames emulated only for run-ahead are never shown
+            if (snes->skip_render) {
+                evaluate_obj(snes, snes->ppu.beam_y - 1);
                 return;
-            uint32_t main_bg_adj = brightness_adjust(ppu.cgram[0]);
-            uint32_t sub_bg_adj = brightness_adjust(ppu.fixed_color_24bit);
-            for (uint16_t i = 0; i < WINDOW_WIDTH; i++) {
-                ((uint32_t *)framebuffer)[(ppu.beam_y - 1) * WINDOW_WIDTH + i] =
-                    main_bg_adj;
-                ((uint32_t *)subscreen)[(ppu.beam_y - 1) * WINDOW_WIDTH + i] =
-                    sub_bg_adj;
-                priority[(ppu.beam_y - 1) * WINDOW_WIDTH + i] = 0;
-                priority_sub[(ppu.beam_y - 1) * WINDOW_WIDTH + i] = 0;
-                use_color_math[i] = ppu.backdrop_color_math_enable;
-            }
-            if (ppu.bg_mode == 0) {
-                draw_bg(0, ppu.beam_y - 1, BPP_2, 7, 10);
-                draw_bg(1, ppu.beam_y - 1, BPP_2, 6, 9);
-                draw_bg(2, ppu.beam_y - 1, BPP_2, 1, 4);
-                draw_bg(3, ppu.beam_y - 1, BPP_2, 0, 3);
-            }
-            if (ppu.bg_mode == 1) {
-                draw_bg(0, ppu.beam_y - 1, BPP_4, 7, 10);
-                draw_bg(1, ppu.beam_y - 1, BPP_4, 6, 9);
-                draw_bg(2, ppu.beam_y - 1, BPP_2, 1,
-                        ppu.mode_1_bg3_prio ? 12 : 4);
             }
-            if (ppu.bg_mode == 2) {
-                draw_bg(0, ppu.beam_y - 1, BPP_4, 4, 10);
-                draw_bg(1, ppu.beam_y - 1, BPP_4, 1, 7);
+            if (snes->window_masks.dirty)
+                build_window_masks(snes);
+            TIMING_ENTER(snes, TIMING_DRAW_BG);
+            memset(snes->layer_lines, 0, sizeof(snes->layer_lines));
+            if (snes->ppu.bg_mode == 0) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_2, 7, 10);
+                draw_bg(snes, 1, snes->ppu.beam_y - 1, BPP_2, 6, 9);
+                draw_bg(snes, 2, snes->ppu.beam_y - 1, BPP_2, 1, 4);
+                draw_bg(snes, 3, snes->ppu.beam_y - 1, BPP_2, 0, 3);
             }
-            if (ppu.bg_mode == 3) {
-                draw_bg(0, ppu.beam_y - 1, BPP_8, 4, 10);
-                draw_bg(1, ppu.beam_y - 1, BPP_4, 1, 7);
+            if (snes->ppu.bg_mode == 1) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_4, 7, 10);
+                draw_bg(snes, 1, snes->ppu.beam_y - 1, BPP_4, 6, 9);
+                draw_bg(snes, 2, snes->ppu.beam_y - 1, BPP_2, 1,
+                        snes->ppu.mode_1_bg3_prio ? 12 : 4);
             }
-            if (ppu.bg_mode == 4) {
-                draw_bg(0, ppu.beam_y - 1, BPP_8, 4, 10);
-                draw_bg(1, ppu.beam_y - 1, BPP_2, 1, 7);
+            if (snes->ppu.bg_mode == 2) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_4, 4, 10);
+                draw_bg(snes, 1, snes->ppu.beam_y - 1, BPP_4, 1, 7);
             }
-            if (ppu.bg_mode == 5) {
-                draw_bg(0, ppu.beam_y - 1, BPP_4, 4, 10);
-                draw_bg(1, ppu.beam_y - 1, BPP_2, 1, 7);
+            if (snes->ppu.bg_mode == 3) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_8, 4, 10);
+                draw_bg(snes, 1, snes->ppu.beam_y - 1, BPP_4, 1, 7);
             }
-            if (ppu.bg_mode == 6) {
-                draw_bg(0, ppu.beam_y - 1, BPP_4, 4, 10);
+            if (snes->ppu.bg_mode == 4) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_8, 4, 10);
+                draw_bg(snes, 1, snes->ppu.beam_y - 1, BPP_2, 1, 7);
             }
-            if (ppu.bg_mode == 7) {
-                draw_bg_1_mode_7(ppu.beam_y - 1);
+            if (snes->ppu.bg_mode == 5) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_4, 4, 10);
+                draw_bg(snes, 1, snes->ppu.beam_y - 1, BPP_2, 1, 7);
             }
-            draw_obj(ppu.beam_y - 1);
-            for (uint16_t i = 0; i < WINDOW_WIDTH; i++) {
-                if (use_color_math[i]) {
-                    bool window_1 = false;
-                    if (ppu.col_window_1_enable) {
-                        window_1 =
-                            IN_INTERVAL(i, ppu.window_1_l, ppu.window_1_r) ^
-                            ppu.col_window_1_invert;
-                    }
-                    bool window_2 = false;
-                    if (ppu.col_window_2_enable) {
-                        window_2 =
-                            IN_INTERVAL(i, ppu.window_2_l, ppu.window_2_r) ^
-                            ppu.col_window_2_invert;
-                    }
-                    bool blocked;
-                    if (!ppu.col_window_1_enable && !ppu.col_window_2_enable) {
-                        blocked = false;
-                    } else if (ppu.col_window_1_enable &&
-                               !ppu.col_window_2_enable) {
-                        blocked = window_1;
-                    } else if (!ppu.col_window_1_enable &&
-                               ppu.col_window_2_enable) {
-                        blocked = window_2;
-                    } else
-                        switch (ppu.col_window_mask_logic) {
-                        case 0:
-                            blocked = window_1 || window_2;
-                            break;
-                        case 1:
-                            blocked = window_1 && window_2;
-                            break;
-                        case 2:
-                            blocked = window_1 ^ window_2;
-                            break;
-                        case 3:
-                            blocked = window_1 == window_2;
-                            break;
-                        default:
-                            UNREACHABLE_SWITCH(ppu.col_window_mask_logic);
-                        }
-
-                    switch (ppu.main_window_black_region) {
-                    case 0:
-                        // this page intentionally left blank
-                        break;
-                    case 1:
-                        if (!blocked) {
-                            ((uint32_t *)
-                                 framebuffer)[(ppu.beam_y - 1) * WINDOW_WIDTH +
-                                              i] = 0xff000000;
-                            continue;
-                        }
-                        break;
-                    case 2:
-                        if (blocked) {
-                            ((uint32_t *)
-                                 framebuffer)[(ppu.beam_y - 1) * WINDOW_WIDTH +
-                                              i] = 0xff000000;
-                            continue;
-                        }
-                        break;
-                    case 3:
-                        ((uint32_t *)
-                             framebuffer)[(ppu.beam_y - 1) * WINDOW_WIDTH + i] =
-                            0xff000000;
-                        continue;
-                    }
-                    switch (ppu.sub_window_transparent_region) {
-                    case 0:
-                        // this page intentionally left blank
-                        break;
-                    case 1:
-                        if (!blocked) {
-                            continue;
-                        }
-                        break;
-                    case 2:
-                        if (blocked) {
-                            continue;
-                        }
-                        break;
-                    case 3:
-                        continue;
-                    }
-
-                    int32_t main =
-                        ((uint32_t *)
-                             framebuffer)[(ppu.beam_y - 1) * WINDOW_WIDTH + i] &
-                        0xffffff;
-                    int32_t to_add =
-                        ppu.addend_subscreen
-                            ? ((uint32_t *)
-                                   subscreen)[(ppu.beam_y - 1) * WINDOW_WIDTH +
-                                              i] &
-                                  0xffffff
-                            : ppu.fixed_color_24bit;
-                    int32_t r, g, b;
-                    if (ppu.color_math_subtract) {
-                        r = (main & 0xff) - (to_add & 0xff);
-                        g = ((main >> 8) & 0xff) - ((to_add >> 8) & 0xff);
-                        b = ((main >> 16) & 0xff) - ((to_add >> 16) & 0xff);
-
-                    } else {
-                        r = (main & 0xff) + (to_add & 0xff);
-                        g = ((main >> 8) & 0xff) + ((to_add >> 8) & 0xff);
-                        b = ((main >> 16) & 0xff) + ((to_add >> 16) & 0xff);
-                    }
-                    if (ppu.half_color_math) {
-                        r /= 2;
-                        g /= 2;
-                        b /= 2;
-                    }
-                    r = MIN(255, MAX(0, r));
-                    g = MIN(255, MAX(0, g));
-                    b = MIN(255, MAX(0, b));
-                    ((uint32_t *)
-                         framebuffer)[(ppu.beam_y - 1) * WINDOW_WIDTH + i] =
-                        r | (g << 8) | (b << 16) | 0xff000000;
-                }
+            if (snes->ppu.bg_mode == 6) {
+                draw_bg(snes, 0, snes->ppu.beam_y - 1, BPP_4, 4, 10);
             }
-        }
-    }
-}
-
-void ui(void) {
-    SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE);
-    InitWindow(WINDOW_WIDTH * 4, WINDOW_HEIGHT * 4, "snes");
-    Image framebuffer_image = {framebuffer, WINDOW_WIDTH, WINDOW_HEIGHT, 1,
-                               PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
-    Texture texture = LoadTextureFromImage(framebuffer_image);
-    cpp_init();
-
-    bool view_debug_ui = false, view_scanline = false;
-
-    ppu.v_timer_target = 0x1ff;
-    ppu.h_timer_target = 0x1ff;
-
-    while (!WindowShouldClose()) {
-        BeginDrawing();
-        ClearBackground(GetColor(SWAP_ENDIAN(ppu.fixed_color_24bit))));
-
-        for (uint32_t i = 0;
-             i < 341 * 262 * cpu.speed * (GetFrameTime() / 0.0166f); i++) {
-            switch (cpu.state) {
-            case STATE_STOPPED:
-                // this page intentionally left blank
-                break;
-            case STATE_CPU_STEPPED:
-                ppu.remaining_clocks += (-cpu.remaining_clocks) + 1;
-                spc.remaining_clocks += (-cpu.remaining_clocks) + 1;
-                cpu.remaining_clocks = 1;
-                cpu.state = STATE_STOPPED;
-                try_step_cpu();
-                try_step_ppu();
-                while (spc.remaining_clocks > 0) {
-                    try_step_spc();
-                }
-                break;
-            case STATE_SPC_STEPPED:
-                ppu.remaining_clocks += (-spc.remaining_clocks) + 1;
-                cpu.remaining_clocks += (-spc.remaining_clocks) + 1;
-                spc.remaining_clocks = 1;
-                cpu.state = STATE_STOPPED;
-                try_step_spc();
-                try_step_ppu();
-                while (spc.remaining_clocks > 0) {
-                    try_step_cpu();
-                }
-                break;
-            case STATE_RUNNING:
-                cpu.remaining_clocks += CYCLES_PER_DOT;
-                ppu.remaining_clocks += CYCLES_PER_DOT;
-                spc.remaining_clocks += CYCLES_PER_DOT;
-                while ((cpu.remaining_clocks > 0 || spc.remaining_clocks > 0) &&
-                       cpu.state != STATE_STOPPED) {
-                    try_step_cpu();
-                    try_step_spc();
-                }
-                try_step_ppu();
-                break;
+            if (snes->ppu.bg_mode == 7) {
+                TIMING_ENTER(snes, TIMING_DRAW_MODE_7);
+                draw_bg_1_mode_7(snes, snes->ppu.beam_y - 1);
+                TIMING_LEAVE(snes);
             }
+            TIMING_LEAVE(snes);
+            TIMING_ENTER(snes, TIMING_DRAW_OBJ);
+            draw_obj(snes, snes->ppu.beam_y - 1);
+            TIMING_LEAVE(snes);
+            TIMING_ENTER(snes, TIMING_COLOR_MATH);
+            ppu_compose_line(snes, snes->ppu.beam_y - 1);
+            TIMING_LEAVE(snes);
         }
-
-        cpu.memory.joy1l = 0;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_R) << 4;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_L) << 5;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_X) << 6;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_A) << 7;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_RIGHT) << 8;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_LEFT) << 9;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_DOWN) << 10;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_UP) << 11;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_START) << 12;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_SELECT) << 13;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_Y) << 14;
-        cpu.memory.joy1l |= IsGamepadButtonDown(0, GAMEPAD_B) << 15;
-
-        cpu.memory.joy1l |=
-            (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_X) > 0.5) << 8;
-        cpu.memory.joy1l |=
-            (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_X) < -0.5) << 9;
-        cpu.memory.joy1l |=
-            (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_Y) > 0.5) << 10;
-        cpu.memory.joy1l |=
-            (GetGamepadAxisMovement(0, GAMEPAD_AXIS_LEFT_Y) < -0.5) << 11;
-
-        cpu.memory.joy1l |= IsKeyDown(KEY_RIGHT) << 8;
-        cpu.memory.joy1l |= IsKeyDown(KEY_LEFT) << 9;
-        cpu.memory.joy1l |= IsKeyDown(KEY_DOWN) << 10;
-        cpu.memory.joy1l |= IsKeyDown(KEY_UP) << 11;
-        cpu.memory.joy1l |= IsKeyDown(KEY_RIGHT_CONTROL) << 12;
-        cpu.memory.joy1l |= IsKeyDown(KEY_LEFT_CONTROL) << 13;
-        cpu.memory.joy_latch_pending = false;
-
-        UpdateTexture(texture, framebuffer);
-        DrawTexturePro(texture, (Rectangle){0, 0, WINDOW_WIDTH, WINDOW_HEIGHT},
-                       (Rectangle){0, 0, GetScreenWidth(), GetScreenHeight()},
-                       (Vector2){0, 0}, 0.0f, WHITE);
-
-        if (IsKeyPressed(KEY_TAB)) {
-            view_debug_ui = !view_debug_ui;
-        }
-
-        if (IsKeyPressed(KEY_F10)) {
-            cpu.state =
-                cpu.state == STATE_RUNNING ? STATE_STOPPED : STATE_RUNNING;
-        }
-
-        if (IsKeyPressed(KEY_END)) {
-            cpu.speed *= 2;
-        }
-
-        if (IsKeyPressed(KEY_HOME)) {
-            cpu.speed /= 2;
-        }
-
-        if (IsKeyPressed(KEY_LEFT_ALT)) {
-            view_scanline = !view_scanline;
-        }
-
-        if (view_scanline) {
-            uint32_t scanline_pos =
-                ((ppu.beam_y - 1.f) / WINDOW_HEIGHT) * GetScreenHeight();
-            DrawLine(0, scanline_pos - 1, GetScreenWidth(), scanline_pos - 1,
-                     WHITE);
-            DrawLine(0, scanline_pos, GetScreenWidth(), scanline_pos, RED);
-            DrawLine(0, scanline_pos + 1, GetScreenWidth(), scanline_pos + 1,
-                     WHITE);
-        }
-
-        if (view_debug_ui) {
-            cpp_imgui_render();
-        }
-
-        DrawFPS(0, 0);
-
-        EndDrawing();
     }
-
-    cpp_end();
-    UnloadTexture(texture);
-    CloseWindow();
 }
@@ -2,9 +2,33 @@
 #define PPU_H_
 
 #include "cpu.h"
-#include "raylib.h"
 #include "types.h"
-#include "ui.h"
-void ui(void);
+
+void try_step_cpu(snes_t *snes);
+void try_step_spc(snes_t *snes);
+void try_step_ppu(snes_t *snes);
+// while the CPU runs ahead to the next PPU event, brings the SPC or the beam
+// up to the dot the CPU's instruction started on. Called before the CPU looks
+// at either.
+void catch_up_spc(snes_t *snes);
+void catch_up_ppu(snes_t *snes);
+// how many dots try_step_ppu can go from here before one that does more than
+// move the beam, counting that one
+uint32_t ppu_dots_until_event(snes_t *snes);
+// moves the beam over dots that ppu_dots_until_event said have nothing on them
+void ppu_skip_dots(snes_t *snes, uint32_t dots);
+// drops decoded tiles overlapping a VRAM byte, or all of them
+void ppu_invalidate_tiles(snes_t *snes, uint16_t vram_addr);
+void ppu_invalidate_all_tiles(snes_t *snes);
+// invalidates the tiles whose bytes differ from vram, which is about to
+// replace VRAM
+void ppu_invalidate_changed_tiles(snes_t *snes, const uint8_t *vram);
+// brings the output palette up to date after a cgram write, or after the
+// brightness or all of cgram changed
+void ppu_update_palette(snes_t *snes, uint8_t idx);
+void ppu_build_palette(snes_t *snes);
+uint32_t brightness_adjust(snes_t *snes, uint32_t col);
+// makes the next line drawn rebuild the window masks
+void ppu_invalidate_windows(snes_t *snes);
 
 #endif
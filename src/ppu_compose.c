@@ -0,0 +1,245 @@
+#include "ppu_compose.h"
+#include "ppu.h"
+#include "types.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The BGs and the sprites are drawn into a line buffer each, holding a cgram
+// index and a priority for every pixel. Here they are merged into the main and
+// sub screens in the order they were drawn. A pixel is taken if it is above
+// what the screen holds so far and the layer's windows don't block it on that
+// screen, so on equal priorities the layer merged first wins.
+//
+// With SSE2, merging works on 16 pixels at a time and color math on 4. The
+// scalar code does the same one pixel at a time.
+
+typedef struct {
+    uint8_t color[WINDOW_WIDTH];
+    uint8_t priority[WINDOW_WIDTH];
+    // 0xff where color math applies to the pixel, only used on the main screen
+    uint8_t math[WINDOW_WIDTH];
+} screen_line_t;
+
+#ifdef __SSE2__
+static __m128i load(const void *p) {
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static void store(void *p, __m128i v) { _mm_storeu_si128((__m128i *)p, v); }
+
+static __m128i select_128(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// 0xff in the bytes of pixels x to x + 15 whose window bit is set
+static __m128i window_bytes(const uint64_t *window, uint16_t x) {
+    uint16_t bits = window[x / 64] >> (x % 64);
+    const __m128i select = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64,
+                                        32, 16, 8, 4, 2, 1);
+    __m128i bytes = _mm_set_epi64x(0x0101010101010101ll * (bits >> 8),
+                                   0x0101010101010101ll * (bits & 0xff));
+    return _mm_cmpeq_epi8(_mm_and_si128(bytes, select), select);
+}
+
+static __m128i region_bytes(uint8_t region, __m128i inside) {
+    __m128i ret = _mm_setzero_si128();
+    if (region & 1)
+        ret = _mm_xor_si128(inside, _mm_set1_epi8(-1));
+    if (region & 2)
+        ret = _mm_or_si128(ret, inside);
+    return ret;
+}
+
+// widens 4 bytes of 0x00 or 0xff to one 32-bit lane each
+static __m128i lane_mask(const uint8_t *bytes) {
+    uint32_t four;
+    memcpy(&four, bytes, sizeof(four));
+    __m128i v = _mm_cvtsi32_si128(four);
+    v = _mm_unpacklo_epi8(v, v);
+    return _mm_unpacklo_epi16(v, v);
+}
+#else
+static bool window_bit(const uint64_t *window, uint16_t x) {
+    return (window[x / 64] >> (x % 64)) & 1;
+}
+
+// whether a pixel is in the region a color window setting selects: never,
+// outside the window, inside it or always
+static bool in_region(uint8_t region, bool inside) {
+    return ((region & 1) && !inside) || ((region & 2) && inside);
+}
+
+static uint32_t blend(uint32_t main, uint32_t addend, bool subtract,
+                      bool half) {
+    uint32_t ret = 0xff000000;
+    for (uint8_t shift = 0; shift < 24; shift += 8) {
+        int16_t a = (main >> shift) & 0xff;
+        int16_t b = (addend >> shift) & 0xff;
+        int16_t c = subtract ? MAX(a - b, 0) : a + b;
+        if (half)
+            c /= 2;
+        ret |= (uint32_t)MIN(c, 255) << shift;
+    }
+    return ret;
+}
+#endif
+
+// window is NULL when the layer's windows are off on this screen. Color math
+// applies to the layer's pixels with a color of at least math_from.
+static void merge(screen_line_t *screen, const layer_line_t *layer,
+                  const uint64_t *window, bool math, uint8_t math_from) {
+#ifdef __SSE2__
+    const __m128i math_value = _mm_set1_epi8(math ? -1 : 0);
+    const __m128i from = _mm_set1_epi8(math_from);
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x += 16) {
+        __m128i layer_priority = load(layer->priority + x);
+        __m128i priority = load(screen->priority + x);
+        // priorities are small enough for a signed compare
+        __m128i take = _mm_cmpgt_epi8(layer_priority, priority);
+        if (window != NULL)
+            take = _mm_andnot_si128(window_bytes(window, x), take);
+        store(screen->priority + x, select_128(take, layer_priority, priority));
+        __m128i color = load(layer->color + x);
+        store(screen->color + x,
+              select_128(take, color, load(screen->color + x)));
+        __m128i layer_math = _mm_and_si128(
+            math_value, _mm_cmpeq_epi8(_mm_max_epu8(color, from), color));
+        store(screen->math + x,
+              select_128(take, layer_math, load(screen->math + x)));
+    }
+#else
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x++) {
+        if (layer->priority[x] <= screen->priority[x])
+            continue;
+        if (window != NULL && window_bit(window, x))
+            continue;
+        screen->priority[x] = layer->priority[x];
+        screen->color[x] = layer->color[x];
+        screen->math[x] = math && layer->color[x] >= math_from ? 0xff : 0;
+    }
+#endif
+}
+
+// splits the pixels color math is enabled for into those the color window
+// turns black, and those that get the addend added or subtracted
+static void pick_color_math(snes_t *snes, const uint8_t *math, uint8_t *black,
+                            uint8_t *apply) {
+    const uint64_t *window = snes->window_masks.masks[LAYER_COL];
+    uint8_t black_region = snes->ppu.main_window_black_region;
+    uint8_t clear_region = snes->ppu.sub_window_transparent_region;
+#ifdef __SSE2__
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x += 16) {
+        __m128i inside = window_bytes(window, x);
+        __m128i enabled = load(math + x);
+        __m128i is_black =
+            _mm_and_si128(enabled, region_bytes(black_region, inside));
+        store(black + x, is_black);
+        store(apply + x,
+              _mm_andnot_si128(
+                  _mm_or_si128(is_black, region_bytes(clear_region, inside)),
+                  enabled));
+    }
+#else
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x++) {
+        bool inside = window_bit(window, x);
+        black[x] = math[x] && in_region(black_region, inside) ? 0xff : 0;
+        apply[x] =
+            math[x] && !black[x] && !in_region(clear_region, inside) ? 0xff : 0;
+    }
+#endif
+}
+
+static void color_math(snes_t *snes, uint32_t *out, const uint32_t *addend,
+                       const uint8_t *black, const uint8_t *apply) {
+    bool subtract = snes->ppu.color_math_subtract;
+    bool half = snes->ppu.half_color_math;
+#ifdef __SSE2__
+    const __m128i alpha = _mm_set1_epi32((int32_t)0xff000000);
+    const __m128i low_7 = _mm_set1_epi8(0x7f);
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x += 4) {
+        __m128i main = load(out + x);
+        __m128i add = load(addend + x);
+        __m128i result;
+        if (subtract) {
+            result = _mm_subs_epu8(main, add);
+            if (half)
+                result = _mm_and_si128(_mm_srli_epi16(result, 1), low_7);
+        } else if (half) {
+            // rounds down, unlike _mm_avg_epu8
+            result = _mm_add_epi8(
+                _mm_and_si128(main, add),
+                _mm_and_si128(_mm_srli_epi16(_mm_xor_si128(main, add), 1),
+                              low_7));
+        } else {
+            result = _mm_adds_epu8(main, add);
+        }
+        result = _mm_or_si128(result, alpha);
+        main = select_128(lane_mask(black + x), alpha, main);
+        store(out + x, select_128(lane_mask(apply + x), result, main));
+    }
+#else
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x++) {
+        if (black[x])
+            out[x] = 0xff000000;
+        else if (apply[x])
+            out[x] = blend(out[x], addend[x], subtract, half);
+    }
+#endif
+}
+
+void ppu_compose_line(snes_t *snes, uint16_t y) {
+    ppu_t *ppu = &snes->ppu;
+    const window_masks_t *windows = &snes->window_masks;
+    screen_line_t main = {0}, sub = {0};
+    memset(main.math, ppu->backdrop_color_math_enable ? 0xff : 0,
+           sizeof(main.math));
+
+    for (uint8_t i = LAYER_BG1; i <= LAYER_BG4; i++) {
+        bool math = ppu->bg_config[i].color_math_enable;
+        // mode 7 leaves color math to the backdrop's setting
+        if (ppu->bg_mode == 7)
+            math = ppu->backdrop_color_math_enable;
+        if (ppu->bg_config[i].main_screen_enable)
+            merge(&main, &snes->layer_lines[i],
+                  ppu->bg_config[i].main_window_enable ? windows->masks[i]
+                                                       : NULL,
+                  math, 0);
+        // the sub screen is only seen through color math
+        if (ppu->addend_subscreen && ppu->bg_config[i].sub_screen_enable)
+            merge(&sub, &snes->layer_lines[i],
+                  ppu->bg_config[i].sub_window_enable ? windows->masks[i]
+                                                      : NULL,
+                  false, 0);
+    }
+    // only sprites with palettes 4 to 7 take part in color math
+    if (ppu->obj_main_screen_enable)
+        merge(&main, &snes->layer_lines[LAYER_OBJ],
+              ppu->obj_main_window_enable ? windows->masks[LAYER_OBJ] : NULL,
+              ppu->obj_color_math_enable, 128 + 4 * 16);
+    if (ppu->addend_subscreen && ppu->obj_sub_screen_enable)
+        merge(&sub, &snes->layer_lines[LAYER_OBJ],
+              ppu->obj_sub_window_enable ? windows->masks[LAYER_OBJ] : NULL,
+              false, 0);
+
+    uint32_t *out = (uint32_t *)snes->framebuffer + y * WINDOW_WIDTH;
+    for (uint16_t x = 0; x < WINDOW_WIDTH; x++) {
+        out[x] = snes->palette[main.color[x]];
+    }
+    uint32_t addend[WINDOW_WIDTH];
+    if (ppu->addend_subscreen) {
+        uint32_t backdrop = brightness_adjust(snes, ppu->fixed_color_24bit);
+        for (uint16_t x = 0; x < WINDOW_WIDTH; x++) {
+            addend[x] =
+                sub.priority[x] ? snes->palette[sub.color[x]] : backdrop;
+        }
+    } else {
+        for (uint16_t x = 0; x < WINDOW_WIDTH; x++) {
+            addend[x] = ppu->fixed_color_24bit;
+        }
+    }
+
+    uint8_t black[WINDOW_WIDTH], apply[WINDOW_WIDTH];
+    pick_color_math(snes, main.math, black, apply);
+    color_math(snes, out, addend, black, apply);
+}
@@ -0,0 +1,10 @@
+#ifndef PPU_COMPOSE_H_
+#define PPU_COMPOSE_H_
+
+#include "types.h"
+
+// merges the layers drawn into snes->layer_lines into the main and sub
+// screens, applies color math and writes line y of the framebuffer
+void ppu_compose_line(snes_t *snes, uint16_t y);
+
+#endif
@@ -0,0 +1,396 @@
+#include "profiler.h"
+#include "cpu.h"
+#include "types.h"
+
+// Counts executions and host time for every opcode the CPU and SPC fetch.
+// 65816 opcodes are split further by the M, X and E flags they ran under,
+// since the width of A and the index registers changes what a handler does.
+// Addressing modes follow from the opcode, so the per mode figures are sums
+// over the opcodes' modes. The CPU's come from CPU_OPCODES, the SPC's from the
+// table below, which mirrors the switch in spc_execute.
+
+typedef struct {
+    char name[4];
+    uint32_t mode;
+} cpu_opcode_info_t;
+
+typedef struct {
+    const char *name;
+    uint32_t mode;
+} opcode_info_t;
+
+// handlers are named after their mnemonic, which always has 3 letters. The
+// rest of the name only keeps it clear of C++'s alternative tokens, as in and_
+#define CPU_OPCODE_INFO(opcode, name, mode)                                    \
+    [opcode] = {{#name[0], #name[1], #name[2], '\0'}, mode},
+
+static const cpu_opcode_info_t cpu_opcodes[0x100] = {
+    CPU_OPCODES(CPU_OPCODE_INFO)};
+
+static const opcode_info_t spc_opcodes[0x100] = {
+    {"nop", SM_IMP},
+    {"jst0", SM_IMP},
+    {"set0", SM_DIR_PAGE_BIT},
+    {"bbs0", SM_DIR_PAGE_BIT_REL},
+    {"ora", SM_DIR_PAGE},
+    {"ora", SM_ABS},
+    {"ora", SM_INDIRECT},
+    {"ora", SM_INDX},
+    {"ora", SM_IMM},
+    {"ora", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"or1", SM_ABS_BOOL_BIT},
+    {"asl", SM_DIR_PAGE},
+    {"asl", SM_ABS},
+    {"php", SM_IMP},
+    {"tset1", SM_ABS},
+    {"brk", SM_IMP},
+    {"bpl", SM_REL},
+    {"jst1", SM_IMP},
+    {"clr0", SM_DIR_PAGE_BIT},
+    {"bbc0", SM_DIR_PAGE_BIT_REL},
+    {"ora", SM_DIR_PAGEX},
+    {"ora", SM_ABSX},
+    {"ora", SM_ABSY},
+    {"ora", SM_INDY},
+    {"ora", SM_IMM_TO_DIR_PAGE},
+    {"ora", SM_IND_PAGE_TO_IND_PAGE},
+    {"dew", SM_DIR_PAGE},
+    {"asl", SM_DIR_PAGEX},
+    {"asl", SM_ACC},
+    {"dex", SM_IMP},
+    {"cpx", SM_ABS},
+    {"jmp", SM_ABS_INDX},
+    {"clp", SM_IMP},
+    {"jst2", SM_IMP},
+    {"set1", SM_DIR_PAGE_BIT},
+    {"bbs1", SM_DIR_PAGE_BIT_REL},
+    {"and", SM_DIR_PAGE},
+    {"and", SM_ABS},
+    {"and", SM_INDIRECT},
+    {"and", SM_INDX},
+    {"and", SM_IMM},
+    {"and", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"or1", SM_ABS_BOOL_BIT_INV},
+    {"rol", SM_DIR_PAGE},
+    {"rol", SM_ABS},
+    {"pha", SM_IMP},
+    {"cbne", SM_DIR_PAGE},
+    {"bra", SM_REL},
+    {"bmi", SM_REL},
+    {"jst3", SM_IMP},
+    {"clr1", SM_DIR_PAGE_BIT},
+    {"bbc1", SM_DIR_PAGE_BIT_REL},
+    {"and", SM_DIR_PAGEX},
+    {"and", SM_ABSX},
+    {"and", SM_ABSY},
+    {"and", SM_INDY},
+    {"and", SM_IMM_TO_DIR_PAGE},
+    {"and", SM_IND_PAGE_TO_IND_PAGE},
+    {"inw", SM_DIR_PAGE},
+    {"rol", SM_DIR_PAGEX},
+    {"rol", SM_ACC},
+    {"inx", SM_IMP},
+    {"cpx", SM_DIR_PAGE},
+    {"jsr", SM_ABS},
+    {"sep", SM_IMP},
+    {"jst4", SM_IMP},
+    {"set2", SM_DIR_PAGE_BIT},
+    {"bbs2", SM_DIR_PAGE_BIT_REL},
+    {"eor", SM_DIR_PAGE},
+    {"eor", SM_ABS},
+    {"eor", SM_INDIRECT},
+    {"eor", SM_INDX},
+    {"eor", SM_IMM},
+    {"eor", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"and1", SM_ABS_BOOL_BIT},
+    {"lsr", SM_DIR_PAGE},
+    {"lsr", SM_ABS},
+    {"phx", SM_IMP},
+    {"tclr1", SM_ABS},
+    {"jsp", SM_IMP},
+    {"bvc", SM_REL},
+    {"jst5", SM_IMP},
+    {"clr2", SM_DIR_PAGE_BIT},
+    {"bbc2", SM_DIR_PAGE_BIT_REL},
+    {"eor", SM_DIR_PAGEX},
+    {"eor", SM_ABSX},
+    {"eor", SM_ABSY},
+    {"eor", SM_INDY},
+    {"eor", SM_IMM_TO_DIR_PAGE},
+    {"eor", SM_IND_PAGE_TO_IND_PAGE},
+    {"cpw", SM_DIR_PAGE},
+    {"lsr", SM_DIR_PAGEX},
+    {"lsr", SM_ACC},
+    {"tax", SM_IMP},
+    {"cpy", SM_ABS},
+    {"jmp", SM_ABS},
+    {"clc", SM_IMP},
+    {"jst6", SM_IMP},
+    {"set3", SM_DIR_PAGE_BIT},
+    {"bbs3", SM_DIR_PAGE_BIT_REL},
+    {"cmp", SM_DIR_PAGE},
+    {"cmp", SM_ABS},
+    {"cmp", SM_INDIRECT},
+    {"cmp", SM_INDX},
+    {"cmp", SM_IMM},
+    {"cmp", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"and1", SM_ABS_BOOL_BIT_INV},
+    {"ror", SM_DIR_PAGE},
+    {"ror", SM_ABS},
+    {"phy", SM_IMP},
+    {"dbnz", SM_DIR_PAGE},
+    {"rts", SM_IMP},
+    {"bvs", SM_REL},
+    {"jst7", SM_IMP},
+    {"clr3", SM_DIR_PAGE_BIT},
+    {"bbc3", SM_DIR_PAGE_BIT_REL},
+    {"cmp", SM_DIR_PAGEX},
+    {"cmp", SM_ABSX},
+    {"cmp", SM_ABSY},
+    {"cmp", SM_INDY},
+    {"cmp", SM_IMM_TO_DIR_PAGE},
+    {"cmp", SM_IND_PAGE_TO_IND_PAGE},
+    {"adw", SM_DIR_PAGE},
+    {"ror", SM_DIR_PAGEX},
+    {"ror", SM_ACC},
+    {"txa", SM_IMP},
+    {"cpy", SM_DIR_PAGE},
+    {"rti", SM_IMP},
+    {"sec", SM_IMP},
+    {"jst8", SM_IMP},
+    {"set4", SM_DIR_PAGE_BIT},
+    {"bbs4", SM_DIR_PAGE_BIT_REL},
+    {"adc", SM_DIR_PAGE},
+    {"adc", SM_ABS},
+    {"adc", SM_INDIRECT},
+    {"adc", SM_INDX},
+    {"adc", SM_IMM},
+    {"adc", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"eor1", SM_ABS_BOOL_BIT},
+    {"dec", SM_DIR_PAGE},
+    {"dec", SM_ABS},
+    {"ldy", SM_IMM},
+    {"plp", SM_IMP},
+    {"mov", SM_IMM_TO_DIR_PAGE},
+    {"bcc", SM_REL},
+    {"jst9", SM_IMP},
+    {"clr4", SM_DIR_PAGE_BIT},
+    {"bbc4", SM_DIR_PAGE_BIT_REL},
+    {"adc", SM_DIR_PAGEX},
+    {"adc", SM_ABSX},
+    {"adc", SM_ABSY},
+    {"adc", SM_INDY},
+    {"adc", SM_IMM_TO_DIR_PAGE},
+    {"adc", SM_IND_PAGE_TO_IND_PAGE},
+    {"sbw", SM_DIR_PAGE},
+    {"dec", SM_DIR_PAGEX},
+    {"dec", SM_ACC},
+    {"tsx", SM_IMP},
+    {"div", SM_IMP},
+    {"xcn", SM_ACC},
+    {"cli", SM_IMP},
+    {"jsta", SM_IMP},
+    {"set5", SM_DIR_PAGE_BIT},
+    {"bbs5", SM_DIR_PAGE_BIT_REL},
+    {"sbc", SM_DIR_PAGE},
+    {"sbc", SM_ABS},
+    {"sbc", SM_INDIRECT},
+    {"sbc", SM_INDX},
+    {"sbc", SM_IMM},
+    {"sbc", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"ld1", SM_ABS_BOOL_BIT},
+    {"inc", SM_DIR_PAGE},
+    {"inc", SM_ABS},
+    {"cpy", SM_IMM},
+    {"pla", SM_IMP},
+    {"sta", SM_INDIRECT_INC},
+    {"bcs", SM_REL},
+    {"jstb", SM_IMP},
+    {"clr5", SM_DIR_PAGE_BIT},
+    {"bbc5", SM_DIR_PAGE_BIT_REL},
+    {"sbc", SM_DIR_PAGEX},
+    {"sbc", SM_ABSX},
+    {"sbc", SM_ABSY},
+    {"sbc", SM_INDY},
+    {"sbc", SM_IMM_TO_DIR_PAGE},
+    {"sbc", SM_IND_PAGE_TO_IND_PAGE},
+    {"ldw", SM_DIR_PAGE},
+    {"inc", SM_DIR_PAGEX},
+    {"inc", SM_ACC},
+    {"txs", SM_IMP},
+    {"das", SM_IMP},
+    {"lda", SM_INDIRECT_INC},
+    {"sei", SM_IMP},
+    {"jstc", SM_IMP},
+    {"set6", SM_DIR_PAGE_BIT},
+    {"bbs6", SM_DIR_PAGE_BIT_REL},
+    {"sta", SM_DIR_PAGE},
+    {"sta", SM_ABS},
+    {"sta", SM_INDIRECT},
+    {"sta", SM_INDX},
+    {"cpx", SM_IMM},
+    {"stx", SM_ABS},
+    {"st1", SM_ABS_BOOL_BIT},
+    {"sty", SM_DIR_PAGE},
+    {"sty", SM_ABS},
+    {"ldx", SM_IMM},
+    {"plx", SM_IMP},
+    {"mul", SM_IMP},
+    {"bne", SM_REL},
+    {"jstd", SM_IMP},
+    {"clr6", SM_DIR_PAGE_BIT},
+    {"bbc6", SM_DIR_PAGE_BIT_REL},
+    {"sta", SM_DIR_PAGEX},
+    {"sta", SM_ABSX},
+    {"sta", SM_ABSY},
+    {"sta", SM_INDY},
+    {"stx", SM_DIR_PAGE},
+    {"stx", SM_DIR_PAGEY},
+    {"stw", SM_DIR_PAGE},
+    {"sty", SM_DIR_PAGEX},
+    {"dey", SM_IMP},
+    {"tya", SM_IMP},
+    {"cbne", SM_DIR_PAGEX},
+    {"daa", SM_IMP},
+    {"clv", SM_IMP},
+    {"jste", SM_IMP},
+    {"set7", SM_DIR_PAGE_BIT},
+    {"bbs7", SM_DIR_PAGE_BIT_REL},
+    {"lda", SM_DIR_PAGE},
+    {"lda", SM_ABS},
+    {"lda", SM_INDIRECT},
+    {"lda", SM_INDX},
+    {"lda", SM_IMM},
+    {"ldx", SM_ABS},
+    {"not1", SM_ABS_BOOL_BIT},
+    {"ldy", SM_DIR_PAGE},
+    {"ldy", SM_ABS},
+    {"notc", SM_IMP},
+    {"ply", SM_IMP},
+    {"sleep", SM_IMP},
+    {"beq", SM_REL},
+    {"jstf", SM_IMP},
+    {"clr7", SM_DIR_PAGE_BIT},
+    {"bbc7", SM_DIR_PAGE_BIT_REL},
+    {"lda", SM_DIR_PAGEX},
+    {"lda", SM_ABSX},
+    {"lda", SM_ABSY},
+    {"lda", SM_INDY},
+    {"ldx", SM_DIR_PAGE},
+    {"ldx", SM_DIR_PAGEY},
+    {"mov", SM_DIR_PAGE_TO_DIR_PAGE},
+    {"ldy", SM_DIR_PAGEX},
+    {"iny", SM_IMP},
+    {"tay", SM_IMP},
+    {"dbnz", SM_Y},
+    {"stop", SM_IMP},
+};
+
+// indexed by the bit set in addressing_mode_t
+static const char *const cpu_mode_names[] = {
+    "abs",      "indx",     "absx",     "absy",         "ind",
+    "absx_l",   "abs_l",    "acc",      "blk",          "indx_dir",
+    "zbkx_dir", "zbky_dir", "indy_dir", "indy_dir_l",   "ind_dir_l",
+    "ind_dir",  "dir",      "imm",      "imp",          "pc_rel_l",
+    "pc_rel",   "stk",      "stk_rel",  "stk_rel_indy",
+};
+
+// indexed by the bit set in spc_addressing_mode_t
+static const char *const spc_mode_names[] = {
+    "dir_page",
+    "dir_pagex",
+    "dir_pagey",
+    "indirect",
+    "indirect_inc",
+    "dir_page_to_dir_page",
+    "ind_page_to_ind_page",
+    "imm_to_dir_page",
+    "dir_page_bit",
+    "dir_page_bit_rel",
+    "abs_bool_bit",
+    "abs",
+    "abs_indx",
+    "absx",
+    "absy",
+    "indx",
+    "indy",
+    "rel",
+    "imm",
+    "acc",
+    "imp",
+    "y",
+    "abs_bool_bit_inv",
+};
+
+void profiler_enable(snes_t *snes, bool enabled) {
+    memset(&snes->profiler, 0, sizeof(profiler_t));
+    snes->profiler.enabled = enabled;
+}
+
+void profiler_count_cpu(snes_t *snes, uint8_t opcode, uint8_t flags,
+                        uint64_t ns) {
+    snes->profiler.cpu[flags][opcode].count++;
+    snes->profiler.cpu[flags][opcode].ns += ns;
+}
+
+void profiler_count_spc(snes_t *snes, uint8_t opcode, uint64_t ns) {
+    snes->profiler.spc[opcode].count++;
+    snes->profiler.spc[opcode].ns += ns;
+}
+
+const char *profiler_cpu_name(uint8_t opcode) {
+    return cpu_opcodes[opcode].name;
+}
+
+const char *profiler_cpu_mode(uint8_t opcode) {
+    // opcodes the CPU doesn't implement have no mode
+    if (cpu_opcodes[opcode].mode == 0)
+        return "";
+    return cpu_mode_names[__builtin_ctz(cpu_opcodes[opcode].mode)];
+}
+
+const char *profiler_spc_name(uint8_t opcode) {
+    return spc_opcodes[opcode].name;
+}
+
+const char *profiler_spc_mode(uint8_t opcode) {
+    return spc_mode_names[__builtin_ctz(spc_opcodes[opcode].mode)];
+}
+
+static void write_row(FILE *f, const char *core, uint8_t opcode,
+                      const char *name, const char *mode, const char *flags,
+                      profile_entry_t *entry) {
+    fprintf(f, "%s,0x%02x,%s,%s,%s,%llu,%llu,%.2f\n", core, opcode, name, mode,
+            flags, (unsigned long long)entry->count,
+            (unsigned long long)entry->ns, (double)entry->ns / entry->count);
+}
+
+bool profiler_write_csv(snes_t *snes, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Could not open %s for writing", path);
+        return false;
+    }
+    fprintf(f, "core,opcode,name,mode,m,x,e,count,total_ns,ns_per_exec\n");
+    for (uint32_t flags = 0; flags < 8; flags++) {
+        char flag_columns[8];
+        snprintf(flag_columns, sizeof(flag_columns), "%d,%d,%d", flags & 1,
+                 (flags >> 1) & 1, (flags >> 2) & 1);
+        for (uint32_t i = 0; i < 0x100; i++) {
+            profile_entry_t *entry = &snes->profiler.cpu[flags][i];
+            if (entry->count == 0)
+                continue;
+            write_row(f, "cpu", i, profiler_cpu_name(i), profiler_cpu_mode(i),
+                      flag_columns, entry);
+        }
+    }
+    for (uint32_t i = 0; i < 0x100; i++) {
+        profile_entry_t *entry = &snes->profiler.spc[i];
+        if (entry->count == 0)
+            continue;
+        write_row(f, "spc", i, profiler_spc_name(i), profiler_spc_mode(i), ",,",
+                  entry);
+    }
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "types.h"
+
+// clears everything counted so far
+EXTERNC void profiler_enable(snes_t *snes, bool enabled);
+// flags are those of cpu_flags, the first index into profiler_t.cpu
+EXTERNC void profiler_count_cpu(snes_t *snes, uint8_t opcode, uint8_t flags,
+                                uint64_t ns);
+EXTERNC void profiler_count_spc(snes_t *snes, uint8_t opcode, uint64_t ns);
+
+EXTERNC const char *profiler_cpu_name(uint8_t opcode);
+EXTERNC const char *profiler_cpu_mode(uint8_t opcode);
+EXTERNC const char *profiler_spc_name(uint8_t opcode);
+EXTERNC const char *profiler_spc_mode(uint8_t opcode);
+
+// one row per core, opcode and flag combination that was executed
+EXTERNC bool profiler_write_csv(snes_t *snes, const char *path);
+
+#endif
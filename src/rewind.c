@@ -0,0 +1,240 @@
+#include "rewind.h"
+#include "types.h"
+
+// Every pushed frame is a save state, XORed against the most recent keyframe
+// and run length encoded over 64-bit words. Between two frames only a small
+// part of the machine changes, so most words XOR to zero and the runs stay
+// short. Keyframes are stored the same way against an all zero state.
+//
+// Entries live back to back in one byte ring of a fixed size. Once it is full
+// the oldest keyframe is dropped together with the deltas that depend on it.
+//
+// Encoded entries are a sequence of runs, each a uint32_t count of unchanged
+// words, a uint32_t count of changed words, then the XORed changed words.
+
+#define REWIND_MAX_ENTRIES 0x10000
+
+typedef struct {
+    uint32_t offset, size;
+    uint32_t keyframe_seq;
+} rewind_entry_t;
+
+struct rewind_t {
+    uint8_t *buffer;
+    uint32_t buffer_size;
+
+    rewind_entry_t entries[REWIND_MAX_ENTRIES];
+    // sequence numbers of the oldest entry and of the next one to be pushed,
+    // entries are found at seq % REWIND_MAX_ENTRIES
+    uint32_t first_seq, next_seq;
+
+    uint32_t keyframe_interval;
+    // decoded copy of the keyframe new deltas are encoded against
+    uint64_t *keyframe;
+    uint32_t keyframe_seq;
+    bool keyframe_valid;
+
+    uint32_t state_size, state_words;
+    uint64_t *state;
+    uint8_t *packed;
+};
+
+static rewind_entry_t *get_entry(rewind_t *rewind, uint32_t seq) {
+    return &rewind->entries[seq % REWIND_MAX_ENTRIES];
+}
+
+static uint32_t pack(const uint64_t *state, const uint64_t *base,
+                     uint32_t words, uint8_t *out) {
+    uint8_t *start = out;
+    uint32_t i = 0;
+    while (i < words) {
+        uint32_t same = 0, changed = 0;
+        while (i < words && state[i] == base[i]) {
+            same++;
+            i++;
+        }
+        uint64_t *literals = (uint64_t *)(out + 2 * sizeof(uint32_t));
+        while (i < words && state[i] != base[i]) {
+            literals[changed++] = state[i] ^ base[i];
+            i++;
+        }
+        memcpy(out, &same, sizeof(uint32_t));
+        memcpy(out + sizeof(uint32_t), &changed, sizeof(uint32_t));
+        out += 2 * sizeof(uint32_t) + changed * sizeof(uint64_t);
+    }
+    return out - start;
+}
+
+// XORs a packed entry into state
+static void unpack(const uint8_t *in, uint32_t size, uint64_t *state) {
+    const uint8_t *end = in + size;
+    uint64_t *word = state;
+    while (in < end) {
+        uint32_t same, changed;
+        memcpy(&same, in, sizeof(uint32_t));
+        memcpy(&changed, in + sizeof(uint32_t), sizeof(uint32_t));
+        in += 2 * sizeof(uint32_t);
+        word += same;
+        const uint64_t *literals = (const uint64_t *)in;
+        for (uint32_t i = 0; i < changed; i++) {
+            word[i] ^= literals[i];
+        }
+        word += changed;
+        in += changed * sizeof(uint64_t);
+    }
+}
+
+static void drop_oldest(rewind_t *rewind) {
+    if (get_entry(rewind, rewind->first_seq)->keyframe_seq ==
+        rewind->keyframe_seq) {
+        rewind->keyframe_valid = false;
+    }
+    rewind->first_seq++;
+    // deltas without their keyframe are useless
+    while (rewind->first_seq != rewind->next_seq &&
+           get_entry(rewind, rewind->first_seq)->keyframe_seq !=
+               rewind->first_seq) {
+        rewind->first_seq++;
+    }
+}
+
+// finds room for size bytes after the newest entry, dropping old entries in
+// the way, and returns the offset
+static uint32_t make_room(rewind_t *rewind, uint32_t size) {
+    if (rewind->first_seq == rewind->next_seq)
+        return 0;
+    if (rewind->next_seq - rewind->first_seq == REWIND_MAX_ENTRIES)
+        drop_oldest(rewind);
+
+    rewind_entry_t *newest = get_entry(rewind, rewind->next_seq - 1);
+    uint32_t offset = newest->offset + newest->size;
+    bool wrapped = offset + size > rewind->buffer_size;
+    while (rewind->first_seq != rewind->next_seq) {
+        rewind_entry_t *oldest = get_entry(rewind, rewind->first_seq);
+        // when wrapping around, everything past the newest entry goes first
+        // so that the ring stays in order
+        if (wrapped && oldest->offset >= offset) {
+            drop_oldest(rewind);
+            continue;
+        }
+        uint32_t start = wrapped ? 0 : offset;
+        if (oldest->offset < start + size &&
+            start < oldest->offset + oldest->size) {
+            drop_oldest(rewind);
+            continue;
+        }
+        break;
+    }
+    return wrapped ? 0 : offset;
+}
+
+static void resize(rewind_t *rewind, uint32_t state_size) {
+    rewind_clear(rewind);
+    free(rewind->keyframe);
+    free(rewind->state);
+    free(rewind->packed);
+    rewind->state_size = state_size;
+    rewind->state_words = (state_size + 7) / 8;
+    rewind->keyframe = calloc(rewind->state_words, sizeof(uint64_t));
+    rewind->state = calloc(rewind->state_words, sizeof(uint64_t));
+    // worst case, every other word changed
+    rewind->packed =
+        malloc(rewind->state_words * (sizeof(uint64_t) + 2 * sizeof(uint32_t)) +
+               2 * sizeof(uint32_t));
+}
+
+rewind_t *rewind_create(uint32_t budget, uint32_t keyframe_interval) {
+    rewind_t *rewind = calloc(1, sizeof(rewind_t));
+    if (rewind == NULL)
+        return NULL;
+    rewind->buffer = malloc(budget);
+    if (rewind->buffer == NULL) {
+        free(rewind);
+        return NULL;
+    }
+    rewind->buffer_size = budget;
+    rewind->keyframe_interval = MAX(keyframe_interval, 1);
+    return rewind;
+}
+
+void rewind_destroy(rewind_t *rewind) {
+    if (rewind == NULL)
+        return;
+    free(rewind->buffer);
+    free(rewind->keyframe);
+    free(rewind->state);
+    free(rewind->packed);
+    free(rewind);
+}
+
+void rewind_clear(rewind_t *rewind) {
+    rewind->first_seq = rewind->next_seq = 0;
+    rewind->keyframe_valid = false;
+}
+
+uint32_t rewind_frames(rewind_t *rewind) {
+    return rewind->next_seq - rewind->first_seq;
+}
+
+bool rewind_push(rewind_t *rewind, snes_t *snes) {
+    uint32_t state_size = snes_save_state_size(snes);
+    if (state_size != rewind->state_size)
+        resize(rewind, state_size);
+    snes_save_state(snes, (uint8_t *)rewind->state);
+
+    bool keyframe =
+        !rewind->keyframe_valid ||
+        rewind->next_seq - rewind->keyframe_seq >= rewind->keyframe_interval;
+    uint32_t size, offset;
+    while (true) {
+        if (keyframe) {
+            memset(rewind->keyframe, 0, rewind->state_words * 8);
+            rewind->keyframe_valid = false;
+        }
+        size = pack(rewind->state, rewind->keyframe, rewind->state_words,
+                    rewind->packed);
+        if (size > rewind->buffer_size)
+            return false;
+        offset = make_room(rewind, size);
+        // making room may have thrown out the keyframe this delta needs
+        if (keyframe || rewind->keyframe_valid)
+            break;
+        keyframe = true;
+    }
+
+    memcpy(rewind->buffer + offset, rewind->packed, size);
+    if (keyframe) {
+        memcpy(rewind->keyframe, rewind->state, rewind->state_words * 8);
+        rewind->keyframe_seq = rewind->next_seq;
+        rewind->keyframe_valid = true;
+    }
+    *get_entry(rewind, rewind->next_seq) =
+        (rewind_entry_t){offset, size, rewind->keyframe_seq};
+    rewind->next_seq++;
+    return true;
+}
+
+bool rewind_pop(rewind_t *rewind, snes_t *snes) {
+    if (rewind->first_seq == rewind->next_seq)
+        return false;
+    rewind->next_seq--;
+    rewind_entry_t *entry = get_entry(rewind, rewind->next_seq);
+    if (!rewind->keyframe_valid ||
+        rewind->keyframe_seq != entry->keyframe_seq) {
+        rewind_entry_t *keyframe = get_entry(rewind, entry->keyframe_seq);
+        memset(rewind->keyframe, 0, rewind->state_words * 8);
+        unpack(rewind->buffer + keyframe->offset, keyframe->size,
+               rewind->keyframe);
+        rewind->keyframe_seq = entry->keyframe_seq;
+        rewind->keyframe_valid = true;
+    }
+    memcpy(rewind->state, rewind->keyframe, rewind->state_words * 8);
+    if (entry->keyframe_seq != rewind->next_seq) {
+        unpack(rewind->buffer + entry->offset, entry->size, rewind->state);
+    } else {
+        // the keyframe itself is gone now, new deltas need a fresh one
+        rewind->keyframe_valid = false;
+    }
+    return snes_load_state(snes, (const uint8_t *)rewind->state,
+                           rewind->state_size);
+}
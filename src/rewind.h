@@ -0,0 +1,24 @@
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include "snes.h"
+#include "types.h"
+
+typedef struct rewind_t rewind_t;
+
+// budget is the total number of bytes kept for rewinding, a keyframe is stored
+// every keyframe_interval pushes
+EXTERNC rewind_t *rewind_create(uint32_t budget, uint32_t keyframe_interval);
+EXTERNC void rewind_destroy(rewind_t *rewind);
+EXTERNC void rewind_clear(rewind_t *rewind);
+// number of frames that can currently be rewound
+EXTERNC uint32_t rewind_frames(rewind_t *rewind);
+
+// records the current state of the machine, dropping the oldest frames when
+// the budget is exhausted
+EXTERNC bool rewind_push(rewind_t *rewind, snes_t *snes);
+// restores the most recently pushed state and forgets it, returns false if
+// there is nothing left to rewind
+EXTERNC bool rewind_pop(rewind_t *rewind, snes_t *snes);
+
+#endif
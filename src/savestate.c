@@ -0,0 +1,138 @@
+#include "cpu_blocks.h"
+#include "cpu_mmu.h"
+#include "ppu.h"
+#include "snes.h"
+#include "types.h"
+#include <stddef.h>
+
+// A save state is a header followed by the raw bytes of the emulated part of
+// cpu_t, ppu_t and spc_t, then the cart's SRAM. The debugger fields at the end
+// of cpu_t and spc_t (history rings, breakpoints, frontend settings) are left
+// out, so a state is a few hundred kilobytes and saving or loading is a
+// handful of memcpys.
+//
+// Since the structs are stored as is, a state only loads into a build with
+// the same layout. The sizes in the header catch most mismatches, bump the
+// version whenever a field changes meaning without changing size.
+
+#define SAVE_STATE_MAGIC 0x54535357 // "WSST"
+#define SAVE_STATE_VERSION 2
+
+#define CPU_STATE_SIZE offsetof(cpu_t, file_name)
+#define PPU_STATE_SIZE sizeof(ppu_t)
+#define SPC_STATE_SIZE offsetof(spc_t, breakpoints)
+// more SRAM than any cart has
+#define MAX_SRAM_SIZE 0x100000
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t cpu_size, ppu_size, spc_size;
+    uint32_t rom_size, sram_size;
+    uint32_t mode;
+} save_state_header_t;
+
+uint32_t snes_save_state_size(snes_t *snes) {
+    return sizeof(save_state_header_t) + CPU_STATE_SIZE + PPU_STATE_SIZE +
+           SPC_STATE_SIZE + snes->cpu.memory.sram_size;
+}
+
+bool snes_save_state_size_valid(uint32_t size) {
+    uint32_t base = sizeof(save_state_header_t) + CPU_STATE_SIZE +
+                    PPU_STATE_SIZE + SPC_STATE_SIZE;
+    return size >= base && size - base <= MAX_SRAM_SIZE;
+}
+
+uint32_t snes_save_state(snes_t *snes, uint8_t *buffer) {
+    save_state_header_t header = {
+        .magic = SAVE_STATE_MAGIC,
+        .version = SAVE_STATE_VERSION,
+        .cpu_size = CPU_STATE_SIZE,
+        .ppu_size = PPU_STATE_SIZE,
+        .spc_size = SPC_STATE_SIZE,
+        .rom_size = snes->cpu.memory.rom_size,
+        .sram_size = snes->cpu.memory.sram_size,
+        .mode = snes->cpu.memory.mode,
+    };
+    // N and Z only live in p while it is stored
+    snes->cpu.p = cpu_get_p(snes);
+    snes->spc.p = spc_get_p(snes);
+    uint8_t *out = buffer;
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, &snes->cpu, CPU_STATE_SIZE);
+    out += CPU_STATE_SIZE;
+    memcpy(out, &snes->ppu, PPU_STATE_SIZE);
+    out += PPU_STATE_SIZE;
+    memcpy(out, &snes->spc, SPC_STATE_SIZE);
+    out += SPC_STATE_SIZE;
+    memcpy(out, snes->cpu.memory.sram, snes->cpu.memory.sram_size);
+    out += snes->cpu.memory.sram_size;
+    return out - buffer;
+}
+
+bool snes_load_state(snes_t *snes, const uint8_t *buffer, uint32_t size) {
+    save_state_header_t header;
+    if (size < sizeof(header)) {
+        log_message(LOG_LEVEL_WARNING, "Save state of %d bytes is truncated",
+                    size);
+        return false;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    if (header.magic != SAVE_STATE_MAGIC ||
+        header.version != SAVE_STATE_VERSION) {
+        log_message(LOG_LEVEL_WARNING,
+                    "Not a save state or unsupported version %d",
+                    header.version);
+        return false;
+    }
+    if (header.cpu_size != CPU_STATE_SIZE ||
+        header.ppu_size != PPU_STATE_SIZE ||
+        header.spc_size != SPC_STATE_SIZE) {
+        log_message(LOG_LEVEL_WARNING,
+                    "Save state was made by a build with a different layout");
+        return false;
+    }
+    if (header.rom_size != snes->cpu.memory.rom_size ||
+        header.sram_size != snes->cpu.memory.sram_size ||
+        header.mode != snes->cpu.memory.mode) {
+        log_message(LOG_LEVEL_WARNING,
+                    "Save state belongs to a different cart");
+        return false;
+    }
+    if (size < snes_save_state_size(snes)) {
+        log_message(LOG_LEVEL_WARNING, "Save state of %d bytes is truncated",
+                    size);
+        return false;
+    }
+
+    // the cart buffers belong to this machine, not to the state
+    uint8_t *rom = snes->cpu.memory.rom;
+    uint8_t *sram = snes->cpu.memory.sram;
+    const uint8_t *in = buffer + sizeof(header);
+    // host caches built from memory the state leaves as it is stay valid,
+    // which is most of it when states are loaded back to back
+    bool fast_rom;
+    memcpy(&fast_rom, in + offsetof(cpu_t, memory.fast_rom), sizeof(fast_rom));
+    cpu_blocks_invalidate_changed(snes, in + offsetof(cpu_t, memory.ram),
+                                  fast_rom);
+    ppu_invalidate_changed_tiles(snes,
+                                 in + CPU_STATE_SIZE + offsetof(ppu_t, vram));
+    memcpy(&snes->cpu, in, CPU_STATE_SIZE);
+    in += CPU_STATE_SIZE;
+    memcpy(&snes->ppu, in, PPU_STATE_SIZE);
+    in += PPU_STATE_SIZE;
+    memcpy(&snes->spc, in, SPC_STATE_SIZE);
+    in += SPC_STATE_SIZE;
+    snes->cpu.memory.rom = rom;
+    snes->cpu.memory.sram = sram;
+    memcpy(sram, in, snes->cpu.memory.sram_size);
+    cpu_set_p(snes, snes->cpu.p);
+    spc_set_p(snes, snes->spc.p);
+    mmu_build_access_clocks(snes);
+    // a recorded idle loop belongs to the timeline that was left
+    snes->cpu_idle.state = CPU_IDLE_OFF;
+    ppu_build_palette(snes);
+    ppu_invalidate_windows(snes);
+    return true;
+}
@@ -0,0 +1,420 @@
+#include "snes.h"
+#include "apu.h"
+#include "breakpoints.h"
+#include "cpu.h"
+#include "cpu_blocks.h"
+#include "cpu_jit.h"
+#include "cpu_mmu.h"
+#include "ppu.h"
+#include "spc.h"
+#include "timing.h"
+#include "types.h"
+
+#define get16bits(d)                                                           \
+    ((((uint32_t)(((const uint8_t *)(d))[1])) << 8) +                          \
+     (uint32_t)(((const uint8_t *)(d))[0]))
+// source: https://www.azillionmonkeys.com/qed/hash.html
+uint32_t super_fast_hash(const char *data, uint32_t len) {
+    uint32_t hash = len, tmp;
+    int rem;
+
+    if (len <= 0 || data == NULL)
+        return 0;
+
+    rem = len & 3;
+    len >>= 2;
+
+    /* Main loop */
+    for (; len > 0; len--) {
+        hash += get16bits(data);
+        tmp = (get16bits(data + 2) << 11) ^ hash;
+        hash = (hash << 16) ^ tmp;
+        data += 2 * sizeof(uint16_t);
+        hash += hash >> 11;
+    }
+
+    /* Handle end cases */
+    switch (rem) {
+    case 3:
+        hash += get16bits(data);
+        hash ^= hash << 16;
+        hash ^= ((signed char)data[sizeof(uint16_t)]) << 18;
+        hash += hash >> 11;
+        break;
+    case 2:
+        hash += get16bits(data);
+        hash ^= hash << 11;
+        hash += hash >> 17;
+        break;
+    case 1:
+        hash += (signed char)*data;
+        hash ^= hash << 10;
+        hash += hash >> 1;
+    }
+
+    /* Force "avalanching" of final 127 bits */
+    hash ^= hash << 3;
+    hash += hash >> 5;
+    hash ^= hash << 4;
+    hash += hash >> 17;
+    hash ^= hash << 25;
+    hash += hash >> 6;
+
+    return hash;
+}
+#undef get16bits
+
+static const cart_hash_t rom_hash_lookup[] = {
+    {"Super Mario World", 0x270efb15, LOROM, false},
+    {"Super Mario All Stars", 0x2272b1cd, LOROM, false},
+    {"SNES CPU Test", 0x69d6bf43, LOROM, false},
+    {"SNES CPU Test Basic", 0x7b3f6de6, LOROM, false},
+    {"SNES SPC Test", 0xb9a70b6a, LOROM, false},
+    {"Earthbound", 0xb4975b60, HIROM, false},
+    {"Puzzle Bobble", 0xc1a14c71, LOROM, false},
+    {"Control Test Auto", 0xdd642b6a, LOROM, false},
+    {"Control Test Simple", 0xc0467d5c, LOROM, false},
+    {"Donkey Kong Country", 0xc1a8ad4c, HIROM, false},
+    {"Aging Test ROM", 0x35a123c5, LOROM, false},
+    {"Burn In Test ROM", 0x660892f8, LOROM, false},
+    {"Harvest Moon", 0xe39158fd, LOROM, false},
+    {"The Legend Of Zelda: A Link To The Past", 0x5c289c1c, LOROM, false},
+    {"Mega Man X", 0xcb111768, LOROM, false},
+    {"Chrono Trigger", 0x12183f9, HIROM, false},
+    {"Kirby's Dream Course", 0x859f36cd, LOROM, false},
+};
+
+snes_t *snes_create(void) { return calloc(1, sizeof(snes_t)); }
+
+void snes_destroy(snes_t *snes) {
+    if (snes == NULL)
+        return;
+    snes_unload_rom(snes);
+    breakpoint_index_free(&snes->cpu.breakpoints);
+    breakpoint_index_free(&snes->spc.breakpoints);
+    free(snes->run_ahead_state);
+    free(snes);
+}
+
+bool snes_load_rom(snes_t *snes, const uint8_t *data, uint32_t size) {
+    // problem: SNES roms are in one of three possible layouts and it's not
+    // documented in the rom which one it is
+    // solution: hardcode hashes of the roms
+    uint32_t hash_value = super_fast_hash((const char *)data, size);
+    log_message(LOG_LEVEL_INFO, "ROM hash value: 0x%x", hash_value);
+    for (uint32_t i = 0; i < ARRAYSIZE(rom_hash_lookup); i++) {
+        if (rom_hash_lookup[i].hash == hash_value) {
+            log_message(LOG_LEVEL_INFO, "Identified cart as %s",
+                        rom_hash_lookup[i].name);
+            snes->cpu_idle.disabled = rom_hash_lookup[i].no_idle_loops;
+            return snes_load_rom_with_mode(snes, data, size,
+                                           rom_hash_lookup[i].mode);
+        }
+    }
+
+    log_message(LOG_LEVEL_WARNING, "Cart not identified, hash value is 0x%x",
+                hash_value);
+    return false;
+}
+
+bool snes_load_rom_file(snes_t *snes, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Could not open %s", path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    uint32_t file_size = ftell(f);
+    // skip the copier header some dumps carry in front of the ROM
+    if (file_size % 1024 != 0) {
+        fseek(f, 512, SEEK_SET);
+    } else {
+        fseek(f, 0, SEEK_SET);
+    }
+
+    uint8_t *file_to_hash = calloc(file_size, 1);
+    fread(file_to_hash, 1, file_size, f);
+    fclose(f);
+    bool identified = snes_load_rom(snes, file_to_hash, file_size);
+    free(file_to_hash);
+    return identified;
+}
+
+bool snes_load_rom_with_mode(snes_t *snes, const uint8_t *data, uint32_t size,
+                             memory_map_mode_t mode) {
+    uint32_t header_offset;
+    switch (mode) {
+    case LOROM:
+        header_offset = 0x7fc0;
+        break;
+    case HIROM:
+        header_offset = 0xffc0;
+        break;
+    case EXHIROM:
+        header_offset = 0x40ffc0;
+        break;
+    default:
+        UNREACHABLE_SWITCH(mode);
+    }
+    if (size < header_offset + 0x20) {
+        log_message(LOG_LEVEL_WARNING,
+                    "ROM of size 0x%x is too small to hold a header at 0x%x",
+                    size, header_offset);
+        return false;
+    }
+    const uint8_t *header = data + header_offset;
+
+    log_message(LOG_LEVEL_INFO, "Cartridge type: %d", header[0x16]);
+    log_message(LOG_LEVEL_INFO, "Cart size: %d kilobytes; %d banks",
+                size / 1024, size / 0x10000);
+    log_message(LOG_LEVEL_INFO, "ROM size: %d kilobytes",
+                (uint32_t)pow(2, header[0x17]));
+    log_message(LOG_LEVEL_INFO, "RAM size: %d kilobytes",
+                (uint32_t)pow(2, (double)(header[0x18])));
+
+    snes_unload_rom(snes);
+    snes->cpu.memory.coprocessor = header[0x16] >> 8;
+    snes->cpu.memory.rom_size = size; // pow(2, header[0x17]) * 1024;
+    snes->cpu.memory.rom = calloc(snes->cpu.memory.rom_size, 1);
+    if (header[0x16] == 0x00 || ((header[0x16] & 0xf) == 0x3) ||
+        ((header[0x16] & 0xf) == 0x6)) {
+        // since the size of the cart RAM is calculated with 1 << N, it is
+        // impossible to specify for the ram to not exist using just this field.
+        // Therefore, information is taken from the cart type to establish if
+        // the cart should have RAM or not
+        snes->cpu.memory.sram_size = 0;
+    } else {
+        snes->cpu.memory.sram_size = pow(2, header[0x18]) * 1024;
+        snes->cpu.memory.sram = calloc(snes->cpu.memory.sram_size, 1);
+        for (uint32_t i = 0; i < snes->cpu.memory.sram_size; i++) {
+            snes->cpu.memory.sram[i] = 0xff;
+        }
+    }
+    memcpy(snes->cpu.memory.rom, data, MIN(size, snes->cpu.memory.rom_size));
+    snes->cpu.memory.mode = mode;
+    snes->block_cache = cpu_blocks_create();
+    snes->cpu_jit.cache = cpu_jit_create();
+    snes->cpu_idle.state = CPU_IDLE_OFF;
+    ppu_invalidate_all_tiles(snes);
+    ppu_build_palette(snes);
+    ppu_invalidate_windows(snes);
+    mmu_build_pages(snes);
+    cpu_reset(snes);
+    spc_reset(snes);
+    snes->ppu.v_timer_target = 0x1ff;
+    snes->ppu.h_timer_target = 0x1ff;
+    return true;
+}
+
+void snes_unload_rom(snes_t *snes) {
+    free(snes->cpu.memory.sram);
+    free(snes->cpu.memory.rom);
+    snes->cpu.memory.sram = NULL;
+    snes->cpu.memory.rom = NULL;
+    snes->cpu.memory.sram_size = 0;
+    snes->cpu.memory.rom_size = 0;
+    cpu_blocks_destroy(snes->block_cache);
+    snes->block_cache = NULL;
+    cpu_jit_destroy(snes->cpu_jit.cache);
+    snes->cpu_jit.cache = NULL;
+    mmu_build_pages(snes);
+}
+
+static void step_dot(snes_t *snes) {
+    snes->cpu.remaining_clocks += CYCLES_PER_DOT;
+    snes->ppu.remaining_clocks += CYCLES_PER_DOT;
+    snes->spc.remaining_clocks += CYCLES_PER_DOT * SPC_CLOCK_SCALE;
+    while ((snes->cpu.remaining_clocks > 0 || snes->spc.remaining_clocks > 0) &&
+           snes->cpu.state != STATE_STOPPED) {
+        try_step_cpu(snes);
+        try_step_spc(snes);
+    }
+    try_step_ppu(snes);
+}
+
+// A waiting CPU is stepped every dot only to drop its clocks back to 0, and
+// it's woken up by the PPU
+static bool cpu_asleep(snes_t *snes) {
+    return snes->cpu.waiting && snes->cpu.remaining_clocks == 0;
+}
+
+// Between two PPU events the beam only moves, so the CPU runs through the dots
+// up to the next one in one go, instruction after instruction. The SPC and the
+// beam fall behind and are caught up to the CPU's instruction when it touches
+// them, through the APU ports or the registers that show the beam, and at the
+// end. Both are caught up dot by dot, so everything happens in the same order
+// as when stepping every dot. Returns how many of the dots were run, fewer if
+// the machine stopped or the CPU moved the next event.
+static uint32_t run_cpu_ahead(snes_t *snes, uint32_t dots) {
+    cpu_run_t *run = &snes->cpu_run;
+    int64_t clocks = (int64_t)dots * CYCLES_PER_DOT;
+    snes->spc.remaining_clocks += clocks * SPC_CLOCK_SCALE;
+    run->ppu_dots_owed = dots;
+    run->cut = false;
+    bool ended_early = false;
+    if (!cpu_asleep(snes)) {
+        snes->cpu.remaining_clocks += clocks;
+        run->active = true;
+        while (snes->cpu.remaining_clocks > 0) {
+            run->op_clocks = snes->cpu.remaining_clocks;
+            try_step_cpu(snes);
+            if (run->cut || snes->cpu.state != STATE_RUNNING) {
+                ended_early = true;
+                break;
+            }
+        }
+        run->active = false;
+    }
+
+    if (ended_early) {
+        // the dots after the one the last instruction started on are given
+        // back
+        uint32_t unused =
+            (run->op_clocks + CYCLES_PER_DOT - 1) / CYCLES_PER_DOT - 1;
+        snes->cpu.remaining_clocks -= (int64_t)unused * CYCLES_PER_DOT;
+        snes->spc.remaining_clocks -=
+            (int64_t)unused * CYCLES_PER_DOT * SPC_CLOCK_SCALE;
+        run->ppu_dots_owed -= unused;
+        dots -= unused;
+    }
+    // a machine that stopped runs nothing more on its dot
+    while (snes->spc.remaining_clocks > 0 && snes->cpu.state == STATE_RUNNING) {
+        try_step_spc(snes);
+    }
+    ppu_skip_dots(snes, run->ppu_dots_owed);
+    run->ppu_dots_owed = 0;
+    return dots;
+}
+
+// runs up to and including the next dot the PPU has work at, unless the CPU
+// ends the run before. Returns how many dots were run.
+static uint32_t run_to_event(snes_t *snes, uint32_t max_dots) {
+    uint32_t dots = MIN(ppu_dots_until_event(snes), max_dots);
+    if (dots > 1) {
+        uint32_t ahead = run_cpu_ahead(snes, dots - 1);
+        if (ahead < dots - 1 || snes->cpu.state != STATE_RUNNING)
+            return ahead;
+    }
+    step_dot(snes);
+    return dots;
+}
+
+void snes_run_dots(snes_t *snes, uint32_t dots) {
+    TIMING_ENTER(snes, TIMING_OTHER);
+    uint32_t i = 0;
+    while (i < dots) {
+        switch (snes->cpu.state) {
+        case STATE_STOPPED:
+            // this page intentionally left blank
+            break;
+        case STATE_CPU_STEPPED: {
+            int64_t clocks = -snes->cpu.remaining_clocks + 1;
+            snes->ppu.remaining_clocks += clocks;
+            snes->spc.remaining_clocks += clocks * SPC_CLOCK_SCALE;
+            snes->cpu.remaining_clocks = 1;
+            snes->cpu.state = STATE_STOPPED;
+            try_step_cpu(snes);
+            try_step_ppu(snes);
+            while (snes->spc.remaining_clocks > 0) {
+                try_step_spc(snes);
+            }
+            break;
+        }
+        case STATE_SPC_STEPPED: {
+            // enough master clocks to get the SPC to a positive count
+            int64_t clocks = -snes->spc.remaining_clocks / SPC_CLOCK_SCALE + 1;
+            snes->ppu.remaining_clocks += clocks;
+            snes->cpu.remaining_clocks += clocks;
+            snes->spc.remaining_clocks += clocks * SPC_CLOCK_SCALE;
+            snes->cpu.state = STATE_STOPPED;
+            try_step_spc(snes);
+            try_step_ppu(snes);
+            while (snes->spc.remaining_clocks > 0) {
+                try_step_cpu(snes);
+            }
+            break;
+        }
+        case STATE_RUNNING:
+            i += run_to_event(snes, dots - i);
+            continue;
+        }
+        i++;
+    }
+    TIMING_LEAVE(snes);
+}
+
+void snes_run_frame(snes_t *snes) {
+    // a machine stopped by a breakpoint or the debugger stays where it is
+    if (snes->cpu.state != STATE_RUNNING)
+        return;
+    TIMING_ENTER(snes, TIMING_OTHER);
+    do {
+        run_to_event(snes, UINT32_MAX);
+        // a frame is done once the beam wraps around to the top left again
+    } while (!(snes->ppu.beam_x == 0 && snes->ppu.beam_y == 0) &&
+             snes->cpu.state == STATE_RUNNING);
+    TIMING_LEAVE(snes);
+}
+
+snes_t *snes_clone(snes_t *snes) {
+    snes_t *clone = snes_create();
+    if (clone == NULL)
+        return NULL;
+    clone->cpu_idle.disabled = snes->cpu_idle.disabled;
+    clone->cpu_jit.disabled = snes->cpu_jit.disabled;
+    if (!snes_load_rom_with_mode(clone, snes->cpu.memory.rom,
+                                 snes->cpu.memory.rom_size,
+                                 snes->cpu.memory.mode) ||
+        !snes_run_ahead(snes, clone, 0)) {
+        snes_destroy(clone);
+        return NULL;
+    }
+    return clone;
+}
+
+bool snes_run_ahead(snes_t *snes, snes_t *ahead, uint32_t frames) {
+    uint32_t size = snes_save_state_size(snes);
+    if (ahead->run_ahead_state_size != size) {
+        free(ahead->run_ahead_state);
+        ahead->run_ahead_state = malloc(size);
+        ahead->run_ahead_state_size = 0;
+        if (ahead->run_ahead_state == NULL)
+            return false;
+        ahead->run_ahead_state_size = size;
+    }
+    snes_save_state(snes, ahead->run_ahead_state);
+    bool loaded = snes_load_state(ahead, ahead->run_ahead_state, size);
+    if (!loaded || frames == 0)
+        return loaded;
+
+    // the clone follows snes, which only runs ahead while it is running
+    ahead->cpu.state = STATE_RUNNING;
+
+    // the frames in between only need to be emulated, not drawn
+    ahead->skip_render = true;
+    if (!(ahead->ppu.beam_x == 0 && ahead->ppu.beam_y == 0))
+        snes_run_frame(ahead);
+    for (uint32_t i = 0; i < frames; i++) {
+        ahead->skip_render = i + 1 < frames;
+        snes_run_frame(ahead);
+    }
+    ahead->skip_render = false;
+    return true;
+}
+
+void snes_set_input(snes_t *snes, uint8_t port, uint16_t buttons) {
+    ASSERT(port < 2, "Tried to set input of controller port %d", port);
+    if (port == 0) {
+        snes->cpu.memory.joy1l = buttons;
+    } else {
+        snes->cpu.memory.joy2l = buttons;
+    }
+    snes->cpu.memory.joy_latch_pending = false;
+}
+
+const uint8_t *snes_get_framebuffer(snes_t *snes) { return snes->framebuffer; }
+
+uint32_t snes_read_audio(snes_t *snes, int16_t *out, uint32_t frames) {
+    audio_cb(snes, out, frames);
+    return frames;
+}
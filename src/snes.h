@@ -0,0 +1,76 @@
+#ifndef SNES_H_
+#define SNES_H_
+
+#include "types.h"
+
+// Embedding API of libsnescore. None of these depend on raylib, ImGui or SDL,
+// so the core can be driven by anything that can hand it a ROM image.
+
+// joypad bits as seen through joy1l/joy2l and the auto-joypad registers
+#define SNES_BUTTON_R (1 << 4)
+#define SNES_BUTTON_L (1 << 5)
+#define SNES_BUTTON_X (1 << 6)
+#define SNES_BUTTON_A (1 << 7)
+#define SNES_BUTTON_RIGHT (1 << 8)
+#define SNES_BUTTON_LEFT (1 << 9)
+#define SNES_BUTTON_DOWN (1 << 10)
+#define SNES_BUTTON_UP (1 << 11)
+#define SNES_BUTTON_START (1 << 12)
+#define SNES_BUTTON_SELECT (1 << 13)
+#define SNES_BUTTON_Y (1 << 14)
+#define SNES_BUTTON_B (1 << 15)
+
+EXTERNC uint32_t super_fast_hash(const char *data, uint32_t len);
+
+// machines are independent of each other, nothing is shared between two
+// instances so they may be run from different threads
+EXTERNC snes_t *snes_create(void);
+EXTERNC void snes_destroy(snes_t *snes);
+
+// identifies the cart by hash and resets the machine, returns false if the
+// cart is unknown. The image is copied, the caller keeps ownership of data.
+EXTERNC bool snes_load_rom(snes_t *snes, const uint8_t *data, uint32_t size);
+// reads the image from disk, skipping a copier header if present
+EXTERNC bool snes_load_rom_file(snes_t *snes, const char *path);
+// same as snes_load_rom, for carts missing from the hash table
+EXTERNC bool snes_load_rom_with_mode(snes_t *snes, const uint8_t *data,
+                                     uint32_t size, memory_map_mode_t mode);
+EXTERNC void snes_unload_rom(snes_t *snes);
+
+// steps the machine dot by dot, honoring the stepping state set by the
+// debugger
+EXTERNC void snes_run_dots(snes_t *snes, uint32_t dots);
+// runs until the beam wraps around to the top of the next frame, or until a
+// breakpoint stops the machine. Does nothing unless the machine is running.
+EXTERNC void snes_run_frame(snes_t *snes);
+
+EXTERNC void snes_set_input(snes_t *snes, uint8_t port, uint16_t buttons);
+// 256x224 pixels, 8 bits per channel in R, G, B, A byte order
+EXTERNC const uint8_t *snes_get_framebuffer(snes_t *snes);
+// save states cover everything but the debugger state. A buffer of
+// snes_save_state_size bytes always fits a state of the loaded cart.
+EXTERNC uint32_t snes_save_state_size(snes_t *snes);
+// whether a state of size bytes could be one of this build, for any cart
+EXTERNC bool snes_save_state_size_valid(uint32_t size);
+// returns the number of bytes written
+EXTERNC uint32_t snes_save_state(snes_t *snes, uint8_t *buffer);
+// returns false and leaves the machine untouched if the state doesn't match
+// this build or the loaded cart
+EXTERNC bool snes_load_state(snes_t *snes, const uint8_t *buffer,
+                             uint32_t size);
+
+// a new machine with the same cart and state, NULL if that fails
+EXTERNC snes_t *snes_clone(snes_t *snes);
+// copies the state of snes into ahead, a clone of it, and runs ahead until
+// the end of the current frame plus the given number of frames. Only the last
+// frame is drawn, the framebuffer of ahead then shows what snes will show
+// that many frames from now, given the same input. With 0 frames only the
+// state is copied. snes itself is untouched.
+EXTERNC bool snes_run_ahead(snes_t *snes, snes_t *ahead, uint32_t frames);
+
+// renders interleaved stereo 16-bit samples at SAMPLE_RATE, returns the
+// number of sample frames written
+EXTERNC uint32_t snes_read_audio(snes_t *snes, int16_t *out,
+                                 uint32_t frames);
+
+#endif
@@ -3,7 +3,7 @@
 
 #include "spc_mmu.h"
 
-void spc_reset(void);
-void spc_execute(void);
+void spc_reset(snes_t *snes);
+void spc_execute(snes_t *snes);
 
 #endif
@@ -1,9 +1,6 @@
 #include "spc_instructions.h"
 #include "types.h"
 
-extern cpu_t cpu;
-extern spc_t spc;
-
 static const char *addressing_mode_strings[] = {
     "Direct Page - d",
     "X-Indexed Direct Page - d,X",
@@ -32,220 +29,208 @@ OP(lda) {
     LEGALADDRMODES(SM_IMM | SM_ABS | SM_ABSY | SM_ABSX | SM_DIR_PAGE |
                    SM_DIR_PAGEX | SM_INDIRECT | SM_INDIRECT_INC | SM_INDX |
                    SM_INDY);
-    spc.a = spc_resolve_read(mode);
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    snes->spc.a = spc_resolve_read(snes, mode);
+    spc_set_nz(snes, snes->spc.a);
 }
 
 OP(ldx) {
     LEGALADDRMODES(SM_IMM | SM_DIR_PAGE | SM_DIR_PAGEY | SM_ABS);
-    spc.x = spc_resolve_read(mode);
-    spc_set_status_bit(STATUS_ZERO, spc.x == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.x & 0x80);
+    snes->spc.x = spc_resolve_read(snes, mode);
+    spc_set_nz(snes, snes->spc.x);
 }
 
 OP(ldy) {
     LEGALADDRMODES(SM_IMM | SM_DIR_PAGE | SM_DIR_PAGEX | SM_ABS);
-    spc.y = spc_resolve_read(mode);
-    spc_set_status_bit(STATUS_ZERO, spc.y == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.y & 0x80);
+    snes->spc.y = spc_resolve_read(snes, mode);
+    spc_set_nz(snes, snes->spc.y);
 }
 
 OP(ldw) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint16_t val = spc_read_8(addr);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint16_t val = spc_read_8(snes, addr);
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    val |= spc_read_8(addr) << 8;
-    spc.y = U16_HIBYTE(val);
-    spc.a = U16_LOBYTE(val);
-    spc_set_status_bit(STATUS_NEGATIVE, val & 0x8000);
-    spc_set_status_bit(STATUS_ZERO, val == 0);
+    val |= spc_read_8(snes, addr) << 8;
+    snes->spc.y = U16_HIBYTE(val);
+    snes->spc.a = U16_LOBYTE(val);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, val & 0x8000);
+    spc_set_status_bit(snes, STATUS_ZERO, val == 0);
 }
 
 OP(sta) {
     LEGALADDRMODES(SM_DIR_PAGE | SM_DIR_PAGEX | SM_ABS | SM_ABSX | SM_ABSY |
                    SM_INDIRECT | SM_INDX | SM_INDY | SM_INDIRECT_INC);
-    spc_resolve_write(mode, spc.a);
+    spc_resolve_write(snes, mode, snes->spc.a);
 }
 
 OP(stx) {
     LEGALADDRMODES(SM_ABS | SM_DIR_PAGE | SM_DIR_PAGEY);
-    spc_resolve_write(mode, spc.x);
+    spc_resolve_write(snes, mode, snes->spc.x);
 }
 
 OP(sty) {
     LEGALADDRMODES(SM_ABS | SM_DIR_PAGE | SM_DIR_PAGEX);
-    spc_resolve_write(mode, spc.y);
+    spc_resolve_write(snes, mode, snes->spc.y);
 }
 
 OP(stw) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t addr = spc_resolve_addr(mode);
-    spc_write_8(addr, spc.a);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    spc_write_8(snes, addr, snes->spc.a);
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    spc_write_8(addr, spc.y);
+    spc_write_8(snes, addr, snes->spc.y);
 }
 
 OP(txs) {
     LEGALADDRMODES(SM_IMP);
-    spc.s = spc.x;
+    snes->spc.s = snes->spc.x;
 }
 
 OP(tsx) {
     LEGALADDRMODES(SM_IMP);
-    spc.x = spc.s;
-    spc_set_status_bit(STATUS_ZERO, spc.x == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.x & 0x80);
+    snes->spc.x = snes->spc.s;
+    spc_set_nz(snes, snes->spc.x);
 }
 
 OP(txa) {
     LEGALADDRMODES(SM_IMP);
-    spc.a = spc.x;
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    snes->spc.a = snes->spc.x;
+    spc_set_nz(snes, snes->spc.a);
 }
 
 OP(tax) {
     LEGALADDRMODES(SM_IMP);
-    spc.x = spc.a;
-    spc_set_status_bit(STATUS_ZERO, spc.x == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.x & 0x80);
+    snes->spc.x = snes->spc.a;
+    spc_set_nz(snes, snes->spc.x);
 }
 
 OP(tya) {
     LEGALADDRMODES(SM_IMP);
-    spc.a = spc.y;
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    snes->spc.a = snes->spc.y;
+    spc_set_nz(snes, snes->spc.a);
 }
 
 OP(tay) {
     LEGALADDRMODES(SM_IMP);
-    spc.y = spc.a;
-    spc_set_status_bit(STATUS_ZERO, spc.y == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.y & 0x80);
+    snes->spc.y = snes->spc.a;
+    spc_set_nz(snes, snes->spc.y);
 }
 
 OP(inx) {
     LEGALADDRMODES(SM_IMP);
-    spc.x++;
-    spc_set_status_bit(STATUS_ZERO, spc.x == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.x & 0x80);
+    snes->spc.x++;
+    spc_set_nz(snes, snes->spc.x);
 }
 
 OP(dex) {
     LEGALADDRMODES(SM_IMP);
-    spc.x--;
-    spc_set_status_bit(STATUS_ZERO, spc.x == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.x & 0x80);
+    snes->spc.x--;
+    spc_set_nz(snes, snes->spc.x);
 }
 
 OP(iny) {
     LEGALADDRMODES(SM_IMP);
-    spc.y++;
-    spc_set_status_bit(STATUS_ZERO, spc.y == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.y & 0x80);
+    snes->spc.y++;
+    spc_set_nz(snes, snes->spc.y);
 }
 
 OP(dey) {
     LEGALADDRMODES(SM_IMP);
-    spc.y--;
-    spc_set_status_bit(STATUS_ZERO, spc.y == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.y & 0x80);
+    snes->spc.y--;
+    spc_set_nz(snes, snes->spc.y);
 }
 
 OP(bra) {
     LEGALADDRMODES(SM_REL);
-    spc.pc += (int8_t)spc_next_8();
+    snes->spc.pc += (int8_t)spc_next_8(snes);
 }
 
 OP(beq) {
     LEGALADDRMODES(SM_REL);
-    if (spc_get_status_bit(STATUS_ZERO)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (spc_get_status_bit(snes, STATUS_ZERO)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bne) {
     LEGALADDRMODES(SM_REL);
-    if (!spc_get_status_bit(STATUS_ZERO)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (!spc_get_status_bit(snes, STATUS_ZERO)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bmi) {
     LEGALADDRMODES(SM_REL);
-    if (spc_get_status_bit(STATUS_NEGATIVE)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (spc_get_status_bit(snes, STATUS_NEGATIVE)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bpl) {
     LEGALADDRMODES(SM_REL);
-    if (!spc_get_status_bit(STATUS_NEGATIVE)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (!spc_get_status_bit(snes, STATUS_NEGATIVE)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bcc) {
     LEGALADDRMODES(SM_REL);
-    if (!spc_get_status_bit(STATUS_CARRY)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (!spc_get_status_bit(snes, STATUS_CARRY)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bcs) {
     LEGALADDRMODES(SM_REL);
-    if (spc_get_status_bit(STATUS_CARRY)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (spc_get_status_bit(snes, STATUS_CARRY)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bvs) {
     LEGALADDRMODES(SM_REL);
-    if (spc_get_status_bit(STATUS_OVERFLOW)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (spc_get_status_bit(snes, STATUS_OVERFLOW)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(bvc) {
     LEGALADDRMODES(SM_REL);
-    if (!spc_get_status_bit(STATUS_OVERFLOW)) {
-        spc.pc += (int8_t)spc_next_8();
+    if (!spc_get_status_bit(snes, STATUS_OVERFLOW)) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 #define OP_BBS(x)                                                              \
     OP(bbs##x) {                                                               \
         LEGALADDRMODES(SM_DIR_PAGE_BIT_REL);                                   \
-        uint8_t val = spc_resolve_read(SM_DIR_PAGE);                           \
+        uint8_t val = spc_resolve_read(snes, SM_DIR_PAGE);                     \
         if (val & (1 << x)) {                                                  \
-            spc.pc += (int8_t)spc_next_8();                                    \
+            snes->spc.pc += (int8_t)spc_next_8(snes);                          \
         } else {                                                               \
-            spc.pc++;                                                          \
+            snes->spc.pc++;                                                    \
         }                                                                      \
     }
 OP_BBS(0);
@@ -261,11 +246,11 @@ OP_BBS(7);
 #define OP_BBC(x)                                                              \
     OP(bbc##x) {                                                               \
         LEGALADDRMODES(SM_DIR_PAGE_BIT_REL);                                   \
-        uint8_t val = spc_resolve_read(SM_DIR_PAGE);                           \
+        uint8_t val = spc_resolve_read(snes, SM_DIR_PAGE);                     \
         if (val & (1 << x)) {                                                  \
-            spc.pc++;                                                          \
+            snes->spc.pc++;                                                    \
         } else {                                                               \
-            spc.pc += (int8_t)spc_next_8();                                    \
+            snes->spc.pc += (int8_t)spc_next_8(snes);                          \
         }                                                                      \
     }
 OP_BBC(0);
@@ -280,57 +265,57 @@ OP_BBC(7);
 
 OP(cbne) {
     LEGALADDRMODES(SM_DIR_PAGE | SM_DIR_PAGEX);
-    uint8_t operand = spc_resolve_read(mode);
-    if (spc.a != operand) {
-        spc.pc += (int8_t)spc_next_8();
+    uint8_t operand = spc_resolve_read(snes, mode);
+    if (snes->spc.a != operand) {
+        snes->spc.pc += (int8_t)spc_next_8(snes);
     } else {
-        spc.pc++;
+        snes->spc.pc++;
     }
 }
 
 OP(dbnz) {
     LEGALADDRMODES(SM_DIR_PAGE | SM_Y);
     if (mode == SM_Y) {
-        spc.y--;
-        if (spc.y != 0) {
-            spc.pc += (int8_t)spc_next_8();
+        snes->spc.y--;
+        if (snes->spc.y != 0) {
+            snes->spc.pc += (int8_t)spc_next_8(snes);
         } else {
-            spc.pc++;
+            snes->spc.pc++;
         }
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr) - 1;
-        spc_write_8(addr, val);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr) - 1;
+        spc_write_8(snes, addr, val);
         if (val != 0) {
-            spc.pc += (int8_t)spc_next_8();
+            snes->spc.pc += (int8_t)spc_next_8(snes);
         } else {
-            spc.pc++;
+            snes->spc.pc++;
         }
     }
 }
 
 OP(jmp) {
     LEGALADDRMODES(SM_ABS | SM_ABS_INDX);
-    spc.pc = spc_resolve_addr(mode);
+    snes->spc.pc = spc_resolve_addr(snes, mode);
 }
 
 OP(jsr) {
     LEGALADDRMODES(SM_ABS);
-    spc_push_16(spc.pc + 2);
-    spc.pc = spc_resolve_addr(mode);
+    spc_push_16(snes, snes->spc.pc + 2);
+    snes->spc.pc = spc_resolve_addr(snes, mode);
 }
 
 OP(jsp) {
     LEGALADDRMODES(SM_IMP);
-    spc_push_16(spc.pc + 1);
-    spc.pc = 0xff00 | spc_next_8();
+    spc_push_16(snes, snes->spc.pc + 1);
+    snes->spc.pc = 0xff00 | spc_next_8(snes);
 }
 
 #define OP_JST(x)                                                              \
     OP(jst##x) {                                                               \
         LEGALADDRMODES(SM_IMP);                                                \
-        spc_push_16(spc.pc);                                                   \
-        spc.pc = spc_read_16(0xff00 | (0xde - 0x##x * 2));                     \
+        spc_push_16(snes, snes->spc.pc);                                       \
+        snes->spc.pc = spc_read_16(snes, 0xff00 | (0xde - 0x##x * 2));         \
     }
 
 OP_JST(0);
@@ -354,68 +339,68 @@ OP_JST(f);
 
 OP(rts) {
     LEGALADDRMODES(SM_IMP);
-    spc.pc = spc_pop_16();
+    snes->spc.pc = spc_pop_16(snes);
 }
 
 OP(rti) {
     LEGALADDRMODES(SM_IMP);
-    spc.p = spc_pop_8();
-    spc.pc = spc_pop_16();
+    spc_set_p(snes, spc_pop_8(snes));
+    snes->spc.pc = spc_pop_16(snes);
 }
 
 OP(pha) {
     LEGALADDRMODES(SM_IMP);
-    spc_push_8(spc.a);
+    spc_push_8(snes, snes->spc.a);
 }
 
 OP(pla) {
     LEGALADDRMODES(SM_IMP);
-    spc.a = spc_pop_8();
+    snes->spc.a = spc_pop_8(snes);
 }
 
 OP(phx) {
     LEGALADDRMODES(SM_IMP);
-    spc_push_8(spc.x);
+    spc_push_8(snes, snes->spc.x);
 }
 
 OP(plx) {
     LEGALADDRMODES(SM_IMP);
-    spc.x = spc_pop_8();
+    snes->spc.x = spc_pop_8(snes);
 }
 
 OP(phy) {
     LEGALADDRMODES(SM_IMP);
-    spc_push_8(spc.y);
+    spc_push_8(snes, snes->spc.y);
 }
 
 OP(ply) {
     LEGALADDRMODES(SM_IMP);
-    spc.y = spc_pop_8();
+    snes->spc.y = spc_pop_8(snes);
 }
 
 OP(php) {
     LEGALADDRMODES(SM_IMP);
-    spc_push_8(spc.p);
+    spc_push_8(snes, spc_get_p(snes));
 }
 
 OP(plp) {
     LEGALADDRMODES(SM_IMP);
-    spc.p = spc_pop_8();
+    spc_set_p(snes, spc_pop_8(snes));
 }
 
 OP(mov) {
     LEGALADDRMODES(SM_DIR_PAGE_TO_DIR_PAGE | SM_IMM_TO_DIR_PAGE);
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        uint8_t val = spc_next_8();
-        uint16_t addr =
-            spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        spc_write_8(addr, val);
+        uint8_t val = spc_next_8(snes);
+        uint16_t addr = spc_next_8(snes) +
+                        spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        spc_write_8(snes, addr, val);
     } else {
-        uint16_t src =
-            spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        uint16_t dst =
-            spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        spc_write_8(dst, spc_read_8(src));
+        uint16_t src = spc_next_8(snes) +
+                       spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        uint16_t dst = spc_next_8(snes) +
+                       spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        spc_write_8(snes, dst, spc_read_8(snes, src));
     }
 }
 
@@ -426,170 +411,175 @@ OP(cmp) {
                    SM_IND_PAGE_TO_IND_PAGE);
     uint8_t op1, op2;
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        op2 = spc_next_8();
-        op1 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_next_8(snes);
+        op1 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
     } else if (mode == SM_DIR_PAGE_TO_DIR_PAGE) {
-        op2 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op1 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
+        op1 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
     } else if (mode == SM_IND_PAGE_TO_IND_PAGE) {
-        op1 = spc_read_8(spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op2 = spc_read_8(spc.y + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
+        op1 = spc_read_8(
+            snes,
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(
+            snes,
+            snes->spc.y + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
     } else {
-        op1 = spc.a;
-        op2 = spc_resolve_read(mode);
+        op1 = snes->spc.a;
+        op2 = spc_resolve_read(snes, mode);
     }
 
-    spc_set_status_bit(STATUS_NEGATIVE, (op1 - op2) & 0x80);
-    spc_set_status_bit(STATUS_ZERO, op1 == op2);
-    spc_set_status_bit(STATUS_CARRY, op1 >= op2);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, (op1 - op2) & 0x80);
+    spc_set_status_bit(snes, STATUS_ZERO, op1 == op2);
+    spc_set_status_bit(snes, STATUS_CARRY, op1 >= op2);
 }
 
 OP(cpx) {
     LEGALADDRMODES(SM_IMM | SM_ABS | SM_DIR_PAGE);
-    uint8_t op1 = spc.x;
-    uint8_t op2 = spc_resolve_read(mode);
-    spc_set_status_bit(STATUS_NEGATIVE, (op1 - op2) & 0x80);
-    spc_set_status_bit(STATUS_ZERO, op1 == op2);
-    spc_set_status_bit(STATUS_CARRY, op1 >= op2);
+    uint8_t op1 = snes->spc.x;
+    uint8_t op2 = spc_resolve_read(snes, mode);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, (op1 - op2) & 0x80);
+    spc_set_status_bit(snes, STATUS_ZERO, op1 == op2);
+    spc_set_status_bit(snes, STATUS_CARRY, op1 >= op2);
 }
 
 OP(cpy) {
     LEGALADDRMODES(SM_IMM | SM_ABS | SM_DIR_PAGE);
-    uint8_t op1 = spc.y;
-    uint8_t op2 = spc_resolve_read(mode);
-    spc_set_status_bit(STATUS_NEGATIVE, (op1 - op2) & 0x80);
-    spc_set_status_bit(STATUS_ZERO, op1 == op2);
-    spc_set_status_bit(STATUS_CARRY, op1 >= op2);
+    uint8_t op1 = snes->spc.y;
+    uint8_t op2 = spc_resolve_read(snes, mode);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, (op1 - op2) & 0x80);
+    spc_set_status_bit(snes, STATUS_ZERO, op1 == op2);
+    spc_set_status_bit(snes, STATUS_CARRY, op1 >= op2);
 }
 
 OP(inc) {
     LEGALADDRMODES(SM_ABS | SM_DIR_PAGE | SM_ACC | SM_DIR_PAGEX);
     if (mode == SM_ACC) {
-        spc.a++;
-        spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
-        spc_set_status_bit(STATUS_ZERO, spc.a == 0);
+        snes->spc.a++;
+        spc_set_nz(snes, snes->spc.a);
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr) + 1;
-        spc_write_8(addr, val);
-        spc_set_status_bit(STATUS_NEGATIVE, val & 0x80);
-        spc_set_status_bit(STATUS_ZERO, val == 0);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr) + 1;
+        spc_write_8(snes, addr, val);
+        spc_set_nz(snes, val);
     }
 }
 
 OP(dec) {
     LEGALADDRMODES(SM_ABS | SM_DIR_PAGE | SM_ACC | SM_DIR_PAGEX);
     if (mode == SM_ACC) {
-        spc.a--;
-        spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
-        spc_set_status_bit(STATUS_ZERO, spc.a == 0);
+        snes->spc.a--;
+        spc_set_nz(snes, snes->spc.a);
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr) - 1;
-        spc_write_8(addr, val);
-        spc_set_status_bit(STATUS_NEGATIVE, val & 0x80);
-        spc_set_status_bit(STATUS_ZERO, val == 0);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr) - 1;
+        spc_write_8(snes, addr, val);
+        spc_set_nz(snes, val);
     }
 }
 
 OP(inw) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint16_t val = spc_read_8(addr);
-    spc_write_8(addr, U16_LOBYTE(val + 1));
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint16_t val = spc_read_8(snes, addr);
+    spc_write_8(snes, addr, U16_LOBYTE(val + 1));
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    val |= spc_read_8(addr) << 8;
+    val |= spc_read_8(snes, addr) << 8;
     val++;
-    spc_set_status_bit(STATUS_ZERO, val == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, val & 0x8000);
-    spc_write_8(addr, U16_HIBYTE(val));
+    spc_set_status_bit(snes, STATUS_ZERO, val == 0);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, val & 0x8000);
+    spc_write_8(snes, addr, U16_HIBYTE(val));
 }
 
 OP(dew) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint16_t val = spc_read_8(addr);
-    spc_write_8(addr, U16_LOBYTE(val - 1));
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint16_t val = spc_read_8(snes, addr);
+    spc_write_8(snes, addr, U16_LOBYTE(val - 1));
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    val |= spc_read_8(addr) << 8;
+    val |= spc_read_8(snes, addr) << 8;
     val--;
-    spc_set_status_bit(STATUS_ZERO, val == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, val & 0x8000);
-    spc_write_8(addr, U16_HIBYTE(val));
+    spc_set_status_bit(snes, STATUS_ZERO, val == 0);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, val & 0x8000);
+    spc_write_8(snes, addr, U16_HIBYTE(val));
 }
 
 OP(adw) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t op1 = TO_U16(spc.a, spc.y);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint16_t op2 = spc_read_8(addr);
+    uint16_t op1 = TO_U16(snes->spc.a, snes->spc.y);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint16_t op2 = spc_read_8(snes, addr);
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    op2 |= spc_read_8(addr) << 8;
+    op2 |= spc_read_8(snes, addr) << 8;
     int32_t result = op1 + op2;
-    spc_set_status_bit(STATUS_CARRY, result > 0xffff);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x8000);
-    spc_set_status_bit(STATUS_OVERFLOW,
+    spc_set_status_bit(snes, STATUS_CARRY, result > 0xffff);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, result & 0x8000);
+    spc_set_status_bit(snes, STATUS_OVERFLOW,
                        ~(U16_HIBYTE(op1) ^ U16_HIBYTE(op2)) &
                            (U16_HIBYTE(op1) ^ U16_HIBYTE((uint16_t)result)) &
                            0x80);
-    spc_set_status_bit(STATUS_HALFCARRY, (U16_HIBYTE(op1) ^ U16_HIBYTE(op2) ^
-                                          U16_HIBYTE((uint16_t)result)) &
-                                             0x10);
-    spc_set_status_bit(STATUS_ZERO, (result & 0xffff) == 0);
-    spc.y = U16_HIBYTE((uint16_t)result);
-    spc.a = U16_LOBYTE((uint16_t)result);
+    spc_set_status_bit(
+        snes, STATUS_HALFCARRY,
+        (U16_HIBYTE(op1) ^ U16_HIBYTE(op2) ^ U16_HIBYTE((uint16_t)result)) &
+            0x10);
+    spc_set_status_bit(snes, STATUS_ZERO, (result & 0xffff) == 0);
+    snes->spc.y = U16_HIBYTE((uint16_t)result);
+    snes->spc.a = U16_LOBYTE((uint16_t)result);
 }
 OP(sbw) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t op1 = TO_U16(spc.a, spc.y);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint16_t op2 = spc_read_8(addr);
+    uint16_t op1 = TO_U16(snes->spc.a, snes->spc.y);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint16_t op2 = spc_read_8(snes, addr);
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    op2 |= spc_read_8(addr) << 8;
+    op2 |= spc_read_8(snes, addr) << 8;
     int32_t result = op1 - op2;
-    spc_set_status_bit(STATUS_CARRY, result >= 0);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x8000);
-    spc_set_status_bit(STATUS_OVERFLOW,
+    spc_set_status_bit(snes, STATUS_CARRY, result >= 0);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, result & 0x8000);
+    spc_set_status_bit(snes, STATUS_OVERFLOW,
                        (U16_HIBYTE(op1) ^ U16_HIBYTE(op2)) &
                            (U16_HIBYTE(op1) ^ U16_HIBYTE((uint16_t)result)) &
                            0x80);
-    spc_set_status_bit(STATUS_HALFCARRY, !((U16_HIBYTE(op1) ^ U16_HIBYTE(op2) ^
-                                            U16_HIBYTE((uint16_t)result)) &
-                                           0x10));
-    spc_set_status_bit(STATUS_ZERO, (result & 0xffff) == 0);
-    spc.y = U16_HIBYTE((uint16_t)result);
-    spc.a = U16_LOBYTE((uint16_t)result);
+    spc_set_status_bit(
+        snes, STATUS_HALFCARRY,
+        !((U16_HIBYTE(op1) ^ U16_HIBYTE(op2) ^ U16_HIBYTE((uint16_t)result)) &
+          0x10));
+    spc_set_status_bit(snes, STATUS_ZERO, (result & 0xffff) == 0);
+    snes->spc.y = U16_HIBYTE((uint16_t)result);
+    snes->spc.a = U16_LOBYTE((uint16_t)result);
 }
 
 OP(cpw) {
     LEGALADDRMODES(SM_DIR_PAGE);
-    uint16_t op1 = TO_U16(spc.a, spc.y);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint16_t op2 = spc_read_8(addr);
+    uint16_t op1 = TO_U16(snes->spc.a, snes->spc.y);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint16_t op2 = spc_read_8(snes, addr);
     if (addr % 0x100 == 0xff)
         addr -= 0xff;
     else
         addr++;
-    op2 |= spc_read_8(addr) << 8;
+    op2 |= spc_read_8(snes, addr) << 8;
     int32_t result = op1 - op2;
-    spc_set_status_bit(STATUS_CARRY, result >= 0);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x8000);
-    spc_set_status_bit(STATUS_ZERO, (result & 0xffff) == 0);
+    spc_set_status_bit(snes, STATUS_CARRY, result >= 0);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, result & 0x8000);
+    spc_set_status_bit(snes, STATUS_ZERO, (result & 0xffff) == 0);
 }
 
 OP(adc) {
@@ -600,33 +590,42 @@ OP(adc) {
     uint8_t op1, op2;
     uint16_t dest = 0;
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        op1 = spc_next_8();
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_next_8(snes);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_DIR_PAGE_TO_DIR_PAGE) {
-        op1 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_IND_PAGE_TO_IND_PAGE) {
-        op1 = spc_read_8(spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op2 = spc_read_8(spc.y + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(
+            snes,
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(
+            snes,
+            snes->spc.y + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        dest =
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
     } else {
-        op1 = spc.a;
-        op2 = spc_resolve_read(mode);
+        op1 = snes->spc.a;
+        op2 = spc_resolve_read(snes, mode);
     }
-    uint16_t result = op1 + op2 + spc_get_status_bit(STATUS_CARRY);
-    spc_set_status_bit(STATUS_CARRY, result > 0xff);
-    spc_set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-    spc_set_status_bit(STATUS_HALFCARRY, (result ^ op1 ^ op2) & 0x10);
-    spc_set_status_bit(STATUS_OVERFLOW, ~(op1 ^ op2) & (op1 ^ result) & 0x80);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x80);
+    uint16_t result = op1 + op2 + spc_get_status_bit(snes, STATUS_CARRY);
+    spc_set_status_bit(snes, STATUS_CARRY, result > 0xff);
+    spc_set_status_bit(snes, STATUS_ZERO, (result & 0xff) == 0);
+    spc_set_status_bit(snes, STATUS_HALFCARRY, (result ^ op1 ^ op2) & 0x10);
+    spc_set_status_bit(snes, STATUS_OVERFLOW,
+                       ~(op1 ^ op2) & (op1 ^ result) & 0x80);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, result & 0x80);
     if (mode == SM_IMM_TO_DIR_PAGE || mode == SM_DIR_PAGE_TO_DIR_PAGE ||
         mode == SM_IND_PAGE_TO_IND_PAGE) {
-        spc_write_8(dest, result);
+        spc_write_8(snes, dest, result);
     } else {
-        spc.a = result;
+        snes->spc.a = result;
     }
 }
 
@@ -638,33 +637,42 @@ OP(sbc) {
     uint8_t op1, op2;
     uint16_t dest = 0;
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        op2 = spc_next_8();
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op1 = spc_read_8(dest);
+        op2 = spc_next_8(snes);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(snes, dest);
     } else if (mode == SM_DIR_PAGE_TO_DIR_PAGE) {
-        op2 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op1 = spc_read_8(dest);
+        op2 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(snes, dest);
     } else if (mode == SM_IND_PAGE_TO_IND_PAGE) {
-        op1 = spc_read_8(spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op2 = spc_read_8(spc.y + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(
+            snes,
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(
+            snes,
+            snes->spc.y + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        dest =
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
     } else {
-        op1 = spc.a;
-        op2 = spc_resolve_read(mode);
+        op1 = snes->spc.a;
+        op2 = spc_resolve_read(snes, mode);
     }
-    int16_t result = op1 - op2 - !spc_get_status_bit(STATUS_CARRY);
-    spc_set_status_bit(STATUS_CARRY, result >= 0);
-    spc_set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-    spc_set_status_bit(STATUS_HALFCARRY, !((result ^ op1 ^ op2) & 0x10));
-    spc_set_status_bit(STATUS_OVERFLOW, (op1 ^ op2) & (op1 ^ result) & 0x80);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x80);
+    int16_t result = op1 - op2 - !spc_get_status_bit(snes, STATUS_CARRY);
+    spc_set_status_bit(snes, STATUS_CARRY, result >= 0);
+    spc_set_status_bit(snes, STATUS_ZERO, (result & 0xff) == 0);
+    spc_set_status_bit(snes, STATUS_HALFCARRY, !((result ^ op1 ^ op2) & 0x10));
+    spc_set_status_bit(snes, STATUS_OVERFLOW,
+                       (op1 ^ op2) & (op1 ^ result) & 0x80);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, result & 0x80);
     if (mode == SM_IMM_TO_DIR_PAGE || mode == SM_DIR_PAGE_TO_DIR_PAGE ||
         mode == SM_IND_PAGE_TO_IND_PAGE) {
-        spc_write_8(dest, result);
+        spc_write_8(snes, dest, result);
     } else {
-        spc.a = result;
+        snes->spc.a = result;
     }
 }
 
@@ -676,30 +684,37 @@ OP(and) {
     uint8_t op1, op2;
     uint16_t dest;
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        op1 = spc_next_8();
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_next_8(snes);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_DIR_PAGE_TO_DIR_PAGE) {
-        op1 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_IND_PAGE_TO_IND_PAGE) {
-        op1 = spc_read_8(spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op2 = spc_read_8(spc.y + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(
+            snes,
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(
+            snes,
+            snes->spc.y + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        dest =
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
     } else {
-        op1 = spc.a;
-        op2 = spc_resolve_read(mode);
+        op1 = snes->spc.a;
+        op2 = spc_resolve_read(snes, mode);
     }
     uint16_t result = op1 & op2;
-    spc_set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x80);
+    spc_set_nz(snes, result);
     if (mode == SM_IMM_TO_DIR_PAGE || mode == SM_DIR_PAGE_TO_DIR_PAGE ||
         mode == SM_IND_PAGE_TO_IND_PAGE) {
-        spc_write_8(dest, result);
+        spc_write_8(snes, dest, result);
     } else {
-        spc.a = result;
+        snes->spc.a = result;
     }
 }
 
@@ -711,30 +726,37 @@ OP(ora) {
     uint8_t op1, op2;
     uint16_t dest;
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        op1 = spc_next_8();
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_next_8(snes);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_DIR_PAGE_TO_DIR_PAGE) {
-        op1 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_IND_PAGE_TO_IND_PAGE) {
-        op1 = spc_read_8(spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op2 = spc_read_8(spc.y + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(
+            snes,
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(
+            snes,
+            snes->spc.y + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        dest =
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
     } else {
-        op1 = spc.a;
-        op2 = spc_resolve_read(mode);
+        op1 = snes->spc.a;
+        op2 = spc_resolve_read(snes, mode);
     }
     uint16_t result = op1 | op2;
-    spc_set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x80);
+    spc_set_nz(snes, result);
     if (mode == SM_IMM_TO_DIR_PAGE || mode == SM_DIR_PAGE_TO_DIR_PAGE ||
         mode == SM_IND_PAGE_TO_IND_PAGE) {
-        spc_write_8(dest, result);
+        spc_write_8(snes, dest, result);
     } else {
-        spc.a = result;
+        snes->spc.a = result;
     }
 }
 
@@ -746,184 +768,187 @@ OP(eor) {
     uint8_t op1, op2;
     uint16_t dest;
     if (mode == SM_IMM_TO_DIR_PAGE) {
-        op1 = spc_next_8();
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_next_8(snes);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_DIR_PAGE_TO_DIR_PAGE) {
-        op1 = spc_read_8(spc_next_8() +
-                         spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc_next_8() + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
-        op2 = spc_read_8(dest);
+        op1 = spc_read_8(snes, spc_next_8(snes) +
+                                   spc_get_status_bit(snes, STATUS_DIRECTPAGE) *
+                                       0x100);
+        dest = spc_next_8(snes) +
+               spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
+        op2 = spc_read_8(snes, dest);
     } else if (mode == SM_IND_PAGE_TO_IND_PAGE) {
-        op1 = spc_read_8(spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        op2 = spc_read_8(spc.y + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100);
-        dest = spc.x + spc_get_status_bit(STATUS_DIRECTPAGE) * 0x100;
+        op1 = spc_read_8(
+            snes,
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        op2 = spc_read_8(
+            snes,
+            snes->spc.y + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100);
+        dest =
+            snes->spc.x + spc_get_status_bit(snes, STATUS_DIRECTPAGE) * 0x100;
     } else {
-        op1 = spc.a;
-        op2 = spc_resolve_read(mode);
+        op1 = snes->spc.a;
+        op2 = spc_resolve_read(snes, mode);
     }
     uint16_t result = op1 ^ op2;
-    spc_set_status_bit(STATUS_ZERO, (result & 0xff) == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, result & 0x80);
+    spc_set_nz(snes, result);
     if (mode == SM_IMM_TO_DIR_PAGE || mode == SM_DIR_PAGE_TO_DIR_PAGE ||
         mode == SM_IND_PAGE_TO_IND_PAGE) {
-        spc_write_8(dest, result);
+        spc_write_8(snes, dest, result);
     } else {
-        spc.a = result;
+        snes->spc.a = result;
     }
 }
 
 OP(mul) {
     LEGALADDRMODES(SM_IMP);
-    uint16_t result = spc.a * spc.y;
-    spc.a = U16_LOBYTE(result);
-    spc.y = U16_HIBYTE(result);
-    spc_set_status_bit(STATUS_ZERO, spc.y == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.y & 0x80);
+    uint16_t result = snes->spc.a * snes->spc.y;
+    snes->spc.a = U16_LOBYTE(result);
+    snes->spc.y = U16_HIBYTE(result);
+    spc_set_nz(snes, snes->spc.y);
 }
 
 OP(div) {
     LEGALADDRMODES(SM_IMP);
     uint8_t result1, result2;
-    if (spc.y < (spc.x << 1)) {
-        result1 = TO_U16(spc.a, spc.y) / spc.x;
-        result2 = TO_U16(spc.a, spc.y) % spc.x;
+    if (snes->spc.y < (snes->spc.x << 1)) {
+        result1 = TO_U16(snes->spc.a, snes->spc.y) / snes->spc.x;
+        result2 = TO_U16(snes->spc.a, snes->spc.y) % snes->spc.x;
     } else {
-        result1 = 255 - (TO_U16(spc.a, spc.y) - (spc.x << 9)) / (256 - spc.x);
-        result2 = spc.x + (TO_U16(spc.a, spc.y) - (spc.x << 9)) % (256 - spc.x);
+        result1 =
+            255 - (TO_U16(snes->spc.a, snes->spc.y) - (snes->spc.x << 9)) /
+                      (256 - snes->spc.x);
+        result2 = snes->spc.x +
+                  (TO_U16(snes->spc.a, snes->spc.y) - (snes->spc.x << 9)) %
+                      (256 - snes->spc.x);
     }
-    spc_set_status_bit(STATUS_OVERFLOW, spc.y >= spc.x);
-    spc_set_status_bit(STATUS_HALFCARRY, (spc.y & 0xf) >= (spc.x & 0xf));
-    spc.a = result1;
-    spc.y = result2;
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    spc_set_status_bit(snes, STATUS_OVERFLOW, snes->spc.y >= snes->spc.x);
+    spc_set_status_bit(snes, STATUS_HALFCARRY,
+                       (snes->spc.y & 0xf) >= (snes->spc.x & 0xf));
+    snes->spc.a = result1;
+    snes->spc.y = result2;
+    spc_set_nz(snes, snes->spc.a);
 }
 
 OP(asl) {
     LEGALADDRMODES(SM_ACC | SM_DIR_PAGE | SM_DIR_PAGEX | SM_ABS);
     if (mode == SM_ACC) {
-        spc_set_status_bit(STATUS_CARRY, spc.a & 0x80);
-        spc.a <<= 1;
-        spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+        spc_set_status_bit(snes, STATUS_CARRY, snes->spc.a & 0x80);
+        snes->spc.a <<= 1;
+        spc_set_nz(snes, snes->spc.a);
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr);
-        spc_set_status_bit(STATUS_CARRY, val & 0x80);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr);
+        spc_set_status_bit(snes, STATUS_CARRY, val & 0x80);
         val <<= 1;
-        spc_set_status_bit(STATUS_ZERO, val == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, val & 0x80);
-        spc_write_8(addr, val);
+        spc_set_nz(snes, val);
+        spc_write_8(snes, addr, val);
     }
 }
 
 OP(lsr) {
     LEGALADDRMODES(SM_ACC | SM_DIR_PAGE | SM_DIR_PAGEX | SM_ABS);
     if (mode == SM_ACC) {
-        spc_set_status_bit(STATUS_CARRY, spc.a & 1);
-        spc.a >>= 1;
-        spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+        spc_set_status_bit(snes, STATUS_CARRY, snes->spc.a & 1);
+        snes->spc.a >>= 1;
+        spc_set_nz(snes, snes->spc.a);
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr);
-        spc_set_status_bit(STATUS_CARRY, val & 1);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr);
+        spc_set_status_bit(snes, STATUS_CARRY, val & 1);
         val >>= 1;
-        spc_set_status_bit(STATUS_ZERO, val == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, val & 0x80);
-        spc_write_8(addr, val);
+        spc_set_nz(snes, val);
+        spc_write_8(snes, addr, val);
     }
 }
 
 OP(ror) {
     LEGALADDRMODES(SM_ACC | SM_DIR_PAGE | SM_DIR_PAGEX | SM_ABS);
-    bool c = spc_get_status_bit(STATUS_CARRY);
+    bool c = spc_get_status_bit(snes, STATUS_CARRY);
     if (mode == SM_ACC) {
-        spc_set_status_bit(STATUS_CARRY, spc.a & 1);
-        spc.a >>= 1;
-        spc.a |= c << 7;
-        spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+        spc_set_status_bit(snes, STATUS_CARRY, snes->spc.a & 1);
+        snes->spc.a >>= 1;
+        snes->spc.a |= c << 7;
+        spc_set_nz(snes, snes->spc.a);
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr);
-        spc_set_status_bit(STATUS_CARRY, val & 1);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr);
+        spc_set_status_bit(snes, STATUS_CARRY, val & 1);
         val >>= 1;
         val |= c << 7;
-        spc_set_status_bit(STATUS_ZERO, val == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, val & 0x80);
-        spc_write_8(addr, val);
+        spc_set_nz(snes, val);
+        spc_write_8(snes, addr, val);
     }
 }
 
 OP(rol) {
     LEGALADDRMODES(SM_ACC | SM_DIR_PAGE | SM_DIR_PAGEX | SM_ABS);
-    bool c = spc_get_status_bit(STATUS_CARRY);
+    bool c = spc_get_status_bit(snes, STATUS_CARRY);
     if (mode == SM_ACC) {
-        spc_set_status_bit(STATUS_CARRY, spc.a & 0x80);
-        spc.a <<= 1;
-        spc.a |= c;
-        spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+        spc_set_status_bit(snes, STATUS_CARRY, snes->spc.a & 0x80);
+        snes->spc.a <<= 1;
+        snes->spc.a |= c;
+        spc_set_nz(snes, snes->spc.a);
     } else {
-        uint16_t addr = spc_resolve_addr(mode);
-        uint8_t val = spc_read_8(addr);
-        spc_set_status_bit(STATUS_CARRY, val & 0x80);
+        uint16_t addr = spc_resolve_addr(snes, mode);
+        uint8_t val = spc_read_8(snes, addr);
+        spc_set_status_bit(snes, STATUS_CARRY, val & 0x80);
         val <<= 1;
         val |= c;
-        spc_set_status_bit(STATUS_ZERO, val == 0);
-        spc_set_status_bit(STATUS_NEGATIVE, val & 0x80);
-        spc_write_8(addr, val);
+        spc_set_nz(snes, val);
+        spc_write_8(snes, addr, val);
     }
 }
 
 OP(sep) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_DIRECTPAGE, true);
+    spc_set_status_bit(snes, STATUS_DIRECTPAGE, true);
 }
 
 OP(clp) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_DIRECTPAGE, false);
+    spc_set_status_bit(snes, STATUS_DIRECTPAGE, false);
 }
 
 OP(sec) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_CARRY, true);
+    spc_set_status_bit(snes, STATUS_CARRY, true);
 }
 
 OP(clc) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_CARRY, false);
+    spc_set_status_bit(snes, STATUS_CARRY, false);
 }
 
 OP(sei) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_IRQOFF, false);
+    spc_set_status_bit(snes, STATUS_IRQOFF, false);
 }
 
 OP(cli) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_IRQOFF, true);
+    spc_set_status_bit(snes, STATUS_IRQOFF, true);
 }
 
 OP(clv) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_OVERFLOW, false);
-    spc_set_status_bit(STATUS_HALFCARRY, false);
+    spc_set_status_bit(snes, STATUS_OVERFLOW, false);
+    spc_set_status_bit(snes, STATUS_HALFCARRY, false);
 }
 
 OP(notc) {
     LEGALADDRMODES(SM_IMP);
-    spc_set_status_bit(STATUS_CARRY, !spc_get_status_bit(STATUS_CARRY));
+    spc_set_status_bit(snes, STATUS_CARRY,
+                       !spc_get_status_bit(snes, STATUS_CARRY));
 }
 
 #define OP_SET(x)                                                              \
     OP(set##x) {                                                               \
         LEGALADDRMODES(SM_DIR_PAGE_BIT);                                       \
-        uint16_t addr = spc_resolve_addr(SM_DIR_PAGE);                         \
-        spc_write_8(addr, spc_read_8(addr) | (1 << x));                        \
+        uint16_t addr = spc_resolve_addr(snes, SM_DIR_PAGE);                   \
+        spc_write_8(snes, addr, spc_read_8(snes, addr) | (1 << x));            \
     }
 
 OP_SET(0);
@@ -940,8 +965,8 @@ OP_SET(7);
 #define OP_CLR(x)                                                              \
     OP(clr##x) {                                                               \
         LEGALADDRMODES(SM_DIR_PAGE_BIT);                                       \
-        uint16_t addr = spc_resolve_addr(SM_DIR_PAGE);                         \
-        spc_write_8(addr, spc_read_8(addr) & ~(1 << x));                       \
+        uint16_t addr = spc_resolve_addr(snes, SM_DIR_PAGE);                   \
+        spc_write_8(snes, addr, spc_read_8(snes, addr) & ~(1 << x));           \
     }
 
 OP_CLR(0);
@@ -957,137 +982,136 @@ OP_CLR(7);
 
 OP(and1) {
     LEGALADDRMODES(SM_ABS_BOOL_BIT | SM_ABS_BOOL_BIT_INV);
-    uint16_t addr = spc_next_16();
+    uint16_t addr = spc_next_16(snes);
     uint8_t bit = addr >> 13;
     addr &= 0x1fff;
     if (mode == SM_ABS_BOOL_BIT) {
-        spc_set_status_bit(STATUS_CARRY,
-                           spc_get_status_bit(STATUS_CARRY) &&
-                               (((spc_read_8(addr) >> bit) & 1) == 1));
+        spc_set_status_bit(snes, STATUS_CARRY,
+                           spc_get_status_bit(snes, STATUS_CARRY) &&
+                               (((spc_read_8(snes, addr) >> bit) & 1) == 1));
     } else {
-        spc_set_status_bit(STATUS_CARRY,
-                           spc_get_status_bit(STATUS_CARRY) &&
-                               (((spc_read_8(addr) >> bit) & 1) == 0));
+        spc_set_status_bit(snes, STATUS_CARRY,
+                           spc_get_status_bit(snes, STATUS_CARRY) &&
+                               (((spc_read_8(snes, addr) >> bit) & 1) == 0));
     }
 }
 
 OP(or1) {
     LEGALADDRMODES(SM_ABS_BOOL_BIT | SM_ABS_BOOL_BIT_INV);
-    uint16_t addr = spc_next_16();
+    uint16_t addr = spc_next_16(snes);
     uint8_t bit = addr >> 13;
     addr &= 0x1fff;
     if (mode == SM_ABS_BOOL_BIT) {
-        spc_set_status_bit(STATUS_CARRY,
-                           spc_get_status_bit(STATUS_CARRY) ||
-                               (((spc_read_8(addr) >> bit) & 1) == 1));
+        spc_set_status_bit(snes, STATUS_CARRY,
+                           spc_get_status_bit(snes, STATUS_CARRY) ||
+                               (((spc_read_8(snes, addr) >> bit) & 1) == 1));
     } else {
-        spc_set_status_bit(STATUS_CARRY,
-                           spc_get_status_bit(STATUS_CARRY) ||
-                               (((spc_read_8(addr) >> bit) & 1) == 0));
+        spc_set_status_bit(snes, STATUS_CARRY,
+                           spc_get_status_bit(snes, STATUS_CARRY) ||
+                               (((spc_read_8(snes, addr) >> bit) & 1) == 0));
     }
 }
 
 OP(eor1) {
     LEGALADDRMODES(SM_ABS_BOOL_BIT);
-    uint16_t addr = spc_next_16();
+    uint16_t addr = spc_next_16(snes);
     uint8_t bit = addr >> 13;
     addr &= 0x1fff;
     if (mode == SM_ABS_BOOL_BIT) {
-        spc_set_status_bit(STATUS_CARRY,
-                           spc_get_status_bit(STATUS_CARRY) ^
-                               (((spc_read_8(addr) >> bit) & 1) == 1));
+        spc_set_status_bit(snes, STATUS_CARRY,
+                           spc_get_status_bit(snes, STATUS_CARRY) ^
+                               (((spc_read_8(snes, addr) >> bit) & 1) == 1));
     } else {
-        spc_set_status_bit(STATUS_CARRY,
-                           spc_get_status_bit(STATUS_CARRY) ^
-                               (((spc_read_8(addr) >> bit) & 1) == 0));
+        spc_set_status_bit(snes, STATUS_CARRY,
+                           spc_get_status_bit(snes, STATUS_CARRY) ^
+                               (((spc_read_8(snes, addr) >> bit) & 1) == 0));
     }
 }
 
 OP(ld1) {
     LEGALADDRMODES(SM_ABS_BOOL_BIT);
-    uint16_t addr = spc_next_16();
+    uint16_t addr = spc_next_16(snes);
     uint8_t bit = addr >> 13;
     addr &= 0x1fff;
-    spc_set_status_bit(STATUS_CARRY, (spc_read_8(addr) >> bit) & 1);
+    spc_set_status_bit(snes, STATUS_CARRY, (spc_read_8(snes, addr) >> bit) & 1);
 }
 
 OP(st1) {
     LEGALADDRMODES(SM_ABS_BOOL_BIT);
-    uint16_t addr = spc_next_16();
+    uint16_t addr = spc_next_16(snes);
     uint8_t bit = addr >> 13;
     addr &= 0x1fff;
-    uint8_t val = spc_read_8(addr);
+    uint8_t val = spc_read_8(snes, addr);
     val &= ~(1 << bit);
-    val |= (spc_get_status_bit(STATUS_CARRY) << bit);
-    spc_write_8(addr, val);
+    val |= (spc_get_status_bit(snes, STATUS_CARRY) << bit);
+    spc_write_8(snes, addr, val);
 }
 
 OP(not1) {
     LEGALADDRMODES(SM_ABS_BOOL_BIT);
-    uint16_t addr = spc_next_16();
+    uint16_t addr = spc_next_16(snes);
     uint8_t bit = addr >> 13;
     addr &= 0x1fff;
-    uint8_t val = spc_read_8(addr);
+    uint8_t val = spc_read_8(snes, addr);
     val ^= (1 << bit);
-    spc_write_8(addr, val);
+    spc_write_8(snes, addr, val);
 }
 
 OP(tset1) {
     LEGALADDRMODES(SM_ABS);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint8_t val = spc_read_8(addr);
-    spc_set_status_bit(STATUS_ZERO, val == spc.a);
-    spc_set_status_bit(STATUS_NEGATIVE, (spc.a - val) & 0x80);
-    val |= spc.a;
-    spc_write_8(addr, val);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint8_t val = spc_read_8(snes, addr);
+    spc_set_status_bit(snes, STATUS_ZERO, val == snes->spc.a);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, (snes->spc.a - val) & 0x80);
+    val |= snes->spc.a;
+    spc_write_8(snes, addr, val);
 }
 
 OP(tclr1) {
     LEGALADDRMODES(SM_ABS);
-    uint16_t addr = spc_resolve_addr(mode);
-    uint8_t val = spc_read_8(addr);
-    spc_set_status_bit(STATUS_ZERO, val == spc.a);
-    spc_set_status_bit(STATUS_NEGATIVE, (spc.a - val) & 0x80);
-    val &= ~spc.a;
-    spc_write_8(addr, val);
+    uint16_t addr = spc_resolve_addr(snes, mode);
+    uint8_t val = spc_read_8(snes, addr);
+    spc_set_status_bit(snes, STATUS_ZERO, val == snes->spc.a);
+    spc_set_status_bit(snes, STATUS_NEGATIVE, (snes->spc.a - val) & 0x80);
+    val &= ~snes->spc.a;
+    spc_write_8(snes, addr, val);
 }
 
 OP(xcn) {
     LEGALADDRMODES(SM_ACC);
-    spc.a = ((spc.a & 0xf) << 4) | (spc.a >> 4);
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    snes->spc.a = ((snes->spc.a & 0xf) << 4) | (snes->spc.a >> 4);
+    spc_set_nz(snes, snes->spc.a);
 }
 
 OP(brk) {
     LEGALADDRMODES(SM_IMP);
-    spc.brk = true;
+    snes->spc.brk = true;
 }
 
 OP(daa) {
     LEGALADDRMODES(SM_IMP);
-    if (spc_get_status_bit(STATUS_CARRY) || spc.a > 0x99) {
-        spc.a += 0x60;
-        spc_set_status_bit(STATUS_CARRY, true);
+    if (spc_get_status_bit(snes, STATUS_CARRY) || snes->spc.a > 0x99) {
+        snes->spc.a += 0x60;
+        spc_set_status_bit(snes, STATUS_CARRY, true);
     }
 
-    if (spc_get_status_bit(STATUS_HALFCARRY) || (spc.a & 0xf) > 0x9) {
-        spc.a += 6;
+    if (spc_get_status_bit(snes, STATUS_HALFCARRY) ||
+        (snes->spc.a & 0xf) > 0x9) {
+        snes->spc.a += 6;
     }
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    spc_set_nz(snes, snes->spc.a);
 }
 
 OP(das) {
     LEGALADDRMODES(SM_IMP);
-    if (!spc_get_status_bit(STATUS_CARRY) || spc.a > 0x99) {
-        spc.a -= 0x60;
-        spc_set_status_bit(STATUS_CARRY, false);
+    if (!spc_get_status_bit(snes, STATUS_CARRY) || snes->spc.a > 0x99) {
+        snes->spc.a -= 0x60;
+        spc_set_status_bit(snes, STATUS_CARRY, false);
     }
 
-    if (!spc_get_status_bit(STATUS_HALFCARRY) || (spc.a & 0xf) > 0x9) {
-        spc.a -= 6;
+    if (!spc_get_status_bit(snes, STATUS_HALFCARRY) ||
+        (snes->spc.a & 0xf) > 0x9) {
+        snes->spc.a -= 6;
     }
-    spc_set_status_bit(STATUS_ZERO, spc.a == 0);
-    spc_set_status_bit(STATUS_NEGATIVE, spc.a & 0x80);
+    spc_set_nz(snes, snes->spc.a);
 }
@@ -3,7 +3,8 @@
 
 #include "types.h"
 
-#define OP(name) void spc_##name(spc_addressing_mode_t mode)
+#define OP(name)                                                               \
+    void spc_##name(snes_t *snes, spc_addressing_mode_t mode)
 #define LEGALADDRMODES(modes)                                                  \
     ASSERT((mode & (modes)) != 0,                                              \
            "Illegal address mode for mask: expected %d, found %s", modes,      \
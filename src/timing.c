@@ -0,0 +1,136 @@
+#include "timing.h"
+#include "types.h"
+#include <time.h>
+
+// Host time is charged to whichever section is on top of a small stack, so
+// nested work like a DMA started by a CPU store counts as DMA and not as CPU.
+// Time spent outside of the core, waiting for vsync or drawing the debugger,
+// counts towards nothing. The audio callback runs on its own thread and adds
+// to a separate counter that is folded into the frame it ends in.
+
+static const char *const section_names[TIMING_SECTIONS] = {
+    "other",    "cpu",        "spc",  "draw_bg", "draw_mode_7",
+    "draw_obj", "color_math", "hdma", "dma",     "audio",
+};
+
+const char *timing_section_name(uint32_t section) {
+    return section < TIMING_SECTIONS ? section_names[section] : "total";
+}
+
+uint64_t timing_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void timing_enable(snes_t *snes, bool enabled) {
+    memset(&snes->timing, 0, sizeof(timing_t));
+    snes->timing.enabled = enabled;
+}
+
+// charges the time since the last switch to the section on top
+static void charge(snes_t *snes, uint64_t now) {
+    timing_t *timing = &snes->timing;
+    if (timing->depth > 0) {
+        timing->frame_ns[timing->stack[timing->depth - 1]] +=
+            now - timing->last_ns;
+    }
+    timing->last_ns = now;
+}
+
+void timing_enter(snes_t *snes, timing_section_t section) {
+    timing_t *timing = &snes->timing;
+    ASSERT(timing->depth < ARRAYSIZE(timing->stack),
+           "Timing sections nested %d deep", timing->depth);
+    charge(snes, timing_now());
+    timing->stack[timing->depth++] = section;
+}
+
+void timing_leave(snes_t *snes) {
+    timing_t *timing = &snes->timing;
+    // timing may have been switched on halfway through a section
+    if (timing->depth == 0)
+        return;
+    charge(snes, timing_now());
+    timing->depth--;
+}
+
+void timing_add_audio(snes_t *snes, uint64_t ns) {
+    __atomic_fetch_add(&snes->timing.audio_ns, ns, __ATOMIC_RELAXED);
+}
+
+void timing_end_frame(snes_t *snes) {
+    timing_t *timing = &snes->timing;
+    if (!timing->enabled)
+        return;
+    charge(snes, timing_now());
+    timing->frame_ns[TIMING_AUDIO] +=
+        __atomic_exchange_n(&timing->audio_ns, 0, __ATOMIC_RELAXED);
+
+    float *row = timing->history[timing->frames % TIMING_HISTORY];
+    row[TIMING_SECTIONS] = 0;
+    for (uint32_t i = 0; i < TIMING_SECTIONS; i++) {
+        row[i] = timing->frame_ns[i] / 1e6f;
+        row[TIMING_SECTIONS] += row[i];
+        timing->total_ns[i] += timing->frame_ns[i];
+        timing->frame_ns[i] = 0;
+    }
+    timing->frames++;
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+float timing_percentile(snes_t *snes, uint32_t section, float p) {
+    timing_t *timing = &snes->timing;
+    uint32_t count = MIN(timing->frames, TIMING_HISTORY);
+    if (count == 0)
+        return 0;
+    float sorted[TIMING_HISTORY];
+    for (uint32_t i = 0; i < count; i++) {
+        sorted[i] = timing->history[i][section];
+    }
+    qsort(sorted, count, sizeof(float), compare_floats);
+    return sorted[MIN((uint32_t)(p * count), count - 1)];
+}
+
+bool timing_write_json(snes_t *snes, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        log_message(LOG_LEVEL_WARNING, "Could not open %s for writing", path);
+        return false;
+    }
+    timing_t *timing = &snes->timing;
+    uint64_t total_ns = 0;
+    for (uint32_t i = 0; i < TIMING_SECTIONS; i++) {
+        total_ns += timing->total_ns[i];
+    }
+    uint32_t frames = MAX(timing->frames, 1);
+
+    // percentiles only cover the frames still in the history
+    fprintf(f, "{\n");
+    fprintf(f, "  \"frames\": %u,\n", timing->frames);
+    fprintf(f, "  \"total_ms\": %.3f,\n", total_ns / 1e6);
+    fprintf(
+        f, "  \"frame_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f},\n",
+        total_ns / 1e6 / frames, timing_percentile(snes, TIMING_SECTIONS, 0.5f),
+        timing_percentile(snes, TIMING_SECTIONS, 0.99f));
+    fprintf(f, "  \"sections\": {\n");
+    for (uint32_t i = 0; i < TIMING_SECTIONS; i++) {
+        fprintf(f,
+                "    \"%s\": {\"total_ms\": %.3f, \"share\": %.4f, "
+                "\"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f}%s\n",
+                section_names[i], timing->total_ns[i] / 1e6,
+                (double)timing->total_ns[i] / MAX(total_ns, 1),
+                timing->total_ns[i] / 1e6 / frames,
+                timing_percentile(snes, i, 0.5f),
+                timing_percentile(snes, i, 0.99f),
+                i + 1 < TIMING_SECTIONS ? "," : "");
+    }
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include "types.h"
+
+// the hooks cost a load and a branch while timing is off
+#define TIMING_ENTER(snes, section)                                            \
+    do {                                                                       \
+        if ((snes)->timing.enabled)                                            \
+            timing_enter(snes, section);                                       \
+    } while (0)
+#define TIMING_LEAVE(snes)                                                     \
+    do {                                                                       \
+        if ((snes)->timing.enabled)                                            \
+            timing_leave(snes);                                                \
+    } while (0)
+
+EXTERNC const char *timing_section_name(uint32_t section);
+
+// clears everything recorded so far
+EXTERNC void timing_enable(snes_t *snes, bool enabled);
+EXTERNC uint64_t timing_now(void);
+// time from here on counts towards section, until the matching leave
+EXTERNC void timing_enter(snes_t *snes, timing_section_t section);
+EXTERNC void timing_leave(snes_t *snes);
+// thread safe, for the audio callback
+EXTERNC void timing_add_audio(snes_t *snes, uint64_t ns);
+// called by the PPU when the beam wraps around
+EXTERNC void timing_end_frame(snes_t *snes);
+
+// milliseconds, over the frames still in the history. Section TIMING_SECTIONS
+// is the frame total.
+EXTERNC float timing_percentile(snes_t *snes, uint32_t section, float p);
+EXTERNC bool timing_write_json(snes_t *snes, const char *path);
+
+#endif
@@ -1,7 +1,6 @@
 #ifndef TYPES_H_
 #define TYPES_H_
 
-#include "raylib.h"
 #include <assert.h>
 #include <math.h>
 #include <stdarg.h>
@@ -28,8 +27,9 @@ static void log_message(log_level_t level, char *message, ...);
                         __LINE__);                                             \
             log_message(LOG_LEVEL_ERROR, msg, __VA_ARGS__);                    \
             log_message(LOG_LEVEL_ERROR, (char*)"CPU PC: 0x%04x, bank: 0x%02x",       \
-                        cpu.pc, cpu.pbr);                                      \
-            log_message(LOG_LEVEL_ERROR, (char*)"SPC PC: 0x%04x", spc.pc);            \
+                        snes->cpu.pc, snes->cpu.pbr);                          \
+            log_message(LOG_LEVEL_ERROR, (char*)"SPC PC: 0x%04x",             \
+                        snes->spc.pc);                                         \
             exit(1);                                                           \
         }                                                                      \
     } while (0)
@@ -55,7 +55,16 @@ static void log_message(log_level_t level, char *message, ...);
 #define WINDOW_HEIGHT 224
 #define CLOCK_FREQ 21477268
 #define CYCLES_PER_DOT 4
+// the SPC700 runs at 1.024 MHz against the 21.477 MHz master clock, 5632 SPC
+// cycles pass for every 118125 master clocks. SPC time is counted in 1/5632 of
+// a master clock so that both move in whole steps, one SPC cycle is then
+// SPC_CYCLE_SCALED_MASTER_CLOCKS of those
+#define SPC_CLOCK_SCALE 5632
+#define SPC_CYCLE_SCALED_MASTER_CLOCKS 118125
 #define SAMPLE_RATE 32000.f
+#define MMU_PAGE_BITS 12
+#define MMU_PAGE_SIZE (1 << MMU_PAGE_BITS)
+#define MMU_PAGES (0x1000000 >> MMU_PAGE_BITS)
 
 typedef enum { LOROM, HIROM, EXHIROM } memory_map_mode_t;
 
@@ -139,10 +148,26 @@ typedef enum { BPP_2 = 2, BPP_4 = 4, BPP_8 = 8 } color_depth_t;
 
 typedef enum { ATTACK, DECAY, SUSTAIN, RELEASE } adsr_state_t;
 
+typedef enum {
+    TIMING_OTHER,
+    TIMING_CPU,
+    TIMING_SPC,
+    TIMING_DRAW_BG,
+    TIMING_DRAW_MODE_7,
+    TIMING_DRAW_OBJ,
+    TIMING_COLOR_MATH,
+    TIMING_HDMA,
+    TIMING_DMA,
+    TIMING_AUDIO,
+    TIMING_SECTIONS
+} timing_section_t;
+
 typedef struct {
     const char *name;
     const uint32_t hash;
     const memory_map_mode_t mode;
+    // games that break when polling loops are skipped, see cpu_idle.c
+    const bool no_idle_loops;
 } cart_hash_t;
 
 typedef struct {
@@ -152,6 +177,21 @@ typedef struct {
     bool read, write, execute;
 } breakpoint_t;
 
+typedef enum {
+    BREAKPOINT_READ = 1,
+    BREAKPOINT_WRITE = 2,
+    BREAKPOINT_EXECUTE = 4,
+} breakpoint_kind_t;
+
+// breakpoint_t lists flattened into per address flags, see breakpoints.c
+typedef struct {
+    // all kinds of breakpoint set anywhere, accesses skip the lookup when
+    // their kind isn't in here
+    uint8_t kinds;
+    // breakpoint_kind_t flags per address, allocated per bank on demand
+    uint8_t *banks[0x100];
+} breakpoint_index_t;
+
 typedef struct {
     uint8_t *rom;
     uint32_t rom_size;
@@ -196,12 +236,17 @@ typedef struct {
     uint16_t joy1l, joy1h, joy1l_latched, joy1h_latched;
     uint16_t joy2l, joy2h, joy2l_latched, joy2h_latched;
     uint8_t joy1_shift_idx, joy2_shift_idx;
+
+    // MEMSEL, ROM from bank $80 up takes 6 master clocks instead of 8
+    bool fast_rom;
 } cpu_mmu_t;
 
 typedef struct {
     cpu_mmu_t memory;
-    double remaining_clocks;
+    // master clocks
+    int64_t remaining_clocks;
     bool vblank_nmi_enable;
+    bool prev_vblank;
     uint8_t timer_irq;
     bool emulation_mode;
     bool irq;
@@ -209,21 +254,25 @@ typedef struct {
     bool cop;
     bool waiting;
 
+    uint16_t pc, c, x, y, d, s;
+    uint8_t dbr, pbr, p;
+
+    // debugger and frontend state from here on, left out of save states
     char *file_name;
 
     emu_state_t state;
     double speed;
     bool break_next_frame, break_next_scanline;
 
-    breakpoint_t *breakpoints;
-    uint32_t breakpoints_size;
+    breakpoint_index_t breakpoints;
 
     uint8_t opcode_history[0x10000];
     uint32_t pc_history[0x10000];
     uint16_t history_idx;
 
-    uint16_t pc, c, x, y, d, s;
-    uint8_t dbr, pbr, p;
+    // N is bit 15 of n_result and Z is set if z_result is 0, the bits in p
+    // are stale. Save states store p as cpu_get_p returns it instead
+    uint16_t n_result, z_result;
 } cpu_t;
 
 typedef struct {
@@ -269,7 +318,6 @@ typedef struct {
         uint8_t counter;
         uint8_t timer_internal;
     } timers[3];
-    AudioStream stream;
     dsp_channel_t channels[8];
     uint8_t coefficients[8];
     int8_t vol_left, vol_right, echo_left, echo_right;
@@ -287,21 +335,31 @@ typedef struct {
     uint8_t noise_freq;
 
     uint8_t dsp_addr;
+
+    uint16_t smp_counter;
+    uint16_t noise_generator;
+    float noise_generator_timer;
 } spc_mmu_t;
 
 typedef struct {
     spc_mmu_t memory;
     uint8_t a, x, y, s, p;
     uint16_t pc;
-    double remaining_clocks;
-    breakpoint_t *breakpoints;
-    uint32_t breakpoints_size;
+    // in 1/SPC_CLOCK_SCALE of a master clock
+    int64_t remaining_clocks;
     bool enable_ipl;
     bool brk;
+    uint8_t timer_timer, fast_timer_timer;
+
+    // debugger state from here on, left out of save states
+    breakpoint_index_t breakpoints;
 
     uint8_t opcode_history[0x10000];
     uint16_t pc_history[0x10000];
     uint16_t history_idx;
+
+    // N is bit 7 of n_result and Z is set if z_result is 0, as for the CPU
+    uint8_t n_result, z_result;
 } spc_t;
 
 typedef struct {
@@ -312,7 +370,7 @@ typedef struct {
     uint8_t brightness;
     uint8_t address_increment_amount, address_remapping;
     bool address_increment_mode;
-    double remaining_clocks;
+    int64_t remaining_clocks;
     uint16_t beam_x, beam_y;
     bool beam_x_latch, beam_y_latch, counter_latch;
     uint16_t beam_x_latch_content, beam_y_latch_content;
@@ -368,8 +426,8 @@ typedef struct {
     uint16_t mode_7_center_x, mode_7_center_y;
     int16_t mul_factor_1;
     int8_t mul_factor_2;
-    uint16_t a_7_buffer, b_7_buffer, c_7_buffer, d_7_buffer;
-    float a_7, b_7, c_7, d_7;
+    // the mode 7 matrix, signed 8.8 fixed point
+    int16_t a_7, b_7, c_7, d_7;
     uint8_t mode_7_latch;
 
     uint16_t vram_addr;
@@ -403,53 +461,307 @@ typedef struct {
     } oam[128];
 } ppu_t;
 
+#define TIMING_HISTORY 256
+
+// host time spent per section, see timing.c
+typedef struct {
+    bool enabled;
+    // the section being timed and the ones it interrupted
+    uint8_t stack[8];
+    uint8_t depth;
+    uint64_t last_ns;
+    uint64_t frame_ns[TIMING_SECTIONS];
+    // added to from the audio thread
+    uint64_t audio_ns;
+
+    // milliseconds per frame and section, the last column is the frame total
+    float history[TIMING_HISTORY][TIMING_SECTIONS + 1];
+    uint32_t frames;
+    uint64_t total_ns[TIMING_SECTIONS];
+} timing_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t ns;
+} profile_entry_t;
+
+// executions and host time per opcode, see profiler.c
+typedef struct {
+    bool enabled;
+    // indexed by the M, X and E flags at fetch time, then by opcode
+    profile_entry_t cpu[8][0x100];
+    profile_entry_t spc[0x100];
+} profiler_t;
+
+// M, X and E, which decide register and operand widths. E implies the other
+// two, so only five of the combinations occur
+#define CPU_FLAG_M 1
+#define CPU_FLAG_X 2
+#define CPU_FLAG_E 4
+#define CPU_FLAG_COMBINATIONS 8
+
+#define CPU_BLOCK_SIZE 16
+#define CPU_BLOCKS 0x1000
+
+struct snes_t;
+
+// one instruction of a decoded block, see cpu_blocks.c
+typedef struct {
+    uint32_t addr;
+    uint8_t opcode;
+    // master clocks charged for it
+    uint8_t clocks;
+    void (*op)(struct snes_t *snes);
+    // host address of the operand bytes
+    const uint8_t *operands;
+} cpu_uop_t;
+
+typedef struct {
+    uint32_t addr;
+    // M, X and E the block was decoded under
+    uint8_t flags;
+    // 0 if the code at addr can't be cached
+    uint8_t size;
+    // counter of the page holding the code, the block is stale once it no
+    // longer matches generation_seen
+    const uint32_t *generation;
+    uint32_t generation_seen;
+    cpu_uop_t uops[CPU_BLOCK_SIZE];
+} cpu_block_t;
+
+typedef struct {
+    cpu_block_t blocks[CPU_BLOCKS];
+    // block being executed and index of its next instruction
+    cpu_block_t *current;
+    uint8_t next;
+    // ROM is never written, its blocks all share this counter
+    uint32_t rom_generation;
+} cpu_block_cache_t;
+
+#define CPU_JIT_BLOCK_BITS 14
+
+// a ROM block compiled to native code, see cpu_jit.c
+typedef struct {
+    uint32_t addr;
+    uint8_t flags;
+    // times the block was reached before it was compiled
+    uint8_t hits;
+    // the code at addr can't be compiled, it's left to the interpreter
+    bool rejected;
+    // rom_generation of the block cache it was compiled under
+    uint32_t generation_seen;
+    // runs the block and returns the opcode and PBR:PC of the last
+    // instruction it ran, as opcode << 24 | PBR:PC. NULL until the block is
+    // hot
+    uint32_t (*code)(struct snes_t *snes);
+} cpu_jit_block_t;
+
+typedef struct {
+    cpu_jit_block_t blocks[1 << CPU_JIT_BLOCK_BITS];
+    // executable memory the blocks are compiled into, and how much of it is
+    // taken
+    uint8_t *code;
+    uint32_t used;
+} cpu_jit_cache_t;
+
+typedef struct {
+    // leaves every instruction to the interpreter, to compare against
+    bool disabled;
+    // NULL without a cart or on hosts the JIT can't run on
+    cpu_jit_cache_t *cache;
+} cpu_jit_t;
+
+#define CPU_IDLE_LOOP_BYTES 16
+#define CPU_IDLE_LOOP_OPS 8
+#define CPU_IDLE_LOOP_READS 4
+
+// the registers an instruction of an idle loop starts from or leaves behind
+typedef struct {
+    uint16_t pc, c, x, y, d, s;
+    uint8_t dbr, pbr, p;
+    bool emulation_mode;
+    uint16_t n_result, z_result;
+} cpu_idle_regs_t;
+
+// one instruction of an idle loop, see cpu_idle.c
+typedef struct {
+    uint32_t addr;
+    uint8_t opcode;
+    uint16_t clocks;
+    // everything it read from the bus and what came back
+    uint8_t reads;
+    uint32_t read_addrs[CPU_IDLE_LOOP_READS];
+    uint8_t read_values[CPU_IDLE_LOOP_READS];
+    cpu_idle_regs_t before, after;
+} cpu_idle_op_t;
+
+typedef enum {
+    CPU_IDLE_OFF,
+    CPU_IDLE_RECORDING,
+    CPU_IDLE_LOCKED,
+} cpu_idle_state_t;
+
+typedef struct {
+    cpu_idle_state_t state;
+    // set for carts that must run every instruction, and by --no-idle-skip
+    bool disabled;
+    // PBR:PC the loop branches back to and of the branch doing it
+    uint32_t head, end;
+    // loop the watcher gave up on, it isn't recorded again until another one
+    // has been
+    uint32_t rejected;
+    uint8_t attempts;
+    // page holding the loop and its write counter when it was recorded
+    uint32_t page;
+    uint32_t generation_seen;
+    cpu_idle_op_t ops[CPU_IDLE_LOOP_OPS];
+    uint8_t size, next;
+} cpu_idle_t;
+
+// the CPU running through the dots before the next PPU event, see snes.c
+typedef struct {
+    bool active;
+    // the CPU's clocks when its current instruction started, counted from the
+    // end of the run
+    int64_t op_clocks;
+    // dots the beam still has to move over to catch up with the CPU
+    uint32_t ppu_dots_owed;
+    // set by writes that move the next PPU event, the run ends after the
+    // instruction
+    bool cut;
+    // set by every register access, compiled code hands back to the
+    // interpreter after the instruction
+    bool mmio;
+} cpu_run_t;
+
+// VRAM decoded to one byte per pixel for each color depth, 64 bytes a tile,
+// see ppu.c
+typedef struct {
+    uint8_t pixels_2bpp[0x10000 / 16][64];
+    uint8_t pixels_4bpp[0x10000 / 32][64];
+    uint8_t pixels_8bpp[0x10000 / 64][64];
+    bool valid_2bpp[0x10000 / 16];
+    bool valid_4bpp[0x10000 / 32];
+    bool valid_8bpp[0x10000 / 64];
+} tile_cache_t;
+
+// the layers that are drawn and have windows of their own, in the order they
+// are merged. The color window only decides where color math happens.
+enum {
+    LAYER_BG1,
+    LAYER_BG2,
+    LAYER_BG3,
+    LAYER_BG4,
+    LAYER_OBJ,
+    LAYER_COL,
+};
+
+// one bit for each pixel of a line that a layer's windows cover, built from
+// the window registers when they changed since the last line drawn
+typedef struct {
+    uint64_t masks[LAYER_COL + 1][WINDOW_WIDTH / 64];
+    bool dirty;
+} window_masks_t;
+
+// one line of a BG or of the sprites, drawn before the layers are merged. The
+// color is an index into cgram, priority 0 where the layer is transparent.
+typedef struct {
+    uint8_t color[WINDOW_WIDTH];
+    uint8_t priority[WINDOW_WIDTH];
+} layer_line_t;
+
+// everything belonging to one console. Nothing in the core keeps state outside
+// of this, so any number of machines can run side by side
+typedef struct snes_t {
+    cpu_t cpu;
+    ppu_t ppu;
+    spc_t spc;
+
+    uint8_t framebuffer[WINDOW_WIDTH * WINDOW_HEIGHT * 4];
+    // the line being drawn, one for each BG and one for the sprites
+    layer_line_t layer_lines[LAYER_OBJ + 1];
+    // set while emulating frames nobody will see, lines are not drawn but
+    // sprite evaluation still runs. Not part of save states.
+    bool skip_render;
+    // buffer a run-ahead clone gets the state of the machine it follows
+    // through, kept from frame to frame. Not part of save states.
+    uint8_t *run_ahead_state;
+    uint32_t run_ahead_state_size;
+    // host pointers to every MMU page that is plain ROM, RAM or SRAM, built
+    // when a cart is loaded. NULL pages go through mmu_read and mmu_write.
+    // Not part of save states.
+    uint8_t *read_pages[MMU_PAGES];
+    uint8_t *write_pages[MMU_PAGES];
+    // bumped on every write through the page, points into wram_generation or
+    // at sram_generation
+    uint32_t *write_generations[MMU_PAGES];
+    // master clocks the CPU spends on an access to each page, 0 for the page
+    // at $4000 whose first $200 bytes are slower than the rest
+    uint8_t access_clocks[MMU_PAGES];
+    uint32_t wram_generation[0x20000 >> MMU_PAGE_BITS];
+    uint32_t sram_generation;
+    cpu_block_cache_t *block_cache;
+    // not part of save states, the ROM it's compiled from doesn't change
+    cpu_jit_t cpu_jit;
+    cpu_idle_t cpu_idle;
+    // not part of save states, only set while snes_run_frame or
+    // snes_run_dots runs
+    cpu_run_t cpu_run;
+    // not part of save states, loading one drops it
+    tile_cache_t tile_cache;
+    // cgram at the current master brightness, rebuilt when either changes so
+    // drawing a pixel is one lookup. Not part of save states.
+    uint32_t palette[0x100];
+    // not part of save states, loading one rebuilds it
+    window_masks_t window_masks;
+    // operand bytes of the cached instruction being executed, if any
+    const uint8_t *cpu_fetch;
+    timing_t timing;
+    profiler_t profiler;
+} snes_t;
+
 #ifdef __cplusplus
 #define EXTERNC extern "C"
 #else
 #define EXTERNC
 #endif
-EXTERNC uint32_t lo_rom_resolve(uint32_t addr, bool log);
-EXTERNC uint32_t hi_rom_resolve(uint32_t addr, bool log);
-EXTERNC uint32_t ex_hi_rom_resolve(uint32_t addr, bool log);
-EXTERNC void set_status_bit(status_bit_t bit, bool value);
-EXTERNC bool get_status_bit(status_bit_t bit);
-EXTERNC void spc_set_status_bit(status_bit_t bit, bool value);
-EXTERNC bool spc_get_status_bit(status_bit_t bit);
-EXTERNC uint32_t resolve_addr(addressing_mode_t mode);
-EXTERNC uint16_t resolve_read8(addressing_mode_t mode);
-EXTERNC uint16_t resolve_read16(addressing_mode_t mode, bool respect_x,
-                                bool respect_m);
-EXTERNC uint16_t spc_resolve_addr(spc_addressing_mode_t mode);
-EXTERNC uint8_t spc_resolve_read(spc_addressing_mode_t mode);
-EXTERNC void spc_resolve_write(spc_addressing_mode_t mode, uint8_t val);
-
-EXTERNC uint8_t read_8(uint16_t addr, uint8_t bank);
-EXTERNC uint8_t read_8_no_log(uint16_t addr, uint8_t bank);
-EXTERNC uint16_t read_16(uint16_t addr, uint8_t bank);
-EXTERNC uint32_t read_24(uint16_t addr, uint8_t bank);
-EXTERNC uint16_t read_r(r_t reg);
-EXTERNC uint8_t next_8(void);
-EXTERNC uint16_t next_16(void);
-EXTERNC void write_8(uint16_t addr, uint8_t bank, uint8_t val);
-EXTERNC void write_16(uint16_t addr, uint8_t bank, uint16_t val);
-EXTERNC void write_r(r_t reg, uint16_t val);
-EXTERNC void push_8(uint8_t val);
-EXTERNC void push_16(uint16_t val);
-EXTERNC void push_24(uint32_t val);
-EXTERNC uint8_t pop_8(void);
-EXTERNC uint16_t pop_16(void);
-EXTERNC uint32_t pop_24(void);
-EXTERNC uint8_t spc_read_8(uint16_t addr);
-EXTERNC uint8_t spc_read_8_no_log(uint16_t addr);
-EXTERNC uint16_t spc_read_16(uint16_t addr);
-EXTERNC uint8_t spc_next_8(void);
-EXTERNC uint16_t spc_next_16(void);
-EXTERNC void spc_write_8(uint16_t addr, uint8_t val);
-EXTERNC void spc_write_16(uint16_t addr, uint16_t val);
-EXTERNC void spc_push_8(uint8_t val);
-EXTERNC void spc_push_16(uint16_t val);
-EXTERNC uint8_t spc_pop_8(void);
-EXTERNC uint16_t spc_pop_16(void);
+EXTERNC uint32_t lo_rom_resolve(snes_t *snes, uint32_t addr, bool log);
+EXTERNC uint32_t hi_rom_resolve(snes_t *snes, uint32_t addr, bool log);
+EXTERNC uint32_t ex_hi_rom_resolve(snes_t *snes, uint32_t addr, bool log);
+EXTERNC uint16_t spc_resolve_addr(snes_t *snes, spc_addressing_mode_t mode);
+EXTERNC uint8_t spc_resolve_read(snes_t *snes, spc_addressing_mode_t mode);
+EXTERNC void spc_resolve_write(snes_t *snes, spc_addressing_mode_t mode,
+                               uint8_t val);
+
+EXTERNC uint8_t read_8(snes_t *snes, uint16_t addr, uint8_t bank);
+EXTERNC uint8_t read_8_no_log(snes_t *snes, uint16_t addr, uint8_t bank);
+EXTERNC uint16_t read_16(snes_t *snes, uint16_t addr, uint8_t bank);
+EXTERNC uint32_t read_24(snes_t *snes, uint16_t addr, uint8_t bank);
+EXTERNC uint8_t next_8(snes_t *snes);
+EXTERNC uint16_t next_16(snes_t *snes);
+EXTERNC uint32_t next_24(snes_t *snes);
+EXTERNC void write_8(snes_t *snes, uint16_t addr, uint8_t bank, uint8_t val);
+EXTERNC void write_16(snes_t *snes, uint16_t addr, uint8_t bank, uint16_t val);
+EXTERNC uint8_t dma_read_8(snes_t *snes, uint16_t addr, uint8_t bank);
+EXTERNC void dma_write_8(snes_t *snes, uint16_t addr, uint8_t bank,
+                         uint8_t val);
+EXTERNC void push_8(snes_t *snes, uint8_t val);
+EXTERNC void push_16(snes_t *snes, uint16_t val);
+EXTERNC void push_24(snes_t *snes, uint32_t val);
+EXTERNC uint8_t pop_8(snes_t *snes);
+EXTERNC uint16_t pop_16(snes_t *snes);
+EXTERNC uint32_t pop_24(snes_t *snes);
+EXTERNC uint8_t spc_read_8(snes_t *snes, uint16_t addr);
+EXTERNC uint8_t spc_read_8_no_log(snes_t *snes, uint16_t addr);
+EXTERNC uint16_t spc_read_16(snes_t *snes, uint16_t addr);
+EXTERNC uint8_t spc_next_8(snes_t *snes);
+EXTERNC uint16_t spc_next_16(snes_t *snes);
+EXTERNC void spc_write_8(snes_t *snes, uint16_t addr, uint8_t val);
+EXTERNC void spc_write_16(snes_t *snes, uint16_t addr, uint16_t val);
+EXTERNC void spc_push_8(snes_t *snes, uint8_t val);
+EXTERNC void spc_push_16(snes_t *snes, uint16_t val);
+EXTERNC uint8_t spc_pop_8(snes_t *snes);
+EXTERNC uint16_t spc_pop_16(snes_t *snes);
 EXTERNC uint16_t r8g8b8a8_to_r5g5b5(uint32_t in);
 EXTERNC uint32_t r5g5b5_to_r8g8b8a8(uint16_t in);
 EXTERNC uint32_t r5g5b5_components_to_r8g8b8a8(uint8_t r, uint8_t g, uint8_t b);
@@ -485,4 +797,104 @@ static void log_message(log_level_t level, char *message, ...) {
 #endif
 }
 
+// Nearly every instruction sets N and Z, so rather than updating p they store
+// the value the flags come from and the flags are worked out when read. p as
+// a whole is only put together for the stack, save states and the debugger.
+
+static inline bool get_status_bit(snes_t *snes, status_bit_t bit) {
+    switch (bit) {
+    case STATUS_ZERO:
+        return snes->cpu.z_result == 0;
+    case STATUS_NEGATIVE:
+        return snes->cpu.n_result & 0x8000;
+    default:
+        if (snes->cpu.emulation_mode)
+            snes->cpu.p |= 0b110000;
+        return snes->cpu.p & (1 << bit);
+    }
+}
+
+static inline void set_status_bit(snes_t *snes, status_bit_t bit, bool value) {
+    switch (bit) {
+    case STATUS_ZERO:
+        snes->cpu.z_result = !value;
+        break;
+    case STATUS_NEGATIVE:
+        snes->cpu.n_result = value ? 0x8000 : 0;
+        break;
+    default:
+        if (value) {
+            snes->cpu.p |= 1 << bit;
+        } else {
+            snes->cpu.p &= ~(1 << bit);
+        }
+        if (snes->cpu.emulation_mode)
+            snes->cpu.p |= 0b110000;
+    }
+}
+
+// sets N and Z from a result, narrow results are 8 bits wide
+static inline void cpu_set_nz(snes_t *snes, uint16_t val, bool narrow) {
+    snes->cpu.z_result = narrow ? U16_LOBYTE(val) : val;
+    snes->cpu.n_result = narrow ? val << 8 : val;
+}
+
+static inline uint8_t cpu_get_p(snes_t *snes) {
+    return (snes->cpu.p & 0b01111101) |
+           get_status_bit(snes, STATUS_NEGATIVE) << STATUS_NEGATIVE |
+           get_status_bit(snes, STATUS_ZERO) << STATUS_ZERO;
+}
+
+static inline void cpu_set_p(snes_t *snes, uint8_t p) {
+    snes->cpu.p = p;
+    set_status_bit(snes, STATUS_NEGATIVE, p & (1 << STATUS_NEGATIVE));
+    set_status_bit(snes, STATUS_ZERO, p & (1 << STATUS_ZERO));
+}
+
+static inline bool spc_get_status_bit(snes_t *snes, status_bit_t bit) {
+    switch (bit) {
+    case STATUS_ZERO:
+        return snes->spc.z_result == 0;
+    case STATUS_NEGATIVE:
+        return snes->spc.n_result & 0x80;
+    default:
+        return snes->spc.p & (1 << bit);
+    }
+}
+
+static inline void spc_set_status_bit(snes_t *snes, status_bit_t bit,
+                                      bool value) {
+    switch (bit) {
+    case STATUS_ZERO:
+        snes->spc.z_result = !value;
+        break;
+    case STATUS_NEGATIVE:
+        snes->spc.n_result = value ? 0x80 : 0;
+        break;
+    default:
+        if (value) {
+            snes->spc.p |= 1 << bit;
+        } else {
+            snes->spc.p &= ~(1 << bit);
+        }
+    }
+}
+
+static inline void spc_set_nz(snes_t *snes, uint8_t val) {
+    snes->spc.z_result = val;
+    snes->spc.n_result = val;
+}
+
+static inline uint8_t spc_get_p(snes_t *snes) {
+    return (snes->spc.p & 0b01111101) |
+           spc_get_status_bit(snes, STATUS_NEGATIVE) << STATUS_NEGATIVE |
+           spc_get_status_bit(snes, STATUS_ZERO) << STATUS_ZERO;
+}
+
+static inline void spc_set_p(snes_t *snes, uint8_t p) {
+    snes->spc.p = p;
+    spc_set_status_bit(snes, STATUS_NEGATIVE, p & (1 << STATUS_NEGATIVE));
+    spc_set_status_bit(snes, STATUS_ZERO, p & (1 << STATUS_ZERO));
+}
+
 #endif
@@ -1,5 +1,11 @@
 #include "ui.h"
+#include "breakpoints.h"
+#include "profiler.h"
+#include "snes.h"
+#include "timing.h"
 #include "types.h"
+#include <algorithm>
+#include <cfloat>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -7,23 +13,23 @@
 #include "imgui.h"
 #include "rlImGui.h"
 
-extern cpu_t cpu;
-extern ppu_t ppu;
-extern spc_t spc;
+// the debugger inspects a single machine, handed over in cpp_init
+static snes_t *snes = NULL;
 
 bool confirm_save = false, confirm_load = false;
+bool confirm_save_state = false, confirm_load_state = false;
 std::vector<breakpoint_t> cpu_bp;
 void cpu_window(void) {
     ImGui::Begin("cpu", NULL, ImGuiWindowFlags_HorizontalScrollbar);
     if (ImGui::Button(confirm_save ? "Confirm Save##save" : "Save##save")) {
         if (confirm_save) {
             std::fstream f;
-            f.open(std::string(cpu.file_name) + ".wsav",
+            f.open(std::string(snes->cpu.file_name) + ".wsav",
                    f.binary | f.out | f.trunc);
-            f.write(reinterpret_cast<char *>(&cpu.memory.sram_size),
-                    sizeof(cpu.memory.sram_size));
-            f.write(reinterpret_cast<char *>(cpu.memory.sram),
-                    cpu.memory.sram_size);
+            f.write(reinterpret_cast<char *>(&snes->cpu.memory.sram_size),
+                    sizeof(snes->cpu.memory.sram_size));
+            f.write(reinterpret_cast<char *>(snes->cpu.memory.sram),
+                    snes->cpu.memory.sram_size);
             f.close();
             confirm_save = false;
         } else {
@@ -34,15 +40,15 @@ void cpu_window(void) {
     if (ImGui::Button(confirm_load ? "Confirm Load##load" : "Load##load")) {
         if (confirm_load) {
             std::fstream f;
-            f.open(std::string(cpu.file_name) + ".wsav", f.binary | f.in);
+            f.open(std::string(snes->cpu.file_name) + ".wsav", f.binary | f.in);
             uint32_t sram_size;
             f.read(reinterpret_cast<char *>(&sram_size), sizeof(sram_size));
-            if (cpu.memory.sram_size == sram_size) {
-                f.read(reinterpret_cast<char *>(cpu.memory.sram),
-                       cpu.memory.sram_size);
+            if (snes->cpu.memory.sram_size == sram_size) {
+                f.read(reinterpret_cast<char *>(snes->cpu.memory.sram),
+                       snes->cpu.memory.sram_size);
             } else {
                 ASSERT(0, (char *)"Expected SRAM size %d, found %d",
-                       cpu.memory.sram_size, sram_size);
+                       snes->cpu.memory.sram_size, sram_size);
             }
             f.close();
             confirm_load = false;
@@ -50,64 +56,103 @@ void cpu_window(void) {
             confirm_load = true;
         }
     }
-    ImGui::Text("PC: 0x%06x Opcode: 0x%02x", cpu.pc + (cpu.pbr << 16),
-                read_8_no_log(cpu.pc, cpu.pbr));
+    ImGui::SameLine();
+    if (ImGui::Button(confirm_save_state ? "Confirm Save State##save_state"
+                                         : "Save State##save_state")) {
+        if (confirm_save_state) {
+            std::vector<uint8_t> state(snes_save_state_size(snes));
+            uint32_t size = snes_save_state(snes, state.data());
+            std::fstream f;
+            f.open(std::string(snes->cpu.file_name) + ".wsst",
+                   f.binary | f.out | f.trunc);
+            f.write(reinterpret_cast<char *>(state.data()), size);
+            f.close();
+            confirm_save_state = false;
+        } else {
+            confirm_save_state = true;
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button(confirm_load_state ? "Confirm Load State##load_state"
+                                         : "Load State##load_state")) {
+        if (confirm_load_state) {
+            std::fstream f;
+            f.open(std::string(snes->cpu.file_name) + ".wsst", f.binary | f.in);
+            std::vector<uint8_t> state(std::istreambuf_iterator<char>(f), {});
+            f.close();
+            if (!snes_load_state(snes, state.data(), state.size())) {
+                log_message(LOG_LEVEL_WARNING, (char *)"Could not load %s.wsst",
+                            snes->cpu.file_name);
+            }
+            confirm_load_state = false;
+        } else {
+            confirm_load_state = true;
+        }
+    }
+    ImGui::Text("PC: 0x%06x Opcode: 0x%02x",
+                snes->cpu.pc + (snes->cpu.pbr << 16),
+                read_8_no_log(snes, snes->cpu.pc, snes->cpu.pbr));
     if (ImGui::Button("Start"))
-        cpu.state = STATE_RUNNING;
+        snes->cpu.state = STATE_RUNNING;
     ImGui::SameLine();
     if (ImGui::Button("Stop"))
-        cpu.state = STATE_STOPPED;
+        snes->cpu.state = STATE_STOPPED;
     ImGui::SameLine();
     if (ImGui::Button("Step"))
-        cpu.state = STATE_CPU_STEPPED;
+        snes->cpu.state = STATE_CPU_STEPPED;
     ImGui::SameLine();
     if (ImGui::Button("Run Scanline")) {
-        cpu.state = STATE_RUNNING;
-        cpu.break_next_scanline = true;
+        snes->cpu.state = STATE_RUNNING;
+        snes->cpu.break_next_scanline = true;
     }
     ImGui::SameLine();
     if (ImGui::Button("Run Frame")) {
-        cpu.state = STATE_RUNNING;
-        cpu.break_next_frame = true;
+        snes->cpu.state = STATE_RUNNING;
+        snes->cpu.break_next_frame = true;
     }
     ImGui::SameLine();
     if (ImGui::Button("Dump State")) {
-        for (uint16_t i = cpu.history_idx; i != cpu.history_idx - 1; i++) {
-            printf("0x%06x: 0x%02x\t 0x%04x: 0x%02x\n", cpu.pc_history[i],
-                   cpu.opcode_history[i], spc.pc_history[i],
-                   spc.opcode_history[i]);
+        for (uint16_t i = snes->cpu.history_idx; i != snes->cpu.history_idx - 1;
+             i++) {
+            printf("0x%06x: 0x%02x\t 0x%04x: 0x%02x\n", snes->cpu.pc_history[i],
+                   snes->cpu.opcode_history[i], snes->spc.pc_history[i],
+                   snes->spc.opcode_history[i]);
         }
     }
-    ImGui::Text("Speed: %.4lfx", cpu.speed);
+    ImGui::Text("Speed: %.4lfx", snes->cpu.speed);
     ImGui::NewLine();
-    ImGui::Text("Mode: %s", cpu.emulation_mode ? "emulation" : "native");
-    ImGui::Text("C: 0x%04x, %s", cpu.c,
-                (cpu.emulation_mode || get_status_bit(STATUS_MEMNARROW))
-                    ? "short"
-                    : "long");
-    ImGui::Text("X: 0x%04x, %s", cpu.x,
-                (cpu.emulation_mode || get_status_bit(STATUS_XNARROW))
-                    ? "short"
-                    : "long");
-    ImGui::Text("Y: 0x%04x, %s", cpu.y,
-                (cpu.emulation_mode || get_status_bit(STATUS_XNARROW))
-                    ? "short"
-                    : "long");
-    ImGui::Text("D: 0x%04x", cpu.d);
-    ImGui::Text("SP: 0x%04x", cpu.s);
-    ImGui::Text("P: 0x%02x", cpu.p);
-    ImGui::Text("Data Bank: 0x%02x", cpu.dbr);
-    ImGui::Text("JOY1L: 0x%02x", cpu.memory.joy1l);
-    ImGui::Text("JOY1H: 0x%02x", cpu.memory.joy1h);
-    ImGui::Text("JOY2L: 0x%02x", cpu.memory.joy2l);
-    ImGui::Text("JOY2H: 0x%02x", cpu.memory.joy2h);
-    ImGui::Text("WRAM Address: 0x%06x", cpu.memory.ramaddr);
+    ImGui::Text("Mode: %s", snes->cpu.emulation_mode ? "emulation" : "native");
+    ImGui::Text(
+        "C: 0x%04x, %s", snes->cpu.c,
+        (snes->cpu.emulation_mode || get_status_bit(snes, STATUS_MEMNARROW))
+            ? "short"
+            : "long");
+    ImGui::Text(
+        "X: 0x%04x, %s", snes->cpu.x,
+        (snes->cpu.emulation_mode || get_status_bit(snes, STATUS_XNARROW))
+            ? "short"
+            : "long");
+    ImGui::Text(
+        "Y: 0x%04x, %s", snes->cpu.y,
+        (snes->cpu.emulation_mode || get_status_bit(snes, STATUS_XNARROW))
+            ? "short"
+            : "long");
+    ImGui::Text("D: 0x%04x", snes->cpu.d);
+    ImGui::Text("SP: 0x%04x", snes->cpu.s);
+    ImGui::Text("P: 0x%02x", cpu_get_p(snes));
+    ImGui::Text("Data Bank: 0x%02x", snes->cpu.dbr);
+    ImGui::Text("JOY1L: 0x%02x", snes->cpu.memory.joy1l);
+    ImGui::Text("JOY1H: 0x%02x", snes->cpu.memory.joy1h);
+    ImGui::Text("JOY2L: 0x%02x", snes->cpu.memory.joy2l);
+    ImGui::Text("JOY2H: 0x%02x", snes->cpu.memory.joy2h);
+    ImGui::Text("WRAM Address: 0x%06x", snes->cpu.memory.ramaddr);
 
     ImGui::NewLine();
+    // the index the core checks is only rebuilt when the list changes
+    bool changed = false;
     if (ImGui::Button("+##cpubpadd")) {
         cpu_bp.push_back(breakpoint_t{0, {0}, 0, 0, 0, 0});
-        cpu.breakpoints = cpu_bp.data();
-        cpu.breakpoints_size = cpu_bp.size();
+        changed = true;
     }
     bool remove = false;
     uint32_t to_remove = 0;
@@ -115,8 +160,9 @@ void cpu_window(void) {
         ImGui::Text("0x");
         ImGui::SameLine();
         ImGui::PushItemWidth(4 * ImGui::GetFontSize());
-        ImGui::InputText((std::string("##cpubpin") + std::to_string(i)).c_str(),
-                         cpu_bp[i].bp_inter, 7);
+        changed |= ImGui::InputText(
+            (std::string("##cpubpin") + std::to_string(i)).c_str(),
+            cpu_bp[i].bp_inter, 7);
         ImGui::PopItemWidth();
         cpu_bp[i].valid = true;
         for (char &c : cpu_bp[i].bp_inter) {
@@ -135,14 +181,17 @@ void cpu_window(void) {
             ImGui::SetCursorPosX(ImGui::GetCursorPosX() +
                                  ImGui::CalcTextSize(" Invalid!").x);
         }
-        ImGui::Checkbox((std::string("R##cpubpr") + std::to_string(i)).c_str(),
-                        &cpu_bp[i].read);
+        changed |= ImGui::Checkbox(
+            (std::string("R##cpubpr") + std::to_string(i)).c_str(),
+            &cpu_bp[i].read);
         ImGui::SameLine();
-        ImGui::Checkbox((std::string("W##cpubpw") + std::to_string(i)).c_str(),
-                        &cpu_bp[i].write);
+        changed |= ImGui::Checkbox(
+            (std::string("W##cpubpw") + std::to_string(i)).c_str(),
+            &cpu_bp[i].write);
         ImGui::SameLine();
-        ImGui::Checkbox((std::string("X##cpubpx") + std::to_string(i)).c_str(),
-                        &cpu_bp[i].execute);
+        changed |= ImGui::Checkbox(
+            (std::string("X##cpubpx") + std::to_string(i)).c_str(),
+            &cpu_bp[i].execute);
         ImGui::SameLine();
         if (ImGui::Button(
                 (std::string("-##cpubprm") + std::to_string(i)).c_str())) {
@@ -153,51 +202,55 @@ void cpu_window(void) {
 
     if (remove) {
         cpu_bp.erase(cpu_bp.begin() + to_remove);
-        cpu.breakpoints = cpu_bp.data();
-        cpu.breakpoints_size = cpu_bp.size();
+        changed = true;
     }
+    if (changed)
+        breakpoint_index_build(&snes->cpu.breakpoints, cpu_bp.data(),
+                               cpu_bp.size());
 
     ImGui::End();
 }
 
 void ppu_window(void) {
     ImGui::Begin("ppu", NULL, ImGuiWindowFlags_HorizontalScrollbar);
-    ImGui::Text("BG Mode: %d", ppu.bg_mode);
-    ImGui::Text("Brightness: %f", ppu.brightness / 15.f);
-    ImGui::Text("Fixed Color: 0x%08x", ppu.fixed_color_24bit);
-    ImGui::Text("VRAM Address: 0x%04x", ppu.vram_addr);
-    ImGui::Text("VRAM Address Remapping Index: %d", ppu.address_remapping);
+    ImGui::Text("BG Mode: %d", snes->ppu.bg_mode);
+    ImGui::Text("Brightness: %f", snes->ppu.brightness / 15.f);
+    ImGui::Text("Fixed Color: 0x%08x", snes->ppu.fixed_color_24bit);
+    ImGui::Text("VRAM Address: 0x%04x", snes->ppu.vram_addr);
+    ImGui::Text("VRAM Address Remapping Index: %d",
+                snes->ppu.address_remapping);
     ImGui::Text("VRAM Address Increment Amount Index: %d",
-                ppu.address_increment_amount);
-    ImGui::Text("Window 1: %d-%d", ppu.window_1_l, ppu.window_1_r);
-    ImGui::Text("Window 2: %d-%d", ppu.window_2_l, ppu.window_2_r);
-    ImGui::Text("Beam X: %d", ppu.beam_x);
-    ImGui::Text("Beam Y: %d", ppu.beam_y);
-    ImGui::Text("Overscan: %s", ppu.overscan ? "true" : "false");
-    ImGui::Text("H Timer Target: %d", ppu.h_timer_target);
-    ImGui::Text("V Timer Target: %d", ppu.v_timer_target);
-    ImGui::Text("Timer Target Mode: %d", cpu.timer_irq);
+                snes->ppu.address_increment_amount);
+    ImGui::Text("Window 1: %d-%d", snes->ppu.window_1_l, snes->ppu.window_1_r);
+    ImGui::Text("Window 2: %d-%d", snes->ppu.window_2_l, snes->ppu.window_2_r);
+    ImGui::Text("Beam X: %d", snes->ppu.beam_x);
+    ImGui::Text("Beam Y: %d", snes->ppu.beam_y);
+    ImGui::Text("Overscan: %s", snes->ppu.overscan ? "true" : "false");
+    ImGui::Text("H Timer Target: %d", snes->ppu.h_timer_target);
+    ImGui::Text("V Timer Target: %d", snes->ppu.v_timer_target);
+    ImGui::Text("Timer Target Mode: %d", snes->cpu.timer_irq);
     ImGui::Text("BG Mode 1 BG3 elevate: %s",
-                ppu.mode_1_bg3_prio ? "true" : "false");
+                snes->ppu.mode_1_bg3_prio ? "true" : "false");
     ImGui::Text("Color Math Color Source: %s",
-                ppu.addend_subscreen ? "Subscreen" : "Fixed Color");
+                snes->ppu.addend_subscreen ? "Subscreen" : "Fixed Color");
     std::string region_types[] = {"Nowhere", "Outside Window", "Inside Window",
                                   "Everywhere"};
     ImGui::Text("Color Math Main Black: %s",
-                region_types[ppu.main_window_black_region].c_str());
+                region_types[snes->ppu.main_window_black_region].c_str());
     ImGui::Text("Color Math Sub Transparent: %s",
-                region_types[ppu.sub_window_transparent_region].c_str());
-    if (ppu.bg_mode == 7) {
-        ImGui::Text("M7 X: %d", ppu.mode_7_center_x);
-        ImGui::Text("M7 Y: %d", ppu.mode_7_center_y);
-        ImGui::Text("M7 right -> right: %f", ppu.a_7);
-        ImGui::Text("M7 down -> right: %f", ppu.b_7);
-        ImGui::Text("M7 right -> down: %f", ppu.c_7);
-        ImGui::Text("M7 down -> down: %f", ppu.d_7);
+                region_types[snes->ppu.sub_window_transparent_region].c_str());
+    if (snes->ppu.bg_mode == 7) {
+        ImGui::Text("M7 X: %d", snes->ppu.mode_7_center_x);
+        ImGui::Text("M7 Y: %d", snes->ppu.mode_7_center_y);
+        ImGui::Text("M7 right -> right: %f", snes->ppu.a_7 / 256.f);
+        ImGui::Text("M7 down -> right: %f", snes->ppu.b_7 / 256.f);
+        ImGui::Text("M7 right -> down: %f", snes->ppu.c_7 / 256.f);
+        ImGui::Text("M7 down -> down: %f", snes->ppu.d_7 / 256.f);
         ImGui::Text("M7 Tilemap Repeat: %s",
-                    ppu.mode_7_tilemap_repeat ? "true" : "false");
-        ImGui::Text("M7 Non-Tilemap Fill: %s",
-                    ppu.mode_7_non_tilemap_fill ? "Char 0" : "Transparent");
+                    snes->ppu.mode_7_tilemap_repeat ? "true" : "false");
+        ImGui::Text("M7 Non-Tilemap Fill: %s", snes->ppu.mode_7_non_tilemap_fill
+                                                   ? "Char 0"
+                                                   : "Transparent");
     }
     ImGui::End();
 }
@@ -207,15 +260,15 @@ void bg_window(void) {
     ImGui::Begin("bg", NULL, ImGuiWindowFlags_HorizontalScrollbar);
 
     ImGui::Text("Disable:");
-    ImGui::Checkbox("BG1", &ppu.enable_bg_override[0]);
+    ImGui::Checkbox("BG1", &snes->ppu.enable_bg_override[0]);
     ImGui::SameLine();
-    ImGui::Checkbox("BG2", &ppu.enable_bg_override[1]);
+    ImGui::Checkbox("BG2", &snes->ppu.enable_bg_override[1]);
     ImGui::SameLine();
-    ImGui::Checkbox("BG3", &ppu.enable_bg_override[2]);
+    ImGui::Checkbox("BG3", &snes->ppu.enable_bg_override[2]);
     ImGui::SameLine();
-    ImGui::Checkbox("BG4", &ppu.enable_bg_override[3]);
+    ImGui::Checkbox("BG4", &snes->ppu.enable_bg_override[3]);
     ImGui::SameLine();
-    ImGui::Checkbox("OBJ", &ppu.enable_obj_override);
+    ImGui::Checkbox("OBJ", &snes->ppu.enable_obj_override);
 
     ImGui::InputInt("BG Layer", &bg_selected, 1, 1,
                     ImGuiInputTextFlags_CharsDecimal);
@@ -225,27 +278,33 @@ void bg_window(void) {
         bg_selected = 0;
 
     ImGui::Text("Main: %sabled",
-                ppu.bg_config[bg_selected].main_screen_enable ? "en" : "dis");
+                snes->ppu.bg_config[bg_selected].main_screen_enable ? "en"
+                                                                    : "dis");
     ImGui::Text("Sub:  %sabled",
-                ppu.bg_config[bg_selected].sub_screen_enable ? "en" : "dis");
+                snes->ppu.bg_config[bg_selected].sub_screen_enable ? "en"
+                                                                   : "dis");
     ImGui::Text("Tile Data Addr: 0x%02x",
-                ppu.bg_config[bg_selected].tiledata_addr);
+                snes->ppu.bg_config[bg_selected].tiledata_addr);
     ImGui::Text("Tile Map Addr: 0x%02x",
-                ppu.bg_config[bg_selected].tilemap_addr);
-    ImGui::Text("h: %d, v: %d", ppu.bg_config[bg_selected].double_h_tilemap + 1,
-                ppu.bg_config[bg_selected].double_v_tilemap + 1);
-    ImGui::Text("X Scroll: %d", ppu.bg_config[bg_selected].h_scroll);
-    ImGui::Text("Y Scroll: %d", ppu.bg_config[bg_selected].v_scroll);
+                snes->ppu.bg_config[bg_selected].tilemap_addr);
+    ImGui::Text("h: %d, v: %d",
+                snes->ppu.bg_config[bg_selected].double_h_tilemap + 1,
+                snes->ppu.bg_config[bg_selected].double_v_tilemap + 1);
+    ImGui::Text("X Scroll: %d", snes->ppu.bg_config[bg_selected].h_scroll);
+    ImGui::Text("Y Scroll: %d", snes->ppu.bg_config[bg_selected].v_scroll);
     ImGui::Text("Tile Size: %dpx",
-                ppu.bg_config[bg_selected].large_characters ? 16 : 8);
+                snes->ppu.bg_config[bg_selected].large_characters ? 16 : 8);
     ImGui::Text("Window 1 %sabled%s",
-                ppu.bg_config[bg_selected].window_1_enable ? "en" : "dis",
-                ppu.bg_config[bg_selected].window_1_invert ? ", inverted" : "");
+                snes->ppu.bg_config[bg_selected].window_1_enable ? "en" : "dis",
+                snes->ppu.bg_config[bg_selected].window_1_invert ? ", inverted"
+                                                                 : "");
     ImGui::Text("Window 2 %sabled%s",
-                ppu.bg_config[bg_selected].window_2_enable ? "en" : "dis",
-                ppu.bg_config[bg_selected].window_2_invert ? ", inverted" : "");
+                snes->ppu.bg_config[bg_selected].window_2_enable ? "en" : "dis",
+                snes->ppu.bg_config[bg_selected].window_2_invert ? ", inverted"
+                                                                 : "");
     ImGui::Text("Color Math %sabled",
-                ppu.bg_config[bg_selected].color_math_enable ? "en" : "dis");
+                snes->ppu.bg_config[bg_selected].color_math_enable ? "en"
+                                                                   : "dis");
     ImGui::End();
 }
 
@@ -263,7 +322,8 @@ void vram_window(void) {
         for (uint16_t i = 0; i < 16; i++) {
             for (uint8_t j = 0; j < 16; j++) {
                 ImGui::TableNextColumn();
-                ImGui::Text("%02x", ppu.vram[vram_page * 0x100 + i * 16 + j]);
+                ImGui::Text("%02x",
+                            snes->ppu.vram[vram_page * 0x100 + i * 16 + j]);
                 if (ImGui::IsItemHovered()) {
                     ImGui::SetTooltip("0x%04x", vram_page * 0x100 + i * 16 + j);
                 }
@@ -278,11 +338,12 @@ void vram_window(void) {
 
 void oam_window(void) {
     ImGui::Begin("oam", NULL, ImGuiWindowFlags_HorizontalScrollbar);
-    ImGui::Text("DEF Nametable: 0x%04x", ppu.obj_name_base_address << 14);
-    ImGui::Text("ALT Nametable: 0x%04x", (ppu.obj_name_base_address << 14) +
-                                             ((ppu.obj_name_select + 1) << 13));
-    ImGui::Text("Sprite size index: %d", ppu.obj_sprite_size);
-    ImGui::Text("OAM Address: 0x%04x", ppu.oam_addr);
+    ImGui::Text("DEF Nametable: 0x%04x", snes->ppu.obj_name_base_address << 14);
+    ImGui::Text("ALT Nametable: 0x%04x",
+                (snes->ppu.obj_name_base_address << 14) +
+                    ((snes->ppu.obj_name_select + 1) << 13));
+    ImGui::Text("Sprite size index: %d", snes->ppu.obj_sprite_size);
+    ImGui::Text("OAM Address: 0x%04x", snes->ppu.oam_addr);
     if (ImGui::BeginTable("##oam", 6,
                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
         ImGui::TableSetupColumn("X", ImGuiTableColumnFlags_WidthFixed);
@@ -296,18 +357,19 @@ void oam_window(void) {
         ImGui::TableNextRow();
         for (uint16_t i = 0; i < 128; i++) {
             ImGui::TableNextColumn();
-            ImGui::Text("%4d", ppu.oam[i].x);
+            ImGui::Text("%4d", snes->ppu.oam[i].x);
             ImGui::TableNextColumn();
-            ImGui::Text("%4d", ppu.oam[i].y);
+            ImGui::Text("%4d", snes->ppu.oam[i].y);
             ImGui::TableNextColumn();
-            ImGui::Text("0x%03x", ppu.oam[i].tile_idx |
-                                      (ppu.oam[i].use_second_sprite_page << 8));
+            ImGui::Text("0x%03x",
+                        snes->ppu.oam[i].tile_idx |
+                            (snes->ppu.oam[i].use_second_sprite_page << 8));
             ImGui::TableNextColumn();
-            ImGui::Text("0x%02x", ppu.oam[i].palette);
+            ImGui::Text("0x%02x", snes->ppu.oam[i].palette);
             ImGui::TableNextColumn();
-            ImGui::Text("%c", ppu.oam[i].use_second_size ? 'X' : ' ');
+            ImGui::Text("%c", snes->ppu.oam[i].use_second_size ? 'X' : ' ');
             ImGui::TableNextColumn();
-            ImGui::Text("%d", ppu.oam[i].priority);
+            ImGui::Text("%d", snes->ppu.oam[i].priority);
 
             if (i != 127) {
                 ImGui::TableNextRow();
@@ -325,7 +387,7 @@ void col_window(void) {
         for (uint16_t i = 0; i < 64; i++) {
             for (uint8_t j = 0; j < 4; j++) {
                 ImGui::TableNextColumn();
-                ImGui::Text("%08x", ppu.cgram[i * 4 + j]);
+                ImGui::Text("%08x", snes->ppu.cgram[i * 4 + j]);
                 if (ImGui::IsItemHovered()) {
                     ImGui::SetTooltip("0x%02x", i * 4 + j);
                 }
@@ -347,36 +409,40 @@ void dma_window(void) {
         dma_selected = 0;
     if (dma_selected > 7)
         dma_selected = 7;
-    ImGui::Text("HDMA: %s",
-                cpu.memory.dmas[dma_selected].hdma_enable ? "true" : "false");
-    ImGui::Text("Direction: %s",
-                cpu.memory.dmas[dma_selected].direction ? "B -> A" : "A -> B");
+    ImGui::Text("HDMA: %s", snes->cpu.memory.dmas[dma_selected].hdma_enable
+                                ? "true"
+                                : "false");
+    ImGui::Text("Direction: %s", snes->cpu.memory.dmas[dma_selected].direction
+                                     ? "B -> A"
+                                     : "A -> B");
     ImGui::Text("Transfer pattern: %d",
-                cpu.memory.dmas[dma_selected].transfer_pattern);
-    if (cpu.memory.dmas[dma_selected].hdma_enable) {
+                snes->cpu.memory.dmas[dma_selected].transfer_pattern);
+    if (snes->cpu.memory.dmas[dma_selected].hdma_enable) {
         ImGui::Text("HDMA Indirect: %s",
-                    cpu.memory.dmas[dma_selected].indirect_hdma ? "true"
-                                                                : "false");
+                    snes->cpu.memory.dmas[dma_selected].indirect_hdma
+                        ? "true"
+                        : "false");
         ImGui::Text("HDMA Scanlines Left: %d",
-                    cpu.memory.dmas[dma_selected].scanlines_left);
+                    snes->cpu.memory.dmas[dma_selected].scanlines_left);
         ImGui::Text("HDMA Repeat: %s",
-                    cpu.memory.dmas[dma_selected].hdma_repeat ? "yes" : "no");
+                    snes->cpu.memory.dmas[dma_selected].hdma_repeat ? "yes"
+                                                                    : "no");
         ImGui::Text("HDMA Indirect Address: 0x%06x",
-                    cpu.memory.dmas[dma_selected].dma_byte_count);
+                    snes->cpu.memory.dmas[dma_selected].dma_byte_count);
         ImGui::Text("HDMA Table Current Address: 0x%06x",
-                    cpu.memory.dmas[dma_selected].hdma_current_address);
+                    snes->cpu.memory.dmas[dma_selected].hdma_current_address);
         ImGui::Text("HDMA Table Start Address: 0x%06x",
-                    cpu.memory.dmas[dma_selected].dma_src_addr);
+                    snes->cpu.memory.dmas[dma_selected].dma_src_addr);
     } else {
         ImGui::Text("DMA Address adjust mode: %d",
-                    cpu.memory.dmas[dma_selected].addr_inc_mode);
+                    snes->cpu.memory.dmas[dma_selected].addr_inc_mode);
         ImGui::Text("DMA Byte Count: 0x%04x",
-                    cpu.memory.dmas[dma_selected].dma_byte_count);
+                    snes->cpu.memory.dmas[dma_selected].dma_byte_count);
         ImGui::Text("DMA A Address: 0x%06x",
-                    cpu.memory.dmas[dma_selected].dma_src_addr);
+                    snes->cpu.memory.dmas[dma_selected].dma_src_addr);
     }
     ImGui::Text("B Address: 0x%04x",
-                0x2100 + cpu.memory.dmas[dma_selected].b_bus_addr);
+                0x2100 + snes->cpu.memory.dmas[dma_selected].b_bus_addr);
     ImGui::End();
 }
 
@@ -384,31 +450,33 @@ std::vector<breakpoint_t> spc_bp;
 void spc_window(void) {
     ImGui::Begin("spc", NULL, ImGuiWindowFlags_HorizontalScrollbar);
     if (ImGui::Button("Start"))
-        cpu.state = STATE_RUNNING;
+        snes->cpu.state = STATE_RUNNING;
     ImGui::SameLine();
     if (ImGui::Button("Stop"))
-        cpu.state = STATE_STOPPED;
+        snes->cpu.state = STATE_STOPPED;
     ImGui::SameLine();
     if (ImGui::Button("Step"))
-        cpu.state = STATE_SPC_STEPPED;
-    ImGui::Text("PC: 0x%04x Opcode: 0x%02x", spc.pc, spc_read_8_no_log(spc.pc));
-    ImGui::Text("A: 0x%02x", spc.a);
-    ImGui::Text("X: 0x%02x", spc.x);
-    ImGui::Text("Y: 0x%02x", spc.y);
-    ImGui::Text("SP: 0x%02x", spc.s);
-    ImGui::Text("P: 0x%02x", spc.p);
-    ImGui::Text("CPU Bus Tx: 0x%02x 0x%02x 0x%02x 0x%02x", spc.memory.ram[0xf4],
-                spc.memory.ram[0xf5], spc.memory.ram[0xf6],
-                spc.memory.ram[0xf7]);
-    ImGui::Text("CPU Bus Rx: 0x%02x 0x%02x 0x%02x 0x%02x", cpu.memory.apu_io[0],
-                cpu.memory.apu_io[1], cpu.memory.apu_io[2],
-                cpu.memory.apu_io[3]);
+        snes->cpu.state = STATE_SPC_STEPPED;
+    ImGui::Text("PC: 0x%04x Opcode: 0x%02x", snes->spc.pc,
+                spc_read_8_no_log(snes, snes->spc.pc));
+    ImGui::Text("A: 0x%02x", snes->spc.a);
+    ImGui::Text("X: 0x%02x", snes->spc.x);
+    ImGui::Text("Y: 0x%02x", snes->spc.y);
+    ImGui::Text("SP: 0x%02x", snes->spc.s);
+    ImGui::Text("P: 0x%02x", spc_get_p(snes));
+    ImGui::Text("CPU Bus Tx: 0x%02x 0x%02x 0x%02x 0x%02x",
+                snes->spc.memory.ram[0xf4], snes->spc.memory.ram[0xf5],
+                snes->spc.memory.ram[0xf6], snes->spc.memory.ram[0xf7]);
+    ImGui::Text("CPU Bus Rx: 0x%02x 0x%02x 0x%02x 0x%02x",
+                snes->cpu.memory.apu_io[0], snes->cpu.memory.apu_io[1],
+                snes->cpu.memory.apu_io[2], snes->cpu.memory.apu_io[3]);
     ImGui::NewLine();
 
+    // the index the core checks is only rebuilt when the list changes
+    bool changed = false;
     if (ImGui::Button("+##spcbpadd")) {
         spc_bp.push_back(breakpoint_t{0, {0}, 0, 0, 0, 0});
-        spc.breakpoints = spc_bp.data();
-        spc.breakpoints_size = spc_bp.size();
+        changed = true;
     }
     bool remove = false;
     uint32_t to_remove = 0;
@@ -416,8 +484,9 @@ void spc_window(void) {
         ImGui::Text("0x");
         ImGui::SameLine();
         ImGui::PushItemWidth(4 * ImGui::GetFontSize());
-        ImGui::InputText((std::string("##spcbpin") + std::to_string(i)).c_str(),
-                         spc_bp[i].bp_inter, 7);
+        changed |= ImGui::InputText(
+            (std::string("##spcbpin") + std::to_string(i)).c_str(),
+            spc_bp[i].bp_inter, 7);
         ImGui::PopItemWidth();
         spc_bp[i].valid = true;
         for (char &c : spc_bp[i].bp_inter) {
@@ -436,14 +505,17 @@ void spc_window(void) {
             ImGui::SetCursorPosX(ImGui::GetCursorPosX() +
                                  ImGui::CalcTextSize(" Invalid!").x);
         }
-        ImGui::Checkbox((std::string("R##spcbpr") + std::to_string(i)).c_str(),
-                        &spc_bp[i].read);
+        changed |= ImGui::Checkbox(
+            (std::string("R##spcbpr") + std::to_string(i)).c_str(),
+            &spc_bp[i].read);
         ImGui::SameLine();
-        ImGui::Checkbox((std::string("W##spcbpw") + std::to_string(i)).c_str(),
-                        &spc_bp[i].write);
+        changed |= ImGui::Checkbox(
+            (std::string("W##spcbpw") + std::to_string(i)).c_str(),
+            &spc_bp[i].write);
         ImGui::SameLine();
-        ImGui::Checkbox((std::string("X##spcbpx") + std::to_string(i)).c_str(),
-                        &spc_bp[i].execute);
+        changed |= ImGui::Checkbox(
+            (std::string("X##spcbpx") + std::to_string(i)).c_str(),
+            &spc_bp[i].execute);
         ImGui::SameLine();
         if (ImGui::Button(
                 (std::string("-##spcbprm") + std::to_string(i)).c_str())) {
@@ -454,27 +526,29 @@ void spc_window(void) {
 
     if (remove) {
         spc_bp.erase(spc_bp.begin() + to_remove);
-        spc.breakpoints = spc_bp.data();
-        spc.breakpoints_size = spc_bp.size();
+        changed = true;
     }
+    if (changed)
+        breakpoint_index_build(&snes->spc.breakpoints, spc_bp.data(),
+                               spc_bp.size());
 
     ImGui::NewLine();
 
     ImGui::Text("Timer 0 enable: %s",
-                spc.memory.timers[0].enable ? "true" : "false");
-    ImGui::Text("Timer 0 timer: %d", spc.memory.timers[0].timer_internal);
-    ImGui::Text("Timer 0 modulo: %d", spc.memory.timers[0].timer);
-    ImGui::Text("Timer 0 counter: %d", spc.memory.timers[0].counter);
+                snes->spc.memory.timers[0].enable ? "true" : "false");
+    ImGui::Text("Timer 0 timer: %d", snes->spc.memory.timers[0].timer_internal);
+    ImGui::Text("Timer 0 modulo: %d", snes->spc.memory.timers[0].timer);
+    ImGui::Text("Timer 0 counter: %d", snes->spc.memory.timers[0].counter);
     ImGui::Text("Timer 1 enable: %s",
-                spc.memory.timers[1].enable ? "true" : "false");
-    ImGui::Text("Timer 1 timer: %d", spc.memory.timers[1].timer_internal);
-    ImGui::Text("Timer 1 modulo: %d", spc.memory.timers[1].timer);
-    ImGui::Text("Timer 1 counter: %d", spc.memory.timers[1].counter);
+                snes->spc.memory.timers[1].enable ? "true" : "false");
+    ImGui::Text("Timer 1 timer: %d", snes->spc.memory.timers[1].timer_internal);
+    ImGui::Text("Timer 1 modulo: %d", snes->spc.memory.timers[1].timer);
+    ImGui::Text("Timer 1 counter: %d", snes->spc.memory.timers[1].counter);
     ImGui::Text("Timer 2 enable: %s",
-                spc.memory.timers[2].enable ? "true" : "false");
-    ImGui::Text("Timer 2 timer: %d", spc.memory.timers[2].timer_internal);
-    ImGui::Text("Timer 2 modulo: %d", spc.memory.timers[2].timer);
-    ImGui::Text("Timer 2 counter: %d", spc.memory.timers[2].counter);
+                snes->spc.memory.timers[2].enable ? "true" : "false");
+    ImGui::Text("Timer 2 timer: %d", snes->spc.memory.timers[2].timer_internal);
+    ImGui::Text("Timer 2 modulo: %d", snes->spc.memory.timers[2].timer);
+    ImGui::Text("Timer 2 counter: %d", snes->spc.memory.timers[2].counter);
     ImGui::End();
 }
 
@@ -492,8 +566,9 @@ void spc_ram_window(void) {
         for (uint16_t i = 0; i < 16; i++) {
             for (uint8_t j = 0; j < 16; j++) {
                 ImGui::TableNextColumn();
-                ImGui::Text("%02x",
-                            spc.memory.ram[spc_ram_page * 0x100 + i * 16 + j]);
+                ImGui::Text(
+                    "%02x",
+                    snes->spc.memory.ram[spc_ram_page * 0x100 + i * 16 + j]);
                 if (ImGui::IsItemHovered()) {
                     ImGui::SetTooltip("0x%04x",
                                       spc_ram_page * 0x100 + i * 16 + j);
@@ -531,9 +606,10 @@ void cpu_ram_window(void) {
         for (uint16_t i = 0; i < 16; i++) {
             for (uint8_t j = 0; j < 16; j++) {
                 ImGui::TableNextColumn();
-                ImGui::Text("%02x",
-                            cpu.memory.ram[cpu_ram_bank * 0x10000 +
-                                           cpu_ram_page * 0x100 + i * 16 + j]);
+                ImGui::Text(
+                    "%02x",
+                    snes->cpu.memory.ram[cpu_ram_bank * 0x10000 +
+                                         cpu_ram_page * 0x100 + i * 16 + j]);
                 if (ImGui::IsItemHovered()) {
                     ImGui::SetTooltip("0x%06x", cpu_ram_bank * 0x10000 +
                                                     cpu_ram_page * 0x100 +
@@ -565,8 +641,8 @@ void cpu_sram_window(void) {
     }
     if (cpu_sram_bank < 0)
         cpu_sram_bank = 0;
-    if ((uint32_t)cpu_sram_bank > cpu.memory.sram_size / 0x10000 - 1)
-        cpu_sram_bank = cpu.memory.sram_size / 0x10000 - 1;
+    if ((uint32_t)cpu_sram_bank > snes->cpu.memory.sram_size / 0x10000 - 1)
+        cpu_sram_bank = snes->cpu.memory.sram_size / 0x10000 - 1;
     if (ImGui::BeginTable("##cpusram", 16,
                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
         for (uint16_t i = 0; i < 16; i++) {
@@ -574,8 +650,8 @@ void cpu_sram_window(void) {
                 ImGui::TableNextColumn();
                 ImGui::Text(
                     "%02x",
-                    cpu.memory.sram[cpu_sram_bank * 0x10000 +
-                                    cpu_sram_page * 0x100 + i * 16 + j]);
+                    snes->cpu.memory.sram[cpu_sram_bank * 0x10000 +
+                                          cpu_sram_page * 0x100 + i * 16 + j]);
                 if (ImGui::IsItemHovered()) {
                     ImGui::SetTooltip("0x%06x", cpu_sram_bank * 0x10000 +
                                                     cpu_sram_page * 0x100 +
@@ -615,8 +691,8 @@ void cpu_rom_window(void) {
         cpu_rom_bank = 0xff;
     if (ImGui::BeginTable("##cpurom", 16,
                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
-        uint32_t (*resolver)(uint32_t, bool);
-        switch (cpu.memory.mode) {
+        uint32_t (*resolver)(snes_t *, uint32_t, bool);
+        switch (snes->cpu.memory.mode) {
         case LOROM:
             resolver = lo_rom_resolve;
             break;
@@ -630,7 +706,8 @@ void cpu_rom_window(void) {
         for (uint16_t i = 0; i < 16; i++) {
             for (uint8_t j = 0; j < 16; j++) {
                 ImGui::TableNextColumn();
-                ImGui::Text("%02x", cpu.memory.rom[resolver(
+                ImGui::Text("%02x", snes->cpu.memory.rom[resolver(
+                                        snes,
                                         cpu_rom_bank * 0x10000 +
                                             cpu_rom_page * 0x100 + i * 16 + j,
                                         false)]);
@@ -652,35 +729,41 @@ int dsp_selected = 0;
 void dsp_window(void) {
     ImGui::Begin("dsp", NULL, ImGuiWindowFlags_HorizontalScrollbar);
     ImGui::Text("Sample Directory Page: 0x%04x",
-                spc.memory.sample_source_directory_page << 8);
+                snes->spc.memory.sample_source_directory_page << 8);
     ImGui::InputInt("Channel", &dsp_selected, 1, 1,
                     ImGuiInputTextFlags_CharsDecimal);
     if (dsp_selected > 7)
         dsp_selected = 7;
     if (dsp_selected < 0)
         dsp_selected = 0;
-    if (spc.memory.channels[dsp_selected].playing) {
+    if (snes->spc.memory.channels[dsp_selected].playing) {
         ImGui::TextColored(ImVec4{0x00, 0xff, 0x00, 0xff}, "Enabled");
     } else {
         ImGui::TextColored(ImVec4{0xff, 0x00, 0x00, 0xff}, "Disabled");
     }
-    ImGui::Text("Volume left: %d", spc.memory.channels[dsp_selected].vol_left);
+    ImGui::Text("Volume left: %d",
+                snes->spc.memory.channels[dsp_selected].vol_left);
     ImGui::Text("Volume right: %d",
-                spc.memory.channels[dsp_selected].vol_right);
-    ImGui::Text("Pitch: %d", spc.memory.channels[dsp_selected].pitch);
-    ImGui::Text("Sample Source Directory: 0x%02x",
-                spc.memory.channels[dsp_selected].sample_source_directory);
-    ImGui::Text("Use Noise Generator: %s", spc.memory.channels[dsp_selected].noise_enable ? "true" : "false");
-    ImGui::Text("Noise Frequency Index: %d", spc.memory.noise_freq);
+                snes->spc.memory.channels[dsp_selected].vol_right);
+    ImGui::Text("Pitch: %d", snes->spc.memory.channels[dsp_selected].pitch);
+    ImGui::Text(
+        "Sample Source Directory: 0x%02x",
+        snes->spc.memory.channels[dsp_selected].sample_source_directory);
+    ImGui::Text("Use Noise Generator: %s",
+                snes->spc.memory.channels[dsp_selected].noise_enable ? "true"
+                                                                     : "false");
+    ImGui::Text("Noise Frequency Index: %d", snes->spc.memory.noise_freq);
     ImGui::Text("ADSR %sabled",
-                spc.memory.channels[dsp_selected].adsr_enable ? "en" : "dis");
-    if (spc.memory.channels[dsp_selected].adsr_enable) {
-        ImGui::Text(" A: %d", spc.memory.channels[dsp_selected].a_rate);
-        ImGui::Text(" D: %d", spc.memory.channels[dsp_selected].d_rate);
-        ImGui::Text("SL: %d", spc.memory.channels[dsp_selected].s_level);
-        ImGui::Text("SR: %d", spc.memory.channels[dsp_selected].s_rate);
-    }
-    ImGui::Text("Envelope: %d", spc.memory.channels[dsp_selected].envelope);
+                snes->spc.memory.channels[dsp_selected].adsr_enable ? "en"
+                                                                    : "dis");
+    if (snes->spc.memory.channels[dsp_selected].adsr_enable) {
+        ImGui::Text(" A: %d", snes->spc.memory.channels[dsp_selected].a_rate);
+        ImGui::Text(" D: %d", snes->spc.memory.channels[dsp_selected].d_rate);
+        ImGui::Text("SL: %d", snes->spc.memory.channels[dsp_selected].s_level);
+        ImGui::Text("SR: %d", snes->spc.memory.channels[dsp_selected].s_rate);
+    }
+    ImGui::Text("Envelope: %d",
+                snes->spc.memory.channels[dsp_selected].envelope);
     ImGui::End();
 }
 
@@ -688,17 +771,144 @@ void mute_window(void) {
     ImGui::Begin("mute");
     for (int i = 0; i < 8; i++) {
         ImGui::Checkbox(std::to_string(i + 1).c_str(),
-                        &spc.memory.channels[i].mute_override);
+                        &snes->spc.memory.channels[i].mute_override);
+    }
+    ImGui::End();
+}
+
+void timing_window(void) {
+    ImGui::Begin("timing");
+    bool enabled = snes->timing.enabled;
+    if (ImGui::Checkbox("Enabled", &enabled))
+        timing_enable(snes, enabled);
+    ImGui::Text("Frame: p50 %.3f ms, p99 %.3f ms",
+                timing_percentile(snes, TIMING_SECTIONS, 0.5f),
+                timing_percentile(snes, TIMING_SECTIONS, 0.99f));
+    uint32_t count = std::min<uint32_t>(snes->timing.frames, TIMING_HISTORY);
+    uint32_t offset = snes->timing.frames > TIMING_HISTORY
+                          ? snes->timing.frames % TIMING_HISTORY
+                          : 0;
+    for (uint32_t i = 0; i <= TIMING_SECTIONS; i++) {
+        const char *name = timing_section_name(i);
+        std::string overlay = std::string(name) + ": p50 " +
+                              std::to_string(timing_percentile(snes, i, 0.5f)) +
+                              " p99 " +
+                              std::to_string(timing_percentile(snes, i, 0.99f));
+        ImGui::PlotHistogram(("##timing_" + std::string(name)).c_str(),
+                             &snes->timing.history[0][i], count, offset,
+                             overlay.c_str(), 0.f, FLT_MAX, ImVec2(0, 60),
+                             sizeof(snes->timing.history[0]));
+    }
+    ImGui::End();
+}
+
+struct profile_row_t {
+    std::string name;
+    profile_entry_t entry;
+};
+
+static void profile_table(const char *id, std::vector<profile_row_t> rows) {
+    std::sort(rows.begin(), rows.end(),
+              [](auto &a, auto &b) { return a.entry.ns > b.entry.ns; });
+    if (ImGui::BeginTable(id, 4,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("Time (ms)");
+        ImGui::TableSetupColumn("ns/exec");
+        ImGui::TableHeadersRow();
+        for (size_t i = 0; i < rows.size() && i < 32; i++) {
+            if (rows[i].entry.count == 0)
+                break;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", rows[i].name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)rows[i].entry.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", rows[i].entry.ns / 1e6);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", (double)rows[i].entry.ns / rows[i].entry.count);
+        }
+        ImGui::EndTable();
     }
+}
+
+// adds entry to the row called name, creating it if needed
+static void profile_add(std::vector<profile_row_t> &rows, std::string name,
+                        profile_entry_t entry) {
+    for (auto &row : rows) {
+        if (row.name == name) {
+            row.entry.count += entry.count;
+            row.entry.ns += entry.ns;
+            return;
+        }
+    }
+    rows.push_back({name, entry});
+}
+
+void profiler_window(void) {
+    ImGui::Begin("profiler", NULL, ImGuiWindowFlags_HorizontalScrollbar);
+    bool enabled = snes->profiler.enabled;
+    if (ImGui::Checkbox("Enabled", &enabled))
+        profiler_enable(snes, enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+        profiler_enable(snes, snes->profiler.enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV")) {
+        profiler_write_csv(
+            snes, (std::string(snes->cpu.file_name) + ".profile.csv").c_str());
+    }
+
+    std::vector<profile_row_t> cpu_opcodes, cpu_modes, cpu_flags, spc_opcodes,
+        spc_modes;
+    for (uint32_t flags = 0; flags < 8; flags++) {
+        char flags_name[16];
+        snprintf(flags_name, sizeof(flags_name), "M%d X%d E%d", flags & 1,
+                 (flags >> 1) & 1, (flags >> 2) & 1);
+        for (uint32_t i = 0; i < 0x100; i++) {
+            profile_entry_t entry = snes->profiler.cpu[flags][i];
+            if (entry.count == 0)
+                continue;
+            char opcode_name[32];
+            snprintf(opcode_name, sizeof(opcode_name), "%02x %s %s", i,
+                     profiler_cpu_name(i), profiler_cpu_mode(i));
+            profile_add(cpu_opcodes, opcode_name, entry);
+            profile_add(cpu_modes, profiler_cpu_mode(i), entry);
+            profile_add(cpu_flags, flags_name, entry);
+        }
+    }
+    for (uint32_t i = 0; i < 0x100; i++) {
+        profile_entry_t entry = snes->profiler.spc[i];
+        if (entry.count == 0)
+            continue;
+        char opcode_name[48];
+        snprintf(opcode_name, sizeof(opcode_name), "%02x %s %s", i,
+                 profiler_spc_name(i), profiler_spc_mode(i));
+        profile_add(spc_opcodes, opcode_name, entry);
+        profile_add(spc_modes, profiler_spc_mode(i), entry);
+    }
+
+    ImGui::Text("CPU opcodes:");
+    profile_table("##cpu_opcodes", cpu_opcodes);
+    ImGui::Text("CPU addressing modes:");
+    profile_table("##cpu_modes", cpu_modes);
+    ImGui::Text("CPU flags:");
+    profile_table("##cpu_flags", cpu_flags);
+    ImGui::Text("SPC opcodes:");
+    profile_table("##spc_opcodes", spc_opcodes);
+    ImGui::Text("SPC addressing modes:");
+    profile_table("##spc_modes", spc_modes);
     ImGui::End();
 }
+
 extern "C" {
-void cpp_init(void) {
+void cpp_init(snes_t *machine) {
+    snes = machine;
     rlImGuiSetup(true);
     ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
     ImGui::GetIO().FontGlobalScale *= 2;
-    cpu.breakpoints = cpu_bp.data();
-    cpu.breakpoints_size = cpu_bp.size();
 }
 
 void cpp_imgui_render(void) {
@@ -712,13 +922,15 @@ void cpp_imgui_render(void) {
     oam_window();
     col_window();
     cpu_ram_window();
-    if (cpu.memory.sram_size > 0) {
+    if (snes->cpu.memory.sram_size > 0) {
         cpu_sram_window();
     }
     cpu_rom_window();
     cpu_window();
     dsp_window();
     mute_window();
+    timing_window();
+    profiler_window();
     rlImGuiEnd();
 }
 